@@ -133,7 +133,9 @@ struct block_t
  *      be done with i_buffer = i_body).
  *      with preheader and or body (increase
  *      and decrease are supported). Use it as it is optimised.
- * - block_Duplicate : create a copy of a block.
+ * - block_Duplicate : create a copy of a block (a reference if it is shared).
+ * - block_Share : turn a block into a read-only, reference-counted block.
+ * - block_Writable : get a block whose payload can be modified in place.
  ****************************************************************************/
 VLC_API void block_Init( block_t *, void *, size_t );
 VLC_API block_t *block_Alloc( size_t ) VLC_USED VLC_MALLOC;
@@ -148,18 +150,10 @@ static inline void block_CopyProperties( block_t *dst, block_t *src )
     dst->i_length  = src->i_length;
 }
 
-VLC_USED
-static inline block_t *block_Duplicate( block_t *p_block )
-{
-    block_t *p_dup = block_Alloc( p_block->i_buffer );
-    if( p_dup == NULL )
-        return NULL;
-
-    block_CopyProperties( p_dup, p_block );
-    memcpy( p_dup->p_buffer, p_block->p_buffer, p_block->i_buffer );
-
-    return p_dup;
-}
+VLC_API block_t *block_Duplicate( block_t * ) VLC_USED;
+VLC_API block_t *block_Share( block_t * ) VLC_USED;
+VLC_API block_t *block_Writable( block_t * ) VLC_USED;
+VLC_API bool block_IsShared( const block_t * ) VLC_USED;
 
 static inline void block_Release( block_t *p_block )
 {
@@ -294,6 +288,8 @@ static inline block_t *block_ChainGather( block_t *p_list )
  * Fifos of blocks.
  ****************************************************************************
  * - block_FifoNew : create and init a new fifo
+ * - block_FifoNewSPSC : create a fifo for one producer and one consumer
+ *      thread, which does not lock in the common case
  * - block_FifoRelease : destroy a fifo and free all blocks in it.
  * - block_FifoPace : wait for a fifo to drain to a specified number of packets or total data size
  * - block_FifoEmpty : free all blocks in a fifo
@@ -308,6 +304,7 @@ static inline block_t *block_ChainGather( block_t *p_list )
  ****************************************************************************/
 
 VLC_API block_fifo_t *block_FifoNew( void ) VLC_USED VLC_MALLOC;
+VLC_API block_fifo_t *block_FifoNewSPSC( void ) VLC_USED VLC_MALLOC;
 VLC_API void block_FifoRelease( block_fifo_t * );
 VLC_API void block_FifoPace( block_fifo_t *fifo, size_t max_depth, size_t max_size );
 VLC_API void block_FifoEmpty( block_fifo_t * );
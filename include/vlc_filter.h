@@ -270,6 +270,85 @@ VLC_API void filter_DeleteBlend( filter_t * );
         return p_outpic;                                                \
     }
 
+/**
+ * It runs a slice function on horizontal slices of a picture.
+ *
+ * pf_slice( p_filter, p_data, i_slice, i_slices ) is called once for each
+ * i_slice from 0 to i_slices - 1, possibly concurrently from the threads
+ * shared by all filters (see the "filter-threads" option). The number of
+ * slices depends on i_lines, the height of the picture to process. It
+ * returns once all slices are done; pf_slice must not depend on the
+ * order of the slices and must not wait for other slices.
+ *
+ * Filters whose output lines only depend on a bounded neighbourhood of the
+ * input lines can use it to spread the work of one picture over several
+ * CPUs.
+ */
+VLC_API void filter_RunSlices( filter_t *, void (*pf_slice)( filter_t *, void *, unsigned, unsigned ), void *p_data, int i_lines );
+
+/**
+ * It computes the lines [*pi_first, *pi_end) covered by a slice of a
+ * picture with i_lines lines. Boundaries between slices are multiples of
+ * i_align lines.
+ */
+static inline void filter_GetSliceLines( unsigned i_slice, unsigned i_slices,
+                                         int i_lines, int i_align,
+                                         int *pi_first, int *pi_end )
+{
+    *pi_first = (int64_t)i_lines * i_slice / i_slices / i_align * i_align;
+    if( i_slice + 1 < i_slices )
+        *pi_end = (int64_t)i_lines * (i_slice + 1) / i_slices
+                / i_align * i_align;
+    else
+        *pi_end = i_lines;
+}
+
+/**
+ * It sets up p_view as a view of the lines [i_first, i_end) of p_pic.
+ *
+ * The lines are counted on the first plane and are scaled for the other
+ * planes according to their vertical subsampling. The view shares the
+ * pixels of p_pic; it holds no reference and must not be released.
+ */
+VLC_API void filter_SlicePicture( picture_t *p_view, const picture_t *p_pic, int i_first, int i_end );
+
+/**
+ * Same as VIDEO_FILTER_WRAPPER, but for a
+ * void (*)( filter_t *, picture_t *, picture_t *, int i_lines ) function
+ * working on horizontal slices of the pictures (see filter_RunSlices).
+ *
+ * The function is given views of the same lines of the input and output
+ * pictures, so both must have the same height. i_lines is the number of
+ * lines of the slice, a multiple of i_align except maybe for the last one.
+ */
+#define VIDEO_FILTER_WRAPPER_SLICED( name, i_align )                    \
+    static void name ## _Slice( filter_t *p_filter, void *p_data,       \
+                                unsigned i_slice, unsigned i_slices )   \
+    {                                                                   \
+        picture_t **pp_pics = p_data, src, dst;                         \
+        int i_first, i_end;                                             \
+        filter_GetSliceLines( i_slice, i_slices,                        \
+                              p_filter->fmt_in.video.i_height, i_align, \
+                              &i_first, &i_end );                       \
+        filter_SlicePicture( &src, pp_pics[0], i_first, i_end );        \
+        filter_SlicePicture( &dst, pp_pics[1], i_first, i_end );        \
+        name( p_filter, &src, &dst, i_end - i_first );                  \
+    }                                                                   \
+    static picture_t *name ## _Filter ( filter_t *p_filter,             \
+                                        picture_t *p_pic )              \
+    {                                                                   \
+        picture_t *p_outpic = filter_NewPicture( p_filter );            \
+        if( p_outpic )                                                  \
+        {                                                               \
+            picture_t *pp_pics[2] = { p_pic, p_outpic };                \
+            filter_RunSlices( p_filter, name ## _Slice, pp_pics,        \
+                              p_filter->fmt_in.video.i_height );        \
+            picture_CopyProperties( p_outpic, p_pic );                  \
+        }                                                               \
+        picture_Release( p_pic );                                       \
+        return p_outpic;                                                \
+    }
+
 /**
  * Filter chain management API
  * The filter chain management API is used to dynamically construct filters
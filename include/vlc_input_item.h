@@ -290,6 +290,12 @@ struct input_stats_t
     float f_input_bitrate;
     float f_average_input_bitrate;
 
+    /* Stream cache */
+    int64_t i_cache_hits;        /* seeks served from the cache */
+    int64_t i_cache_misses;      /* seeks done on the access */
+    int64_t i_cache_refills;
+    int64_t i_cache_refill_time; /* time spent refilling (microseconds) */
+
     /* Demux */
     int64_t i_demux_read_packets;
     int64_t i_demux_read_bytes;
@@ -295,6 +295,10 @@ VLC_API void playlist_Clear( playlist_t *, bool );
 /** Enqueue an input item for preparsing */
 VLC_API int playlist_PreparseEnqueue(playlist_t *, input_item_t * );
 
+/** Enqueue an input item for preparsing before the others, for items that
+ * are shown or about to be played */
+VLC_API int playlist_PreparseEnqueuePriority(playlist_t *, input_item_t * );
+
 /** Request the art for an input item to be fetched */
 VLC_API int playlist_AskForArtEnqueue(playlist_t *, input_item_t * );
 
@@ -596,7 +596,7 @@ static int media_parse(libvlc_media_t *media)
 
     /* TODO: Fetch art on need basis. But how not to break compatibility? */
     playlist_AskForArtEnqueue(playlist, media->p_input_item );
-    return playlist_PreparseEnqueue(playlist, media->p_input_item);
+    return playlist_PreparseEnqueuePriority(playlist, media->p_input_item);
 }
 
 /**************************************************************************
@@ -52,6 +52,9 @@
 #   include <unistd.h>
 #endif
 #include <dirent.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "fs.h"
@@ -64,6 +67,9 @@
 #include <vlc_fs.h>
 #include <vlc_url.h>
 
+/* Size of the windows of the file mapped by FileBlock() */
+#define FILE_MMAP_SIZE (4 * 1024 * 1024)
+
 struct access_sys_t
 {
     unsigned int i_nb_reads;
@@ -72,6 +78,9 @@ struct access_sys_t
 
     /* */
     bool b_pace_control;
+
+    /* mmap */
+    size_t i_page_size;
 };
 
 #if !defined (WIN32) && !defined (__OS2__)
@@ -129,8 +138,14 @@ static bool IsRemote (const char *path)
 #ifndef HAVE_POSIX_FADVISE
 # define posix_fadvise(fd, off, len, adv)
 #endif
+#ifndef HAVE_POSIX_MADVISE
+# define posix_madvise(addr, len, adv)
+#endif
 
 static ssize_t FileRead (access_t *, uint8_t *, size_t);
+#ifdef HAVE_MMAP
+static block_t *FileBlock (access_t *);
+#endif
 static int FileSeek (access_t *, uint64_t);
 static ssize_t StreamRead (access_t *, uint8_t *, size_t);
 static int NoSeek (access_t *, uint64_t);
@@ -245,6 +260,17 @@ int FileOpen( vlc_object_t *p_this )
 # if defined(F_NOCACHE)
         fcntl (fd, F_NOCACHE, 1);
 # endif
+#endif
+#ifdef HAVE_MMAP
+        /* Mapping remote files is asking for SIGBUS on network errors */
+        if (S_ISREG (st.st_mode) && var_InheritBool (p_access, "file-mmap")
+         && !IsRemote (fd, p_access->psz_filepath))
+        {
+            msg_Dbg (p_access, "using memory mapping");
+            p_access->pf_read = NULL;
+            p_access->pf_block = FileBlock;
+            p_sys->i_page_size = sysconf (_SC_PAGESIZE);
+        }
 #endif
     }
     else
@@ -268,7 +294,7 @@ void FileClose (vlc_object_t * p_this)
 {
     access_t     *p_access = (access_t*)p_this;
 
-    if (p_access->pf_read == NULL)
+    if (p_access->pf_block == DirBlock)
     {
         DirClose (p_this);
         return;
@@ -328,6 +354,73 @@ static ssize_t FileRead (access_t *p_access, uint8_t *p_buffer, size_t i_len)
 }
 
 
+#ifdef HAVE_MMAP
+/**
+ * Maps the next window of a regular file.
+ * The stream layer keeps the blocks as they are, so neither read() nor the
+ * stream cache copy the data, and peeks within a window are direct.
+ */
+static block_t *FileBlock (access_t *p_access)
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    int fd = p_sys->fd;
+    uint64_t i_pos = p_access->info.i_pos;
+
+    p_sys->i_nb_reads++;
+
+    if (!(p_sys->i_nb_reads % INPUT_FSTAT_NB_READS)
+     || (i_pos >= p_access->info.i_size))
+    {
+        struct stat st;
+
+        if ((fstat (fd, &st) == 0)
+         && (p_access->info.i_size != (uint64_t)st.st_size))
+        {
+            p_access->info.i_size = st.st_size;
+            p_access->info.i_update |= INPUT_UPDATE_SIZE;
+        }
+    }
+
+    if (i_pos >= p_access->info.i_size)
+    {
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+
+    /* The mapping offset must be page aligned */
+    uint64_t i_offset = i_pos & ~(uint64_t)(p_sys->i_page_size - 1);
+    size_t i_length = __MIN (FILE_MMAP_SIZE, p_access->info.i_size - i_offset);
+
+    /* Private writable mapping: demuxers may modify blocks in place */
+    void *addr = mmap (NULL, i_length, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+                       fd, i_offset);
+    if (addr == MAP_FAILED)
+    {
+        msg_Err (p_access, "memory mapping failed (%m)");
+        dialog_Fatal (p_access, _("File reading failed"),
+                      _("VLC could not read the file (%m)."));
+        p_access->info.b_eof = true;
+        return NULL;
+    }
+
+    /* This window is read sequentially and soon, and so is the next one */
+    posix_madvise (addr, i_length, POSIX_MADV_SEQUENTIAL);
+    posix_madvise (addr, i_length, POSIX_MADV_WILLNEED);
+    posix_fadvise (fd, i_offset + i_length, FILE_MMAP_SIZE,
+                   POSIX_FADV_WILLNEED);
+
+    block_t *p_block = block_mmap_Alloc (addr, i_length);
+    if (unlikely(p_block == NULL))
+        return NULL;
+
+    p_block->p_buffer += i_pos - i_offset;
+    p_block->i_buffer -= i_pos - i_offset;
+
+    p_access->info.i_pos = i_offset + i_length;
+    return p_block;
+}
+#endif
+
 /*****************************************************************************
  * Seek: seek to a specific location in a file
  *****************************************************************************/
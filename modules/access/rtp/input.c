@@ -29,6 +29,7 @@
 #include <vlc_block.h>
 #include <vlc_network.h>
 
+#include <errno.h>
 #include <limits.h>
 #include <unistd.h>
 #ifdef HAVE_POLL
@@ -94,6 +95,139 @@ static int rtp_timeout (mtime_t deadline)
     return t;
 }
 
+#ifdef HAVE_RECVMMSG
+# define RTP_BATCH 32 /* datagrams per recvmmsg() call */
+#else
+# define RTP_BATCH 1
+#endif
+
+/**
+ * Receive buffers of the datagram thread.
+ * The first slot can hold any datagram. The other ones are sized after the
+ * largest datagram received so far; the end of a larger datagram goes to the
+ * spill buffer of its slot.
+ */
+typedef struct
+{
+    block_t *slot[RTP_BATCH];
+    uint8_t *spill;
+    size_t mru;
+} rtp_batch_t;
+
+static void rtp_batch_clean (void *data)
+{
+    rtp_batch_t *batch = data;
+
+    for (unsigned i = 0; i < RTP_BATCH; i++)
+        if (batch->slot[i] != NULL)
+            block_Release (batch->slot[i]);
+    free (batch->spill);
+}
+
+/**
+ * Receives and processes the pending datagrams from the RTP socket.
+ * @return -1 if out of memory, 0 otherwise
+ */
+static int rtp_recv_batch (demux_t *demux, int fd, rtp_batch_t *batch)
+{
+#ifdef HAVE_RECVMMSG
+    struct mmsghdr msg[RTP_BATCH];
+    struct iovec iov[2 * RTP_BATCH];
+
+    /* Only the pages that receive data are ever committed */
+    if (batch->spill == NULL)
+        batch->spill = malloc (RTP_BATCH * 0xffff);
+#endif
+    unsigned count;
+
+    for (count = 0; count < RTP_BATCH; count++)
+    {
+        size_t size = count ? batch->mru : 0xffff;
+        block_t *block = batch->slot[count];
+
+        if (block != NULL && block->i_buffer < size)
+        {
+            block_Release (block);
+            block = NULL;
+        }
+        if (block == NULL)
+        {
+            block = block_Alloc (size);
+            if (unlikely(block == NULL))
+                break;
+            batch->slot[count] = block;
+        }
+#ifdef HAVE_RECVMMSG
+        iov[2 * count].iov_base = block->p_buffer;
+        iov[2 * count].iov_len = block->i_buffer;
+        memset (msg + count, 0, sizeof (msg[count]));
+        msg[count].msg_hdr.msg_iov = iov + 2 * count;
+        msg[count].msg_hdr.msg_iovlen = 1;
+        if (batch->spill != NULL)
+        {
+            iov[2 * count + 1].iov_base = batch->spill + count * 0xffff;
+            iov[2 * count + 1].iov_len = 0xffff;
+            msg[count].msg_hdr.msg_iovlen = 2;
+        }
+#endif
+    }
+
+    if (unlikely(count == 0))
+        return -1;
+
+#ifdef HAVE_RECVMMSG
+    /* MSG_TRUNC: get the real length of truncated datagrams */
+    int n = recvmmsg (fd, msg, count, MSG_DONTWAIT | MSG_TRUNC, NULL);
+#else
+    ssize_t len = recv (fd, batch->slot[0]->p_buffer,
+                        batch->slot[0]->i_buffer, 0);
+    int n = (len >= 0) ? 1 : -1;
+#endif
+    if (n <= 0)
+    {
+        if (n == -1 && errno != EAGAIN)
+            msg_Warn (demux, "RTP network error: %m");
+        return 0;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+#ifdef HAVE_RECVMMSG
+        size_t len = msg[i].msg_len;
+
+        if (msg[i].msg_hdr.msg_flags & MSG_TRUNC)
+        {   /* No spill buffer: grow the slots for the next datagrams */
+            msg_Warn (demux, "dropped %zu bytes RTP datagram", len);
+            batch->mru = __MIN(len, 0xffff);
+            continue;
+        }
+        if (len > batch->slot[i]->i_buffer)
+        {   /* Glue the tail back: the slot is kept for the next calls */
+            const size_t head = batch->slot[i]->i_buffer;
+            block_t *block = block_Alloc (len);
+
+            batch->mru = __MIN(len, 0xffff);
+            if (unlikely(block == NULL))
+                continue;
+            memcpy (block->p_buffer, batch->slot[i]->p_buffer, head);
+            memcpy (block->p_buffer + head, batch->spill + i * 0xffff,
+                    len - head);
+            rtp_process (demux, block);
+            continue;
+        }
+#endif
+        if (len > batch->mru)
+            batch->mru = len;
+
+        /* Right-size the block, as it may stay queued for a while */
+        block_t *block = block_Realloc (batch->slot[i], 0, len);
+        batch->slot[i] = NULL;
+        if (block != NULL)
+            rtp_process (demux, block);
+    }
+    return 0;
+}
+
 /**
  * RTP/RTCP session thread for datagram sockets
  */
@@ -103,11 +237,13 @@ void *rtp_dgram_thread (void *opaque)
     demux_sys_t *sys = demux->p_sys;
     mtime_t deadline = VLC_TS_INVALID;
     int rtp_fd = sys->fd;
+    rtp_batch_t batch = { .mru = 1500 };
 
     struct pollfd ufd[1];
     ufd[0].fd = rtp_fd;
     ufd[0].events = POLLIN;
 
+    vlc_cleanup_push (rtp_batch_clean, &batch);
     for (;;)
     {
         int n = poll (ufd, 1, rtp_timeout (deadline));
@@ -124,21 +260,8 @@ void *rtp_dgram_thread (void *opaque)
             if (unlikely(ufd[0].revents & POLLHUP))
                 break; /* RTP socket dead (DCCP only) */
 
-            block_t *block = block_Alloc (0xffff); /* TODO: p_sys->mru */
-            if (unlikely(block == NULL))
+            if (rtp_recv_batch (demux, rtp_fd, &batch))
                 break; /* we are totallly screwed */
-
-            ssize_t len = recv (rtp_fd, block->p_buffer, block->i_buffer, 0);
-            if (len != -1)
-            {
-                block->i_buffer = len;
-                rtp_process (demux, block);
-            }
-            else
-            {
-                msg_Warn (demux, "RTP network error: %m");
-                block_Release (block);
-            }
         }
 
     dequeue:
@@ -146,6 +269,7 @@ void *rtp_dgram_thread (void *opaque)
             deadline = VLC_TS_INVALID;
         vlc_restorecancel (canc);
     }
+    vlc_cleanup_run ();
     return NULL;
 }
 
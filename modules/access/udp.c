@@ -43,6 +43,11 @@
 
 #define MTU 65535
 
+#ifdef HAVE_RECVMMSG
+# define UDP_BATCH 32 /* datagrams per recvmmsg() call */
+# define UDP_MRU   1500 /* initial batch slot size */
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -69,6 +74,18 @@ vlc_module_end ()
 static block_t *BlockUDP( access_t * );
 static int Control( access_t *, int, va_list );
 
+struct access_sys_t
+{
+    int fd;
+#ifdef HAVE_RECVMMSG
+    size_t i_mru; /* largest datagram received so far */
+    block_t *pp_slot[UDP_BATCH];
+    uint8_t *p_spill; /* tails of the datagrams larger than their slot */
+    struct mmsghdr msg[UDP_BATCH];
+    struct iovec iov[2 * UDP_BATCH];
+#endif
+};
+
 /*****************************************************************************
  * Open: open the socket
  *****************************************************************************/
@@ -136,7 +153,26 @@ static int Open( vlc_object_t *p_this )
         msg_Err( p_access, "cannot open socket" );
         return VLC_EGENERIC;
     }
-    p_access->p_sys = (void *)(intptr_t)fd;
+
+    access_sys_t *p_sys = calloc( 1, sizeof( *p_sys ) );
+    if( unlikely(p_sys == NULL) )
+    {
+        net_Close( fd );
+        return VLC_ENOMEM;
+    }
+    p_sys->fd = fd;
+#ifdef HAVE_RECVMMSG
+    p_sys->i_mru = UDP_MRU;
+    /* Only the pages that receive data are ever committed */
+    p_sys->p_spill = malloc( UDP_BATCH * MTU );
+    if( unlikely(p_sys->p_spill == NULL) )
+    {
+        net_Close( fd );
+        free( p_sys );
+        return VLC_ENOMEM;
+    }
+#endif
+    p_access->p_sys = p_sys;
 
     return VLC_SUCCESS;
 }
@@ -147,8 +183,16 @@ static int Open( vlc_object_t *p_this )
 static void Close( vlc_object_t *p_this )
 {
     access_t     *p_access = (access_t*)p_this;
+    access_sys_t *p_sys = p_access->p_sys;
 
-    net_Close( (intptr_t)p_access->p_sys );
+#ifdef HAVE_RECVMMSG
+    for( unsigned i = 0; i < UDP_BATCH; i++ )
+        if( p_sys->pp_slot[i] != NULL )
+            block_Release( p_sys->pp_slot[i] );
+    free( p_sys->p_spill );
+#endif
+    net_Close( p_sys->fd );
+    free( p_sys );
 }
 
 /*****************************************************************************
@@ -193,6 +237,97 @@ static int Control( access_t *p_access, int i_query, va_list args )
     return VLC_SUCCESS;
 }
 
+#ifdef HAVE_RECVMMSG
+/*****************************************************************************
+ * BlockBatch: drains the datagrams already queued on the socket
+ *****************************************************************************
+ * All pending datagrams are received with a single system call, into blocks
+ * sized after the largest datagram seen so far. Those are right-sized
+ * afterwards. The end of a datagram larger than its block goes to a spill
+ * buffer, from which it is copied back, and the blocks are grown for the
+ * next calls.
+ *****************************************************************************/
+static block_t *BlockBatch( access_t *p_access )
+{
+    access_sys_t *p_sys = p_access->p_sys;
+    unsigned i_slots;
+
+    for( i_slots = 0; i_slots < UDP_BATCH; i_slots++ )
+    {
+        block_t *p_block = p_sys->pp_slot[i_slots];
+
+        if( p_block != NULL && p_block->i_buffer < p_sys->i_mru )
+        {
+            block_Release( p_block );
+            p_block = NULL;
+        }
+        if( p_block == NULL )
+        {
+            p_block = block_Alloc( p_sys->i_mru );
+            if( unlikely(p_block == NULL) )
+                break;
+            p_sys->pp_slot[i_slots] = p_block;
+        }
+
+        struct iovec *iov = &p_sys->iov[2 * i_slots];
+
+        iov[0].iov_base = p_block->p_buffer;
+        iov[0].iov_len = p_block->i_buffer;
+        iov[1].iov_base = p_sys->p_spill + i_slots * MTU;
+        iov[1].iov_len = MTU;
+        memset( &p_sys->msg[i_slots], 0, sizeof( p_sys->msg[i_slots] ) );
+        p_sys->msg[i_slots].msg_hdr.msg_iov = iov;
+        p_sys->msg[i_slots].msg_hdr.msg_iovlen = 2;
+    }
+
+    if( i_slots == 0 )
+        return NULL;
+
+    /* MSG_TRUNC: get the real length of truncated datagrams */
+    int i_count = recvmmsg( p_sys->fd, p_sys->msg, i_slots,
+                            MSG_DONTWAIT | MSG_TRUNC, NULL );
+    if( i_count <= 0 )
+        return NULL; /* nothing queued; errors show up on the next read */
+
+    block_t *p_chain = NULL, **pp_last = &p_chain;
+
+    for( int i = 0; i < i_count; i++ )
+    {
+        size_t i_len = p_sys->msg[i].msg_len;
+        block_t *p_block = p_sys->pp_slot[i];
+
+        if( p_sys->msg[i].msg_hdr.msg_flags & MSG_TRUNC )
+        {   /* cannot happen with IPv4 nor with IPv6 without jumbograms */
+            msg_Warn( p_access, "dropped %zu bytes datagram", i_len );
+            continue;
+        }
+
+        if( i_len > p_block->i_buffer )
+        {   /* Glue the tail back, and grow the slots for the next calls */
+            block_t *p_large = block_Alloc( i_len );
+            if( p_large == NULL )
+                continue;
+            memcpy( p_large->p_buffer, p_block->p_buffer, p_block->i_buffer );
+            memcpy( p_large->p_buffer + p_block->i_buffer,
+                    p_sys->p_spill + i * MTU, i_len - p_block->i_buffer );
+            p_sys->i_mru = i_len;
+            p_block = p_large;
+        }
+        else
+        {
+            p_block = block_Realloc( p_block, 0, i_len );
+            p_sys->pp_slot[i] = NULL;
+            if( p_block == NULL )
+                continue;
+        }
+
+        *pp_last = p_block;
+        pp_last = &p_block->p_next;
+    }
+    return p_chain;
+}
+#endif
+
 /*****************************************************************************
  * BlockUDP:
  *****************************************************************************/
@@ -207,7 +342,9 @@ static block_t *BlockUDP( access_t *p_access )
 
     /* Read data */
     p_block = block_Alloc( MTU );
-    len = net_Read( p_access, (intptr_t)p_sys, NULL,
+    if( unlikely(p_block == NULL) )
+        return NULL;
+    len = net_Read( p_access, p_sys->fd, NULL,
                     p_block->p_buffer, MTU, false );
     if( len < 0 )
     {
@@ -215,5 +352,14 @@ static block_t *BlockUDP( access_t *p_access )
         return NULL;
     }
 
-    return block_Realloc( p_block, 0, len );
+    p_block = block_Realloc( p_block, 0, len );
+#ifdef HAVE_RECVMMSG
+    if( p_block != NULL )
+    {
+        if( (size_t)len > p_sys->i_mru )
+            p_sys->i_mru = len;
+        p_block->p_next = BlockBatch( p_access );
+    }
+#endif
+    return p_block;
 }
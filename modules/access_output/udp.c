@@ -53,6 +53,10 @@
 
 #define MAX_EMPTY_BLOCKS 200
 
+#ifdef HAVE_SENDMMSG
+# define UDP_BATCH 64 /* packets per sendmmsg() call */
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -73,6 +77,12 @@ static void Close( vlc_object_t * );
                           "helps reducing the scheduling load on " \
                           "heavily-loaded systems." )
 
+#define BATCH_TEXT N_("Batching window (ms)")
+#define BATCH_LONGTEXT N_("Queued packets due within this time window " \
+                          "after the current one are sent together, with " \
+                          "a single system call. 0 only coalesces packets " \
+                          "that are already due." )
+
 vlc_module_begin ()
     set_description( N_("UDP stream output") )
     set_shortname( "UDP" )
@@ -81,6 +91,8 @@ vlc_module_begin ()
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000, CACHING_TEXT, CACHING_LONGTEXT, true )
     add_integer( SOUT_CFG_PREFIX "group", 1, GROUP_TEXT, GROUP_LONGTEXT,
                                  true )
+    add_integer( SOUT_CFG_PREFIX "batch", 0, BATCH_TEXT, BATCH_LONGTEXT,
+                                 true )
 
     set_capability( "sout access", 0 )
     add_shortcut( "udp" )
@@ -94,6 +106,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "caching",
     "group",
+    "batch",
     NULL
 };
 
@@ -394,6 +407,40 @@ static block_t *NewUDPPacket( sout_access_out_t *p_access, mtime_t i_dts)
     return p_buffer;
 }
 
+#ifdef HAVE_SENDMMSG
+/*****************************************************************************
+ * SendBatch: send several packets with a single system call
+ *****************************************************************************/
+static void SendBatch( sout_access_out_t *p_access, block_t **pp_batch,
+                       unsigned i_count )
+{
+    sout_access_out_sys_t *p_sys = p_access->p_sys;
+    struct mmsghdr msg[UDP_BATCH];
+    struct iovec iov[UDP_BATCH];
+
+    assert( i_count <= UDP_BATCH );
+    for( unsigned i = 0; i < i_count; i++ )
+    {
+        iov[i].iov_base = pp_batch[i]->p_buffer;
+        iov[i].iov_len = pp_batch[i]->i_buffer;
+        memset( &msg[i], 0, sizeof( msg[i] ) );
+        msg[i].msg_hdr.msg_iov = &iov[i];
+        msg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for( unsigned i = 0; i < i_count; )
+    {
+        int i_sent = sendmmsg( p_sys->i_handle, &msg[i], i_count - i, 0 );
+        if( i_sent <= 0 )
+        {
+            msg_Warn( p_access, "send error: %m" );
+            i_sent = 1; /* skip the failing packet */
+        }
+        i += i_sent;
+    }
+}
+#endif
+
 /*****************************************************************************
  * ThreadWrite: Write a packet on the network at the good time.
  *****************************************************************************/
@@ -406,6 +453,11 @@ static void* ThreadWrite( void *data )
                                              SOUT_CFG_PREFIX "group" );
     mtime_t i_to_send = i_group;
     unsigned i_dropped_packets = 0;
+#ifdef HAVE_SENDMMSG
+    const mtime_t i_window = INT64_C(1000)
+                           * var_GetInteger( p_access, SOUT_CFG_PREFIX "batch" );
+    block_t *pp_batch[UDP_BATCH];
+#endif
 
     for (;;)
     {
@@ -442,9 +494,44 @@ static void* ThreadWrite( void *data )
             mwait( i_date );
             i_to_send = i_group;
         }
+#ifdef HAVE_SENDMMSG
+        vlc_cleanup_pop();
+
+        /* Coalesce the queued packets that would not be waited for, or that
+         * are due within the batching window */
+        int canc = vlc_savecancel();
+        const mtime_t i_due = __MAX( i_date, mdate() ) + i_window;
+        unsigned i_count = 1;
+
+        pp_batch[0] = p_pk;
+        while( i_count < UDP_BATCH && block_FifoCount( p_sys->p_fifo ) > 0 )
+        {
+            block_t *p_next = block_FifoShow( p_sys->p_fifo );
+            mtime_t i_next = p_sys->i_caching + p_next->i_dts;
+
+            /* Leave holes and packets in the past to the slow path */
+            if( i_next - i_date > 2000000 || i_next - i_date < -1000 )
+                break;
+
+            if( i_to_send > 1 && !(p_next->i_flags & BLOCK_FLAG_CLOCK) )
+                i_to_send--;
+            else if( i_next <= i_due )
+                i_to_send = i_group;
+            else
+                break;
+
+            pp_batch[i_count++] = block_FifoGet( p_sys->p_fifo );
+        }
+
+        SendBatch( p_access, pp_batch, i_count );
+        for( unsigned i = 1; i < i_count; i++ )
+            block_FifoPut( p_sys->p_empty_blocks, pp_batch[i] );
+        vlc_restorecancel( canc );
+#else
         if ( send( p_sys->i_handle, p_pk->p_buffer, p_pk->i_buffer, 0 ) == -1 )
             msg_Warn( p_access, "send error: %m" );
         vlc_cleanup_pop();
+#endif
 
         if( i_dropped_packets )
         {
@@ -1808,6 +1808,13 @@ static int updateStatistics( intf_thread_t *p_intf, input_item_t *p_item )
             (float)(p_item->p_stats->i_read_bytes)/1024 );
     msg_rc(_("| input bitrate    :   %6.0f kb/s"),
             (float)(p_item->p_stats->f_input_bitrate)*8000 );
+    msg_rc(_("| cache hit rate   :    %5.1f %%"),
+            p_item->p_stats->i_cache_hits + p_item->p_stats->i_cache_misses ?
+            100.f * p_item->p_stats->i_cache_hits /
+            (p_item->p_stats->i_cache_hits + p_item->p_stats->i_cache_misses) : 0.f );
+    msg_rc(_("| cache refills    :    %5"PRIi64" (%"PRIi64" ms)"),
+            p_item->p_stats->i_cache_refills,
+            p_item->p_stats->i_cache_refill_time / 1000 );
     msg_rc(_("| demux bytes read : %8.0f KiB"),
             (float)(p_item->p_stats->i_demux_read_bytes)/1024 );
     msg_rc(_("| demux bitrate    :   %6.0f kb/s"),
@@ -45,6 +45,7 @@
 
 #include "libavi.h"
 #include "../rawdv.h"
+#include "../index_cache.h"
 
 /*****************************************************************************
  * Module descriptor
@@ -57,6 +58,12 @@
     "Recreate a index for the AVI file. Use this if your AVI file is damaged "\
     "or incomplete (not seekable)." )
 
+#define INDEX_CACHE_TEXT N_("Keep the created indexes")
+#define INDEX_CACHE_LONGTEXT N_( \
+    "Save the index created for a damaged or incomplete AVI file in the " \
+    "cache directory, and use it when the file is opened again instead of " \
+    "creating it again." )
+
 static int  Open ( vlc_object_t * );
 static void Close( vlc_object_t * );
 
@@ -79,6 +86,8 @@ vlc_module_begin ()
     add_integer( "avi-index", 0,
               INDEX_TEXT, INDEX_LONGTEXT, false )
         change_integer_list( pi_index, ppsz_indexes )
+    add_bool( "avi-index-cache", false,
+              INDEX_CACHE_TEXT, INDEX_CACHE_LONGTEXT, true )
 
     set_callbacks( Open, Close )
 vlc_module_end ()
@@ -213,6 +222,8 @@ static int AVI_PacketSearch   ( demux_t * );
 
 static void AVI_IndexLoad    ( demux_t * );
 static void AVI_IndexCreate  ( demux_t * );
+static int  AVI_IndexCacheLoad( demux_t * );
+static void AVI_IndexCacheSave( demux_t * );
 
 static void AVI_ExtractSubtitle( demux_t *, unsigned int i_stream, avi_chunk_list_t *, avi_chunk_STRING_t * );
 
@@ -664,11 +675,17 @@ aviindex:
                            "approximative or will exhibit strange behavior" );
         if( (i_do_index == 0 || i_do_index == 3) && !b_index )
         {
-            if( !p_sys->b_seekable ) {
+            if( !AVI_IndexCacheLoad( p_demux ) )
+            {
+                /* built the last time the file was opened */
+                b_index = true;
+                p_sys->i_length = AVI_MovieGetLength( p_demux );
+            }
+            else if( !p_sys->b_seekable ) {
                 b_index = true;
                 goto aviindex;
             }
-            if( i_do_index == 0 )
+            else if( i_do_index == 0 )
             {
                 switch( dialog_Question( p_demux, _("Broken or missing AVI Index") ,
                    _( "Because this AVI file index is broken or missing, "
@@ -2360,6 +2377,7 @@ static void AVI_IndexCreate( demux_t *p_demux )
 
     mtime_t i_dialog_update;
     dialog_progress_bar_t *p_dialog = NULL;
+    bool b_complete = true;
 
     p_riff = AVI_ChunkFind( &p_sys->ck_root, AVIFOURCC_RIFF, 0);
     p_movi = AVI_ChunkFind( p_riff, AVIFOURCC_movi, 0);
@@ -2391,13 +2409,19 @@ static void AVI_IndexCreate( demux_t *p_demux )
         avi_packet_t pk;
 
         if( !vlc_object_alive (p_demux) )
+        {
+            b_complete = false;
             break;
+        }
 
         /* Don't update/check dialog too often */
         if( p_dialog && mdate() - i_dialog_update > 100000 )
         {
             if( dialog_ProgressCancelled( p_dialog ) )
+            {
+                b_complete = false;
                 break;
+            }
 
             double f_current = stream_Tell( p_demux->s );
             double f_size    = stream_Size( p_demux->s );
@@ -2474,6 +2498,85 @@ print_stat:
         msg_Dbg( p_demux, "stream[%d] creating %d index entries",
                 i_stream, p_sys->track[i_stream]->idx.i_size );
     }
+
+    if( b_complete )
+        AVI_IndexCacheSave( p_demux );
+}
+
+/* The index created by AVI_IndexCreate can be kept in the index cache, with
+ * the stream of each entry */
+typedef struct
+{
+    unsigned int i_stream;
+    avi_entry_t  entry;
+} avi_cache_entry_t;
+
+static int AVI_IndexCacheLoad( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_cache_entry_t *p_entries;
+    size_t i_count;
+
+    if( !p_sys->b_seekable || !var_InheritBool( p_demux, "avi-index-cache" ) )
+        return VLC_EGENERIC;
+
+    p_entries = IndexCacheLoad( p_demux, "avi", sizeof( *p_entries ),
+                                &i_count );
+    if( p_entries == NULL )
+        return VLC_EGENERIC;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        avi_index_Clean( &p_sys->track[i]->idx );
+        avi_index_Init( &p_sys->track[i]->idx );
+    }
+    for( size_t i = 0; i < i_count; i++ )
+    {
+        if( p_entries[i].i_stream < p_sys->i_track )
+            avi_index_Append( &p_sys->track[p_entries[i].i_stream]->idx,
+                              &p_sys->i_movi_lastchunk_pos,
+                              &p_entries[i].entry );
+    }
+    free( p_entries );
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        msg_Dbg( p_demux, "stream[%u] loaded %u index entries",
+                 i, p_sys->track[i]->idx.i_size );
+    return VLC_SUCCESS;
+}
+
+static void AVI_IndexCacheSave( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+    avi_cache_entry_t *p_entries;
+    size_t i_count = 0;
+
+    if( !var_InheritBool( p_demux, "avi-index-cache" ) )
+        return;
+
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+        i_count += p_sys->track[i]->idx.i_size;
+    if( i_count == 0 )
+        return;
+
+    p_entries = calloc( i_count, sizeof( *p_entries ) );
+    if( p_entries == NULL )
+        return;
+
+    i_count = 0;
+    for( unsigned i = 0; i < p_sys->i_track; i++ )
+    {
+        const avi_index_t *p_index = &p_sys->track[i]->idx;
+
+        for( unsigned j = 0; j < p_index->i_size; j++ )
+        {
+            p_entries[i_count].i_stream = i;
+            p_entries[i_count].entry = p_index->p_entry[j];
+            i_count++;
+        }
+    }
+    IndexCacheSave( p_demux, "avi", p_entries, sizeof( *p_entries ), i_count );
+    free( p_entries );
 }
 
 /* */
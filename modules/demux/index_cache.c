@@ -0,0 +1,206 @@
+/*****************************************************************************
+ * index_cache.c: on-disk cache of the seek indexes built by demuxers
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <sys/stat.h>
+
+#include <vlc_common.h>
+#include <vlc_demux.h>
+#include <vlc_fs.h>
+#include <vlc_md5.h>
+#include <vlc_configuration.h>
+
+#include "index_cache.h"
+
+#define INDEX_CACHE_MAGIC   "VLCINDEX"
+#define INDEX_CACHE_VERSION 1
+
+/* Header of a cache file, followed by the path of the indexed file and the
+ * entries. It is written in the host byte order: the cache is not shared */
+typedef struct
+{
+    char     magic[8];
+    uint32_t i_version;
+    uint32_t i_entry_size;
+    uint64_t i_file_size;
+    int64_t  i_file_mtime;
+    uint64_t i_count;
+    uint32_t i_path_size;
+} index_cache_header_t;
+
+/* Returns the cache file of the psz_type index of the file of a demuxer,
+ * and fills the header describing the file as it is now */
+static char *IndexCachePath( demux_t *p_demux, const char *psz_type,
+                             size_t i_entry_size, index_cache_header_t *p_hdr )
+{
+    struct stat st;
+    struct md5_s md5;
+    char *psz_cachedir, *psz_hash, *psz_path;
+
+    /* Only local files have an identity to check */
+    if( p_demux->psz_file == NULL || vlc_stat( p_demux->psz_file, &st ) )
+        return NULL;
+
+    memset( p_hdr, 0, sizeof(*p_hdr) );
+    memcpy( p_hdr->magic, INDEX_CACHE_MAGIC, sizeof(p_hdr->magic) );
+    p_hdr->i_version    = INDEX_CACHE_VERSION;
+    p_hdr->i_entry_size = i_entry_size;
+    p_hdr->i_file_size  = st.st_size;
+    p_hdr->i_file_mtime = st.st_mtime;
+    p_hdr->i_path_size  = strlen( p_demux->psz_file );
+
+    InitMD5( &md5 );
+    AddMD5( &md5, p_demux->psz_file, p_hdr->i_path_size );
+    EndMD5( &md5 );
+
+    psz_hash = psz_md5_hash( &md5 );
+    psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_hash == NULL || psz_cachedir == NULL ||
+        asprintf( &psz_path, "%s" DIR_SEP "index" DIR_SEP "%s.%s",
+                  psz_cachedir, psz_hash, psz_type ) == -1 )
+        psz_path = NULL;
+    free( psz_cachedir );
+    free( psz_hash );
+    return psz_path;
+}
+
+void *IndexCacheLoad( demux_t *p_demux, const char *psz_type,
+                      size_t i_entry_size, size_t *pi_count )
+{
+    index_cache_header_t cur, hdr;
+    char *psz_path = IndexCachePath( p_demux, psz_type, i_entry_size, &cur );
+    char *psz_file = NULL;
+    void *p_entries = NULL;
+    FILE *f;
+
+    if( psz_path == NULL )
+        return NULL;
+    f = vlc_fopen( psz_path, "rb" );
+    free( psz_path );
+    if( f == NULL )
+        return NULL;
+
+    if( fread( &hdr, sizeof(hdr), 1, f ) != 1 ||
+        memcmp( hdr.magic, cur.magic, sizeof(hdr.magic) ) ||
+        hdr.i_version != cur.i_version ||
+        hdr.i_entry_size != cur.i_entry_size ||
+        hdr.i_path_size != cur.i_path_size )
+        goto error;
+
+    if( hdr.i_file_size != cur.i_file_size ||
+        hdr.i_file_mtime != cur.i_file_mtime )
+    {
+        msg_Dbg( p_demux, "the file changed since its %s index was saved",
+                 psz_type );
+        goto error;
+    }
+
+    psz_file = malloc( hdr.i_path_size );
+    if( psz_file == NULL ||
+        fread( psz_file, hdr.i_path_size, 1, f ) != 1 ||
+        memcmp( psz_file, p_demux->psz_file, hdr.i_path_size ) )
+        goto error;
+
+    if( hdr.i_count == 0 || hdr.i_count > SIZE_MAX / i_entry_size )
+        goto error;
+    p_entries = malloc( hdr.i_count * i_entry_size );
+    if( p_entries == NULL ||
+        fread( p_entries, i_entry_size, hdr.i_count, f ) != hdr.i_count )
+        goto error;
+
+    msg_Dbg( p_demux, "loaded %"PRIu64" entries of the %s index from the "
+             "cache", hdr.i_count, psz_type );
+    free( psz_file );
+    fclose( f );
+    *pi_count = hdr.i_count;
+    return p_entries;
+
+error:
+    free( p_entries );
+    free( psz_file );
+    fclose( f );
+    return NULL;
+}
+
+int IndexCacheSave( demux_t *p_demux, const char *psz_type,
+                    const void *p_entries, size_t i_entry_size,
+                    size_t i_count )
+{
+    index_cache_header_t hdr;
+    char *psz_path = IndexCachePath( p_demux, psz_type, i_entry_size, &hdr );
+    char *psz_tmp;
+    FILE *f;
+
+    if( psz_path == NULL )
+        return VLC_EGENERIC;
+    if( asprintf( &psz_tmp, "%s.part", psz_path ) == -1 )
+    {
+        free( psz_path );
+        return VLC_ENOMEM;
+    }
+
+    /* Create the cache directory and its index sub-directory */
+    char *psz_cachedir = config_GetUserDir( VLC_CACHE_DIR );
+    if( psz_cachedir != NULL )
+    {
+        char *psz_dir;
+
+        vlc_mkdir( psz_cachedir, 0700 );
+        if( asprintf( &psz_dir, "%s" DIR_SEP "index", psz_cachedir ) != -1 )
+        {
+            vlc_mkdir( psz_dir, 0700 );
+            free( psz_dir );
+        }
+        free( psz_cachedir );
+    }
+
+    hdr.i_count = i_count;
+    f = vlc_fopen( psz_tmp, "wb" );
+    if( f == NULL )
+        goto error;
+    if( fwrite( &hdr, sizeof(hdr), 1, f ) != 1 ||
+        fwrite( p_demux->psz_file, hdr.i_path_size, 1, f ) != 1 ||
+        fwrite( p_entries, i_entry_size, i_count, f ) != i_count )
+    {
+        fclose( f );
+        vlc_unlink( psz_tmp );
+        goto error;
+    }
+    if( fclose( f ) || vlc_rename( psz_tmp, psz_path ) )
+    {
+        vlc_unlink( psz_tmp );
+        goto error;
+    }
+
+    msg_Dbg( p_demux, "saved %zu entries of the %s index in the cache",
+             i_count, psz_type );
+    free( psz_tmp );
+    free( psz_path );
+    return VLC_SUCCESS;
+
+error:
+    msg_Warn( p_demux, "cannot save the %s index in %s", psz_type, psz_path );
+    free( psz_tmp );
+    free( psz_path );
+    return VLC_EGENERIC;
+}
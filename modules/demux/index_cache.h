@@ -0,0 +1,48 @@
+/*****************************************************************************
+ * index_cache.h: on-disk cache of the seek indexes built by demuxers
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#ifndef VLC_DEMUX_INDEX_CACHE_H
+#define VLC_DEMUX_INDEX_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* The indexes are stored in the user cache directory, one file per local
+ * file and index type. They are only given back while the size and the
+ * modification time of the file are the ones it had when they were saved.
+ * psz_type names the index and the layout of its entries, it has to be
+ * changed with the entries. */
+
+/* Returns the psz_type index saved for the file of a demuxer, as a malloc'ed
+ * array of *pi_count entries of i_entry_size bytes, or NULL */
+void *IndexCacheLoad( demux_t *, const char *psz_type, size_t i_entry_size,
+                      size_t *pi_count );
+
+/* Saves i_count entries of i_entry_size bytes as the psz_type index of the
+ * file of a demuxer */
+int IndexCacheSave( demux_t *, const char *psz_type, const void *p_entries,
+                    size_t i_entry_size, size_t i_count );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -110,6 +110,7 @@ public:
     int                     i_index;
     int                     i_index_max;
     mkv_index_t             *p_indexes;
+    int                     i_index_cached; /* entries in the index cache */
 
     /* info */
     char                    *psz_muxing_application;
@@ -32,6 +32,7 @@
 #include "Ebml_parser.hpp"
 
 #include "stream_io_callback.hpp"
+#include "../index_cache.h"
 
 #include <vlc_fs.h>
 #include <vlc_url.h>
@@ -70,6 +71,10 @@ vlc_module_begin ()
             N_("Dummy Elements"),
             N_("Read and discard unknown EBML elements (not good for broken files)."), true );
 
+    add_bool( "mkv-index-cache", false,
+            N_("Keep the cluster indexes"),
+            N_("Save the index of the clusters found in files without cues in the cache directory, and use it when the file is opened again."), true );
+
     add_shortcut( "mka", "mkv" )
 vlc_module_end ()
 
@@ -78,6 +83,8 @@ class demux_sys_t;
 static int  Demux  ( demux_t * );
 static int  Control( demux_t *, int, va_list );
 static void Seek   ( demux_t *, mtime_t i_date, double f_percent, virtual_chapter_c *p_chapter );
+static void SegmentIndexLoad( demux_t *, matroska_segment_c *, size_t );
+static void SegmentIndexSave( demux_t *, matroska_segment_c *, size_t );
 
 /*****************************************************************************
  * Open: initializes matroska demux structures
@@ -132,6 +139,7 @@ static int Open( vlc_object_t * p_this )
     {
         p_stream->segments[i]->Preload();
         b_need_preload |= p_stream->segments[i]->b_ref_external_segments;
+        SegmentIndexLoad( p_demux, p_stream->segments[i], i );
     }
 
     p_segment = p_stream->segments[0];
@@ -273,9 +281,64 @@ static void Close( vlc_object_t *p_this )
             p_segment->UnSelect();
     }
 
+    /* the segments of the file itself, not the linked ones */
+    if( !p_sys->streams.empty() )
+    {
+        matroska_stream_c *p_stream = p_sys->streams[0];
+        for( size_t i = 0; i < p_stream->segments.size(); i++ )
+            SegmentIndexSave( p_demux, p_stream->segments[i], i );
+    }
+
     delete p_sys;
 }
 
+/*****************************************************************************
+ * Index cache: the clusters found in a segment without cues
+ *****************************************************************************/
+static void SegmentIndexLoad( demux_t *p_demux, matroska_segment_c *p_segment,
+                              size_t i_segment )
+{
+    char psz_type[16];
+    size_t i_count;
+    mkv_index_t *p_indexes;
+
+    if( p_segment->b_cues || !var_InheritBool( p_demux, "mkv-index-cache" ) )
+        return;
+
+    snprintf( psz_type, sizeof(psz_type), "mkv%zu", i_segment );
+    p_indexes = (mkv_index_t *)IndexCacheLoad( p_demux, psz_type,
+                                               sizeof(mkv_index_t), &i_count );
+    if( p_indexes == NULL )
+        return;
+
+    if( i_count > (size_t)p_segment->i_index && i_count < INT_MAX - 1024 )
+    {
+        /* IndexAppendCluster() expects a free entry */
+        p_segment->i_index_max = i_count + 1024;
+        p_segment->p_indexes = (mkv_index_t*)xrealloc( p_segment->p_indexes,
+                                sizeof( mkv_index_t ) * p_segment->i_index_max );
+        memcpy( p_segment->p_indexes, p_indexes, sizeof( mkv_index_t ) * i_count );
+        p_segment->i_index = i_count;
+        p_segment->i_index_cached = i_count;
+    }
+    free( p_indexes );
+}
+
+static void SegmentIndexSave( demux_t *p_demux, matroska_segment_c *p_segment,
+                              size_t i_segment )
+{
+    char psz_type[16];
+
+    if( p_segment->b_cues || p_segment->i_index <= p_segment->i_index_cached ||
+        !var_InheritBool( p_demux, "mkv-index-cache" ) )
+        return;
+
+    snprintf( psz_type, sizeof(psz_type), "mkv%zu", i_segment );
+    if( !IndexCacheSave( p_demux, psz_type, p_segment->p_indexes,
+                         sizeof(mkv_index_t), p_segment->i_index ) )
+        p_segment->i_index_cached = p_segment->i_index;
+}
+
 /*****************************************************************************
  * Control:
  *****************************************************************************/
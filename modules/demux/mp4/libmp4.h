@@ -1263,6 +1263,16 @@ typedef struct MP4_Box_s
 
 } MP4_Box_t;
 
+/* Position of a sample in a run-length table of the sample table (stts or
+ * ctts), so that the tables are decoded lazily instead of being expanded */
+typedef struct
+{
+    uint32_t     i_sample;  /* sample number */
+    uint32_t     i_entry;   /* entry of the table holding this sample */
+    uint32_t     i_used;    /* samples of this entry before this sample */
+    int64_t      i_dts;     /* DTS of this sample (stts only) */
+} mp4_cursor_t;
+
 /* Contain all information about a chunk */
 typedef struct
 {
@@ -1284,6 +1294,13 @@ typedef struct
     uint32_t     *p_sample_count_pts;
     int32_t      *p_sample_offset_pts;  /* pts-dts */
 
+    /* when the tables above are not set (not fragmented), position of the
+     * first sample of the chunk in the stts and ctts tables of the track */
+    uint32_t     i_stts_entry;
+    uint32_t     i_stts_used;
+    uint32_t     i_ctts_entry;
+    uint32_t     i_ctts_used;
+
     uint8_t      **p_sample_data;     /* set when b_fragmented is true */
     uint32_t     *p_sample_size;
     /* TODO if needed add pts
@@ -1334,8 +1351,23 @@ typedef struct
     /* sample size, p_sample_size defined only if i_sample_size == 0
         else i_sample_size is size for all sample */
     uint32_t         i_sample_size;
-    uint32_t         *p_sample_size; /* XXX perhaps add file offset if take
-                                    too much time to do sumations each time*/
+    uint32_t         *p_sample_size; /* points into the stsz box */
+
+    /* offset in the chunk of sample i_pos_sample, when p_sample_size is set,
+     * so that the sizes are not summed from the chunk start every time */
+    uint32_t         i_pos_sample;
+    uint64_t         i_pos;
+
+    /* stts and ctts tables of the track, if not fragmented, and the cursors
+     * of the last samples looked up in them */
+    MP4_Box_data_stts_t *p_stts;
+    MP4_Box_data_ctts_t *p_ctts;
+    mp4_cursor_t     dts_cursor;
+    mp4_cursor_t     pts_cursor;
+
+    /* samples of the track read ahead from the file, at i_readahead_pos */
+    block_t          *p_readahead;
+    uint64_t         i_readahead_pos;
 
     uint32_t     i_sample_first; /* i_sample_first value
                                                    of the next chunk */
@@ -101,41 +101,92 @@ static int  MP4_TrackSeek   ( demux_t *, mp4_track_t *, mtime_t );
 
 static uint64_t MP4_TrackGetPos    ( mp4_track_t * );
 static int      MP4_TrackSampleSize( mp4_track_t * );
+static block_t *MP4_TrackReadSample( demux_t *, mp4_track_t *, uint64_t, int );
 static int      MP4_TrackNextSample( demux_t *, mp4_track_t * );
 static void     MP4_TrackSetELST( demux_t *, mp4_track_t *, int64_t );
 
 static void     MP4_UpdateSeekpoint( demux_t * );
 static const char *MP4_ConvertMacCode( uint16_t );
 
+/* Moves a cursor of the stts or ctts table forward to i_sample, summing the
+ * deltas of pi_delta (if not NULL) into the DTS */
+static void MP4_CursorForward( mp4_cursor_t *p_cur, uint32_t i_sample,
+                               uint32_t i_entry_count,
+                               const uint32_t *pi_count,
+                               const int32_t *pi_delta )
+{
+    while( p_cur->i_sample < i_sample && p_cur->i_entry < i_entry_count )
+    {
+        uint32_t i_used = __MIN( pi_count[p_cur->i_entry] - p_cur->i_used,
+                                 i_sample - p_cur->i_sample );
+
+        if( pi_delta )
+            p_cur->i_dts += (int64_t)i_used * pi_delta[p_cur->i_entry];
+        p_cur->i_sample += i_used;
+        p_cur->i_used   += i_used;
+
+        if( p_cur->i_used >= pi_count[p_cur->i_entry] )
+        {
+            p_cur->i_entry++;
+            p_cur->i_used = 0;
+        }
+    }
+}
+
+/* Returns the stts cursor of the current sample of a non fragmented track.
+ * It goes on from the last sample looked up if it is in the same chunk and
+ * not after the current one, else from the start of the current chunk */
+static const mp4_cursor_t *MP4_TrackGetDTSCursor( mp4_track_t *p_track )
+{
+    const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+    mp4_cursor_t *p_cur = &p_track->dts_cursor;
+
+    if( p_cur->i_sample < ck->i_sample_first ||
+        p_cur->i_sample > p_track->i_sample )
+    {
+        p_cur->i_sample = ck->i_sample_first;
+        p_cur->i_entry  = ck->i_stts_entry;
+        p_cur->i_used   = ck->i_stts_used;
+        p_cur->i_dts    = ck->i_first_dts;
+    }
+    MP4_CursorForward( p_cur, p_track->i_sample,
+                       p_track->p_stts->i_entry_count,
+                       p_track->p_stts->i_sample_count,
+                       p_track->p_stts->i_sample_delta );
+    return p_cur;
+}
+
 /* Return time in microsecond of a track */
 static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    mp4_chunk_t chunk;
-    if( p_sys->b_fragmented )
-        chunk = *p_track->cchunk;
-    else
-        chunk = p_track->chunk[p_track->i_chunk];
+    int64_t i_dts;
 
-    unsigned int i_index = 0;
-    unsigned int i_sample = p_track->i_sample - chunk.i_sample_first;
-    int64_t i_dts = chunk.i_first_dts;
-
-    while( i_sample > 0 )
+    if( p_sys->b_fragmented )
     {
-        if( i_sample > chunk.p_sample_count_dts[i_index] )
-        {
-            i_dts += chunk.p_sample_count_dts[i_index] *
-                chunk.p_sample_delta_dts[i_index];
-            i_sample -= chunk.p_sample_count_dts[i_index];
-            i_index++;
-        }
-        else
+        const mp4_chunk_t *ck = p_track->cchunk;
+        unsigned int i_index = 0;
+        unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
+
+        i_dts = ck->i_first_dts;
+        while( i_sample > 0 )
         {
-            i_dts += i_sample * chunk.p_sample_delta_dts[i_index];
-            break;
+            if( i_sample > ck->p_sample_count_dts[i_index] )
+            {
+                i_dts += ck->p_sample_count_dts[i_index] *
+                    ck->p_sample_delta_dts[i_index];
+                i_sample -= ck->p_sample_count_dts[i_index];
+                i_index++;
+            }
+            else
+            {
+                i_dts += i_sample * ck->p_sample_delta_dts[i_index];
+                break;
+            }
         }
     }
+    else
+        i_dts = MP4_TrackGetDTSCursor( p_track )->i_dts;
 
     /* now handle elst */
     if( p_track->p_elst )
@@ -164,11 +215,33 @@ static inline int64_t MP4_TrackGetDTS( demux_t *p_demux, mp4_track_t *p_track )
 static inline int64_t MP4_TrackGetPTSDelta( demux_t *p_demux, mp4_track_t *p_track )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
-    mp4_chunk_t *ck;
-    if( p_sys->b_fragmented )
-        ck = p_track->cchunk;
-    else
-        ck = &p_track->chunk[p_track->i_chunk];
+
+    if( !p_sys->b_fragmented )
+    {
+        const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+        MP4_Box_data_ctts_t *ctts = p_track->p_ctts;
+        mp4_cursor_t *p_cur = &p_track->pts_cursor;
+
+        if( ctts == NULL )
+            return -1;
+
+        if( p_cur->i_sample < ck->i_sample_first ||
+            p_cur->i_sample > p_track->i_sample )
+        {
+            p_cur->i_sample = ck->i_sample_first;
+            p_cur->i_entry  = ck->i_ctts_entry;
+            p_cur->i_used   = ck->i_ctts_used;
+        }
+        MP4_CursorForward( p_cur, p_track->i_sample, ctts->i_entry_count,
+                           ctts->i_sample_count, NULL );
+
+        if( p_cur->i_entry >= ctts->i_entry_count )
+            return -1;
+        return ctts->i_sample_offset[p_cur->i_entry] * INT64_C(1000000) /
+               (int64_t)p_track->i_timescale;
+    }
+
+    mp4_chunk_t *ck = p_track->cchunk;
 
     unsigned int i_index = 0;
     unsigned int i_sample = p_track->i_sample - ck->i_sample_first;
@@ -713,92 +786,93 @@ static int Demux( demux_t *p_demux )
     /* we will read 100ms for each stream so ...*/
     p_sys->i_time += __MAX( p_sys->i_timescale / 10 , 1 );
 
-    for( i_track = 0; i_track < p_sys->i_tracks; i_track++ )
+    /* Read the samples of all the tracks up to this time in file order,
+     * so that the stream goes forward instead of seeking back and forth
+     * between the tracks of badly interleaved files */
+    for( ;; )
     {
-        mp4_track_t *tk = &p_sys->track[i_track];
-
-        if( !tk->b_ok || tk->b_chapter || !tk->b_selected || tk->i_sample >= tk->i_sample_count )
-            continue;
+        mp4_track_t *tk = NULL;
+        uint64_t i_pos = 0;
 
-        while( MP4_TrackGetDTS( p_demux, tk ) < MP4_GetMoviePTS( p_sys ) )
+        for( i_track = 0; i_track < p_sys->i_tracks; i_track++ )
         {
-#if 0
-            msg_Dbg( p_demux, "tk(%i)=%lld mv=%lld", i_track,
-                     MP4_TrackGetDTS( p_demux, tk ),
-                     MP4_GetMoviePTS( p_sys ) );
-#endif
+            mp4_track_t *p_track = &p_sys->track[i_track];
+            uint64_t i_track_pos;
 
-            if( MP4_TrackSampleSize( tk ) > 0 )
+            if( !p_track->b_ok || p_track->b_chapter || !p_track->b_selected ||
+                p_track->i_sample >= p_track->i_sample_count ||
+                MP4_TrackGetDTS( p_demux, p_track ) >= MP4_GetMoviePTS( p_sys ) )
+                continue;
+
+            i_track_pos = MP4_TrackGetPos( p_track );
+            if( tk == NULL || i_track_pos < i_pos )
             {
-                block_t *p_block;
-                int64_t i_delta;
+                tk = p_track;
+                i_pos = i_track_pos;
+            }
+        }
+        if( tk == NULL )
+            break;
 
-                /* go,go go ! */
-                if( stream_Seek( p_demux->s, MP4_TrackGetPos( tk ) ) )
-                {
-                    msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
-                              tk->i_track_ID );
-                    MP4_TrackUnselect( p_demux, tk );
-                    break;
-                }
+        if( MP4_TrackSampleSize( tk ) > 0 )
+        {
+            block_t *p_block;
+            int64_t i_delta;
 
-                /* now read pes */
-                if( !(p_block =
-                         stream_Block( p_demux->s, MP4_TrackSampleSize(tk) )) )
+            /* go,go go ! */
+            if( !(p_block = MP4_TrackReadSample( p_demux, tk, i_pos,
+                                                 MP4_TrackSampleSize(tk) )) )
+            {
+                msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
+                          tk->i_track_ID );
+                MP4_TrackUnselect( p_demux, tk );
+                continue;
+            }
+            else if( tk->fmt.i_cat == SPU_ES )
+            {
+                if( tk->fmt.i_codec == VLC_CODEC_SUBT &&
+                    p_block->i_buffer >= 2 )
                 {
-                    msg_Warn( p_demux, "track[0x%x] will be disabled (eof?)",
-                              tk->i_track_ID );
-                    MP4_TrackUnselect( p_demux, tk );
-                    break;
-                }
+                    size_t i_size = GetWBE( p_block->p_buffer );
 
-                else if( tk->fmt.i_cat == SPU_ES )
-                {
-                    if( tk->fmt.i_codec == VLC_CODEC_SUBT &&
-                        p_block->i_buffer >= 2 )
+                    if( i_size + 2 <= p_block->i_buffer )
                     {
-                        size_t i_size = GetWBE( p_block->p_buffer );
-
-                        if( i_size + 2 <= p_block->i_buffer )
-                        {
-                            char *p;
-                            /* remove the length field, and append a '\0' */
-                            memmove( &p_block->p_buffer[0],
-                                     &p_block->p_buffer[2], i_size );
-                            p_block->p_buffer[i_size] = '\0';
-                            p_block->i_buffer = i_size + 1;
-
-                            /* convert \r -> \n */
-                            while( ( p = strchr((char *) p_block->p_buffer, '\r' ) ) )
-                            {
-                                *p = '\n';
-                            }
-                        }
-                        else
+                        char *p;
+                        /* remove the length field, and append a '\0' */
+                        memmove( &p_block->p_buffer[0],
+                                 &p_block->p_buffer[2], i_size );
+                        p_block->p_buffer[i_size] = '\0';
+                        p_block->i_buffer = i_size + 1;
+
+                        /* convert \r -> \n */
+                        while( ( p = strchr((char *) p_block->p_buffer, '\r' ) ) )
                         {
-                            /* Invalid */
-                            p_block->i_buffer = 0;
+                            *p = '\n';
                         }
                     }
+                    else
+                    {
+                        /* Invalid */
+                        p_block->i_buffer = 0;
+                    }
                 }
-                /* dts */
-                p_block->i_dts = VLC_TS_0 + MP4_TrackGetDTS( p_demux, tk );
-                /* pts */
-                i_delta = MP4_TrackGetPTSDelta( p_demux, tk );
-                if( i_delta != -1 )
-                    p_block->i_pts = p_block->i_dts + i_delta;
-                else if( tk->fmt.i_cat != VIDEO_ES )
-                    p_block->i_pts = p_block->i_dts;
-                else
-                    p_block->i_pts = VLC_TS_INVALID;
-
-                es_out_Send( p_demux->out, tk->p_es, p_block );
             }
+            /* dts */
+            p_block->i_dts = VLC_TS_0 + MP4_TrackGetDTS( p_demux, tk );
+            /* pts */
+            i_delta = MP4_TrackGetPTSDelta( p_demux, tk );
+            if( i_delta != -1 )
+                p_block->i_pts = p_block->i_dts + i_delta;
+            else if( tk->fmt.i_cat != VIDEO_ES )
+                p_block->i_pts = p_block->i_dts;
+            else
+                p_block->i_pts = VLC_TS_INVALID;
 
-            /* Next sample */
-            if( MP4_TrackNextSample( p_demux, tk ) )
-                break;
+            es_out_Send( p_demux->out, tk->p_es, p_block );
         }
+
+        /* Next sample, the track is done at the end or on error */
+        MP4_TrackNextSample( p_demux, tk );
     }
 
     return 1;
@@ -1376,15 +1450,10 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     MP4_Box_t *p_box;
     MP4_Box_data_stsz_t *stsz;
     MP4_Box_data_stts_t *stts;
+    MP4_Box_data_ctts_t *ctts = NULL;
     /* TODO use also stss and stsh table for seeking */
     /* FIXME use edit table */
-    int64_t i_sample;
-    int64_t i_chunk;
-
-    int64_t i_index;
-    int64_t i_index_sample_used;
-
-    int64_t i_next_dts;
+    mp4_cursor_t dts, pts;
 
     /* Find stsz
      *  Gives the sample size for each samples. There is also a stz2 table
@@ -1409,7 +1478,18 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     }
     stts = p_box->data.p_stts;
 
-    /* Use stsz table to create a sample number -> sample size table */
+    /* Find ctts
+     *  Gives the delta between decoding time (dts) and composition table (pts)
+     */
+    p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
+    if( p_box )
+    {
+        ctts = p_box->data.p_ctts;
+        msg_Warn( p_demux, "CTTS table" );
+    }
+
+    /* Use stsz table as the sample number -> sample size table, the box
+     * lives as long as the track */
     p_demux_track->i_sample_count = stsz->i_sample_count;
     if( stsz->i_sample_size )
     {
@@ -1421,154 +1501,54 @@ static int TrackCreateSamplesIndex( demux_t *p_demux,
     {
         /* 2: each sample can have a different size */
         p_demux_track->i_sample_size = 0;
-        p_demux_track->p_sample_size =
-            calloc( p_demux_track->i_sample_count, sizeof( uint32_t ) );
-        if( p_demux_track->p_sample_size == NULL )
-            return VLC_ENOMEM;
-
-        for( i_sample = 0; i_sample < p_demux_track->i_sample_count; i_sample++ )
-        {
-            p_demux_track->p_sample_size[i_sample] =
-                    stsz->i_entry_size[i_sample];
-        }
+        p_demux_track->p_sample_size = stsz->i_entry_size;
     }
+    p_demux_track->i_pos_sample = 0;
+    p_demux_track->i_pos = 0;
 
-    /* Use stts table to create a sample number -> dts table.
-     * XXX: if we don't want to waste too much memory, we can't expand
-     *  the box! so each chunk will contain an "extract" of this table
-     *  for fast research (problem with raw stream where a sample is sometime
-     *  just channels*bits_per_sample/8 */
+    /* The stts and ctts tables are not expanded, as raw streams can have a
+     * sample for each channels*bits_per_sample/8 bytes: each chunk only
+     * saves where its first sample is in them, the dts and pts are then
+     * computed from there (see MP4_TrackGetDTS and MP4_TrackGetPTSDelta) */
+    p_demux_track->p_stts = stts;
+    p_demux_track->p_ctts = ctts;
+    memset( &dts, 0, sizeof( dts ) );
+    memset( &pts, 0, sizeof( pts ) );
+    p_demux_track->dts_cursor = dts;
+    p_demux_track->pts_cursor = pts;
 
-    i_next_dts = 0;
-    i_index = 0; i_index_sample_used = 0;
-    for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
+    for( uint32_t i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
     {
         mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-        int64_t i_entry, i_sample_count, i;
+        const uint32_t i_last = ck->i_sample_first + ck->i_sample_count;
 
         /* save first dts */
-        ck->i_first_dts = i_next_dts;
-        ck->i_last_dts  = i_next_dts;
-
-        /* count how many entries are needed for this chunk
-         * for p_sample_delta_dts and p_sample_count_dts */
-        i_sample_count = ck->i_sample_count;
-
-        i_entry = 0;
-        while( i_sample_count > 0 )
-        {
-            i_sample_count -= stts->i_sample_count[i_index+i_entry];
-            /* don't count already used sample in this entry */
-            if( i_entry == 0 )
-                i_sample_count += i_index_sample_used;
-
-            i_entry++;
-        }
-
-        /* allocate them */
-        ck->p_sample_count_dts = calloc( i_entry, sizeof( uint32_t ) );
-        ck->p_sample_delta_dts = calloc( i_entry, sizeof( uint32_t ) );
-
-        if( !ck->p_sample_count_dts || !ck->p_sample_delta_dts )
-            return VLC_ENOMEM;
+        ck->i_first_dts  = dts.i_dts;
+        ck->i_last_dts   = dts.i_dts;
+        ck->i_stts_entry = dts.i_entry;
+        ck->i_stts_used  = dts.i_used;
 
-        /* now copy */
-        i_sample_count = ck->i_sample_count;
-        for( i = 0; i < i_entry; i++ )
+        if( ck->i_sample_count > 0 )
         {
-            int64_t i_used;
-            int64_t i_rest;
-
-            i_rest = stts->i_sample_count[i_index] - i_index_sample_used;
-
-            i_used = __MIN( i_rest, i_sample_count );
-
-            i_index_sample_used += i_used;
-            i_sample_count -= i_used;
-            i_next_dts += i_used * stts->i_sample_delta[i_index];
-
-            ck->p_sample_count_dts[i] = i_used;
-            ck->p_sample_delta_dts[i] = stts->i_sample_delta[i_index];
-            if( i_used > 0 )
-                ck->i_last_dts = i_next_dts - ck->p_sample_delta_dts[i];
-
-            if( i_index_sample_used >= stts->i_sample_count[i_index] )
-            {
-                i_index++;
-                i_index_sample_used = 0;
-            }
+            MP4_CursorForward( &dts, i_last - 1, stts->i_entry_count,
+                               stts->i_sample_count, stts->i_sample_delta );
+            ck->i_last_dts = dts.i_dts;
         }
-    }
-
-    /* Find ctts
-     *  Gives the delta between decoding time (dts) and composition table (pts)
-     */
-    p_box = MP4_BoxGet( p_demux_track->p_stbl, "ctts" );
-    if( p_box )
-    {
-        MP4_Box_data_ctts_t *ctts = p_box->data.p_ctts;
-
-        msg_Warn( p_demux, "CTTS table" );
+        MP4_CursorForward( &dts, i_last, stts->i_entry_count,
+                           stts->i_sample_count, stts->i_sample_delta );
 
-        /* Create pts-dts table per chunk */
-        i_index = 0; i_index_sample_used = 0;
-        for( i_chunk = 0; i_chunk < p_demux_track->i_chunk_count; i_chunk++ )
+        if( ctts )
         {
-            mp4_chunk_t *ck = &p_demux_track->chunk[i_chunk];
-            int64_t i_entry, i_sample_count, i;
-
-            /* count how many entries are needed for this chunk
-             * for p_sample_delta_dts and p_sample_count_dts */
-            i_sample_count = ck->i_sample_count;
-
-            i_entry = 0;
-            while( i_sample_count > 0 )
-            {
-                i_sample_count -= ctts->i_sample_count[i_index+i_entry];
-
-                /* don't count already used sample in this entry */
-                if( i_entry == 0 )
-                    i_sample_count += i_index_sample_used;
-
-                i_entry++;
-            }
-
-            /* allocate them */
-            ck->p_sample_count_pts = calloc( i_entry, sizeof( uint32_t ) );
-            ck->p_sample_offset_pts = calloc( i_entry, sizeof( int32_t ) );
-            if( !ck->p_sample_count_pts || !ck->p_sample_offset_pts )
-                return VLC_ENOMEM;
-
-            /* now copy */
-            i_sample_count = ck->i_sample_count;
-            for( i = 0; i < i_entry; i++ )
-            {
-                int64_t i_used;
-                int64_t i_rest;
-
-                i_rest = ctts->i_sample_count[i_index] -
-                    i_index_sample_used;
-
-                i_used = __MIN( i_rest, i_sample_count );
-
-                i_index_sample_used += i_used;
-                i_sample_count -= i_used;
-
-                ck->p_sample_count_pts[i] = i_used;
-                ck->p_sample_offset_pts[i] = ctts->i_sample_offset[i_index];
-
-                if( i_index_sample_used >= ctts->i_sample_count[i_index] )
-                {
-                    i_index++;
-                    i_index_sample_used = 0;
-                }
-            }
+            ck->i_ctts_entry = pts.i_entry;
+            ck->i_ctts_used  = pts.i_used;
+            MP4_CursorForward( &pts, i_last, ctts->i_entry_count,
+                               ctts->i_sample_count, NULL );
         }
     }
 
     msg_Dbg( p_demux, "track[Id 0x%x] read %d samples length:%"PRId64"s",
              p_demux_track->i_track_ID, p_demux_track->i_sample_count,
-             i_next_dts / p_demux_track->i_timescale );
+             dts.i_dts / p_demux_track->i_timescale );
 
     return VLC_SUCCESS;
 }
@@ -2239,10 +2219,8 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
 {
     demux_sys_t *p_sys = p_demux->p_sys;
     MP4_Box_t   *p_box_stss;
-    uint64_t     i_dts;
     unsigned int i_sample;
     unsigned int i_chunk;
-    int          i_index;
 
     /* FIXME see if it's needed to check p_track->i_chunk_count */
     if( p_track->i_chunk_count == 0 )
@@ -2286,49 +2264,63 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         i_start = i_start * p_track->i_timescale / (int64_t)1000000;
     }
 
-    /* we start from sample 0/chunk 0, hope it won't take too much time */
-    /* *** find good chunk *** */
-    for( i_chunk = 0; ; i_chunk++ )
+    /* *** find good chunk: the last one starting before i_start, the
+     * first dts of the chunks being a sparse index of the stts table *** */
+    unsigned int i_low = 0;
+    unsigned int i_high = p_track->i_chunk_count - 1;
+    while( i_low < i_high )
     {
-        if( i_chunk + 1 >= p_track->i_chunk_count )
-        {
-            /* at the end and can't check if i_start in this chunk,
-               it will be check while searching i_sample */
-            i_chunk = p_track->i_chunk_count - 1;
-            break;
-        }
+        unsigned int i_mid = i_low + ( i_high - i_low + 1 ) / 2;
 
-        if( (uint64_t)i_start >= p_track->chunk[i_chunk].i_first_dts &&
-            (uint64_t)i_start <  p_track->chunk[i_chunk + 1].i_first_dts )
-        {
-            break;
-        }
+        if( p_track->chunk[i_mid].i_first_dts <= (uint64_t)i_start )
+            i_low = i_mid;
+        else
+            i_high = i_mid - 1;
     }
+    i_chunk = i_low;
+    /* empty chunks start with the next one */
+    while( i_chunk + 1 < p_track->i_chunk_count &&
+           p_track->chunk[i_chunk].i_sample_count == 0 )
+        i_chunk++;
 
     /* *** find sample in the chunk *** */
-    i_sample = p_track->chunk[i_chunk].i_sample_first;
-    i_dts    = p_track->chunk[i_chunk].i_first_dts;
-    for( i_index = 0; i_sample < p_track->chunk[i_chunk].i_sample_count; )
+    const mp4_chunk_t *ck = &p_track->chunk[i_chunk];
+    MP4_Box_data_stts_t *stts = p_track->p_stts;
+    mp4_cursor_t cur = {
+        .i_sample = ck->i_sample_first,
+        .i_entry = ck->i_stts_entry,
+        .i_used = ck->i_stts_used,
+        .i_dts = ck->i_first_dts,
+    };
+    const uint32_t i_last = ck->i_sample_first + ck->i_sample_count;
+
+    i_sample = ck->i_sample_first;
+    while( cur.i_sample < i_last && cur.i_entry < stts->i_entry_count )
     {
-        if( i_dts +
-            p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-            p_track->chunk[i_chunk].p_sample_delta_dts[i_index] < (uint64_t)i_start )
+        if( stts->i_sample_count[cur.i_entry] <= cur.i_used )
         {
-            i_dts    +=
-                p_track->chunk[i_chunk].p_sample_count_dts[i_index] *
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            /* empty entry, as left by a truncated stts */
+            cur.i_entry++;
+            cur.i_used = 0;
+            continue;
+        }
 
-            i_sample += p_track->chunk[i_chunk].p_sample_count_dts[i_index];
-            i_index++;
+        uint32_t i_count = __MIN( stts->i_sample_count[cur.i_entry] - cur.i_used,
+                                  i_last - cur.i_sample );
+        int64_t i_delta = stts->i_sample_delta[cur.i_entry];
+
+        if( cur.i_dts + i_count * i_delta < i_start )
+        {
+            MP4_CursorForward( &cur, cur.i_sample + i_count,
+                               stts->i_entry_count, stts->i_sample_count,
+                               stts->i_sample_delta );
+            i_sample = cur.i_sample;
         }
         else
         {
-            if( p_track->chunk[i_chunk].p_sample_delta_dts[i_index] <= 0 )
-            {
-                break;
-            }
-            i_sample += ( i_start - i_dts ) /
-                p_track->chunk[i_chunk].p_sample_delta_dts[i_index];
+            i_sample = cur.i_sample;
+            if( i_delta > 0 && i_start > cur.i_dts )
+                i_sample += ( i_start - cur.i_dts ) / i_delta;
             break;
         }
     }
@@ -2348,31 +2340,40 @@ static int TrackTimeToSampleChunk( demux_t *p_demux, mp4_track_t *p_track,
         MP4_Box_data_stss_t *p_stss = p_box_stss->data.p_stss;
         msg_Dbg( p_demux, "track[Id 0x%x] using Sync Sample Box (stss)",
                  p_track->i_track_ID );
-        for( unsigned i_index = 0; i_index < p_stss->i_entry_count; i_index++ )
+
+        /* the last sync sample not after i_sample, or the first one */
+        i_low = 0;
+        i_high = p_stss->i_entry_count > 0 ? p_stss->i_entry_count - 1 : 0;
+        while( i_low < i_high )
         {
-            if( i_index >= p_stss->i_entry_count - 1 ||
-                i_sample < p_stss->i_sample_number[i_index+1] )
-            {
-                unsigned i_sync_sample = p_stss->i_sample_number[i_index];
-                msg_Dbg( p_demux, "stts gives %d --> %d (sample number)",
-                         i_sample, i_sync_sample );
+            unsigned int i_mid = i_low + ( i_high - i_low + 1 ) / 2;
 
-                if( i_sync_sample <= i_sample )
-                {
-                    while( i_chunk > 0 &&
-                           i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
-                        i_chunk--;
-                }
-                else
-                {
-                    while( i_chunk < p_track->i_chunk_count - 1 &&
-                           i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
-                                            p_track->chunk[i_chunk].i_sample_count )
-                        i_chunk++;
-                }
-                i_sample = i_sync_sample;
-                break;
+            if( p_stss->i_sample_number[i_mid] <= i_sample )
+                i_low = i_mid;
+            else
+                i_high = i_mid - 1;
+        }
+
+        if( p_stss->i_entry_count > 0 )
+        {
+            unsigned i_sync_sample = p_stss->i_sample_number[i_low];
+            msg_Dbg( p_demux, "stts gives %d --> %d (sample number)",
+                     i_sample, i_sync_sample );
+
+            if( i_sync_sample <= i_sample )
+            {
+                while( i_chunk > 0 &&
+                       i_sync_sample < p_track->chunk[i_chunk].i_sample_first )
+                    i_chunk--;
             }
+            else
+            {
+                while( i_chunk < p_track->i_chunk_count - 1 &&
+                       i_sync_sample >= p_track->chunk[i_chunk].i_sample_first +
+                                        p_track->chunk[i_chunk].i_sample_count )
+                    i_chunk++;
+            }
+            i_sample = i_sync_sample;
         }
     }
     else
@@ -2683,34 +2684,25 @@ static void FreeAndResetChunk( mp4_chunk_t *ck )
  ****************************************************************************/
 static void MP4_TrackDestroy( mp4_track_t *p_track )
 {
-    unsigned int i_chunk;
-
     p_track->b_ok = false;
     p_track->b_enable   = false;
     p_track->b_selected = false;
 
     es_format_Clean( &p_track->fmt );
 
-    for( i_chunk = 0; i_chunk < p_track->i_chunk_count; i_chunk++ )
-    {
-        if( p_track->chunk )
-        {
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_dts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_delta_dts );
-
-           FREENULL(p_track->chunk[i_chunk].p_sample_count_pts);
-           FREENULL(p_track->chunk[i_chunk].p_sample_offset_pts );
-        }
-    }
+    /* the sample tables belong to the boxes */
     FREENULL( p_track->chunk );
     if( p_track->cchunk ) {
         FreeAndResetChunk( p_track->cchunk );
         FREENULL( p_track->cchunk );
     }
-
-    if( !p_track->i_sample_size )
+    p_track->p_sample_size = NULL;
+    p_track->p_stts = NULL;
+    p_track->p_ctts = NULL;
+    if( p_track->p_readahead )
     {
-        FREENULL( p_track->p_sample_size );
+        block_Release( p_track->p_readahead );
+        p_track->p_readahead = NULL;
     }
 }
 
@@ -2752,6 +2744,12 @@ static void MP4_TrackUnselect( demux_t *p_demux, mp4_track_t *p_track )
     }
 
     p_track->b_selected = false;
+
+    if( p_track->p_readahead )
+    {
+        block_Release( p_track->p_readahead );
+        p_track->p_readahead = NULL;
+    }
 }
 
 static int MP4_TrackSeek( demux_t *p_demux, mp4_track_t *p_track,
@@ -2861,16 +2859,100 @@ static uint64_t MP4_TrackGetPos( mp4_track_t *p_track )
     }
     else
     {
-        for( i_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
+        /* go on from the last sample if it is in the chunk */
+        if( p_track->i_pos_sample < p_track->chunk[p_track->i_chunk].i_sample_first ||
+            p_track->i_pos_sample > p_track->i_sample )
+        {
+            p_track->i_pos_sample = p_track->chunk[p_track->i_chunk].i_sample_first;
+            p_track->i_pos = 0;
+        }
+        for( i_sample = p_track->i_pos_sample;
              i_sample < p_track->i_sample; i_sample++ )
         {
-            i_pos += p_track->p_sample_size[i_sample];
+            p_track->i_pos += p_track->p_sample_size[i_sample];
         }
+        p_track->i_pos_sample = p_track->i_sample;
+        i_pos += p_track->i_pos;
     }
 
     return i_pos;
 }
 
+/* Largest amount of data read at once for the samples of a track */
+#define MP4_READAHEAD_MAX (1024 * 1024)
+
+/* Reads i_size bytes at i_pos, the data of the current sample of a track.
+ * When the samples have a size table, the following samples of the track
+ * stored right after this one are read too, up to MP4_READAHEAD_MAX bytes,
+ * and kept for the next calls. Badly interleaved files then do not cost a
+ * seek and a small read per sample */
+static block_t *MP4_TrackReadSample( demux_t *p_demux, mp4_track_t *p_track,
+                                     uint64_t i_pos, int i_size )
+{
+    block_t *p_ra = p_track->p_readahead;
+    uint64_t i_run = i_size;
+
+    if( p_ra && i_pos >= p_track->i_readahead_pos &&
+        i_pos + i_size <= p_track->i_readahead_pos + p_ra->i_buffer )
+    {
+        block_t *p_block = block_Alloc( i_size );
+        if( p_block )
+            memcpy( p_block->p_buffer,
+                    &p_ra->p_buffer[i_pos - p_track->i_readahead_pos], i_size );
+        return p_block;
+    }
+
+    if( p_ra )
+    {
+        block_Release( p_ra );
+        p_track->p_readahead = NULL;
+    }
+
+    if( p_track->i_sample_size == 0 )
+    {
+        const mp4_chunk_t *ck = &p_track->chunk[p_track->i_chunk];
+        uint32_t i_chunk = p_track->i_chunk;
+        bool b_contiguous = true;
+
+        for( uint32_t i_sample = p_track->i_sample + 1;
+             i_sample < p_track->i_sample_count && b_contiguous; i_sample++ )
+        {
+            /* the next non empty chunk must follow in the file */
+            while( i_sample >= ck->i_sample_first + ck->i_sample_count )
+            {
+                if( ++i_chunk >= p_track->i_chunk_count )
+                {
+                    b_contiguous = false;
+                    break;
+                }
+                ck = &p_track->chunk[i_chunk];
+                if( ck->i_sample_count > 0 && ck->i_offset != i_pos + i_run )
+                {
+                    b_contiguous = false;
+                    break;
+                }
+            }
+            if( !b_contiguous ||
+                i_run + p_track->p_sample_size[i_sample] > MP4_READAHEAD_MAX )
+                break;
+            i_run += p_track->p_sample_size[i_sample];
+        }
+    }
+
+    if( stream_Seek( p_demux->s, i_pos ) )
+        return NULL;
+    if( i_run == (uint64_t)i_size )
+        return stream_Block( p_demux->s, i_size );
+
+    p_ra = stream_Block( p_demux->s, i_run );
+    if( p_ra == NULL || p_ra->i_buffer < (size_t)i_size )
+        return p_ra; /* truncated */
+
+    p_track->p_readahead = p_ra;
+    p_track->i_readahead_pos = i_pos;
+    return MP4_TrackReadSample( p_demux, p_track, i_pos, i_size );
+}
+
 static int MP4_TrackNextSample( demux_t *p_demux, mp4_track_t *p_track )
 {
     if( p_track->fmt.i_cat == AUDIO_ES && p_track->i_sample_size != 0 )
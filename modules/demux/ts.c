@@ -298,8 +298,26 @@ struct demux_sys_t
     mtime_t     *p_pcrs;
     int64_t     *p_pos;
 
-    /* All pid */
-    ts_pid_t    pid[8192];
+    /* PIDs in use, allocated on first sight. Their numbers are kept sorted
+     * in a compact array for the lookup of each packet PID. */
+    int         i_pids;
+    int         i_pids_alloc;
+    uint16_t    *pi_pids;
+    ts_pid_t    **pp_pids;
+    ts_pid_t    *p_last_pid; /* last lookup */
+
+    /* SDT/EIT/TDT parsing thread */
+    struct
+    {
+        vlc_mutex_t  lock; /* fields shared with the SI callbacks */
+        block_fifo_t *fifo;
+        vlc_thread_t thread;
+        ts_pid_t     *pat;
+        ts_pid_t     *sdt;
+        ts_pid_t     *eit;
+        ts_pid_t     *tdt;
+        unsigned     i_dropped;
+    } si;
 
     /* All PMT */
     bool        b_user_pmt;
@@ -354,6 +372,12 @@ static inline int PIDGet( block_t *p )
     return ( (p->p_buffer[1]&0x1f)<<8 )|p->p_buffer[2];
 }
 
+static ts_pid_t *GetPID( demux_sys_t *, int i_pid );
+
+static int  SIStart( demux_t * );
+static void SIStop( demux_t * );
+static void SIQueue( demux_t *, block_t * );
+
 static bool GatherData( demux_t *p_demux, ts_pid_t *pid, block_t *p_bk );
 
 static block_t* ReadTSPacket( demux_t *p_demux );
@@ -536,16 +560,14 @@ static int Open( vlc_object_t *p_this )
 
     p_sys->b_broken_charset = false;
 
-    for( int i = 0; i < 8192; i++ )
-    {
-        ts_pid_t *pid = &p_sys->pid[i];
+    p_sys->i_pids = 0;
+    p_sys->i_pids_alloc = 0;
+    p_sys->pi_pids = NULL;
+    p_sys->pp_pids = NULL;
+    p_sys->p_last_pid = NULL;
+    vlc_mutex_init( &p_sys->si.lock );
+    p_sys->si.fifo = NULL;
 
-        pid->i_pid      = i;
-        pid->b_seen     = false;
-        pid->b_valid    = false;
-    }
-    /* PID 8191 is padding */
-    p_sys->pid[8191].b_seen = true;
     p_sys->i_packet_size = i_packet_size;
     p_sys->b_udp_out = false;
     p_sys->fd = -1;
@@ -554,13 +576,13 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_start_record = false;
 
     /* Init PAT handler */
-    pat = &p_sys->pid[0];
+    pat = p_sys->si.pat = GetPID( p_sys, 0 );
     PIDInit( pat, true, NULL );
     pat->psi->handle = dvbpsi_AttachPAT( PATCallBack, p_demux );
     if( p_sys->b_dvb_meta )
     {
-        ts_pid_t *sdt = &p_sys->pid[0x11];
-        ts_pid_t *eit = &p_sys->pid[0x12];
+        ts_pid_t *sdt = p_sys->si.sdt = GetPID( p_sys, 0x11 );
+        ts_pid_t *eit = p_sys->si.eit = GetPID( p_sys, 0x12 );
 
         PIDInit( sdt, true, NULL );
         sdt->psi->handle =
@@ -571,7 +593,7 @@ static int Open( vlc_object_t *p_this )
             dvbpsi_AttachDemux( (dvbpsi_demux_new_cb_t)PSINewTableCallBack,
                                 p_demux );
 
-        ts_pid_t *tdt = &p_sys->pid[0x14];
+        ts_pid_t *tdt = p_sys->si.tdt = GetPID( p_sys, 0x14 );
         PIDInit( tdt, true, NULL );
         tdt->psi->handle =
             dvbpsi_AttachDemux( (dvbpsi_demux_new_cb_t)PSINewTableCallBack,
@@ -583,6 +605,10 @@ static int Open( vlc_object_t *p_this )
                 SetPIDFilter( p_demux, 0x12, true ) )
                 p_sys->b_access_control = false;
         }
+
+        /* Keep the SI parsing and EPG building off the demux thread */
+        if( SIStart( p_demux ) )
+            msg_Warn( p_demux, "parsing SI tables in the demux thread" );
     }
 
     /* Init PMT array */
@@ -723,10 +749,12 @@ static void Close( vlc_object_t *p_this )
     demux_t     *p_demux = (demux_t*)p_this;
     demux_sys_t *p_sys = p_demux->p_sys;
 
+    SIStop( p_demux );
+
     msg_Dbg( p_demux, "pid list:" );
-    for( int i = 0; i < 8192; i++ )
+    for( int i = 0; i < p_sys->i_pids; i++ )
     {
-        ts_pid_t *pid = &p_sys->pid[i];
+        ts_pid_t *pid = p_sys->pp_pids[i];
 
         if( pid->b_valid && pid->psi )
         {
@@ -768,6 +796,11 @@ static void Close( vlc_object_t *p_this )
             SetPIDFilter( p_demux, pid->i_pid, false );
     }
 
+    for( int i = 0; i < p_sys->i_pids; i++ )
+        free( p_sys->pp_pids[i] );
+    free( p_sys->pp_pids );
+    free( p_sys->pi_pids );
+
     vlc_mutex_lock( &p_sys->csa_lock );
     if( p_sys->csa )
     {
@@ -792,6 +825,7 @@ static void Close( vlc_object_t *p_this )
     free( p_sys->p_pcrs );
     free( p_sys->p_pos );
 
+    vlc_mutex_destroy( &p_sys->si.lock );
     vlc_mutex_destroy( &p_sys->csa_lock );
     free( p_sys );
 }
@@ -850,13 +884,20 @@ static int Demux( demux_t *p_demux )
         }
 
         /* Parse the TS packet */
-        ts_pid_t *p_pid = &p_sys->pid[PIDGet( p_pkt )];
+        ts_pid_t *p_pid = GetPID( p_sys, PIDGet( p_pkt ) );
 
         if( p_pid->b_valid )
         {
             if( p_pid->psi )
             {
-                if( p_pid->i_pid == 0 || ( p_sys->b_dvb_meta && ( p_pid->i_pid == 0x11 || p_pid->i_pid == 0x12 || p_pid->i_pid == 0x14 ) ) )
+                if( p_sys->si.fifo != NULL &&
+                    ( p_pid->i_pid == 0x11 || p_pid->i_pid == 0x12 || p_pid->i_pid == 0x14 ) )
+                {
+                    /* SDT/EIT/TDT go to the SI thread */
+                    SIQueue( p_demux, p_pkt );
+                    p_pkt = NULL;
+                }
+                else if( p_pid->i_pid == 0 || ( p_sys->b_dvb_meta && ( p_pid->i_pid == 0x11 || p_pid->i_pid == 0x12 || p_pid->i_pid == 0x14 ) ) )
                 {
                     dvbpsi_PushPacket( p_pid->psi->handle, p_pkt->p_buffer );
                 }
@@ -868,7 +909,8 @@ static int Demux( demux_t *p_demux )
                                            p_pkt->p_buffer );
                     }
                 }
-                block_Release( p_pkt );
+                if( p_pkt != NULL )
+                    block_Release( p_pkt );
             }
             else if( !p_sys->b_udp_out )
             {
@@ -912,11 +954,15 @@ static int Demux( demux_t *p_demux )
 static int DVBEventInformation( demux_t *p_demux, int64_t *pi_time, int64_t *pi_length )
 {
     demux_sys_t *p_sys = p_demux->p_sys;
+    int i_ret = VLC_EGENERIC;
+
     if( pi_length )
         *pi_length = 0;
     if( pi_time )
         *pi_time = 0;
 
+    /* Those are set by the SI callbacks */
+    vlc_mutex_lock( &p_sys->si.lock );
     if( p_sys->i_dvb_length > 0 )
     {
         const int64_t t = mdate() + p_sys->i_tdt_delta;
@@ -927,10 +973,11 @@ static int DVBEventInformation( demux_t *p_demux, int64_t *pi_time, int64_t *pi_
                 *pi_length = p_sys->i_dvb_length;
             if( pi_time )
                 *pi_time   = t - p_sys->i_dvb_start;
-            return VLC_SUCCESS;
+            i_ret = VLC_SUCCESS;
         }
     }
-    return VLC_EGENERIC;
+    vlc_mutex_unlock( &p_sys->si.lock );
+    return i_ret;
 }
 
 static int Control( demux_t *p_demux, int i_query, va_list args )
@@ -1045,12 +1092,16 @@ static int Control( demux_t *p_demux, int i_query, va_list args )
 
         if( i_int > 0 )
         {
+            vlc_mutex_lock( &p_sys->si.lock );
             p_sys->i_current_program = i_int;
+            vlc_mutex_unlock( &p_sys->si.lock );
             SetPrgFilter( p_demux, p_sys->i_current_program, true );
         }
         else if( i_int < 0 )
         {
+            vlc_mutex_lock( &p_sys->si.lock );
             p_sys->i_current_program = -1;
+            vlc_mutex_unlock( &p_sys->si.lock );
             p_sys->programs_list.i_count = 0;
             if( p_list )
             {
@@ -1118,7 +1169,7 @@ static int UserPmt( demux_t *p_demux, const char *psz_fmt )
         i_number = strtol( &psz[1], &psz, 0 );
 
     /* */
-    ts_pid_t *pmt = &p_sys->pid[i_pid];
+    ts_pid_t *pmt = GetPID( p_sys, i_pid );
     ts_prg_psi_t *prg;
 
     msg_Dbg( p_demux, "user pmt specified (pid=%d,number=%d)", i_pid, i_number );
@@ -1159,9 +1210,9 @@ static int UserPmt( demux_t *p_demux, const char *psz_fmt )
         {
             prg->i_pid_pcr = i_pid;
         }
-        else if( !p_sys->pid[i_pid].b_valid )
+        else if( !GetPID( p_sys, i_pid )->b_valid )
         {
-            ts_pid_t *pid = &p_sys->pid[i_pid];
+            ts_pid_t *pid = GetPID( p_sys, i_pid );
 
             char *psz_arg = strchr( psz_opt, '=' );
             if( psz_arg )
@@ -1264,11 +1315,11 @@ static void SetPrgFilter( demux_t *p_demux, int i_prg_id, bool b_selected )
         SetPIDFilter( p_demux, p_prg->i_pid_pcr, b_selected );
 
     /* All ES */
-    for( int i = 2; i < 8192; i++ )
+    for( int i = 0; i < p_sys->i_pids; i++ )
     {
-        ts_pid_t *pid = &p_sys->pid[i];
+        ts_pid_t *pid = p_sys->pp_pids[i];
 
-        if( !pid->b_valid || pid->psi )
+        if( pid->i_pid < 2 || !pid->b_valid || pid->psi )
             continue;
 
         for( int i_prg = 0; i_prg < pid->p_owner->i_prg; i_prg++ )
@@ -1276,13 +1327,152 @@ static void SetPrgFilter( demux_t *p_demux, int i_prg_id, bool b_selected )
             if( pid->p_owner->prg[i_prg]->i_pid_pmt == i_pmt_pid && pid->es->id )
             {
                 /* We only remove/select es that aren't defined by extra pmt */
-                SetPIDFilter( p_demux, i, b_selected );
+                SetPIDFilter( p_demux, pid->i_pid, b_selected );
                 break;
             }
         }
     }
 }
 
+/*****************************************************************************
+ * GetPID: look up a PID, creating its entry on first sight
+ *****************************************************************************/
+static ts_pid_t *GetPID( demux_sys_t *p_sys, int i_pid )
+{
+    ts_pid_t *pid = p_sys->p_last_pid;
+
+    /* Packets of a given PID mostly come in bursts */
+    if( likely(pid != NULL && pid->i_pid == i_pid) )
+        return pid;
+
+    int i_low = 0, i_high = p_sys->i_pids;
+    while( i_low < i_high )
+    {
+        const int i_mid = (i_low + i_high) / 2;
+
+        if( p_sys->pi_pids[i_mid] < i_pid )
+            i_low = i_mid + 1;
+        else
+            i_high = i_mid;
+    }
+
+    if( i_low < p_sys->i_pids && p_sys->pi_pids[i_low] == i_pid )
+    {
+        pid = p_sys->pp_pids[i_low];
+    }
+    else
+    {
+        pid = xcalloc( 1, sizeof( *pid ) );
+        pid->i_pid  = i_pid;
+        pid->b_seen = i_pid == 8191; /* PID 8191 is padding */
+
+        if( p_sys->i_pids == p_sys->i_pids_alloc )
+        {
+            p_sys->i_pids_alloc = __MAX( 32, 2 * p_sys->i_pids_alloc );
+            p_sys->pi_pids = xrealloc( p_sys->pi_pids,
+                            p_sys->i_pids_alloc * sizeof( *p_sys->pi_pids ) );
+            p_sys->pp_pids = xrealloc( p_sys->pp_pids,
+                            p_sys->i_pids_alloc * sizeof( *p_sys->pp_pids ) );
+        }
+        memmove( &p_sys->pi_pids[i_low + 1], &p_sys->pi_pids[i_low],
+                 (p_sys->i_pids - i_low) * sizeof( *p_sys->pi_pids ) );
+        memmove( &p_sys->pp_pids[i_low + 1], &p_sys->pp_pids[i_low],
+                 (p_sys->i_pids - i_low) * sizeof( *p_sys->pp_pids ) );
+        p_sys->pi_pids[i_low] = i_pid;
+        p_sys->pp_pids[i_low] = pid;
+        p_sys->i_pids++;
+    }
+
+    p_sys->p_last_pid = pid;
+    return pid;
+}
+
+/*****************************************************************************
+ * SI thread: SDT/EIT/TDT sections are parsed and the EPG is built there.
+ * The callbacks run with si.lock held, which protects the few demux_sys_t
+ * fields they share with the demux thread.
+ *****************************************************************************/
+#define TS_SI_QUEUE_MAX 8192 /* packets */
+
+static void *SIThread( void *data )
+{
+    demux_t *p_demux = data;
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    for( ;; )
+    {
+        block_t *p_pkt = block_FifoGet( p_sys->si.fifo );
+        int canc = vlc_savecancel();
+        ts_pid_t *pid;
+
+        switch( PIDGet( p_pkt ) )
+        {
+            case 0x11: pid = p_sys->si.sdt; break;
+            case 0x12: pid = p_sys->si.eit; break;
+            default:   pid = p_sys->si.tdt; break;
+        }
+
+        vlc_mutex_lock( &p_sys->si.lock );
+        dvbpsi_PushPacket( pid->psi->handle, p_pkt->p_buffer );
+        vlc_mutex_unlock( &p_sys->si.lock );
+
+        block_Release( p_pkt );
+        vlc_restorecancel( canc );
+    }
+    return NULL;
+}
+
+static int SIStart( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    /* Only the demux thread feeds the SI thread */
+    p_sys->si.fifo = block_FifoNewSPSC();
+    if( p_sys->si.fifo == NULL )
+        return VLC_ENOMEM;
+    p_sys->si.i_dropped = 0;
+
+    if( vlc_clone( &p_sys->si.thread, SIThread, p_demux,
+                   VLC_THREAD_PRIORITY_LOW ) )
+    {
+        block_FifoRelease( p_sys->si.fifo );
+        p_sys->si.fifo = NULL;
+        return VLC_EGENERIC;
+    }
+    return VLC_SUCCESS;
+}
+
+static void SIStop( demux_t *p_demux )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->si.fifo == NULL )
+        return;
+
+    vlc_cancel( p_sys->si.thread );
+    vlc_join( p_sys->si.thread, NULL );
+    block_FifoRelease( p_sys->si.fifo );
+    p_sys->si.fifo = NULL;
+
+    if( p_sys->si.i_dropped > 0 )
+        msg_Warn( p_demux, "%u SI packets dropped", p_sys->si.i_dropped );
+}
+
+static void SIQueue( demux_t *p_demux, block_t *p_pkt )
+{
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    /* SI tables are repeated: rather drop sections than grow without
+     * bounds if the SI thread cannot keep up */
+    if( block_FifoCount( p_sys->si.fifo ) >= TS_SI_QUEUE_MAX )
+    {
+        p_sys->si.i_dropped++;
+        block_Release( p_pkt );
+        return;
+    }
+    block_FifoPut( p_sys->si.fifo, p_pkt );
+}
+
 static void PIDInit( ts_pid_t *pid, bool b_psi, ts_psi_t *p_owner )
 {
     bool b_old_valid = pid->b_valid;
@@ -2570,11 +2760,12 @@ static void ValidateDVBMeta( demux_t *p_demux, int i_pid )
 
     /* This doesn't look like a DVB stream so don't try
      * parsing the SDT/EDT/TDT */
+    SIStop( p_demux );
 
     for( int i = 0x11; i <= 0x14; i++ )
     {
         if( i == 0x13 ) continue;
-        ts_pid_t *p_pid = &p_sys->pid[i];
+        ts_pid_t *p_pid = GetPID( p_sys, i );
         if( p_pid->psi )
         {
             dvbpsi_DetachDemux( p_pid->psi->handle );
@@ -2608,7 +2799,7 @@ static char *EITConvertToUTF8( const unsigned char *psz_instring,
 static void SDTCallBack( demux_t *p_demux, dvbpsi_sdt_t *p_sdt )
 {
     demux_sys_t          *p_sys = p_demux->p_sys;
-    ts_pid_t             *sdt = &p_sys->pid[0x11];
+    ts_pid_t             *sdt = p_sys->si.sdt;
     dvbpsi_sdt_service_t *p_srv;
 
     msg_Dbg( p_demux, "SDTCallBack called" );
@@ -2972,7 +3163,9 @@ static void PSINewTableCallBack( demux_t *p_demux, dvbpsi_handle h,
     msg_Dbg( p_demux, "PSINewTableCallBack: table 0x%x(%d) ext=0x%x(%d)",
              i_table_id, i_table_id, i_extension, i_extension );
 #endif
-    if( p_demux->p_sys->pid[0].psi->i_pat_version != -1 && i_table_id == 0x42 )
+    demux_sys_t *p_sys = p_demux->p_sys;
+
+    if( p_sys->si.pat->psi->i_pat_version != -1 && i_table_id == 0x42 )
     {
         msg_Dbg( p_demux, "PSINewTableCallBack: table 0x%x(%d) ext=0x%x(%d)",
                  i_table_id, i_table_id, i_extension, i_extension );
@@ -2980,7 +3173,7 @@ static void PSINewTableCallBack( demux_t *p_demux, dvbpsi_handle h,
         dvbpsi_AttachSDT( h, i_table_id, i_extension,
                           (dvbpsi_sdt_callback)SDTCallBack, p_demux );
     }
-    else if( p_demux->p_sys->pid[0x11].psi->i_sdt_version != -1 &&
+    else if( p_sys->si.sdt->psi->i_sdt_version != -1 &&
              ( i_table_id == 0x4e || /* Current/Following */
                (i_table_id >= 0x50 && i_table_id <= 0x5f) ) ) /* Schedule */
     {
@@ -2992,7 +3185,7 @@ static void PSINewTableCallBack( demux_t *p_demux, dvbpsi_handle h,
                                     (dvbpsi_eit_callback)EITCallBackSchedule;
         dvbpsi_AttachEIT( h, i_table_id, i_extension, cb, p_demux );
     }
-    else if( p_demux->p_sys->pid[0x11].psi->i_sdt_version != -1 &&
+    else if( p_sys->si.sdt->psi->i_sdt_version != -1 &&
               i_table_id == 0x70 )  /* TDT */
     {
          msg_Dbg( p_demux, "PSINewTableCallBack: table 0x%x(%d) ext=0x%x(%d)",
@@ -3751,9 +3944,9 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_pmt )
     ts_pid_t **pp_clean = NULL;
     int      i_clean = 0;
     /* Clean this program (remove all es) */
-    for( int i = 0; i < 8192; i++ )
+    for( int i = 0; i < p_sys->i_pids; i++ )
     {
-        ts_pid_t *pid = &p_sys->pid[i];
+        ts_pid_t *pid = p_sys->pp_pids[i];
 
         if( pid->b_valid && pid->p_owner == pmt->psi &&
             pid->i_owner_number == prg->i_number && pid->psi == NULL )
@@ -3813,11 +4006,12 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_pmt )
     for( p_es = p_pmt->p_first_es; p_es != NULL; p_es = p_es->p_next )
     {
         ts_pid_t tmp_pid, *old_pid = 0, *pid = &tmp_pid;
+        ts_pid_t *es_pid = GetPID( p_sys, p_es->i_pid );
 
         /* Find out if the PID was already declared */
         for( int i = 0; i < i_clean; i++ )
         {
-            if( pp_clean[i] == &p_sys->pid[p_es->i_pid] )
+            if( pp_clean[i] == es_pid )
             {
                 old_pid = pp_clean[i];
                 break;
@@ -3825,7 +4019,7 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_pmt )
         }
         ValidateDVBMeta( p_demux, p_es->i_pid );
 
-        if( !old_pid && p_sys->pid[p_es->i_pid].b_valid )
+        if( !old_pid && es_pid->b_valid )
         {
             msg_Warn( p_demux, "pmt error: pid=%d already defined",
                       p_es->i_pid );
@@ -3843,7 +4037,7 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_pmt )
         PIDFillFormat( pid->es, p_es->i_type );
         pid->i_owner_number = prg->i_number;
         pid->i_pid          = p_es->i_pid;
-        pid->b_seen         = p_sys->pid[p_es->i_pid].b_seen;
+        pid->b_seen         = es_pid->b_seen;
 
         if( p_es->i_type == 0x10 || p_es->i_type == 0x11 ||
             p_es->i_type == 0x12 || p_es->i_type == 0x0f )
@@ -3945,7 +4139,7 @@ static void PMTCallBack( void *data, dvbpsi_pmt_t *p_pmt )
             PIDClean( p_demux, old_pid );
             TAB_REMOVE( i_clean, pp_clean, old_pid );
         }
-        p_sys->pid[p_es->i_pid] = *pid;
+        *es_pid = *pid;
 
         p_dr = PMTEsFindDescriptor( p_es, 0x09 );
         if( p_dr && p_dr->i_length >= 2 )
@@ -3981,7 +4175,7 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
     demux_t              *p_demux = data;
     demux_sys_t          *p_sys = p_demux->p_sys;
     dvbpsi_pat_program_t *p_program;
-    ts_pid_t             *pat = &p_sys->pid[0];
+    ts_pid_t             *pat = p_sys->si.pat;
 
     msg_Dbg( p_demux, "PATCallBack called" );
 
@@ -4027,11 +4221,11 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
         }
 
         /* Delete all ES attached to thoses PMT */
-        for( int i = 2; i < 8192; i++ )
+        for( int i = 0; i < p_sys->i_pids; i++ )
         {
-            ts_pid_t *pid = &p_sys->pid[i];
+            ts_pid_t *pid = p_sys->pp_pids[i];
 
-            if( !pid->b_valid || pid->psi )
+            if( pid->i_pid < 2 || !pid->b_valid || pid->psi )
                 continue;
 
             for( int j = 0; j < i_pmt_rm && pid->b_valid; j++ )
@@ -4043,7 +4237,7 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
                         continue;
 
                     if( pid->es->id )
-                        SetPIDFilter( p_demux, i, false );
+                        SetPIDFilter( p_demux, pid->i_pid, false );
 
                     PIDClean( p_demux, pid );
                     break;
@@ -4063,7 +4257,7 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
                 es_out_Control( p_demux->out, ES_OUT_DEL_GROUP, i_number );
             }
 
-            PIDClean( p_demux, &p_sys->pid[pid->i_pid] );
+            PIDClean( p_demux, pid );
             TAB_REMOVE( p_sys->i_pmt, p_sys->pmt, pid );
         }
 
@@ -4079,7 +4273,7 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
         if( p_program->i_number == 0 )
             continue;
 
-        ts_pid_t *pmt = &p_sys->pid[p_program->i_pid];
+        ts_pid_t *pmt = GetPID( p_sys, p_program->i_pid );
 
         ValidateDVBMeta( p_demux, p_program->i_pid );
 
@@ -4108,13 +4302,19 @@ static void PATCallBack( void *data, dvbpsi_pat_t *p_pat )
         if( ProgramIsSelected( p_demux, p_program->i_number ) )
         {
             if( p_sys->i_current_program == 0 )
+            {
+                vlc_mutex_lock( &p_sys->si.lock );
                 p_sys->i_current_program = p_program->i_number;
+                vlc_mutex_unlock( &p_sys->si.lock );
+            }
 
             if( SetPIDFilter( p_demux, p_program->i_pid, true ) )
                 p_sys->b_access_control = false;
         }
     }
+    vlc_mutex_lock( &p_sys->si.lock );
     pat->psi->i_pat_version = p_pat->i_version;
+    vlc_mutex_unlock( &p_sys->si.lock );
 
     dvbpsi_DeletePAT( p_pat );
 }
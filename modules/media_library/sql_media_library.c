@@ -188,11 +188,16 @@ static int load( vlc_object_t *obj )
     p_ml->p_sys->p_mon = p_mon;
 
     p_mon->p_ml = p_ml;
+    vlc_cond_init( &p_mon->wait );
+    vlc_mutex_init( &p_mon->lock );
+    p_mon->b_rescan = true;
 
     if( vlc_clone( &p_mon->thread, RunMonitoringThread, p_mon,
                 VLC_THREAD_PRIORITY_LOW ) )
     {
         msg_Err( p_ml, "cannot spawn the media library monitoring thread" );
+        vlc_cond_destroy( &p_mon->wait );
+        vlc_mutex_destroy( &p_mon->lock );
         vlc_mutex_destroy( &p_ml->p_sys->lock );
         sql_Destroy( p_ml->p_sys->p_sql );
         free( p_ml->p_sys );
@@ -221,10 +226,16 @@ static void unload( vlc_object_t *obj )
     /* Stopping the watching system */
     watch_Close( p_ml );
 
-    /* Stop the monitoring thread */
-    vlc_cancel( p_ml->p_sys->p_mon->thread );
-    vlc_join( p_ml->p_sys->p_mon->thread, NULL );
-    vlc_object_release( p_ml->p_sys->p_mon );
+    /* Stop the monitoring thread, once it has written what it found */
+    monitoring_thread_t *p_mon = p_ml->p_sys->p_mon;
+    vlc_mutex_lock( &p_mon->lock );
+    p_mon->b_exit = true;
+    vlc_cond_signal( &p_mon->wait );
+    vlc_mutex_unlock( &p_mon->lock );
+    vlc_join( p_mon->thread, NULL );
+    vlc_cond_destroy( &p_mon->wait );
+    vlc_mutex_destroy( &p_mon->lock );
+    vlc_object_release( p_mon );
 
     /* Destroy the variable */
     var_Destroy( p_ml, "media-meta-change" );
@@ -1035,6 +1046,45 @@ quit_createemptydatabase:
     return VLC_SUCCESS;
 }
 
+/**
+ * @brief Create the indexes of the common lookups, if they do not exist yet
+ *
+ * These are not part of CreateEmptyDatabase() so that the databases created
+ * before them get them too. Where the rows are only used to filter or join,
+ * the index covers every column that is read, so that the table itself is
+ * not looked up.
+ * @param p_ml This ML
+ * @return VLC_SUCCESS or VLC_EGENERIC
+ * @note This function is transactional
+ */
+static int CreateIndexes( media_library_t *p_ml )
+{
+    static const char *const ppsz_indexes[] = {
+        /* Media of an album, and the keep_album_clean trigger */
+        "media_album_index ON media (album_id)",
+        /* Files of a monitored directory */
+        "media_directory_index ON media (directory_id, uri, timestamp)",
+        /* Media of a person, and the keep_people_clean trigger */
+        "media_to_people_people_index ON media_to_people (people_id, media_id)",
+        /* People of a given role, the artists for instance */
+        "people_role_index ON people (role, name)",
+        /* Is a directory already monitored? */
+        "directories_uri_index ON directories (uri)",
+    };
+    int i_ret = VLC_SUCCESS;
+
+    Begin( p_ml );
+    for( unsigned i = 0; i < sizeof( ppsz_indexes ) / sizeof( *ppsz_indexes )
+                         && i_ret == VLC_SUCCESS; i++ )
+        i_ret = QuerySimple( p_ml, "CREATE INDEX IF NOT EXISTS %s",
+                             ppsz_indexes[i] );
+    if( i_ret == VLC_SUCCESS )
+        Commit( p_ml );
+    else
+        Rollback( p_ml );
+    return i_ret;
+}
+
 /**
  * @brief Journal and synchronous disc and writes
  *
@@ -1121,6 +1171,9 @@ int InitDatabase( media_library_t *p_ml )
 #error "ML versioning code needs to be updated. Is this done correctly?"
 #endif
 
+    if( CreateIndexes( p_ml ) != VLC_SUCCESS )
+        msg_Warn( p_ml, "could not create the indexes of the database" );
+
     SetSynchronous( p_ml, b_sync );
 
     msg_Dbg( p_ml, "ML initialized" );
@@ -51,6 +51,8 @@
  *****************************************************************************/
 #define THREAD_SLEEP_DELAY   2  /* Time between two calls to item_list_loop */
 #define MONITORING_DELAY    30  /* Media library updates interval */
+#define MONITORING_FLUSH_DELAY 2 /* Max delay to write the preparsed files */
+#define MONITORING_BATCH   256  /* Preparsed files written at once */
 #define ITEM_LOOP_UPDATE     1  /* An item is updated after 1 loop */
 #define ITEM_LOOP_MAX_AGE   10  /* An item is deleted after 10 loops */
 #define ML_DBVERSION         1  /* The current version of the database */
@@ -60,6 +62,7 @@
  * Structures and types definitions
  *****************************************************************************/
 typedef struct monitoring_thread_t monitoring_thread_t;
+typedef struct preparsed_item_t    preparsed_item_t;
 typedef struct ml_poolobject_t     ml_poolobject_t;
 
 struct ml_poolobject_t
@@ -101,6 +104,19 @@ struct monitoring_thread_t
     vlc_mutex_t lock;
     vlc_thread_t thread;
     media_library_t *p_ml;
+
+    /* Protected by lock */
+    preparsed_item_t *p_preparsed;  /* Preparsed files not written yet */
+    int i_preparsed;
+    bool b_rescan;                  /* Every directory must be checked */
+    bool b_exit;
+
+    /* Only used by the monitoring thread */
+    sql_stmt_t *p_media_stmt;       /* Sets the directory of a file */
+    sql_stmt_t *p_dir_stmt;         /* Gets the id of a directory */
+    int i_inotify;                  /* Directory watches, or -1 */
+    void *p_watches;
+    bool b_poll;                    /* Some directories are not watched */
 };
 
 /* Media status Watching thread */
@@ -263,10 +279,12 @@ static inline int Begin( media_library_t* p_ml )
 /**
  * @brief Commits the transaction
  * @param p_ml The Media Library object
+ * @return VLC_SUCCESS or VLC_EGENERIC, in which case the transaction must
+ * still be committed or rolled back
  */
-static inline void Commit( media_library_t* p_ml )
+static inline int Commit( media_library_t* p_ml )
 {
-    sql_CommitTransaction( p_ml->p_sys->p_sql );
+    return sql_CommitTransaction( p_ml->p_sys->p_sql );
 }
 
 /**
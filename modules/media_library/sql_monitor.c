@@ -37,14 +37,22 @@
 #include "vlc_url.h"
 #include "vlc_fs.h"
 
+#ifdef HAVE_SYS_INOTIFY_H
+#   include <sys/inotify.h>
+#   include <search.h>
+#   include <unistd.h>
+#endif
+
 static const char* ppsz_MediaExtensions[] =
                         { EXTENSIONS_AUDIO_CSV, EXTENSIONS_VIDEO_CSV, NULL };
 
 
 /* Monitoring and directory scanning private functions */
 typedef struct stat_list_t stat_list_t;
-typedef struct preparsed_item_t preparsed_item_t;
 static void UpdateLibrary( monitoring_thread_t *p_mon );
+static void UpdateDirectory( monitoring_thread_t *p_mon, int i_dir_id,
+                             const char *psz_dir, int i_timestamp,
+                             bool b_recursive, bool b_force );
 static void ScanFiles( monitoring_thread_t *, int, bool, stat_list_t *stparent );
 static int Sort( const char **, const char ** );
 
@@ -58,13 +66,22 @@ struct stat_list_t
 struct preparsed_item_t
 {
     monitoring_thread_t *p_mon;
+    input_item_t *p_input;
     char* psz_uri;
     int i_dir_id;
     int i_mtime;
     int i_update_id;
     bool b_update;
+    preparsed_item_t *p_next;
 };
 
+/* A file of a directory, as known by the database */
+typedef struct
+{
+    const char *psz_uri;
+    int i_row;
+} monitored_file_t;
+
 /**
  * @brief Remove a directory to monitor
  * @param p_ml A media library object
@@ -186,7 +203,12 @@ int AddDirToMonitor( media_library_t *p_ml, const char *psz_dir )
     msg_Dbg( p_ml, "Adding directory `%s' to be monitored", psz_dir );
     QuerySimple( p_ml, "INSERT INTO directories ( uri, timestamp, "
                           "recursive ) VALUES( %Q, 0, 0 )", psz_dir );
-    vlc_cond_signal( &p_ml->p_sys->p_mon->wait );
+
+    monitoring_thread_t *p_mon = p_ml->p_sys->p_mon;
+    vlc_mutex_lock( &p_mon->lock );
+    p_mon->b_rescan = true;
+    vlc_cond_signal( &p_mon->wait );
+    vlc_mutex_unlock( &p_mon->lock );
     return VLC_SUCCESS;
 }
 
@@ -200,33 +222,352 @@ static int Sort( const char **a, const char **b )
 #endif
 }
 
+static bool IsStopping( monitoring_thread_t *p_mon )
+{
+    vlc_mutex_lock( &p_mon->lock );
+    bool b_exit = p_mon->b_exit;
+    vlc_mutex_unlock( &p_mon->lock );
+    return b_exit;
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+/* The changes after which a directory must be scanned again */
+#define WATCH_MASK ( IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE \
+                   | IN_DELETE_SELF | IN_MOVE_SELF | IN_MOVED_FROM \
+                   | IN_MOVED_TO | IN_ONLYDIR )
+
+typedef struct
+{
+    int i_wd;
+    int i_dir_id;
+} watch_t;
+
+static int WatchCmp( const void *a, const void *b )
+{
+    const watch_t *p_a = a, *p_b = b;
+    return ( p_a->i_wd > p_b->i_wd ) - ( p_a->i_wd < p_b->i_wd );
+}
+
+static int IntCmp( const void *a, const void *b )
+{
+    const int *pi_a = a, *pi_b = b;
+    return ( *pi_a > *pi_b ) - ( *pi_a < *pi_b );
+}
+#endif
+
+/**
+ * @brief Watch the changes of a directory, where the system tells them
+ *
+ * When it does not, or when the directory cannot be watched, every
+ * directory is checked each MONITORING_DELAY seconds instead.
+ */
+static void WatchDir( monitoring_thread_t *p_mon, int i_dir_id,
+                      const char *psz_dir )
+{
+#ifdef HAVE_SYS_INOTIFY_H
+    if( p_mon->i_inotify == -1 )
+        return;
+
+    watch_t key;
+    key.i_wd = inotify_add_watch( p_mon->i_inotify, psz_dir, WATCH_MASK );
+    if( key.i_wd == -1 )
+    {
+        /* Most likely fs.inotify.max_user_watches */
+        if( !p_mon->b_poll )
+            msg_Warn( p_mon, "cannot watch `%s' (%m), "
+                      "the directories will be polled", psz_dir );
+        p_mon->b_poll = true;
+        return;
+    }
+
+    /* A directory that was moved keeps its watch */
+    watch_t **pp_watch = tfind( &key, &p_mon->p_watches, WatchCmp );
+    if( pp_watch != NULL )
+    {
+        (*pp_watch)->i_dir_id = i_dir_id;
+        return;
+    }
+
+    watch_t *p_watch = malloc( sizeof( *p_watch ) );
+    if( p_watch == NULL )
+        return;
+    p_watch->i_wd = key.i_wd;
+    p_watch->i_dir_id = i_dir_id;
+    if( tsearch( p_watch, &p_mon->p_watches, WatchCmp ) == NULL )
+        free( p_watch );
+#else
+    VLC_UNUSED( p_mon );
+    VLC_UNUSED( i_dir_id );
+    VLC_UNUSED( psz_dir );
+#endif
+}
+
+/**
+ * @brief Read the changes of the watched directories
+ * @param ppi_dirs the sorted ids of the directories that changed, to free
+ * @param pb_rescan set if some changes were lost
+ * @return the number of directories that changed
+ */
+static int ReadWatches( monitoring_thread_t *p_mon, int **ppi_dirs,
+                        bool *pb_rescan )
+{
+    int i_dirs = 0;
+
+    *ppi_dirs = NULL;
+#ifdef HAVE_SYS_INOTIFY_H
+    char p_buffer[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t i_read;
+
+    if( p_mon->i_inotify == -1 )
+        return 0;
+
+    while( ( i_read = read( p_mon->i_inotify, p_buffer,
+                            sizeof( p_buffer ) ) ) > 0 )
+    {
+        for( ssize_t i = 0; i < i_read; )
+        {
+            const struct inotify_event *p_event =
+                (const struct inotify_event *)&p_buffer[i];
+            i += sizeof( *p_event ) + p_event->len;
+
+            if( p_event->mask & IN_Q_OVERFLOW )
+            {
+                msg_Warn( p_mon, "too many changes, checking everything" );
+                *pb_rescan = true;
+                continue;
+            }
+
+            watch_t key = { .i_wd = p_event->wd };
+            watch_t **pp_watch = tfind( &key, &p_mon->p_watches, WatchCmp );
+            if( pp_watch == NULL )
+                continue;
+            watch_t *p_watch = *pp_watch;
+
+            int *pi_dirs = realloc( *ppi_dirs,
+                                    ( i_dirs + 1 ) * sizeof( int ) );
+            if( pi_dirs == NULL )
+            {
+                *pb_rescan = true;
+                continue;
+            }
+            pi_dirs[i_dirs++] = p_watch->i_dir_id;
+            *ppi_dirs = pi_dirs;
+
+            /* The directory is gone, or its path in the database is wrong:
+             * it will be removed, and added again from its new parent */
+            if( p_event->mask & ( IN_IGNORED | IN_MOVE_SELF ) )
+            {
+                if( !( p_event->mask & IN_IGNORED ) )
+                    inotify_rm_watch( p_mon->i_inotify, p_watch->i_wd );
+                tdelete( p_watch, &p_mon->p_watches, WatchCmp );
+                free( p_watch );
+            }
+        }
+    }
+    if( i_read == -1 && errno != EAGAIN && errno != EINTR )
+        msg_Err( p_mon, "cannot read the directory changes: %m" );
+
+    /* A directory usually changes many times at once */
+    if( i_dirs > 1 )
+    {
+        int *pi_dirs = *ppi_dirs, j = 0;
+
+        qsort( pi_dirs, i_dirs, sizeof( int ), IntCmp );
+        for( int i = 1; i < i_dirs; i++ )
+            if( pi_dirs[i] != pi_dirs[j] )
+                pi_dirs[++j] = pi_dirs[i];
+        i_dirs = j + 1;
+    }
+#else
+    VLC_UNUSED( p_mon );
+    VLC_UNUSED( pb_rescan );
+#endif
+    return i_dirs;
+}
+
+/**
+ * @brief Write the preparsed files to the database
+ *
+ * They are written in a single transaction: a lot less expensive than one
+ * per file.
+ */
+static void FlushPreparsed( monitoring_thread_t *p_mon,
+                            preparsed_item_t *p_list )
+{
+    media_library_t *p_ml = (media_library_t *)p_mon->p_ml;
+    sql_t *p_sql = p_ml->p_sys->p_sql;
+    int i_count = 0;
+
+    if( p_list == NULL )
+        return;
+
+    Begin( p_ml );
+    while( p_list != NULL )
+    {
+        preparsed_item_t *p_itemobject = p_list;
+        input_item_t *p_input = p_itemobject->p_input;
+        int i_ret = VLC_SUCCESS;
+
+        p_list = p_itemobject->p_next;
+        if( input_item_IsPreparsed( p_input ) )
+        {
+            if( p_itemobject->b_update )
+            {
+                //TODO: Perhaps we don't have to load everything?
+                ml_media_t* p_media = GetMedia( p_ml,
+                        p_itemobject->i_update_id, ML_MEDIA_SPARSE, true );
+                CopyInputItemToMedia( p_media, p_input );
+                i_ret = UpdateMedia( p_ml, p_media );
+                ml_gc_decref( p_media );
+            }
+            else
+                i_ret = AddInputItem( p_ml, p_input );
+        }
+
+        if( i_ret != VLC_SUCCESS )
+            msg_Dbg( p_mon, "Item could not be correctly added"
+                    " or updated during scan: %s", p_itemobject->psz_uri );
+
+        /* UPDATE media SET directory_id=?, timestamp=? WHERE uri=? */
+        sql_stmt_t *p_stmt = p_mon->p_media_stmt;
+        if( p_stmt != NULL )
+        {
+            sql_BindInteger( p_sql, p_stmt, 1, p_itemobject->i_dir_id );
+            sql_BindInteger( p_sql, p_stmt, 2, p_itemobject->i_mtime );
+            sql_BindText( p_sql, p_stmt, 3, p_itemobject->psz_uri, -1 );
+            if( sql_Run( p_sql, p_stmt ) != VLC_SQL_DONE )
+                msg_Warn( p_mon, "cannot set the directory of %s",
+                          p_itemobject->psz_uri );
+            sql_Reset( p_sql, p_stmt );
+        }
+
+        vlc_gc_decref( p_input );
+        free( p_itemobject->psz_uri );
+        free( p_itemobject );
+        i_count++;
+    }
+    if( Commit( p_ml ) != VLC_SUCCESS )
+        Rollback( p_ml );
+    msg_Dbg( p_mon, "%d scanned files written", i_count );
+}
+
+/**
+ * @brief Write the preparsed files, if there are enough of them
+ *
+ * So that they are not all kept until the end of a long scan.
+ */
+static void FlushBatch( monitoring_thread_t *p_mon )
+{
+    preparsed_item_t *p_preparsed = NULL;
+
+    vlc_mutex_lock( &p_mon->lock );
+    if( p_mon->i_preparsed >= MONITORING_BATCH )
+    {
+        p_preparsed = p_mon->p_preparsed;
+        p_mon->p_preparsed = NULL;
+        p_mon->i_preparsed = 0;
+    }
+    vlc_mutex_unlock( &p_mon->lock );
+    FlushPreparsed( p_mon, p_preparsed );
+}
+
 /**
  * @brief Directory Monitoring thread loop
  */
 void *RunMonitoringThread( void *p_this )
 {
     monitoring_thread_t *p_mon = (monitoring_thread_t*) p_this;
-    vlc_cond_init( &p_mon->wait );
-    vlc_mutex_init( &p_mon->lock );
+    media_library_t *p_ml = (media_library_t *)p_mon->p_ml;
+    sql_t *p_sql = p_ml->p_sys->p_sql;
+    mtime_t i_next_scan = 0;
 
     var_Create( p_mon, "ml-recursive-scan", VLC_VAR_BOOL | VLC_VAR_DOINHERIT );
 
-    while( vlc_object_alive( p_mon ) )
+    p_mon->p_media_stmt = sql_Prepare( p_sql,
+            "UPDATE media SET directory_id=?, timestamp=? WHERE uri=?", -1 );
+    p_mon->p_dir_stmt = sql_Prepare( p_sql,
+            "SELECT id FROM directories WHERE uri=?", -1 );
+
+    p_mon->b_poll = true;
+#ifdef HAVE_SYS_INOTIFY_H
+    p_mon->p_watches = NULL;
+    p_mon->i_inotify = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+    if( p_mon->i_inotify == -1 )
+        msg_Warn( p_mon, "cannot watch the directories (%m), "
+                  "they will be polled" );
+    else
+        p_mon->b_poll = false;
+#else
+    p_mon->i_inotify = -1;
+#endif
+
+    vlc_mutex_lock( &p_mon->lock );
+    for( ;; )
     {
-        vlc_mutex_lock( &p_mon->lock );
+        /* We wait for the changes of the directories, or that the media
+           library signals us to do something */
+        if( !p_mon->b_rescan && !p_mon->b_exit
+         && p_mon->i_preparsed < MONITORING_BATCH )
+            vlc_cond_timedwait( &p_mon->wait, &p_mon->lock,
+                                mdate() + CLOCK_FREQ * MONITORING_FLUSH_DELAY );
+
+        preparsed_item_t *p_preparsed = p_mon->p_preparsed;
+        bool b_rescan = p_mon->b_rescan;
+        bool b_exit = p_mon->b_exit;
+        p_mon->p_preparsed = NULL;
+        p_mon->i_preparsed = 0;
+        p_mon->b_rescan = false;
+        vlc_mutex_unlock( &p_mon->lock );
+
+        FlushPreparsed( p_mon, p_preparsed );
+        if( b_exit )
+            break;
 
         /* Update */
-        UpdateLibrary( p_mon );
+        bool b_recursive = var_GetBool( p_mon, "ml-recursive-scan" );
+        int *pi_dirs;
+        int i_dirs = ReadWatches( p_mon, &pi_dirs, &b_rescan );
 
-        /* We wait MONITORING_DELAY seconds or wait that the media library
-           signals us to do something */
-        vlc_cond_timedwait( &p_mon->wait, &p_mon->lock,
-                            mdate() + 1000000*MONITORING_DELAY );
+        if( p_mon->b_poll && mdate() >= i_next_scan )
+            b_rescan = true;
+        if( b_rescan )
+        {
+            UpdateLibrary( p_mon );
+            i_next_scan = mdate() + CLOCK_FREQ * MONITORING_DELAY;
+            i_dirs = 0;
+        }
+        for( int i = 0; i < i_dirs && !IsStopping( p_mon ); i++ )
+        {
+            char **pp_results;
+            int i_rows, i_cols;
+
+            if( Query( p_ml, &pp_results, &i_rows, &i_cols,
+                       "SELECT uri AS directory_uri, timestamp AS directory_ts "
+                       "FROM directories WHERE id = %d", pi_dirs[i] )
+                != VLC_SUCCESS )
+                continue;
+            /* The files may have changed while the directory has not */
+            if( i_rows > 0 )
+                UpdateDirectory( p_mon, pi_dirs[i], pp_results[i_cols],
+                                 atoi( pp_results[i_cols+1] ), b_recursive,
+                                 true );
+            FreeSQLResult( p_ml, pp_results );
+        }
+        free( pi_dirs );
 
-        vlc_mutex_unlock( &p_mon->lock );
+        vlc_mutex_lock( &p_mon->lock );
     }
-    vlc_cond_destroy( &p_mon->wait );
-    vlc_mutex_destroy( &p_mon->lock );
+
+#ifdef HAVE_SYS_INOTIFY_H
+    tdestroy( p_mon->p_watches, free );
+    if( p_mon->i_inotify != -1 )
+        close( p_mon->i_inotify );
+#endif
+    if( p_mon->p_media_stmt != NULL )
+        sql_Finalize( p_sql, p_mon->p_media_stmt );
+    if( p_mon->p_dir_stmt != NULL )
+        sql_Finalize( p_sql, p_mon->p_dir_stmt );
     return NULL;
 }
 
@@ -239,53 +580,60 @@ static void UpdateLibrary( monitoring_thread_t *p_mon )
     char **pp_results;
     media_library_t *p_ml = p_mon->p_ml;
 
-    struct stat s_stat;
-
     bool b_recursive = var_GetBool( p_mon, "ml-recursive-scan" );
 
     msg_Dbg( p_mon, "Scanning directories" );
 
-    Query( p_ml, &pp_results, &i_rows, &i_cols,
+    if( Query( p_ml, &pp_results, &i_rows, &i_cols,
               "SELECT id AS directory_id, uri AS directory_uri, "
-              "timestamp AS directory_ts FROM directories" );
+              "timestamp AS directory_ts FROM directories" ) != VLC_SUCCESS )
+        return;
     msg_Dbg( p_mon, "%d directories to scan", i_rows );
 
-    for( i = 1; i <= i_rows; i++ )
+    for( i = 1; i <= i_rows && !IsStopping( p_mon ); i++ )
     {
         int id = atoi( pp_results[i*i_cols] );
         char *psz_dir = pp_results[i*i_cols+1];
         int timestamp = atoi( pp_results[i*i_cols+2] );
 
-        if( vlc_stat( psz_dir, &s_stat ) == -1 )
-        {
-            int err = errno;
-            if( err == ENOTDIR || err == ENOENT )
-            {
-                msg_Dbg( p_mon, "Removing `%s'", psz_dir );
-                RemoveDirToMonitor( p_ml, psz_dir );
-            }
-            else
-            {
-                msg_Err( p_mon, "%s: %m", psz_dir );
-                FreeSQLResult( p_ml, pp_results );
-                return;
-            }
-            errno = err;
-        }
+        UpdateDirectory( p_mon, id, psz_dir, timestamp, b_recursive, false );
+    }
+    FreeSQLResult( p_ml, pp_results );
+}
 
-        if( !S_ISDIR( s_stat.st_mode ) )
+/**
+ * @brief Scan a directory if it changed, or remove it if it is gone
+ * @param b_force scan it even if it has not changed since i_timestamp
+ */
+static void UpdateDirectory( monitoring_thread_t *p_mon, int i_dir_id,
+                             const char *psz_dir, int i_timestamp,
+                             bool b_recursive, bool b_force )
+{
+    media_library_t *p_ml = p_mon->p_ml;
+    struct stat s_stat;
+
+    if( vlc_stat( psz_dir, &s_stat ) == -1 )
+    {
+        if( errno != ENOTDIR && errno != ENOENT )
         {
-            msg_Dbg( p_mon, "Removing `%s'", psz_dir );
-            RemoveDirToMonitor( p_ml, psz_dir );
+            msg_Err( p_mon, "%s: %m", psz_dir );
+            return;
         }
-
-        if( timestamp < s_stat.st_mtime )
+    }
+    else if( S_ISDIR( s_stat.st_mode ) )
+    {
+        if( b_force || i_timestamp < s_stat.st_mtime )
         {
             msg_Dbg( p_mon, "Adding `%s'", psz_dir );
-            ScanFiles( p_mon, id, b_recursive, NULL );
+            ScanFiles( p_mon, i_dir_id, b_recursive, NULL );
         }
+        else
+            WatchDir( p_mon, i_dir_id, psz_dir );
+        return;
     }
-    FreeSQLResult( p_ml, pp_results );
+
+    msg_Dbg( p_mon, "Removing `%s'", psz_dir );
+    RemoveDirToMonitor( p_ml, psz_dir );
 }
 
 /**
@@ -293,38 +641,60 @@ static void UpdateLibrary( monitoring_thread_t *p_mon )
  */
 static void PreparseComplete( const vlc_event_t * p_event, void *p_data )
 {
-    int i_ret = VLC_SUCCESS;
     preparsed_item_t* p_itemobject = (preparsed_item_t*) p_data;
     monitoring_thread_t *p_mon = p_itemobject->p_mon;
-    media_library_t *p_ml = (media_library_t *)p_mon->p_ml;
     input_item_t *p_input = (input_item_t*) p_event->p_obj;
 
-    if( input_item_IsPreparsed( p_input ) )
+    vlc_event_detach( &p_input->event_manager, vlc_InputItemPreparsedChanged,
+                  PreparseComplete, p_itemobject );
+
+    /* The monitoring thread writes them to the database, in batches */
+    vlc_mutex_lock( &p_mon->lock );
+    p_itemobject->p_next = p_mon->p_preparsed;
+    p_mon->p_preparsed = p_itemobject;
+    if( ++p_mon->i_preparsed >= MONITORING_BATCH )
+        vlc_cond_signal( &p_mon->wait );
+    vlc_mutex_unlock( &p_mon->lock );
+}
+
+static int MonitoredFileCmp( const void *a, const void *b )
+{
+    const monitored_file_t *p_a = a, *p_b = b;
+    return strcasecmp( p_a->psz_uri, p_b->psz_uri );
+}
+
+/**
+ * @brief Get the id of a directory
+ * @return the id, or -1 if it is not in the database
+ */
+static int GetDirId( monitoring_thread_t *p_mon, const char *psz_dir )
+{
+    media_library_t *p_ml = (media_library_t *)p_mon->p_ml;
+    sql_t *p_sql = p_ml->p_sys->p_sql;
+    sql_stmt_t *p_stmt = p_mon->p_dir_stmt;
+    int i_id = -1;
+
+    if( p_stmt == NULL )
     {
-        if( p_itemobject->b_update )
-        {
-            //TODO: Perhaps we don't have to load everything?
-            ml_media_t* p_media = GetMedia( p_ml, p_itemobject->i_update_id,
-                    ML_MEDIA_SPARSE, true );
-            CopyInputItemToMedia( p_media, p_input );
-            i_ret = UpdateMedia( p_ml, p_media );
-            ml_gc_decref( p_media );
-        }
-        else
-            i_ret = AddInputItem( p_ml, p_input );
+        char **pp_results;
+        int i_rows, i_cols;
+
+        if( Query( p_ml, &pp_results, &i_rows, &i_cols,
+                   "SELECT id AS directory_id FROM directories WHERE uri=%Q",
+                   psz_dir ) != VLC_SUCCESS )
+            return -1;
+        if( i_rows > 0 )
+            i_id = atoi( pp_results[1] );
+        FreeSQLResult( p_ml, pp_results );
+        return i_id;
     }
 
-    if( i_ret != VLC_SUCCESS )
-        msg_Dbg( p_mon, "Item could not be correctly added"
-                " or updated during scan: %s", p_input->psz_uri );
-    QuerySimple( p_ml, "UPDATE media SET directory_id=%d, timestamp=%d "
-                          "WHERE id=%d",
-                    p_itemobject->i_dir_id, p_itemobject->i_mtime,
-                    GetMediaIdOfURI( p_ml, p_input->psz_uri ) );
-    vlc_event_detach( &p_input->event_manager, vlc_InputItemPreparsedChanged,
-                  PreparseComplete, p_itemobject );
-    vlc_gc_decref( p_input );
-    free( p_itemobject->psz_uri );
+    sql_BindText( p_sql, p_stmt, 1, (char *)psz_dir, -1 );
+    if( sql_Run( p_sql, p_stmt ) == VLC_SQL_ROW
+     && sql_GetColumnInteger( p_sql, p_stmt, 0, &i_id ) != VLC_SUCCESS )
+        i_id = -1;
+    sql_Reset( p_sql, p_stmt );
+    return i_id;
 }
 
 /**
@@ -333,14 +703,16 @@ static void PreparseComplete( const vlc_event_t * p_event, void *p_data )
 static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
                        bool b_recursive, stat_list_t *stparent )
 {
-    int i_rows, i_cols, i_dir_content, i, i_mon_rows, i_mon_cols;
-    char **ppsz_monitored_files;
-    char **pp_results, *psz_dir;
+    int i_rows = 0, i_cols, i_dir_content, i, i_mon_rows = 0, i_mon_cols;
+    char **ppsz_monitored_files = NULL;
+    char **pp_results = NULL, *psz_dir;
     char **pp_dir_content;
     bool *pb_processed;
+    monitored_file_t *p_monitored;
     input_item_t *p_input;
     struct stat s_stat;
     media_library_t *p_ml = (media_library_t *)p_mon->p_ml;
+    DECL_ARRAY( int ) new_dirs;
 
     Query( p_ml, &pp_results, &i_rows, &i_cols,
               "SELECT uri AS directory_uri FROM directories WHERE id = '%d'",
@@ -349,6 +721,7 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
     {
         msg_Dbg( p_mon, "query returned no directory for dir_id: %d (%s:%d)",
                  i_dir_id, __FILE__, __LINE__ );
+        FreeSQLResult( p_ml, pp_results );
         return;
     }
     psz_dir = strdup( pp_results[1] );
@@ -381,31 +754,41 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
 #endif
     stself.parent = stparent;
 
-    QuerySimple( p_ml, "UPDATE directories SET timestamp=%d WHERE id = %d",
-                    stself.st.st_mtime, i_dir_id );
-    Query( p_ml, &ppsz_monitored_files, &i_mon_rows, &i_mon_cols,
-              "SELECT id AS media_id, timestamp AS media_ts, uri AS media_uri "
-              "FROM media WHERE directory_id = %d",
-              i_dir_id );
-    pb_processed = malloc(sizeof(bool) * i_mon_rows);
-    for( i = 0; i < i_mon_rows ; i++)
-        pb_processed[i] = false;
+    /* Before reading it, so that no change is missed */
+    WatchDir( p_mon, i_dir_id, psz_dir );
 
     i_dir_content = vlc_scandir( psz_dir, &pp_dir_content, NULL, Sort );
     if( i_dir_content == -1 )
     {
         msg_Err( p_mon, "Cannot read `%s': %m", psz_dir );
-        free( pb_processed );
         free( psz_dir );
         return;
     }
     else if( i_dir_content == 0 )
-    {
         msg_Dbg( p_mon, "Nothing in directory `%s'", psz_dir );
-        free( pb_processed );
-        free( psz_dir );
-        return;
+
+    FlushBatch( p_mon );
+
+    /* All the changes of the directory are written at once */
+    Begin( p_ml );
+    QuerySimple( p_ml, "UPDATE directories SET timestamp=%d WHERE id = %d",
+                    stself.st.st_mtime, i_dir_id );
+    Query( p_ml, &ppsz_monitored_files, &i_mon_rows, &i_mon_cols,
+              "SELECT id AS media_id, timestamp AS media_ts, uri AS media_uri "
+              "FROM media WHERE directory_id = %d",
+              i_dir_id );
+    pb_processed = malloc(sizeof(bool) * i_mon_rows);
+    p_monitored = malloc(sizeof(*p_monitored) * i_mon_rows);
+    if( i_mon_rows > 0 && ( !pb_processed || !p_monitored ) )
+        i_mon_rows = 0;
+    for( i = 0; i < i_mon_rows ; i++)
+    {
+        pb_processed[i] = false;
+        p_monitored[i].psz_uri = ppsz_monitored_files[ (i + 1) * i_mon_cols + 2 ];
+        p_monitored[i].i_row = i + 1;
     }
+    qsort( p_monitored, i_mon_rows, sizeof(*p_monitored), MonitoredFileCmp );
+    ARRAY_INIT( new_dirs );
 
     for( i = 0; i < i_dir_content; i++ )
     {
@@ -419,10 +802,9 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
 
             if( vlc_stat( psz_uri, &s_stat ) == -1 )
             {
+                /* A dangling link, or a file that was just removed */
                 msg_Err( p_mon, "%s: %m", psz_uri );
-                free( pb_processed );
-                free( psz_dir );
-                return;
+                continue;
             }
 
             if( S_ISREG( s_stat.st_mode ) )
@@ -455,30 +837,25 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
                 /* Check if given media is already in DB and it has been updated */
                 bool b_skip = false;
                 bool b_update = false;
-                int j = 1;
-                for( j = 1; j <= i_mon_rows; j++ )
+                int j = 0;
+                monitored_file_t key = { .psz_uri = psz_encoded_uri };
+                monitored_file_t *p_found = bsearch( &key, p_monitored,
+                        i_mon_rows, sizeof(*p_monitored), MonitoredFileCmp );
+                if( p_found )
                 {
-                    if( strcasecmp( ppsz_monitored_files[ j * i_mon_cols + 2 ],
-                                    psz_encoded_uri ) != 0 )
-                        continue;
+                    j = p_found->i_row;
                     b_update = true;
                     pb_processed[ j - 1 ] = true;
-                    if( atoi( ppsz_monitored_files[ j * i_mon_cols + 1 ] )
-                        < s_stat.st_mtime )
-                    {
-                        b_skip = false;
-                        break;
-                    }
-                    else
-                    {
-                        b_skip = true;
-                        break;
-                    }
+                    b_skip = atoi( ppsz_monitored_files[ j * i_mon_cols + 1 ] )
+                             >= s_stat.st_mtime;
                 }
                 msg_Dbg( p_ml , "Checking if %s is in DB. Found: %d", psz_encoded_uri,
                          b_skip? 1 : 0 );
                 if( b_skip )
+                {
+                    free( psz_encoded_uri );
                     continue;
+                }
 
                 p_input = input_item_New( psz_encoded_uri, psz_entry );
 
@@ -489,6 +866,7 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
                 p_itemobject->psz_uri = psz_encoded_uri;
                 p_itemobject->i_mtime = s_stat.st_mtime;
                 p_itemobject->p_mon = p_mon;
+                p_itemobject->p_input = p_input;
                 p_itemobject->b_update = b_update;
                 p_itemobject->i_update_id = b_update ?
                     atoi( ppsz_monitored_files[ j * i_mon_cols + 0 ] ) : 0 ;
@@ -500,12 +878,7 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
             }
             else if( S_ISDIR( s_stat.st_mode ) && b_recursive )
             {
-                Query( p_ml, &pp_results, &i_rows, &i_cols,
-                        "SELECT id AS directory_id FROM directories "
-                        "WHERE uri=%Q", psz_uri );
-                FreeSQLResult( p_ml, pp_results );
-
-                if( i_rows <= 0 )
+                if( GetDirId( p_mon, psz_uri ) < 0 )
                 {
                     msg_Dbg( p_mon, "New directory `%s' in dir of id %d",
                              psz_uri, i_dir_id );
@@ -514,20 +887,14 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
                                     "recursive) VALUES(%Q, 0, 1)", psz_uri );
 
                     // We get the id of the directory we've just added
-                    Query( p_ml, &pp_results, &i_rows, &i_cols,
-                    "SELECT id AS directory_id FROM directories WHERE uri=%Q",
-                              psz_uri );
-                    if( i_rows <= 0 )
+                    int i_new_id = GetDirId( p_mon, psz_uri );
+                    if( i_new_id < 0 )
                     {
                         msg_Err( p_mon, "Directory `%s' was not sucessfully"
                                 " added to the database", psz_uri );
-                        FreeSQLResult( p_ml, pp_results );
                         continue;
                     }
-
-                    ScanFiles( p_mon, atoi( pp_results[1] ), b_recursive,
-                               &stself );
-                    FreeSQLResult( p_ml, pp_results );
+                    ARRAY_APPEND( new_dirs, i_new_id );
                 }
             }
         }
@@ -547,7 +914,8 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
     }
 
     /* Delete the unfound media */
-    if( Delete( p_ml, delete_ids ) != VLC_SUCCESS )
+    if( vlc_array_count( delete_ids ) > 0
+     && Delete( p_ml, delete_ids ) != VLC_SUCCESS )
         msg_Dbg( p_ml, "Something went wrong in multi delete" );
 
     for( i = 0; i < vlc_array_count( delete_ids ); i++ )
@@ -556,10 +924,19 @@ static void ScanFiles( monitoring_thread_t *p_mon, int i_dir_id,
     }
     vlc_array_destroy( delete_ids );
 
+    if( Commit( p_ml ) != VLC_SUCCESS )
+        Rollback( p_ml );
+
     FreeSQLResult( p_ml, ppsz_monitored_files );
     for( i = 0; i < i_dir_content; i++ )
         free( pp_dir_content[i] );
     free( pp_dir_content );
     free( psz_dir );
     free( pb_processed );
+    free( p_monitored );
+
+    /* The new sub-directories, each in its own transaction */
+    for( i = 0; i < new_dirs.i_size && !IsStopping( p_mon ); i++ )
+        ScanFiles( p_mon, new_dirs.p_elems[i], b_recursive, &stself );
+    ARRAY_RESET( new_dirs );
 }
@@ -888,7 +888,7 @@ case casestr:                                                                 \
         || tree->comp == ML_COMP_STARTS_WITH                                  \
         || tree->comp == ML_COMP_ENDS_WITH );                                 \
     *ppsz_where = sql_Printf( p_ml->p_sys->p_sql, "%s %s '%s%q%s'", fmt,      \
-        (ML_COMP_EQUAL)?"=":"LIKE",                                           \
+        tree->comp == ML_COMP_EQUAL ? "=" : "LIKE",                           \
         tree->comp == ML_COMP_HAS                                             \
         || tree->comp == ML_COMP_STARTS_WITH? "%%" : "",                      \
             tree->value.str,                                                  \
@@ -46,6 +46,8 @@ struct sql_sys_t
     sqlite3 *db;              /**< Database connection. */
     vlc_mutex_t lock;         /**< SQLite mutex. Threads are evil here. */
     vlc_mutex_t trans_lock;   /**< Mutex for running transactions */
+    vlc_threadvar_t trans_owner; /**< Set in the thread running them */
+    unsigned i_trans_depth;   /**< Number of nested transactions */
 };
 
 struct sql_stmt_t
@@ -133,6 +135,11 @@ static int load( vlc_object_t *p_this )
     if( !p_sql->p_sys )
         return VLC_ENOMEM;
 
+    if( vlc_threadvar_create( &p_sql->p_sys->trans_owner, NULL ) )
+    {
+        free( p_sql->p_sys );
+        return VLC_ENOMEM;
+    }
     vlc_mutex_init( &p_sql->p_sys->lock );
     vlc_mutex_init( &p_sql->p_sys->trans_lock );
 
@@ -141,9 +148,10 @@ static int load( vlc_object_t *p_this )
         msg_Dbg( p_sql, "sqlite module loaded" );
     else
     {
-        free( p_sql->p_sys );
         vlc_mutex_destroy( &p_sql->p_sys->lock );
         vlc_mutex_destroy( &p_sql->p_sys->trans_lock );
+        vlc_threadvar_delete( &p_sql->p_sys->trans_owner );
+        free( p_sql->p_sys );
         return VLC_EGENERIC;
     }
 
@@ -179,6 +187,7 @@ static void unload( vlc_object_t *p_this )
     CloseDatabase( p_sql );
     vlc_mutex_destroy( &p_sql->p_sys->lock );
     vlc_mutex_destroy( &p_sql->p_sys->trans_lock );
+    vlc_threadvar_delete( &p_sql->p_sys->trans_owner );
     free( p_sql->p_sys );
 }
 
@@ -401,27 +410,40 @@ static char* VMSprintf( const char* psz_fmt, va_list args )
  * @note This function locks the transactions on the database.
  * Within the period of the transaction, only the calling thread may
  * execute sql statements provided all threads use these transaction fns.
+ * A transaction started by the thread that already runs one is nested in
+ * it, as a savepoint: it is only written with the outermost one, but it can
+ * be rolled back on its own.
  */
 static int BeginTransaction( sql_t* p_sql )
 {
     int i_ret = VLC_SUCCESS;
-    vlc_mutex_lock( &p_sql->p_sys->trans_lock );
+    bool b_nested = vlc_threadvar_get( p_sql->p_sys->trans_owner ) != NULL;
+
+    if( !b_nested )
+        vlc_mutex_lock( &p_sql->p_sys->trans_lock );
     vlc_mutex_lock( &p_sql->p_sys->lock );
     assert( p_sql->p_sys->db );
 
-    sqlite3_exec( p_sql->p_sys->db, "BEGIN;", NULL, NULL, NULL );
+    const char *psz_query = b_nested ? "SAVEPOINT nested;" : "BEGIN;";
+    sqlite3_exec( p_sql->p_sys->db, psz_query, NULL, NULL, NULL );
 #ifndef NDEBUG
-    msg_Dbg( p_sql, "Transaction Query: BEGIN;" );
+    msg_Dbg( p_sql, "Transaction Query: %s", psz_query );
 #endif
     if( sqlite3_errcode( p_sql->p_sys->db ) != SQLITE_OK )
     {
-        vlc_mutex_unlock( &p_sql->p_sys->trans_lock );
-        vlc_mutex_unlock( &p_sql->p_sys->lock );
+        if( !b_nested )
+            vlc_mutex_unlock( &p_sql->p_sys->trans_lock );
         msg_Warn( p_sql, "sqlite3 error: %d: %s",
                   sqlite3_errcode( p_sql->p_sys->db ),
                   sqlite3_errmsg( p_sql->p_sys->db ) );
         i_ret = VLC_EGENERIC;
     }
+    else
+    {
+        if( !b_nested )
+            vlc_threadvar_set( p_sql->p_sys->trans_owner, p_sql );
+        p_sql->p_sys->i_trans_depth++;
+    }
     vlc_mutex_unlock( &p_sql->p_sys->lock );
     return i_ret;
 }
@@ -439,12 +461,15 @@ static int CommitTransaction( sql_t* p_sql )
 {
     int i_ret = VLC_SUCCESS;
     assert( p_sql->p_sys->db );
+    assert( vlc_threadvar_get( p_sql->p_sys->trans_owner ) == p_sql );
     vlc_mutex_lock( &p_sql->p_sys->lock );
 
-    /** This turns the auto commit on. */
-    sqlite3_exec( p_sql->p_sys->db, "COMMIT;", NULL, NULL, NULL );
+    /** This turns the auto commit on, unless the transaction is nested */
+    const char *psz_query = p_sql->p_sys->i_trans_depth > 1 ?
+                            "RELEASE nested;" : "COMMIT;";
+    sqlite3_exec( p_sql->p_sys->db, psz_query, NULL, NULL, NULL );
 #ifndef NDEBUG
-    msg_Dbg( p_sql, "Transaction Query: COMMIT;" );
+    msg_Dbg( p_sql, "Transaction Query: %s", psz_query );
 #endif
     if( sqlite3_errcode( p_sql->p_sys->db ) != SQLITE_OK )
     {
@@ -453,8 +478,11 @@ static int CommitTransaction( sql_t* p_sql )
                   sqlite3_errmsg( p_sql->p_sys->db ) );
         i_ret = VLC_EGENERIC;
     }
-    else
+    else if( --p_sql->p_sys->i_trans_depth == 0 )
+    {
+        vlc_threadvar_set( p_sql->p_sys->trans_owner, NULL );
         vlc_mutex_unlock( &p_sql->p_sys->trans_lock );
+    }
     vlc_mutex_unlock( &p_sql->p_sys->lock );
     return i_ret;
 }
@@ -473,11 +501,15 @@ static int CommitTransaction( sql_t* p_sql )
 static void RollbackTransaction( sql_t* p_sql )
 {
     assert( p_sql->p_sys->db );
+    assert( vlc_threadvar_get( p_sql->p_sys->trans_owner ) == p_sql );
     vlc_mutex_lock( &p_sql->p_sys->lock );
 
-    sqlite3_exec( p_sql->p_sys->db, "ROLLBACK;", NULL, NULL, NULL );
+    /* Only the statements of a nested transaction are undone */
+    const char *psz_query = p_sql->p_sys->i_trans_depth > 1 ?
+        "ROLLBACK TO nested; RELEASE nested;" : "ROLLBACK;";
+    sqlite3_exec( p_sql->p_sys->db, psz_query, NULL, NULL, NULL );
 #ifndef NDEBUG
-    msg_Dbg( p_sql, "Transaction Query: ROLLBACK;" );
+    msg_Dbg( p_sql, "Transaction Query: %s", psz_query );
 #endif
     if( sqlite3_errcode( p_sql->p_sys->db ) != SQLITE_OK )
     {
@@ -485,7 +517,11 @@ static void RollbackTransaction( sql_t* p_sql )
                   sqlite3_errcode( p_sql->p_sys->db ),
                   sqlite3_errmsg( p_sql->p_sys->db ) );
     }
-    vlc_mutex_unlock( &p_sql->p_sys->trans_lock );
+    if( --p_sql->p_sys->i_trans_depth == 0 )
+    {
+        vlc_threadvar_set( p_sql->p_sys->trans_owner, NULL );
+        vlc_mutex_unlock( &p_sql->p_sys->trans_lock );
+    }
     vlc_mutex_unlock( &p_sql->p_sys->lock );
 }
 
@@ -584,7 +620,7 @@ static int StatementStep( sql_t* p_sql, sql_stmt_t* p_stmt )
     int i_ret = VLC_EGENERIC;
     if( i_sqlret == SQLITE_ROW )
         i_ret = VLC_SQL_ROW;
-    else if( i_ret == SQLITE_DONE )
+    else if( i_sqlret == SQLITE_DONE )
         i_ret = VLC_SQL_DONE;
     else
     {
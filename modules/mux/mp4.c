@@ -48,6 +48,17 @@
     "Create \"Fast Start\" files. " \
     "\"Fast Start\" files are optimized for downloads and allow the user " \
     "to start previewing the file while it is downloading.")
+#define FRAGMENT_TEXT N_("Fragment duration")
+#define FRAGMENT_LONGTEXT N_( \
+    "Create a fragmented file, made of fragments of about this duration " \
+    "(in milliseconds). The data is written as it comes and the index is " \
+    "split across the fragments, so the file can be streamed and nothing " \
+    "has to be rewritten at the end. 0 disables fragmentation.")
+#define RESERVE_TEXT N_("Reserve room for the index")
+#define RESERVE_LONGTEXT N_( \
+    "Expected duration of the file (in seconds). Room for the index of " \
+    "such a file is reserved at its start, so that a \"Fast Start\" file " \
+    "is created without moving the data at the end. 0 disables it.")
 
 static int  Open   ( vlc_object_t * );
 static void Close  ( vlc_object_t * );
@@ -63,6 +74,10 @@ vlc_module_begin ()
     add_bool( SOUT_CFG_PREFIX "faststart", true,
               FASTSTART_TEXT, FASTSTART_LONGTEXT,
               true )
+    add_integer( SOUT_CFG_PREFIX "fragment-duration", 0,
+                 FRAGMENT_TEXT, FRAGMENT_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "reserve-duration", 0,
+                 RESERVE_TEXT, RESERVE_LONGTEXT, true )
     set_capability( "sout mux", 5 )
     add_shortcut( "mp4", "mov", "3gp" )
     set_callbacks( Open, Close )
@@ -72,7 +87,7 @@ vlc_module_end ()
  * Exported prototypes
  *****************************************************************************/
 static const char *const ppsz_sout_options[] = {
-    "faststart", NULL
+    "faststart", "fragment-duration", "reserve-duration", NULL
 };
 
 static int Control( sout_mux_t *, int, va_list );
@@ -116,6 +131,15 @@ typedef struct
     /* for spu */
     int64_t i_last_dts;
 
+    bool b_started;
+
+    /* for fragmented files: data of the current fragment, and end of the
+     * previous fragments relative to the start of the stream */
+    block_t  *p_frag;
+    block_t  **pp_frag_last;
+    int64_t  i_frag_dts;
+    int      i_trun_pos;
+
 } mp4_stream_t;
 
 struct sout_mux_sys_t
@@ -124,12 +148,26 @@ struct sout_mux_sys_t
     bool b_3gp;
     bool b_64_ext;
     bool b_fast_start;
+    bool b_header;
 
     uint64_t i_mdat_pos;
     uint64_t i_pos;
 
     int64_t  i_dts_start;
 
+    /* room reserved for the moov before the mdat */
+    mtime_t  i_reserve_duration;
+    uint64_t i_reserve_pos;
+    int      i_reserve_size;
+
+    /* fragmented files */
+    bool     b_fragmented;
+    bool     b_video;
+    mtime_t  i_frag_duration;
+    mtime_t  i_frag_start;
+    int      i_frag_samples;
+    uint32_t i_frag_sequence;
+
     int          i_nb_streams;
     mp4_stream_t **pp_streams;
 };
@@ -164,11 +202,17 @@ static void  box_free    ( bo_t *box );
 static void  box_gather  ( bo_t *box, bo_t *box2 );
 
 static void box_send( sout_mux_t *p_mux,  bo_t *box );
+static void box_send_header( sout_mux_t *p_mux,  bo_t *box );
 
 static block_t *bo_to_sout( bo_t *box );
 
 static bo_t *GetMoovBox( sout_mux_t *p_mux );
 
+static void WriteHeader( sout_mux_t *p_mux );
+static void WriteFragment( sout_mux_t *p_mux, bool b_last );
+static void WriteSample( sout_mux_t *p_mux, mp4_stream_t *p_stream,
+                         block_t *p_data );
+
 static block_t *ConvertSUBT( block_t *);
 static block_t *ConvertAVC1( block_t * );
 
@@ -198,6 +242,18 @@ static int Open( vlc_object_t *p_this )
     p_sys->b_mov        = p_mux->psz_mux && !strcmp( p_mux->psz_mux, "mov" );
     p_sys->b_3gp        = p_mux->psz_mux && !strcmp( p_mux->psz_mux, "3gp" );
     p_sys->i_dts_start  = 0;
+    p_sys->b_header     = false;
+    p_sys->i_reserve_pos  = 0;
+    p_sys->i_reserve_size = 0;
+    p_sys->i_reserve_duration = CLOCK_FREQ *
+        var_GetInteger( p_mux, SOUT_CFG_PREFIX "reserve-duration" );
+    p_sys->i_frag_duration = 1000 *
+        var_GetInteger( p_mux, SOUT_CFG_PREFIX "fragment-duration" );
+    p_sys->b_fragmented = p_sys->i_frag_duration > 0;
+    p_sys->b_video      = false;
+    p_sys->i_frag_start = 0;
+    p_sys->i_frag_samples  = 0;
+    p_sys->i_frag_sequence = 0;
 
 
     if( !p_sys->b_mov )
@@ -211,26 +267,24 @@ static int Open( vlc_object_t *p_this )
         else bo_add_fourcc( box, "mp41" );
         bo_add_fourcc( box, "avc1" );
         bo_add_fourcc( box, "qt  " );
+        if( p_sys->b_fragmented ) bo_add_fourcc( box, "iso6" );
         box_fix( box );
 
         p_sys->i_pos += box->i_buffer;
         p_sys->i_mdat_pos = p_sys->i_pos;
 
-        box_send( p_mux, box );
+        if( p_sys->b_fragmented )
+            box_send_header( p_mux, box );
+        else
+            box_send( p_mux, box );
     }
 
     /* FIXME FIXME
      * Quicktime actually doesn't like the 64 bits extensions !!! */
     p_sys->b_64_ext = false;
 
-    /* Now add mdat header */
-    box = box_new( "mdat" );
-    bo_add_64be  ( box, 0 ); // enough to store an extended size
-
-    p_sys->i_pos += box->i_buffer;
-
-    box_send( p_mux, box );
-
+    /* The rest of the header depends on the streams, it is written by the
+     * first call to Mux() */
     return VLC_SUCCESS;
 }
 
@@ -250,6 +304,16 @@ static void Close( vlc_object_t * p_this )
 
     msg_Dbg( p_mux, "Close" );
 
+    if( !p_sys->b_header )
+        WriteHeader( p_mux );
+
+    if( p_sys->b_fragmented )
+    {
+        /* Everything but the last fragment is already written */
+        WriteFragment( p_mux, true );
+        goto clean;
+    }
+
     /* Update mdat size */
     bo_init( &bo, 0, NULL, true );
     if( p_sys->i_pos - p_sys->i_mdat_pos >= (((uint64_t)1)<<32) )
@@ -279,6 +343,33 @@ static void Close( vlc_object_t * p_this )
     /* Check we need to create "fast start" files */
     var_Get( p_this, SOUT_CFG_PREFIX "faststart", &val );
     p_sys->b_fast_start = val.b_bool;
+
+    /* Use the room reserved at the start of the file if the moov fits, the
+     * rest of it stays a free box */
+    if( p_sys->i_reserve_size > 0 &&
+        ( moov->i_buffer == p_sys->i_reserve_size ||
+          moov->i_buffer + 8 <= p_sys->i_reserve_size ) )
+    {
+        if( moov->i_buffer < p_sys->i_reserve_size )
+        {
+            bo_t *p_free = box_new( "free" );
+            int i_free = p_sys->i_reserve_size - moov->i_buffer - 8;
+
+            for( int i = 0; i < i_free; i++ )
+                bo_add_8( p_free, 0 );
+            box_fix( p_free );
+            box_gather( moov, p_free );
+        }
+        i_moov_pos = p_sys->i_reserve_pos;
+        p_sys->b_fast_start = false;
+    }
+    else if( p_sys->i_reserve_size > 0 )
+    {
+        msg_Warn( p_mux, "reserved room for the moov is too small "
+                  "(%d bytes needed, %d reserved)",
+                  moov->i_buffer, p_sys->i_reserve_size );
+    }
+
     while( p_sys->b_fast_start )
     {
         /* Move data to the end of the file so we can fit the moov header
@@ -348,12 +439,14 @@ static void Close( vlc_object_t * p_this )
     sout_AccessOutSeek( p_mux->p_access, i_moov_pos );
     box_send( p_mux, moov );
 
+clean:
     /* Clean-up */
     for( i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
     {
         mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
 
         es_format_Clean( &p_stream->fmt );
+        block_ChainRelease( p_stream->p_frag );
         free( p_stream->entry );
         free( p_stream );
     }
@@ -366,8 +459,8 @@ static void Close( vlc_object_t * p_this )
  *****************************************************************************/
 static int Control( sout_mux_t *p_mux, int i_query, va_list args )
 {
-    VLC_UNUSED(p_mux);
     bool *pb_bool;
+    char **ppsz;
 
     switch( i_query )
     {
@@ -381,7 +474,14 @@ static int Control( sout_mux_t *p_mux, int i_query, va_list args )
             *pb_bool = true;
             return VLC_SUCCESS;
 
-        case MUX_GET_MIME:   /* Not needed, as not streamable */
+        case MUX_GET_MIME:
+            /* Only fragmented files can be streamed */
+            if( !p_mux->p_sys->b_fragmented )
+                return VLC_EGENERIC;
+            ppsz = (char**)va_arg( args, char ** );
+            *ppsz = strdup( "video/mp4" );
+            return VLC_SUCCESS;
+
         default:
             return VLC_EGENERIC;
     }
@@ -433,6 +533,10 @@ static int AddStream( sout_mux_t *p_mux, sout_input_t *p_input )
         calloc( p_stream->i_entry_max, sizeof( mp4_entry_t ) );
     p_stream->i_dts_start   = 0;
     p_stream->i_duration    = 0;
+    p_stream->b_started     = false;
+    p_stream->p_frag        = NULL;
+    p_stream->pp_frag_last  = &p_stream->p_frag;
+    p_stream->i_frag_dts    = 0;
 
     p_input->p_sys          = p_stream;
 
@@ -459,6 +563,9 @@ static int Mux( sout_mux_t *p_mux )
 {
     sout_mux_sys_t *p_sys = p_mux->p_sys;
 
+    if( !p_sys->b_header )
+        WriteHeader( p_mux );
+
     for( ;; )
     {
         sout_input_t    *p_input;
@@ -515,9 +622,29 @@ again:
             }
         }
 
+        /* Start a new fragment on a key frame once the current one is long
+         * enough, or on any sample if it is far too long */
+        if( p_sys->b_fragmented && p_sys->i_frag_samples > 0 )
+        {
+            mtime_t i_frag_length = p_data->i_dts - p_sys->i_frag_start;
+            bool b_key = p_stream->fmt.i_cat == VIDEO_ES ?
+                         (p_data->i_flags & BLOCK_FLAG_TYPE_I) != 0 :
+                         !p_sys->b_video;
+
+            if( ( b_key && i_frag_length >= p_sys->i_frag_duration ) ||
+                i_frag_length >= 4 * p_sys->i_frag_duration )
+            {
+                WriteFragment( p_mux, false );
+                p_sys->i_frag_start = p_data->i_dts;
+            }
+        }
+        if( p_sys->i_frag_samples == 0 )
+            p_sys->i_frag_start = p_data->i_dts;
+
         /* Save starting time */
-        if( p_stream->i_entry_count == 0 )
+        if( !p_stream->b_started )
         {
+            p_stream->b_started = true;
             p_stream->i_dts_start = p_data->i_dts;
 
             /* Update global dts_start */
@@ -555,6 +682,7 @@ again:
         p_stream->entry[p_stream->i_entry_count].i_flags  = p_data->i_flags;
 
         p_stream->i_entry_count++;
+        p_sys->i_frag_samples++;
         /* XXX: -1 to always have 2 entry for easy adding of empty SPU */
         if( p_stream->i_entry_count >= p_stream->i_entry_max - 1 )
         {
@@ -571,7 +699,7 @@ again:
         p_stream->i_last_dts = p_data->i_dts;
 
         /* write data */
-        sout_AccessOutWrite( p_mux->p_access, p_data );
+        WriteSample( p_mux, p_stream, p_data );
 
         if( p_stream->fmt.i_cat == SPU_ES )
         {
@@ -591,6 +719,7 @@ again:
 
                 /* XXX: No need to grow the entry here */
                 p_stream->i_entry_count++;
+                p_sys->i_frag_samples++;
 
                 /* Fix last dts */
                 p_stream->i_last_dts += i_length;
@@ -603,7 +732,7 @@ again:
 
                 p_sys->i_pos += p_data->i_buffer;
 
-                sout_AccessOutWrite( p_mux->p_access, p_data );
+                WriteSample( p_mux, p_stream, p_data );
             }
 
             /* Fix duration */
@@ -614,6 +743,263 @@ again:
     return( VLC_SUCCESS );
 }
 
+/*****************************************************************************
+ * WriteHeader: writes what follows the ftyp, once the streams are known
+ *****************************************************************************/
+static int GetTimescale( const mp4_stream_t *p_stream )
+{
+    if( p_stream->fmt.i_cat == AUDIO_ES )
+        return p_stream->fmt.audio.i_rate;
+    return 1001;
+}
+
+/* Upper bound of the size of the moov for i_duration of every stream, with
+ * a few sample table entries per sample */
+static int EstimateMoovSize( sout_mux_t *p_mux, mtime_t i_duration )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    int64_t i_size = 4096;
+
+    for( int i = 0; i < p_sys->i_nb_streams; i++ )
+    {
+        const es_format_t *p_fmt = &p_sys->pp_streams[i]->fmt;
+        int64_t i_rate, i_entry_size;
+
+        switch( p_fmt->i_cat )
+        {
+            case VIDEO_ES:
+                /* stsz, stco, stts, stsc and stss */
+                i_entry_size = 32;
+                if( p_fmt->video.i_frame_rate > 0 &&
+                    p_fmt->video.i_frame_rate_base > 0 )
+                    i_rate = p_fmt->video.i_frame_rate /
+                             p_fmt->video.i_frame_rate_base + 1;
+                else
+                    i_rate = 60;
+                break;
+            case AUDIO_ES:
+                i_entry_size = 24;
+                if( p_fmt->i_codec == VLC_CODEC_AMR_NB ||
+                    p_fmt->i_codec == VLC_CODEC_AMR_WB )
+                    i_rate = 50;
+                else
+                    i_rate = p_fmt->audio.i_rate / 576 + 1;
+                break;
+            default:
+                i_entry_size = 24;
+                i_rate = 2;
+                break;
+        }
+        i_size += 1024 + p_fmt->i_extra +
+                  i_entry_size * i_rate * i_duration / CLOCK_FREQ;
+    }
+    return __MIN( i_size, INT32_MAX );
+}
+
+static void WriteHeader( sout_mux_t *p_mux )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    bo_t *box;
+
+    p_sys->b_header = true;
+
+    for( int i = 0; i < p_sys->i_nb_streams; i++ )
+    {
+        if( p_sys->pp_streams[i]->fmt.i_cat == VIDEO_ES )
+            p_sys->b_video = true;
+    }
+
+    if( p_sys->b_fragmented )
+    {
+        /* Without any sample, the fragments follow */
+        box = GetMoovBox( p_mux );
+        p_sys->i_pos += box->i_buffer;
+        box_send_header( p_mux, box );
+        return;
+    }
+
+    if( p_sys->i_reserve_duration > 0 )
+    {
+        p_sys->i_reserve_size = EstimateMoovSize( p_mux,
+                                                  p_sys->i_reserve_duration );
+        p_sys->i_reserve_pos  = p_sys->i_pos;
+        msg_Dbg( p_mux, "reserving %d bytes for the moov",
+                 p_sys->i_reserve_size );
+
+        box = box_new( "free" );
+        for( int i = 8; i < p_sys->i_reserve_size; i++ )
+            bo_add_8( box, 0 );
+        box_fix( box );
+
+        p_sys->i_pos += box->i_buffer;
+        p_sys->i_mdat_pos = p_sys->i_pos;
+        box_send( p_mux, box );
+    }
+
+    /* Now add mdat header */
+    box = box_new( "mdat" );
+    bo_add_64be  ( box, 0 ); // enough to store an extended size
+
+    p_sys->i_pos += box->i_buffer;
+
+    box_send( p_mux, box );
+}
+
+/*****************************************************************************
+ * WriteSample: writes the sample, or keeps it for the current fragment
+ *****************************************************************************/
+static void WriteSample( sout_mux_t *p_mux, mp4_stream_t *p_stream,
+                         block_t *p_data )
+{
+    if( p_mux->p_sys->b_fragmented )
+        block_ChainLastAppend( &p_stream->pp_frag_last, p_data );
+    else
+        sout_AccessOutWrite( p_mux->p_access, p_data );
+}
+
+/* Number of entries of the stream that go in the current fragment: the
+ * length of the last subtitle is only known with the next one, so it is
+ * kept for the following fragment */
+static unsigned FragmentEntries( const mp4_stream_t *p_stream, bool b_last )
+{
+    unsigned i_count = p_stream->i_entry_count;
+
+    if( !b_last && p_stream->fmt.i_cat == SPU_ES && i_count > 0 &&
+        p_stream->entry[i_count-1].i_length <= 0 )
+        i_count--;
+    return i_count;
+}
+
+/*****************************************************************************
+ * WriteFragment: writes the samples kept since the previous fragment
+ *****************************************************************************/
+static void WriteFragment( sout_mux_t *p_mux, bool b_last )
+{
+    sout_mux_sys_t *p_sys = p_mux->p_sys;
+    bo_t *moof, *mfhd, *mdat;
+    uint32_t i_data_size = 0;
+    unsigned i_samples = 0;
+
+    for( int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+        i_samples += FragmentEntries( p_sys->pp_streams[i_trak], b_last );
+    if( i_samples == 0 )
+        return;
+
+    moof = box_new( "moof" );
+
+    mfhd = box_full_new( "mfhd", 0, 0 );
+    bo_add_32be( mfhd, ++p_sys->i_frag_sequence );  // sequence-number
+    box_fix( mfhd );
+    box_gather( moof, mfhd );
+
+    for( int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+    {
+        mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+        const int64_t i_timescale = GetTimescale( p_stream );
+        const unsigned i_entries = FragmentEntries( p_stream, b_last );
+        bo_t *traf, *tfhd, *tfdt, *trun;
+
+        if( i_entries == 0 )
+            continue;
+
+        /* the start of the file can still move back while streams begin */
+        const int64_t i_start = __MAX( p_stream->i_dts_start -
+                                       p_sys->i_dts_start, 0 );
+
+        traf = box_new( "traf" );
+
+        /* data offsets are relative to the moof */
+        tfhd = box_full_new( "tfhd", 0, 0x020000 );
+        bo_add_32be( tfhd, p_stream->i_track_id );
+        box_fix( tfhd );
+        box_gather( traf, tfhd );
+
+        tfdt = box_full_new( "tfdt", 1, 0 );
+        bo_add_64be( tfdt, ( i_start + p_stream->i_frag_dts ) * i_timescale
+                           / CLOCK_FREQ );
+        box_fix( tfdt );
+        box_gather( traf, tfdt );
+
+        /* data-offset, sample-duration, sample-size, sample-flags and
+         * sample-composition-time-offset */
+        trun = box_full_new( "trun", 0, 0x000f01 );
+        bo_add_32be( trun, i_entries );
+        p_stream->i_trun_pos = moof->i_buffer + traf->i_buffer + trun->i_buffer;
+        bo_add_32be( trun, i_data_size );   // data-offset (fixed later)
+
+        for( unsigned i = 0; i < i_entries; i++ )
+        {
+            const mp4_entry_t *p_entry = &p_stream->entry[i];
+            int64_t i_dts = i_start + p_stream->i_frag_dts;
+
+            /* Rounded the same way whatever the number of fragments */
+            p_stream->i_frag_dts += __MAX( p_entry->i_length, 0 );
+            bo_add_32be( trun, ( i_start + p_stream->i_frag_dts ) * i_timescale
+                               / CLOCK_FREQ - i_dts * i_timescale / CLOCK_FREQ );
+            bo_add_32be( trun, p_entry->i_size );
+            if( p_stream->fmt.i_cat != VIDEO_ES ||
+                ( p_entry->i_flags & BLOCK_FLAG_TYPE_I ) )
+                bo_add_32be( trun, 0x02000000 );    // sync sample
+            else
+                bo_add_32be( trun, 0x01010000 );    // depends on others
+            bo_add_32be( trun, p_entry->i_pts_dts * i_timescale / CLOCK_FREQ );
+
+            i_data_size += p_entry->i_size;
+        }
+        box_fix( trun );
+        box_gather( traf, trun );
+
+        box_fix( traf );
+        box_gather( moof, traf );
+    }
+    box_fix( moof );
+
+    /* The data follows the moof and the mdat header */
+    for( int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+    {
+        mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+        uint8_t *p_offset = &moof->p_buffer[p_stream->i_trun_pos];
+
+        if( FragmentEntries( p_stream, b_last ) > 0 )
+            bo_fix_32be( moof, p_stream->i_trun_pos,
+                         GetDWBE( p_offset ) + moof->i_buffer + 8 );
+    }
+
+    mdat = box_new( "mdat" );
+    bo_fix_32be( mdat, 0, 8 + i_data_size );
+
+    p_sys->i_pos += moof->i_buffer + mdat->i_buffer;
+    box_send( p_mux, moof );
+    box_send( p_mux, mdat );
+
+    p_sys->i_frag_samples = 0;
+    for( int i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+    {
+        mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+        const unsigned i_entries = FragmentEntries( p_stream, b_last );
+        block_t **pp_kept = &p_stream->p_frag;
+        block_t *p_kept;
+
+        /* one block per entry, the ones left go in the next fragment */
+        for( unsigned i = 0; i < i_entries; i++ )
+            pp_kept = &(*pp_kept)->p_next;
+        p_kept = *pp_kept;
+        *pp_kept = NULL;
+
+        if( p_stream->p_frag != NULL )
+            sout_AccessOutWrite( p_mux->p_access, p_stream->p_frag );
+        p_stream->p_frag = p_kept;
+        p_stream->pp_frag_last = &p_stream->p_frag;
+        while( *p_stream->pp_frag_last != NULL )
+            p_stream->pp_frag_last = &(*p_stream->pp_frag_last)->p_next;
+
+        p_stream->i_entry_count -= i_entries;
+        memmove( p_stream->entry, &p_stream->entry[i_entries],
+                 p_stream->i_entry_count * sizeof( mp4_entry_t ) );
+        p_sys->i_frag_samples += p_stream->i_entry_count;
+    }
+}
+
 /*****************************************************************************
  *
  *****************************************************************************/
@@ -633,6 +1019,11 @@ static block_t *ConvertSUBT( block_t *p_block )
 
 static block_t *ConvertAVC1( block_t *p_block )
 {
+    /* Start codes are replaced in place */
+    p_block = block_Writable( p_block );
+    if( p_block == NULL )
+        return NULL;
+
     uint8_t *last = p_block->p_buffer;  /* Assume it starts with 0x00000001 */
     uint8_t *dat  = &p_block->p_buffer[4];
     uint8_t *end = &p_block->p_buffer[p_block->i_buffer];
@@ -1882,6 +2273,28 @@ static bo_t *GetMoovBox( sout_mux_t *p_mux )
         box_gather( moov, trak );
     }
 
+    /* The samples are described by the fragments */
+    if( p_sys->b_fragmented )
+    {
+        bo_t *mvex = box_new( "mvex" );
+
+        for( i_trak = 0; i_trak < p_sys->i_nb_streams; i_trak++ )
+        {
+            mp4_stream_t *p_stream = p_sys->pp_streams[i_trak];
+            bo_t *trex = box_full_new( "trex", 0, 0 );
+
+            bo_add_32be( trex, p_stream->i_track_id );
+            bo_add_32be( trex, 1 );     // sample-description-index
+            bo_add_32be( trex, 0 );     // default-sample-duration
+            bo_add_32be( trex, 0 );     // default-sample-size
+            bo_add_32be( trex, 0 );     // default-sample-flags
+            box_fix( trex );
+            box_gather( mvex, trex );
+        }
+        box_fix( mvex );
+        box_gather( moov, mvex );
+    }
+
     /* Add user data tags */
     box_gather( moov, GetUdtaTag( p_mux ) );
 
@@ -2062,6 +2475,18 @@ static void box_send( sout_mux_t *p_mux,  bo_t *box )
     sout_AccessOutWrite( p_mux->p_access, p_buf );
 }
 
+/* Same as box_send(), for the boxes a client needs before any fragment */
+static void box_send_header( sout_mux_t *p_mux,  bo_t *box )
+{
+    block_t *p_buf;
+
+    p_buf = bo_to_sout( box );
+    box_free( box );
+
+    p_buf->i_flags |= BLOCK_FLAG_HEADER;
+    sout_AccessOutWrite( p_mux->p_access, p_buf );
+}
+
 static int64_t get_timestamp(void)
 {
     int64_t i_timestamp = time(NULL);
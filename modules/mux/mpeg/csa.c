@@ -26,7 +26,10 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
+#include <vlc_cpu.h>
 
 #include "csa.h"
 
@@ -225,17 +228,20 @@ void csa_Decrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
 }
 
 /*****************************************************************************
- * csa_Encrypt:
+ * csa_EncryptBlocks: first pass of the scrambling, with the block cypher
+ *****************************************************************************
+ * Sets the transport scrambling control and replaces the payload with the
+ * output of the block cypher. Returns the size of the header, or -1 if the
+ * payload is too small to be scrambled.
  *****************************************************************************/
-void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
+static int csa_EncryptBlocks( csa_t *c, uint8_t *pkt, int i_pkt_size )
 {
-    uint8_t *ck;
     uint8_t *kk;
 
     int i, j;
     int i_hdr = 4; /* hdr len */
-    uint8_t  ib[184/8+2][8], stream[8], block[8];
-    int n, i_residue;
+    uint8_t  ib[8], block[8];
+    int n;
 
     /* set transport scrambling control */
     pkt[3] |= 0x80;
@@ -243,12 +249,10 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
     if( c->use_odd )
     {
         pkt[3] |= 0x40;
-        ck = c->o_ck;
         kk = c->o_kk;
     }
     else
     {
-        ck = c->e_ck;
         kk = c->e_kk;
     }
 
@@ -260,50 +264,111 @@ void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
         i_hdr += pkt[4] + 1;
     }
     n = (i_pkt_size - i_hdr) / 8;
-    i_residue = (i_pkt_size - i_hdr) % 8;
 
     if( n <= 0 )
     {
         pkt[3] &= 0x3f;
-        return;
+        return -1;
     }
 
-    /* */
+    /* Each block is chained to the output of the next one, and replaced by
+     * its own output as soon as it has been cyphered */
     for( i = 0; i < 8; i++ )
     {
-        ib[n+1][i] = 0;
+        ib[i] = 0;
     }
     for( i = n; i  > 0; i-- )
     {
+        uint8_t *data = &pkt[i_hdr+8*(i-1)];
+
         for( j = 0; j < 8; j++ )
         {
-            block[j] = pkt[i_hdr+8*(i-1)+j] ^ib[i+1][j];
+            block[j] = data[j] ^ ib[j];
         }
-        csa_BlockCypher( kk, block, ib[i] );
+        csa_BlockCypher( kk, block, ib );
+        memcpy( data, ib, 8 );
     }
+    return i_hdr;
+}
 
-    /* init csa state */
-    csa_StreamCypher( c, 1, ck, ib[1], stream );
+/*****************************************************************************
+ * csa_Encrypt:
+ *****************************************************************************/
+void csa_Encrypt( csa_t *c, uint8_t *pkt, int i_pkt_size )
+{
+    uint8_t *ck = c->use_odd ? c->o_ck : c->e_ck;
+    uint8_t stream[8];
+    int i, j;
 
-    for( i = 0; i < 8; i++ )
-    {
-        pkt[i_hdr+i] = ib[1][i];
-    }
-    for( i = 2; i < n+1; i++ )
+    int i_hdr = csa_EncryptBlocks( c, pkt, i_pkt_size );
+    if( i_hdr < 0 )
+        return;
+
+    /* init csa state with the first block */
+    csa_StreamCypher( c, 1, ck, &pkt[i_hdr], stream );
+
+    /* then xor the stream with every following byte, up to the residue */
+    for( i = i_hdr + 8; i < i_pkt_size; i += 8 )
     {
         csa_StreamCypher( c, 0, ck, NULL, stream );
-        for( j = 0; j < 8; j++ )
+        for( j = 0; j < 8 && i + j < i_pkt_size; j++ )
         {
-            pkt[i_hdr+8*(i-1)+j] = ib[i][j] ^ stream[j];
+            pkt[i+j] ^= stream[j];
         }
     }
-    if( i_residue > 0 )
+}
+
+/*****************************************************************************
+ * csa_EncryptPackets:
+ *****************************************************************************
+ * Gives the same result as csa_Encrypt() on every packet, but the stream
+ * cypher runs on up to CSA_BATCH_MAX packets at once.
+ *****************************************************************************/
+#define CSA_BATCH_MAX 256
+#define CSA_BATCH_MIN 12
+
+typedef void (*csa_bs_stream_t)( const uint8_t ck[8], uint8_t *const *pp_data,
+                                 const int *pi_size, int i_lanes );
+
+static csa_bs_stream_t csa_GetBatchStream( int *pi_batch );
+
+void csa_EncryptPackets( csa_t *c, uint8_t *const *pp_pkts, int i_pkts,
+                         int i_pkt_size )
+{
+    uint8_t *ck = c->use_odd ? c->o_ck : c->e_ck;
+    uint8_t *pp_data[CSA_BATCH_MAX];
+    int     pi_size[CSA_BATCH_MAX];
+    int     i_batch;
+    csa_bs_stream_t pf_stream = csa_GetBatchStream( &i_batch );
+
+    while( i_pkts > 0 )
     {
-        csa_StreamCypher( c, 0, ck, NULL, stream );
-        for( j = 0; j < i_residue; j++ )
+        const int i_count = __MIN( i_pkts, i_batch );
+        int i_lanes = 0;
+
+        /* A batch costs about as much as CSA_BATCH_MIN packets scrambled
+         * one by one, whatever its width */
+        if( i_count < CSA_BATCH_MIN )
         {
-            pkt[i_pkt_size - i_residue + j] ^= stream[j];
+            for( int i = 0; i < i_count; i++ )
+                csa_Encrypt( c, pp_pkts[i], i_pkt_size );
+            return;
         }
+
+        for( int i = 0; i < i_count; i++ )
+        {
+            int i_hdr = csa_EncryptBlocks( c, pp_pkts[i], i_pkt_size );
+            if( i_hdr < 0 )
+                continue;
+            pp_data[i_lanes] = &pp_pkts[i][i_hdr];
+            pi_size[i_lanes] = i_pkt_size - i_hdr;
+            i_lanes++;
+        }
+        if( i_lanes > 0 )
+            pf_stream( ck, pp_data, pi_size, i_lanes );
+
+        pp_pkts += i_count;
+        i_pkts -= i_count;
     }
 }
 
@@ -494,6 +559,111 @@ static void csa_StreamCypher( csa_t *c, int b_init, uint8_t *ck, uint8_t *sb, ui
 }
 
 
+/*****************************************************************************
+ * Bitsliced stream cypher
+ *****************************************************************************
+ * Every output bit of a s-box is the xor of some of the 32 products of its
+ * inputs (algebraic normal form). Bit k of csa_sbox_anf[n][b] is set when
+ * the product of the inputs selected by k is part of the output bit b of the
+ * s-box n+1, bit 4 of k being the first input of the s-box.
+ *****************************************************************************/
+static const uint32_t csa_sbox_anf[7][2] =
+{
+    { 0x35020b24, 0x5d59766f },
+    { 0x29182835, 0x1e4001e7 },
+    { 0x0001012c, 0x52fd5fe7 },
+    { 0x5b861a1d, 0x5b87419b },
+    { 0x0ff226b8, 0x66d66bef },
+    { 0x48c854d2, 0x02093824 },
+    { 0x0c0111da, 0x48da091e },
+};
+
+/* The masks are constant, only the needed xors are left after folding */
+#define BS_ANF1( o, m, anf, k ) \
+    if( (anf) & (1u << (k)) ) o = BS_XOR( o, m[k] )
+#define BS_ANF4( o, m, anf, k ) \
+    BS_ANF1( o, m, anf, k ); BS_ANF1( o, m, anf, k + 1 ); \
+    BS_ANF1( o, m, anf, k + 2 ); BS_ANF1( o, m, anf, k + 3 )
+#define BS_ANF( o, m, anf ) \
+    do { \
+        o = BS_ZERO; \
+        BS_ANF4( o, m, anf, 0 );  BS_ANF4( o, m, anf, 4 ); \
+        BS_ANF4( o, m, anf, 8 );  BS_ANF4( o, m, anf, 12 ); \
+        BS_ANF4( o, m, anf, 16 ); BS_ANF4( o, m, anf, 20 ); \
+        BS_ANF4( o, m, anf, 24 ); BS_ANF4( o, m, anf, 28 ); \
+    } while(0)
+
+/* Transposes a 8x8 bits matrix, bit 8*r+c goes to 8*c+r */
+static inline uint64_t csa_Transpose8x8( uint64_t x )
+{
+    uint64_t t;
+
+    t = (x ^ (x >> 7)) & UINT64_C(0x00AA00AA00AA00AA);
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & UINT64_C(0x0000CCCC0000CCCC);
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & UINT64_C(0x00000000F0F0F0F0);
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+/* Generic version, 64 packets at once */
+#define bs_t            uint64_t
+#define BS_BATCH        64
+#define BS_FUNC(name)   name##_c
+#define BS_TARGET
+#define BS_AND(a, b)    ((a) & (b))
+#define BS_XOR(a, b)    ((a) ^ (b))
+#define BS_ZERO         UINT64_C(0)
+#define BS_ONES         (~UINT64_C(0))
+#include "csa_bs.h"
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+# define bs_t           __m128i
+# define BS_BATCH       128
+# define BS_FUNC(name)  name##_sse2
+# define BS_TARGET
+# define BS_AND(a, b)   _mm_and_si128( a, b )
+# define BS_XOR(a, b)   _mm_xor_si128( a, b )
+# define BS_ZERO        _mm_setzero_si128()
+# define BS_ONES        _mm_set1_epi32( -1 )
+# include "csa_bs.h"
+#endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+# include <immintrin.h>
+# define bs_t           __m256i
+# define BS_BATCH       256
+# define BS_FUNC(name)  name##_avx2
+# define BS_TARGET      VLC_AVX2
+# define BS_AND(a, b)   _mm256_and_si256( a, b )
+# define BS_XOR(a, b)   _mm256_xor_si256( a, b )
+# define BS_ZERO        _mm256_setzero_si256()
+# define BS_ONES        _mm256_set1_epi32( -1 )
+# include "csa_bs.h"
+#endif
+
+static csa_bs_stream_t csa_GetBatchStream( int *pi_batch )
+{
+#ifdef HAVE_AVX2_INTRINSICS
+    if( vlc_CPU_AVX2() )
+    {
+        *pi_batch = 256;
+        return csa_bs_Stream_avx2;
+    }
+#endif
+#ifdef __SSE2__
+    if( vlc_CPU_SSE2() )
+    {
+        *pi_batch = 128;
+        return csa_bs_Stream_sse2;
+    }
+#endif
+    *pi_batch = 64;
+    return csa_bs_Stream_c;
+}
+
 // block - sbox
 static const uint8_t block_sbox[256] =
 {
@@ -0,0 +1,243 @@
+/*****************************************************************************
+ * csa_bs.h: bitsliced CSA stream cypher
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/* This file is included by csa.c once per vector type, with the following
+ * macros defined:
+ *  - bs_t: the vector type, of BS_BATCH bits,
+ *  - BS_FUNC(name): the name of a function of this instance,
+ *  - BS_TARGET: the attributes of the functions of this instance,
+ *  - BS_AND(a,b), BS_XOR(a,b), BS_ZERO and BS_ONES.
+ * Every bit of the cypher state becomes a vector, and bit i of each vector
+ * belongs to the i-th packet, so that BS_BATCH packets are processed at
+ * once with logical operations only. The macros are undefined at the end. */
+
+typedef struct
+{
+    bs_t A[11][4]; /* A[1] to A[10], 4 bits each */
+    bs_t B[11][4];
+    bs_t X[4], Y[4], Z[4];
+    bs_t D[4], E[4], F[4];
+    bs_t p, q, r;
+} BS_FUNC(csa_bs_state_t);
+
+/* Computes the 32 products of the 5 inputs of a s-box, see BS_ANF() */
+BS_TARGET
+static inline void BS_FUNC(csa_bs_Monomials)( bs_t m[32], bs_t x4, bs_t x3,
+                                              bs_t x2, bs_t x1, bs_t x0 )
+{
+    m[0] = BS_ONES;
+    m[1] = x0;
+    m[2] = x1;
+    m[4] = x2;
+    m[8] = x3;
+    m[16] = x4;
+    for( int k = 3; k < 32; k++ )
+    {
+        if( k & (k - 1) )
+            m[k] = BS_AND( m[k & (k - 1)], m[k & -k] );
+    }
+}
+
+#define BS_SBOX( o, n, x4, x3, x2, x1, x0 ) \
+    do { \
+        BS_FUNC(csa_bs_Monomials)( m, s->x4, s->x3, s->x2, s->x1, s->x0 ); \
+        BS_ANF( o[0], m, csa_sbox_anf[n][0] ); \
+        BS_ANF( o[1], m, csa_sbox_anf[n][1] ); \
+    } while(0)
+
+/* Same as one iteration of the inner loop of csa_StreamCypher(), in_a and
+ * in_b are the input nibbles of A and B during the initialisation, or NULL */
+BS_TARGET
+static void BS_FUNC(csa_bs_Step)( BS_FUNC(csa_bs_state_t) *s,
+                                  const bs_t *in_a, const bs_t *in_b,
+                                  bs_t out[2] )
+{
+    bs_t m[32];
+    bs_t s1[2], s2[2], s3[2], s4[2], s5[2], s6[2], s7[2];
+    bs_t extra_B[4], next_A1[4], next_B1[4], next_F[4];
+
+    BS_SBOX( s1, 0, A[4][0], A[1][2], A[6][1], A[7][3], A[9][0] );
+    BS_SBOX( s2, 1, A[2][1], A[3][2], A[6][3], A[7][0], A[9][1] );
+    BS_SBOX( s3, 2, A[1][3], A[2][0], A[5][1], A[5][3], A[6][2] );
+    BS_SBOX( s4, 3, A[3][3], A[1][1], A[2][3], A[4][2], A[8][0] );
+    BS_SBOX( s5, 4, A[5][2], A[4][3], A[6][0], A[8][1], A[9][2] );
+    BS_SBOX( s6, 5, A[3][1], A[4][1], A[5][0], A[7][2], A[9][3] );
+    BS_SBOX( s7, 6, A[2][2], A[3][0], A[7][1], A[8][2], A[8][3] );
+
+    extra_B[3] = BS_XOR( BS_XOR( s->B[3][0], s->B[6][1] ),
+                         BS_XOR( s->B[7][2], s->B[9][3] ) );
+    extra_B[2] = BS_XOR( BS_XOR( s->B[6][0], s->B[8][1] ),
+                         BS_XOR( s->B[3][3], s->B[4][2] ) );
+    extra_B[1] = BS_XOR( BS_XOR( s->B[5][3], s->B[8][2] ),
+                         BS_XOR( s->B[4][0], s->B[5][1] ) );
+    extra_B[0] = BS_XOR( BS_XOR( s->B[9][2], s->B[6][3] ),
+                         BS_XOR( s->B[3][1], s->B[8][0] ) );
+
+    for( int i = 0; i < 4; i++ )
+    {
+        next_A1[i] = BS_XOR( s->A[10][i], s->X[i] );
+        next_B1[i] = BS_XOR( BS_XOR( s->B[7][i], s->B[10][i] ), s->Y[i] );
+        if( in_a != NULL )
+        {
+            next_A1[i] = BS_XOR( next_A1[i], BS_XOR( s->D[i], in_a[i] ) );
+            next_B1[i] = BS_XOR( next_B1[i], in_b[i] );
+        }
+    }
+
+    /* if p is set, rotate next_B1 left */
+    bs_t rotated[4];
+    for( int i = 0; i < 4; i++ )
+        rotated[i] = next_B1[(i + 3) % 4];
+    for( int i = 0; i < 4; i++ )
+        next_B1[i] = BS_XOR( next_B1[i],
+                             BS_AND( s->p, BS_XOR( next_B1[i], rotated[i] ) ) );
+
+    /* if q is set, F = Z + E + r with r the carry, else F = E */
+    bs_t carry = s->r;
+    for( int i = 0; i < 4; i++ )
+    {
+        const bs_t zxe = BS_XOR( s->Z[i], s->E[i] );
+        const bs_t sum = BS_XOR( zxe, carry );
+
+        /* The two terms cannot be set at once */
+        carry = BS_XOR( BS_AND( s->Z[i], s->E[i] ), BS_AND( carry, zxe ) );
+        next_F[i] = BS_XOR( s->E[i], BS_AND( s->q, BS_XOR( sum, s->E[i] ) ) );
+    }
+    s->r = BS_XOR( s->r, BS_AND( s->q, BS_XOR( carry, s->r ) ) );
+
+    for( int i = 0; i < 4; i++ )
+    {
+        s->D[i] = BS_XOR( BS_XOR( s->E[i], s->Z[i] ), extra_B[i] );
+        s->E[i] = s->F[i];
+        s->F[i] = next_F[i];
+    }
+
+    memmove( &s->A[2], &s->A[1], 9 * sizeof(s->A[1]) );
+    memmove( &s->B[2], &s->B[1], 9 * sizeof(s->B[1]) );
+    memcpy( s->A[1], next_A1, sizeof(next_A1) );
+    memcpy( s->B[1], next_B1, sizeof(next_B1) );
+
+    s->X[3] = s4[0]; s->X[2] = s3[0]; s->X[1] = s2[1]; s->X[0] = s1[1];
+    s->Y[3] = s6[0]; s->Y[2] = s5[0]; s->Y[1] = s4[1]; s->Y[0] = s3[1];
+    s->Z[3] = s2[0]; s->Z[2] = s1[0]; s->Z[1] = s6[1]; s->Z[0] = s5[1];
+    s->p = s7[1];
+    s->q = s7[0];
+
+    out[1] = BS_XOR( s->D[2], s->D[3] );
+    out[0] = BS_XOR( s->D[0], s->D[1] );
+}
+#undef BS_SBOX
+
+/*****************************************************************************
+ * csa_bs_Stream: xors the CSA stream into up to BS_BATCH packets
+ *****************************************************************************
+ * pp_data[i] points to the payload of the i-th packet, whose first 8 bytes
+ * initialise the stream and are left untouched. The stream is xored into
+ * the following pi_size[i] - 8 bytes.
+ *****************************************************************************/
+BS_TARGET
+static void BS_FUNC(csa_bs_Stream)( const uint8_t ck[8],
+                                    uint8_t *const *pp_data,
+                                    const int *pi_size, int i_lanes )
+{
+    BS_FUNC(csa_bs_state_t) s;
+    uint8_t bits[8][BS_BATCH / 8];
+    bs_t in[8], out[2];
+    int i_blocks = 0;
+
+    assert( i_lanes > 0 && i_lanes <= BS_BATCH );
+    for( int i = 0; i < i_lanes; i++ )
+        i_blocks = __MAX( i_blocks, (pi_size[i] - 1) / 8 );
+
+    /* The key is the same for every packet, other registers start at 0 */
+    memset( &s, 0, sizeof(s) );
+    for( int i = 0; i < 4; i++ )
+    {
+        for( int j = 0; j < 4; j++ )
+        {
+            s.A[1+2*i+0][j] = (ck[i] >> (4 + j)) & 1 ? BS_ONES : BS_ZERO;
+            s.A[1+2*i+1][j] = (ck[i] >> j) & 1 ? BS_ONES : BS_ZERO;
+            s.B[1+2*i+0][j] = (ck[4+i] >> (4 + j)) & 1 ? BS_ONES : BS_ZERO;
+            s.B[1+2*i+1][j] = (ck[4+i] >> j) & 1 ? BS_ONES : BS_ZERO;
+        }
+    }
+    /* Initialisation with the first 8 bytes, 4 bits per iteration */
+    for( int i = 0; i < 8; i++ )
+    {
+        for( int g = 0; g < BS_BATCH / 8; g++ )
+        {
+            uint64_t x = 0;
+            for( int k = 0; k < 8 && 8 * g + k < i_lanes; k++ )
+                x |= (uint64_t)pp_data[8 * g + k][i] << (8 * k);
+            x = csa_Transpose8x8( x );
+            for( int b = 0; b < 8; b++ )
+                bits[b][g] = x >> (8 * b);
+        }
+        for( int b = 0; b < 8; b++ )
+            memcpy( &in[b], bits[b], sizeof(in[b]) );
+
+        for( int j = 0; j < 4; j++ )
+        {
+            /* the high nibble goes to A first, then the low one */
+            const bs_t *in_a = (j % 2) ? &in[0] : &in[4];
+            const bs_t *in_b = (j % 2) ? &in[4] : &in[0];
+
+            BS_FUNC(csa_bs_Step)( &s, in_a, in_b, out );
+        }
+    }
+
+    /* Generation, 2 bits per iteration starting from the highest ones */
+    for( int i_block = 0; i_block < i_blocks; i_block++ )
+    {
+        for( int i = 0; i < 8; i++ )
+        {
+            const int i_offset = 8 + 8 * i_block + i;
+
+            for( int j = 0; j < 4; j++ )
+            {
+                BS_FUNC(csa_bs_Step)( &s, NULL, NULL, out );
+                memcpy( bits[7 - 2 * j], &out[1], sizeof(out[1]) );
+                memcpy( bits[6 - 2 * j], &out[0], sizeof(out[0]) );
+            }
+
+            for( int g = 0; g < BS_BATCH / 8 && 8 * g < i_lanes; g++ )
+            {
+                uint64_t x = 0;
+                for( int b = 0; b < 8; b++ )
+                    x |= (uint64_t)bits[b][g] << (8 * b);
+                x = csa_Transpose8x8( x );
+                for( int k = 0; k < 8 && 8 * g + k < i_lanes; k++ )
+                {
+                    if( i_offset < pi_size[8 * g + k] )
+                        pp_data[8 * g + k][i_offset] ^= x >> (8 * k);
+                }
+            }
+        }
+    }
+}
+
+#undef bs_t
+#undef BS_BATCH
+#undef BS_FUNC
+#undef BS_TARGET
+#undef BS_AND
+#undef BS_XOR
+#undef BS_ZERO
+#undef BS_ONES
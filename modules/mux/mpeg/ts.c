@@ -1748,9 +1748,12 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
     }
 
     /* msg_Dbg( p_mux, "real pck=%d", i_packet_count ); */
-    for (int i = 0; i < i_packet_count; i++ )
+    uint8_t *pp_scrambled[256];
+    int i_scrambled = 0;
+    block_t *p_ts = p_chain_ts->p_first;
+
+    for (int i = 0; i < i_packet_count; i++, p_ts = p_ts->p_next )
     {
-        block_t *p_ts = BufferChainGet( p_chain_ts );
         mtime_t i_new_dts = i_pcr_dts + i_pcr_length * i / i_packet_count;
 
         p_ts->i_dts    = i_new_dts;
@@ -1762,17 +1765,27 @@ static void TSDate( sout_mux_t *p_mux, sout_buffer_chain_t *p_chain_ts,
             TSSetPCR( p_ts, p_ts->i_dts - p_sys->i_dts_delay );
         }
         if( p_ts->i_flags & BLOCK_FLAG_SCRAMBLED )
+        {
+            pp_scrambled[i_scrambled++] = p_ts->p_buffer;
+        }
+
+        /* The packets are scrambled together, which is much faster */
+        if( i_scrambled > 0 && ( i_scrambled == 256 ||
+                                 i == i_packet_count - 1 ) )
         {
             vlc_mutex_lock( &p_sys->csa_lock );
-            csa_Encrypt( p_sys->csa, p_ts->p_buffer, p_sys->i_csa_pkt_size );
+            csa_EncryptPackets( p_sys->csa, pp_scrambled, i_scrambled,
+                                p_sys->i_csa_pkt_size );
             vlc_mutex_unlock( &p_sys->csa_lock );
+            i_scrambled = 0;
         }
 
         /* latency */
         p_ts->i_dts += p_sys->i_shaping_delay * 3 / 2;
-
-        sout_AccessOutWrite( p_mux->p_access, p_ts );
     }
+
+    for (int i = 0; i < i_packet_count; i++ )
+        sout_AccessOutWrite( p_mux->p_access, BufferChainGet( p_chain_ts ) );
 }
 
 static block_t *TSNew( sout_mux_t *p_mux, ts_stream_t *p_stream,
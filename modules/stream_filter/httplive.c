@@ -42,6 +42,7 @@
 #include <vlc_stream.h>
 #include <vlc_memory.h>
 #include <vlc_gcrypt.h>
+#include <vlc_atomic.h>
 
 /*****************************************************************************
  * Module descriptor
@@ -49,12 +50,24 @@
 static int  Open (vlc_object_t *);
 static void Close(vlc_object_t *);
 
+#define HLS_WINDOW 6 /* segments downloaded ahead of playback */
+#define HLS_READ_CHUNK 65536
+#define HLS_THROUGHPUT_WINDOW (2 * CLOCK_FREQ) /* busy time per sample */
+
+#define DEPTH_TEXT N_("Parallel segment downloads")
+#define DEPTH_LONGTEXT N_( \
+    "Number of segments downloaded at the same time ahead of playback. " \
+    "More downloads hide the request latency on startup and after a seek.")
+
 vlc_module_begin()
     set_category(CAT_INPUT)
     set_subcategory(SUBCAT_INPUT_STREAM_FILTER)
     set_description(N_("Http Live Streaming stream filter"))
     set_capability("stream_filter", 20)
     set_callbacks(Open, Close)
+
+    add_integer("hls-download-depth", 3, DEPTH_TEXT, DEPTH_LONGTEXT, true)
+        change_integer_range(1, HLS_WINDOW)
 vlc_module_end()
 
 /*****************************************************************************
@@ -97,11 +110,18 @@ typedef struct hls_stream_s
     bool         b_iv_loaded;
 } hls_stream_t;
 
+typedef struct hls_worker_s
+{
+    stream_t     *s;
+    vlc_thread_t  thread;
+    int           segment;      /* segment being downloaded (-1 if none) */
+    atomic_bool   b_abort;      /* segment no longer wanted after a seek */
+} hls_worker_t;
+
 struct stream_sys_t
 {
     char         *m3u8;         /* M3U8 url */
     vlc_thread_t  reload;       /* HLS m3u8 reload thread */
-    vlc_thread_t  thread;       /* HLS segment download thread */
 
     block_t      *peeked;
 
@@ -113,12 +133,27 @@ struct stream_sys_t
     struct hls_download_s
     {
         int         stream;     /* current hls_stream  */
-        int         segment;    /* current segment for downloading */
+        int         segment;    /* next segment to download */
         int         seek;       /* segment requested by seek (default -1) */
+        bool        b_close;    /* stop the download threads */
         vlc_mutex_t lock_wait;  /* protect segment download counter */
         vlc_cond_t  wait;       /* some condition to wait on */
+        vlc_mutex_t lock_key;   /* serialize AES key loading */
+
+        hls_worker_t *workers;  /* segment download threads */
+        int         i_workers;
     } download;
 
+    /* Throughput measured over all concurrent downloads */
+    struct hls_throughput_s
+    {
+        vlc_mutex_t lock;
+        int         active;     /* downloads in progress */
+        mtime_t     since;      /* last update of the busy time */
+        mtime_t     busy;       /* time spent with downloads in progress */
+        uint64_t    bytes;      /* bytes received during that time */
+    } throughput;
+
     /* Playback */
     struct hls_playback_s
     {
@@ -154,7 +189,7 @@ static ssize_t read_M3U8_from_stream(stream_t *s, uint8_t **buffer);
 static ssize_t read_M3U8_from_url(stream_t *s, const char *psz_url, uint8_t **buffer);
 static char *ReadLine(uint8_t *buffer, uint8_t **pos, size_t len);
 
-static int hls_Download(stream_t *s, segment_t *segment);
+static int hls_Download(stream_t *s, segment_t *segment, hls_worker_t *worker);
 
 static void* hls_Thread(void *);
 static void* hls_Reload(void *);
@@ -1186,6 +1221,8 @@ static int hls_ManageSegmentKeys(stream_t *s, hls_stream_t *hls)
 
 static int hls_DecodeSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment)
 {
+    stream_sys_t *p_sys = s->p_sys;
+
     /* Did the segment need to be decoded ? */
     if (segment->psz_key_path == NULL)
         return VLC_SUCCESS;
@@ -1194,7 +1231,10 @@ static int hls_DecodeSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segm
     if (!segment->b_key_loaded)
     {
         /* No ? try to download it now */
-        if (hls_ManageSegmentKeys(s, hls) != VLC_SUCCESS)
+        vlc_mutex_lock(&p_sys->download.lock_key);
+        int ret = hls_ManageSegmentKeys(s, hls);
+        vlc_mutex_unlock(&p_sys->download.lock_key);
+        if (ret != VLC_SUCCESS)
             return VLC_EGENERIC;
     }
 
@@ -1477,7 +1517,68 @@ static int BandwidthAdaptation(stream_t *s, int progid, uint64_t *bandwidth)
     return candidate;
 }
 
-static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment, int *cur_stream)
+/* Accounts for the time spent with downloads in progress, and takes a
+ * throughput sample once enough of it has elapsed (or right away if there is
+ * no estimate yet and b_first is set). Throughput lock must be held.
+ * Parallel downloads share the link, so the throughput is measured as the
+ * bytes received over the time during which any download was in progress. */
+static void hls_ThroughputUpdate(stream_sys_t *p_sys, bool b_first)
+{
+    mtime_t now = mdate();
+
+    if (p_sys->throughput.active > 0)
+        p_sys->throughput.busy += now - p_sys->throughput.since;
+    p_sys->throughput.since = now;
+
+    if (p_sys->throughput.busy >= HLS_THROUGHPUT_WINDOW
+     || (b_first && p_sys->bandwidth == 0 && p_sys->throughput.busy > 0))
+    {
+        uint64_t bw = p_sys->bandwidth;
+        uint64_t sample = p_sys->throughput.bytes * 8 * CLOCK_FREQ
+                        / p_sys->throughput.busy; /* bits / s */
+        if (bw == 0)
+            bw = sample;
+        else
+            bw = (3 * bw + sample) / 4;
+        p_sys->bandwidth = bw;
+
+        p_sys->throughput.busy = 0;
+        p_sys->throughput.bytes = 0;
+    }
+}
+
+/* Accounts for a segment download starting */
+static void hls_ThroughputStart(stream_sys_t *p_sys)
+{
+    vlc_mutex_lock(&p_sys->throughput.lock);
+    hls_ThroughputUpdate(p_sys, false);
+    p_sys->throughput.active++;
+    vlc_mutex_unlock(&p_sys->throughput.lock);
+}
+
+/* Accounts for bytes received by a download */
+static void hls_ThroughputAdd(stream_sys_t *p_sys, size_t size)
+{
+    vlc_mutex_lock(&p_sys->throughput.lock);
+    p_sys->throughput.bytes += size;
+    hls_ThroughputUpdate(p_sys, false);
+    vlc_mutex_unlock(&p_sys->throughput.lock);
+}
+
+/* Accounts for a segment download ending, and returns the current
+ * throughput estimate (bits per second). */
+static uint64_t hls_ThroughputStop(stream_sys_t *p_sys)
+{
+    vlc_mutex_lock(&p_sys->throughput.lock);
+    hls_ThroughputUpdate(p_sys, true);
+    p_sys->throughput.active--;
+    uint64_t bw = p_sys->bandwidth;
+    vlc_mutex_unlock(&p_sys->throughput.lock);
+    return bw;
+}
+
+static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *segment,
+                                   int *cur_stream, hls_worker_t *worker)
 {
     stream_sys_t *p_sys = s->p_sys;
 
@@ -1504,15 +1605,21 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
         }
     }
 
-    mtime_t start = mdate();
-    if (hls_Download(s, segment) != VLC_SUCCESS)
+    hls_ThroughputStart(p_sys);
+    if (hls_Download(s, segment, worker) != VLC_SUCCESS)
     {
-        msg_Err(s, "downloading segment %d from stream %d failed",
+        hls_ThroughputStop(p_sys);
+        if (atomic_load(&worker->b_abort))
+            msg_Dbg(s, "downloading segment %d from stream %d aborted",
+                    segment->sequence, *cur_stream);
+        else
+            msg_Err(s, "downloading segment %d from stream %d failed",
                     segment->sequence, *cur_stream);
         vlc_mutex_unlock(&segment->lock);
         return VLC_EGENERIC;
     }
-    mtime_t duration = mdate() - start;
+    uint64_t bw = hls_ThroughputStop(p_sys);
+
     if (hls->bandwidth == 0 && segment->duration > 0)
     {
         /* Try to estimate the bandwidth for this stream */
@@ -1531,13 +1638,10 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
     msg_Info(s, "downloaded segment %d from stream %d",
                 segment->sequence, *cur_stream);
 
-    uint64_t bw = segment->size * 8 * 1000000 / __MAX(1, duration); /* bits / s */
-    p_sys->bandwidth = bw;
     if (p_sys->b_meta && (hls->bandwidth != bw))
     {
         int newstream = BandwidthAdaptation(s, hls->id, &bw);
 
-        /* FIXME: we need an average here */
         if ((newstream >= 0) && (newstream != *cur_stream))
         {
             msg_Info(s, "detected %s bandwidth (%"PRIu64") stream",
@@ -1548,16 +1652,30 @@ static int hls_DownloadSegmentData(stream_t *s, hls_stream_t *hls, segment_t *se
     return VLC_SUCCESS;
 }
 
+/* Is the given segment being downloaded? (lock_wait must be held) */
+static bool hls_IsDownloading(stream_sys_t *p_sys, int segment)
+{
+    for (int i = 0; i < p_sys->download.i_workers; i++)
+        if (p_sys->download.workers[i].segment == segment)
+            return true;
+    return false;
+}
+
 static void* hls_Thread(void *p_this)
 {
-    stream_t *s = (stream_t *)p_this;
+    hls_worker_t *worker = (hls_worker_t *)p_this;
+    stream_t *s = worker->s;
     stream_sys_t *p_sys = s->p_sys;
 
     int canc = vlc_savecancel();
 
     while (vlc_object_alive(s))
     {
-        hls_stream_t *hls = hls_Get(p_sys->hls_stream, p_sys->download.stream);
+        vlc_mutex_lock(&p_sys->download.lock_wait);
+        int stream = p_sys->download.stream;
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
+
+        hls_stream_t *hls = hls_Get(p_sys->hls_stream, stream);
         assert(hls);
 
         /* Sliding window (~60 seconds worth of movie) */
@@ -1566,59 +1684,61 @@ static void* hls_Thread(void *p_this)
         vlc_mutex_unlock(&hls->lock);
 
         /* Is there a new segment to process? */
-        if ((!p_sys->b_live && (p_sys->playback.segment < (count - 6))) ||
+        vlc_mutex_lock(&p_sys->download.lock_wait);
+        while (((p_sys->download.segment - p_sys->playback.segment >= HLS_WINDOW) ||
+                (p_sys->download.segment >= count)) &&
+               (p_sys->download.seek == -1) &&
+               !p_sys->download.b_close && !p_sys->b_error)
+        {
+            vlc_cond_wait(&p_sys->download.wait, &p_sys->download.lock_wait);
+            if (p_sys->b_live /*&& (mdate() >= p_sys->playlist.wakeup)*/)
+                break;
+            if (!vlc_object_alive(s))
+                break;
+        }
+        /* */
+        if (p_sys->download.seek >= 0)
+        {
+            p_sys->download.segment = p_sys->download.seek;
+            p_sys->download.seek = -1;
+        }
+
+        if (p_sys->download.b_close || p_sys->b_error)
+        {
+            vlc_mutex_unlock(&p_sys->download.lock_wait);
+            break;
+        }
+        if ((p_sys->download.segment - p_sys->playback.segment >= HLS_WINDOW) ||
             (p_sys->download.segment >= count))
         {
-            /* wait */
-            vlc_mutex_lock(&p_sys->download.lock_wait);
-            while (((p_sys->download.segment - p_sys->playback.segment > 6) ||
-                    (p_sys->download.segment >= count)) &&
-                   (p_sys->download.seek == -1))
-            {
-                vlc_cond_wait(&p_sys->download.wait, &p_sys->download.lock_wait);
-                if (p_sys->b_live /*&& (mdate() >= p_sys->playlist.wakeup)*/)
-                    break;
-                if (!vlc_object_alive(s))
-                    break;
-            }
-            /* */
-            if (p_sys->download.seek >= 0)
-            {
-                p_sys->download.segment = p_sys->download.seek;
-                p_sys->download.seek = -1;
-            }
+            /* woken up, but nothing to do yet */
             vlc_mutex_unlock(&p_sys->download.lock_wait);
+            continue;
         }
 
-        if (!vlc_object_alive(s)) break;
+        /* claim the next segment, other threads will take the following */
+        int i_segment = p_sys->download.segment++;
+        worker->segment = i_segment;
+        atomic_store(&worker->b_abort, false);
+        vlc_mutex_unlock(&p_sys->download.lock_wait);
 
         vlc_mutex_lock(&hls->lock);
-        segment_t *segment = segment_GetSegment(hls, p_sys->download.segment);
+        segment_t *segment = segment_GetSegment(hls, i_segment);
         vlc_mutex_unlock(&hls->lock);
 
-        if ((segment != NULL) &&
-            (hls_DownloadSegmentData(s, hls, segment, &p_sys->download.stream) != VLC_SUCCESS))
-        {
-            if (!vlc_object_alive(s)) break;
-
-            if (!p_sys->b_live)
-            {
-                p_sys->b_error = true;
-                break;
-            }
-        }
+        int ret = VLC_SUCCESS;
+        int newstream = stream;
+        if (segment != NULL)
+            ret = hls_DownloadSegmentData(s, hls, segment, &newstream, worker);
 
-        /* download succeeded */
-        /* determine next segment to download */
         vlc_mutex_lock(&p_sys->download.lock_wait);
-        if (p_sys->download.seek >= 0)
-        {
-            p_sys->download.segment = p_sys->download.seek;
-            p_sys->download.seek = -1;
-        }
-        else if (p_sys->download.segment < count)
-            p_sys->download.segment++;
-        vlc_cond_signal(&p_sys->download.wait);
+        worker->segment = -1;
+        if ((ret != VLC_SUCCESS) && !atomic_load(&worker->b_abort) &&
+            vlc_object_alive(s) && !p_sys->b_live)
+            p_sys->b_error = true;
+        else if (newstream != stream)
+            p_sys->download.stream = newstream;
+        vlc_cond_broadcast(&p_sys->download.wait);
         vlc_mutex_unlock(&p_sys->download.lock_wait);
     }
 
@@ -1679,6 +1799,27 @@ static void* hls_Reload(void *p_this)
     return NULL;
 }
 
+static void StopDownloads(stream_t *s)
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    vlc_mutex_lock(&p_sys->download.lock_wait);
+    p_sys->download.b_close = true;
+    for (int i = 0; i < p_sys->download.i_workers; i++)
+        atomic_store(&p_sys->download.workers[i].b_abort, true);
+    vlc_cond_broadcast(&p_sys->download.wait);
+    vlc_mutex_unlock(&p_sys->download.lock_wait);
+
+    for (int i = 0; i < p_sys->download.i_workers; i++)
+        vlc_join(p_sys->download.workers[i].thread, NULL);
+    free(p_sys->download.workers);
+    p_sys->download.workers = NULL;
+    p_sys->download.i_workers = 0;
+}
+
+/* Starts the download threads and waits for the first segment. The
+ * following ones are fetched meanwhile, so that startup does not pay
+ * for one round trip per segment. */
 static int Prefetch(stream_t *s, int *current)
 {
     stream_sys_t *p_sys = s->p_sys;
@@ -1693,44 +1834,70 @@ static int Prefetch(stream_t *s, int *current)
     else if (vlc_array_count(hls->segments) == 1 && p_sys->b_live)
         msg_Warn(s, "Only 1 segment available to prefetch in live stream; may stall");
 
-    /* Download first 2 segments of this HLS stream if they exist */
-    for (int i = 0; i < __MIN(vlc_array_count(hls->segments), 2); i++)
+    int depth = var_InheritInteger(s, "hls-download-depth");
+    depth = VLC_CLIP(depth, 1, HLS_WINDOW);
+
+    p_sys->download.workers = calloc(depth, sizeof(hls_worker_t));
+    if (p_sys->download.workers == NULL)
+        return VLC_ENOMEM;
+
+    for (int i = 0; i < depth; i++)
     {
-        segment_t *segment = segment_GetSegment(hls, p_sys->download.segment);
-        if (segment == NULL )
-            return VLC_EGENERIC;
+        hls_worker_t *worker = &p_sys->download.workers[i];
 
-        /* It is useless to lock the segment here, as Prefetch is called before
-           download and playlit thread are started. */
-        if (segment->data)
-        {
-            p_sys->download.segment++;
-            continue;
-        }
+        worker->s = s;
+        worker->segment = -1;
+        atomic_init(&worker->b_abort, false);
+        if (vlc_clone(&worker->thread, hls_Thread, worker, VLC_THREAD_PRIORITY_INPUT))
+            break;
+        p_sys->download.i_workers++;
+    }
+    if (p_sys->download.i_workers == 0)
+    {
+        free(p_sys->download.workers);
+        p_sys->download.workers = NULL;
+        return VLC_EGENERIC;
+    }
+    msg_Dbg(s, "downloading up to %d segments at a time", p_sys->download.i_workers);
 
-        if (hls_DownloadSegmentData(s, hls, segment, current) != VLC_SUCCESS)
-            return VLC_EGENERIC;
+    const int wanted = p_sys->playback.segment;
 
-        p_sys->download.segment++;
+    vlc_mutex_lock(&p_sys->download.lock_wait);
+    while (((p_sys->download.segment <= wanted) || hls_IsDownloading(p_sys, wanted)) &&
+           !p_sys->b_error && vlc_object_alive(s))
+        vlc_cond_wait(&p_sys->download.wait, &p_sys->download.lock_wait);
+    *current = p_sys->download.stream;
+    vlc_mutex_unlock(&p_sys->download.lock_wait);
 
-        /* adapt bandwidth? */
-        if (*current != stream)
-        {
-            hls_stream_t *hls = hls_Get(p_sys->hls_stream, *current);
-            if (hls == NULL)
-                return VLC_EGENERIC;
+    /* The first segment may have been downloaded from any stream */
+    bool b_ready = false;
+    for (int i = 0; i < vlc_array_count(p_sys->hls_stream) && !b_ready; i++)
+    {
+        hls = hls_Get(p_sys->hls_stream, i);
 
-             stream = *current;
+        vlc_mutex_lock(&hls->lock);
+        segment_t *segment = segment_GetSegment(hls, wanted);
+        if (segment != NULL)
+        {
+            vlc_mutex_lock(&segment->lock);
+            b_ready = segment->data != NULL;
+            vlc_mutex_unlock(&segment->lock);
         }
+        vlc_mutex_unlock(&hls->lock);
     }
 
+    if (!b_ready)
+    {
+        StopDownloads(s);
+        return VLC_EGENERIC;
+    }
     return VLC_SUCCESS;
 }
 
 /****************************************************************************
  *
  ****************************************************************************/
-static int hls_Download(stream_t *s, segment_t *segment)
+static int hls_Download(stream_t *s, segment_t *segment, hls_worker_t *worker)
 {
     assert(segment);
 
@@ -1775,10 +1942,21 @@ static int hls_Download(stream_t *s, segment_t *segment)
             assert(segment->data->i_buffer == segment->size);
             p_block = NULL;
         }
-        length = stream_Read(p_ts, segment->data->p_buffer + curlen, segment->size - curlen);
+        /* read in chunks, so that an aborted download stops early */
+        length = stream_Read(p_ts, segment->data->p_buffer + curlen,
+                             __MIN(segment->size - curlen, HLS_READ_CHUNK));
         if (length <= 0)
             break;
         curlen += length;
+        hls_ThroughputAdd(s->p_sys, length);
+
+        if (atomic_load(&worker->b_abort))
+        {
+            stream_Delete(p_ts);
+            block_Release(segment->data);
+            segment->data = NULL;
+            return VLC_EGENERIC;
+        }
     } while (vlc_object_alive(s));
 
     stream_Delete(p_ts);
@@ -1960,18 +2138,20 @@ static int Open(vlc_object_t *p_this)
     /* manage encryption key if needed */
     hls_ManageSegmentKeys(s, hls_Get(p_sys->hls_stream, current));
 
-    if (Prefetch(s, &current) != VLC_SUCCESS)
-    {
-        msg_Err(s, "fetching first segment failed.");
-        goto fail;
-    }
-
     p_sys->download.stream = current;
     p_sys->playback.stream = current;
     p_sys->download.seek = -1;
 
     vlc_mutex_init(&p_sys->download.lock_wait);
     vlc_cond_init(&p_sys->download.wait);
+    vlc_mutex_init(&p_sys->download.lock_key);
+    vlc_mutex_init(&p_sys->throughput.lock);
+
+    if (Prefetch(s, &current) != VLC_SUCCESS)
+    {
+        msg_Err(s, "fetching first segment failed.");
+        goto fail_thread;
+    }
 
     /* Initialize HLS live stream */
     if (p_sys->b_live)
@@ -1983,22 +2163,18 @@ static int Open(vlc_object_t *p_this)
 
         if (vlc_clone(&p_sys->reload, hls_Reload, s, VLC_THREAD_PRIORITY_LOW))
         {
+            StopDownloads(s);
             goto fail_thread;
         }
     }
 
-    if (vlc_clone(&p_sys->thread, hls_Thread, s, VLC_THREAD_PRIORITY_INPUT))
-    {
-        if (p_sys->b_live)
-            vlc_join(p_sys->reload, NULL);
-        goto fail_thread;
-    }
-
     return VLC_SUCCESS;
 
 fail_thread:
     vlc_mutex_destroy(&p_sys->download.lock_wait);
     vlc_cond_destroy(&p_sys->download.wait);
+    vlc_mutex_destroy(&p_sys->download.lock_key);
+    vlc_mutex_destroy(&p_sys->throughput.lock);
 
 fail:
     /* Free hls streams */
@@ -2026,19 +2202,13 @@ static void Close(vlc_object_t *p_this)
     assert(p_sys->hls_stream);
 
     /* */
-    vlc_mutex_lock(&p_sys->download.lock_wait);
-    /* negate the condition variable's predicate */
-    p_sys->download.segment = p_sys->playback.segment = 0;
-    p_sys->download.seek = 0; /* better safe than sorry */
-    vlc_cond_signal(&p_sys->download.wait);
-    vlc_mutex_unlock(&p_sys->download.lock_wait);
-
-    /* */
+    StopDownloads(s);
     if (p_sys->b_live)
         vlc_join(p_sys->reload, NULL);
-    vlc_join(p_sys->thread, NULL);
     vlc_mutex_destroy(&p_sys->download.lock_wait);
     vlc_cond_destroy(&p_sys->download.wait);
+    vlc_mutex_destroy(&p_sys->download.lock_key);
+    vlc_mutex_destroy(&p_sys->throughput.lock);
 
     /* Free hls streams */
     for (int i = 0; i < vlc_array_count(p_sys->hls_stream); i++)
@@ -2063,6 +2233,13 @@ static segment_t *GetSegment(stream_t *s)
     stream_sys_t *p_sys = s->p_sys;
     segment_t *segment = NULL;
 
+    /* Is this segment being downloaded? */
+    vlc_mutex_lock(&p_sys->download.lock_wait);
+    while (hls_IsDownloading(p_sys, p_sys->playback.segment) &&
+           !p_sys->b_error && vlc_object_alive(s))
+        vlc_cond_wait(&p_sys->download.wait, &p_sys->download.lock_wait);
+    vlc_mutex_unlock(&p_sys->download.lock_wait);
+
     /* Is this segment of the current HLS stream ready? */
     hls_stream_t *hls = hls_Get(p_sys->hls_stream, p_sys->playback.stream);
     if (hls != NULL)
@@ -2187,10 +2364,10 @@ static ssize_t hls_Read(stream_t *s, uint8_t *p_read, unsigned int i_read)
 
             vlc_mutex_unlock(&segment->lock);
 
-            /* signal download thread */
+            /* signal download threads */
             vlc_mutex_lock(&p_sys->download.lock_wait);
             p_sys->playback.segment++;
-            vlc_cond_signal(&p_sys->download.wait);
+            vlc_cond_broadcast(&p_sys->download.wait);
             vlc_mutex_unlock(&p_sys->download.lock_wait);
             continue;
         }
@@ -2453,10 +2630,20 @@ static int segment_Seek(stream_t *s, const uint64_t pos)
         /* start download at current playback segment */
         vlc_mutex_unlock(&hls->lock);
 
-        /* Wake up download thread */
+        /* Wake up download threads, and abort the downloads which are not
+         * needed anymore so that they can start on the new position */
         vlc_mutex_lock(&p_sys->download.lock_wait);
         p_sys->download.seek = p_sys->playback.segment;
-        vlc_cond_signal(&p_sys->download.wait);
+        for (int i = 0; i < p_sys->download.i_workers; i++)
+        {
+            hls_worker_t *worker = &p_sys->download.workers[i];
+
+            if ((worker->segment >= 0) &&
+                ((worker->segment < p_sys->download.seek) ||
+                 (worker->segment >= p_sys->download.seek + HLS_WINDOW)))
+                atomic_store(&worker->b_abort, true);
+        }
+        vlc_cond_broadcast(&p_sys->download.wait);
 
         /* Wait for download to be finished */
         msg_Info(s, "seek to segment %d", p_sys->playback.segment);
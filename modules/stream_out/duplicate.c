@@ -275,6 +275,10 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
 
         p_buffer->p_next = NULL;
 
+        /* Branches only get references to the same read-only payload */
+        if( p_sys->i_nb_streams > 1 )
+            p_buffer = block_Share( p_buffer );
+
         for( i_stream = 0; i_stream < p_sys->i_nb_streams - 1; i_stream++ )
         {
             p_dup_stream = p_sys->pp_streams[i_stream];
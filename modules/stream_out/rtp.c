@@ -141,6 +141,12 @@
     "Default caching value for outbound RTP streams. This " \
     "value should be set in milliseconds." )
 
+#define BATCH_TEXT N_("Batching window (ms)")
+#define BATCH_LONGTEXT N_( \
+    "Queued packets due within this time window after the current one " \
+    "are sent together, with a single system call. 0 only coalesces " \
+    "packets that are already due." )
+
 #define PROTO_TEXT N_("Transport protocol")
 #define PROTO_LONGTEXT N_( \
     "This selects which transport protocol to use for RTP." )
@@ -232,6 +238,8 @@ vlc_module_begin ()
               RTCP_MUX_TEXT, RTCP_MUX_LONGTEXT, false )
     add_integer( SOUT_CFG_PREFIX "caching", DEFAULT_PTS_DELAY / 1000,
                  CACHING_TEXT, CACHING_LONGTEXT, true )
+    add_integer( SOUT_CFG_PREFIX "batch", 0,
+                 BATCH_TEXT, BATCH_LONGTEXT, true )
 
 #ifdef HAVE_SRTP
     add_string( SOUT_CFG_PREFIX "key", "",
@@ -268,7 +276,7 @@ vlc_module_end ()
 static const char *const ppsz_sout_options[] = {
     "dst", "name", "cat", "port", "port-audio", "port-video", "*sdp", "ttl",
     "mux", "sap", "description", "url", "email", "phone",
-    "proto", "rtcp-mux", "caching",
+    "proto", "rtcp-mux", "caching", "batch",
 #ifdef HAVE_SRTP
     "key", "salt",
 #endif
@@ -389,6 +397,7 @@ struct sout_stream_id_t
 
     block_fifo_t     *p_fifo;
     int64_t           i_caching;
+    int64_t           i_batch;
 };
 
 /*****************************************************************************
@@ -986,6 +995,8 @@ static sout_stream_id_t *Add( sout_stream_t *p_stream, es_format_t *p_fmt )
     id->b_first_packet = true;
     id->i_caching =
         (int64_t)1000 * var_GetInteger( p_stream, SOUT_CFG_PREFIX "caching");
+    id->i_batch =
+        (int64_t)1000 * var_GetInteger( p_stream, SOUT_CFG_PREFIX "batch");
 
     vlc_rand_bytes (&id->i_sequence, sizeof (id->i_sequence));
     vlc_rand_bytes (id->ssrc, sizeof (id->ssrc));
@@ -1394,15 +1405,101 @@ static int  HttpCallback( httpd_file_sys_t *p_args,
 /****************************************************************************
  * RTP send
  ****************************************************************************/
-static void* ThreadSend( void *data )
+#ifdef HAVE_SENDMMSG
+# define RTP_BATCH 64 /* packets per sendmmsg() call */
+#else
+# define RTP_BATCH 1
+#endif
+
+#ifdef HAVE_SRTP
+static block_t *rtp_protect( sout_stream_id_t *id, block_t *out )
+{   /* FIXME: this is awfully inefficient */
+    size_t len = out->i_buffer;
+    out = block_Realloc( out, 0, len + 10 );
+    out->i_buffer = len;
+
+    int canc = vlc_savecancel ();
+    int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
+    vlc_restorecancel (canc);
+    if( val )
+    {
+        errno = val;
+        msg_Dbg( id->p_stream, "SRTP sending error: %m" );
+        block_Release( out );
+        return NULL;
+    }
+    out->i_buffer = len;
+    return out;
+}
+#endif
+
+/* Handles an error sending a packet to a sink.
+ * Returns false if the connection is broken. */
+static bool rtp_send_error( int fd, const block_t *out )
 {
 #ifdef WIN32
 # define ENOBUFS      WSAENOBUFS
 # define EAGAIN       WSAEWOULDBLOCK
 # define EWOULDBLOCK  WSAEWOULDBLOCK
 #endif
+    if( net_errno == EAGAIN || net_errno == EWOULDBLOCK
+     || net_errno == ENOBUFS || net_errno == ENOMEM )
+        return true;
+
+    int type;
+    getsockopt( fd, SOL_SOCKET, SO_TYPE, &type, &(socklen_t){ sizeof(type) });
+    if( type != SOCK_DGRAM )
+        return false; /* Broken connection */
+
+    /* ICMP soft error: ignore and retry */
+    send( fd, out->p_buffer, out->i_buffer, 0 );
+    return true;
+}
+
+/* Sends packets to a sink, with a single system call if possible.
+ * Returns false if the connection is broken. */
+static bool rtp_send_sink( int fd, block_t *const *pkts, unsigned count )
+{
+#ifdef HAVE_SENDMMSG
+    struct mmsghdr msg[RTP_BATCH];
+    struct iovec iov[RTP_BATCH];
+
+    assert( count <= RTP_BATCH );
+    for( unsigned i = 0; i < count; i++ )
+    {
+        iov[i].iov_base = pkts[i]->p_buffer;
+        iov[i].iov_len = pkts[i]->i_buffer;
+        memset( &msg[i], 0, sizeof( msg[i] ) );
+        msg[i].msg_hdr.msg_iov = &iov[i];
+        msg[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    for( unsigned i = 0; i < count; )
+    {
+        int val = sendmmsg( fd, &msg[i], count - i, 0 );
+        if( val > 0 )
+        {
+            i += val;
+            continue;
+        }
+        if( !rtp_send_error( fd, pkts[i] ) )
+            return false;
+        i++; /* skip the failing packet */
+    }
+#else
+    for( unsigned i = 0; i < count; i++ )
+        if( send( fd, pkts[i]->p_buffer, pkts[i]->i_buffer, 0 ) == -1
+         && !rtp_send_error( fd, pkts[i] ) )
+            return false;
+#endif
+    return true;
+}
+
+static void* ThreadSend( void *data )
+{
     sout_stream_id_t *id = data;
     unsigned i_caching = id->i_caching;
+    block_t *batch[RTP_BATCH];
 
     for (;;)
     {
@@ -1411,24 +1508,7 @@ static void* ThreadSend( void *data )
 
 #ifdef HAVE_SRTP
         if( id->srtp )
-        {   /* FIXME: this is awfully inefficient */
-            size_t len = out->i_buffer;
-            out = block_Realloc( out, 0, len + 10 );
-            out->i_buffer = len;
-
-            int canc = vlc_savecancel ();
-            int val = srtp_send( id->srtp, out->p_buffer, &len, len + 10 );
-            vlc_restorecancel (canc);
-            if( val )
-            {
-                errno = val;
-                msg_Dbg( id->p_stream, "SRTP sending error: %m" );
-                block_Release( out );
-                out = NULL;
-            }
-            else
-                out->i_buffer = len;
-        }
+            out = rtp_protect( id, out );
         if (out)
             mwait (out->i_dts + i_caching);
         vlc_cleanup_pop ();
@@ -1439,9 +1519,29 @@ static void* ThreadSend( void *data )
         vlc_cleanup_pop ();
 #endif
 
-        ssize_t len = out->i_buffer;
         int canc = vlc_savecancel ();
 
+        /* Coalesce the queued packets that are due within the batching
+         * window, or already late */
+        const mtime_t due = __MAX(out->i_dts, mdate () - i_caching)
+                          + id->i_batch;
+        unsigned count = 0;
+
+        batch[count++] = out;
+        while( count < RTP_BATCH && block_FifoCount( id->p_fifo ) > 0 )
+        {
+            block_t *next = block_FifoShow( id->p_fifo );
+            if( next->i_dts > due )
+                break;
+
+            next = block_FifoGet( id->p_fifo );
+#ifdef HAVE_SRTP
+            if( id->srtp && (next = rtp_protect( id, next )) == NULL )
+                continue;
+#endif
+            batch[count++] = next;
+        }
+
         vlc_mutex_lock( &id->lock_sink );
         unsigned deadc = 0; /* How many dead sockets? */
         int deadv[id->sinkc]; /* Dead sockets list */
@@ -1451,26 +1551,16 @@ static void* ThreadSend( void *data )
 #ifdef HAVE_SRTP
             if( !id->srtp ) /* FIXME: SRTCP support */
 #endif
-                SendRTCP( id->sinkv[i].rtcp, out );
+                for( unsigned j = 0; j < count; j++ )
+                    SendRTCP( id->sinkv[i].rtcp, batch[j] );
 
-            if( send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 ) == -1
-             && net_errno != EAGAIN && net_errno != EWOULDBLOCK
-             && net_errno != ENOBUFS && net_errno != ENOMEM )
-            {
-                int type;
-                getsockopt( id->sinkv[i].rtp_fd, SOL_SOCKET, SO_TYPE,
-                            &type, &(socklen_t){ sizeof(type) });
-                if( type == SOCK_DGRAM )
-                    /* ICMP soft error: ignore and retry */
-                    send( id->sinkv[i].rtp_fd, out->p_buffer, len, 0 );
-                else
-                    /* Broken connection */
-                    deadv[deadc++] = id->sinkv[i].rtp_fd;
-            }
+            if( !rtp_send_sink( id->sinkv[i].rtp_fd, batch, count ) )
+                deadv[deadc++] = id->sinkv[i].rtp_fd;
         }
-        id->i_seq_sent_next = ntohs(((uint16_t *) out->p_buffer)[1]) + 1;
+        id->i_seq_sent_next = ntohs(((uint16_t *) batch[count - 1]->p_buffer)[1]) + 1;
         vlc_mutex_unlock( &id->lock_sink );
-        block_Release( out );
+        for( unsigned j = 0; j < count; j++ )
+            block_Release( batch[j] );
 
         for( unsigned i = 0; i < deadc; i++ )
         {
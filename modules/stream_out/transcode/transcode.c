@@ -125,7 +125,9 @@
 
 #define THREADS_TEXT N_("Number of threads")
 #define THREADS_LONGTEXT N_( \
-    "Number of threads used for the transcoding." )
+    "Number of threads used for the transcoding. With a non-zero value, " \
+    "video decoding, deinterlacing and encoding run in separate threads, " \
+    "and this many threads scale and convert pictures in parallel." )
 #define HP_TEXT N_("High priority")
 #define HP_LONGTEXT N_( \
     "Runs the optional encoder thread at the OUTPUT priority instead of " \
@@ -651,6 +653,14 @@ static int Send( sout_stream_t *p_stream, sout_stream_id_t *id,
         return VLC_EGENERIC;
     }
 
+    /* Decoders may modify their input in place */
+    if( p_buffer != NULL )
+    {
+        p_buffer = block_Writable( p_buffer );
+        if( p_buffer == NULL )
+            return VLC_ENOMEM;
+    }
+
     switch( id->p_decoder->fmt_in.i_cat )
     {
     case AUDIO_ES:
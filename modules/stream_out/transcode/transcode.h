@@ -9,19 +9,31 @@
 #include <vlc_es.h>
 #include <vlc_codec.h>
 
-#include <vlc_picture_fifo.h>
-
 #define MASTER_SYNC_MAX_DRIFT 100000
 
+typedef struct transcode_video_job_t transcode_video_job_t;
+typedef struct transcode_video_worker_t transcode_video_worker_t;
+
 struct sout_stream_sys_t
 {
+    /* Video pipeline (threads > 0) */
     sout_stream_id_t *id_video;
-    block_t         *p_buffers;
+    block_t         *p_buffers;     /* encoded blocks, sent by the sout thread */
     vlc_mutex_t     lock_out;
-    vlc_cond_t      cond;
+    vlc_cond_t      cond;           /* some pipeline queue changed */
+    vlc_cond_t      cond_idle;      /* a picture left the pipeline */
     bool            b_abort;
-    picture_fifo_t *pp_pics;
-    vlc_thread_t    thread;
+    unsigned        i_pending;      /* pictures in the pipeline */
+    unsigned        i_pending_max;
+    transcode_video_job_t *p_filter_jobs, **pp_filter_last;
+    transcode_video_job_t *p_convert_jobs, **pp_convert_last;
+    transcode_video_job_t *p_encode_jobs; /* sorted by sequence number */
+    uint64_t        i_filter_seq;
+    uint64_t        i_encode_seq;
+    vlc_thread_t    thread;         /* encoder */
+    vlc_thread_t    filter_thread;
+    transcode_video_worker_t *p_workers;
+    int             i_workers;
 
     /* Audio */
     vlc_fourcc_t    i_acodec;   /* codec audio (0 if not transcode) */
@@ -97,44 +97,339 @@ static void transcode_video_filter_allocation_clear( filter_t *p_filter )
     VLC_UNUSED(p_filter);
 }
 
+/*
+ * Threaded pipeline
+ *
+ * The sout thread decodes and queues pictures for the filter thread, which
+ * runs the deinterlacer. As scaling and chroma conversion keep no state
+ * between pictures, each worker thread has its own conversion chain and
+ * processes a different picture. The encoder thread puts the pictures back
+ * in order, runs the user filters and the encoder. The number of pictures in
+ * the pipeline is bounded: decoding blocks when it is too far ahead.
+ */
+struct transcode_video_job_t
+{
+    transcode_video_job_t *p_next;
+    picture_t *p_pic;      /* NULL if dropped by the conversion */
+    uint64_t   i_seq;      /* order after deinterlacing */
+    mtime_t    i_dup_date; /* date of a duplicate (master sync) if valid */
+};
+
+struct transcode_video_worker_t
+{
+    sout_stream_t  *p_stream;
+    vlc_thread_t    thread;
+    filter_chain_t *p_chain; /* scaling and chroma conversion */
+};
+
+static void JobPush( transcode_video_job_t ***ppp_last,
+                     transcode_video_job_t *p_job )
+{
+    p_job->p_next = NULL;
+    **ppp_last = p_job;
+    *ppp_last = &p_job->p_next;
+}
+
+static transcode_video_job_t *JobPop( transcode_video_job_t **pp_first,
+                                      transcode_video_job_t ***ppp_last )
+{
+    transcode_video_job_t *p_job = *pp_first;
+
+    if( p_job != NULL )
+    {
+        *pp_first = p_job->p_next;
+        if( *pp_first == NULL )
+            *ppp_last = pp_first;
+    }
+    return p_job;
+}
+
+static void JobSort( transcode_video_job_t **pp_first,
+                     transcode_video_job_t *p_job )
+{
+    while( *pp_first != NULL && (*pp_first)->i_seq < p_job->i_seq )
+        pp_first = &(*pp_first)->p_next;
+    p_job->p_next = *pp_first;
+    *pp_first = p_job;
+}
+
+static void JobsRelease( transcode_video_job_t *p_job )
+{
+    while( p_job != NULL )
+    {
+        transcode_video_job_t *p_next = p_job->p_next;
+
+        if( p_job->p_pic != NULL )
+            picture_Release( p_job->p_pic );
+        free( p_job );
+        p_job = p_next;
+    }
+}
+
+static picture_t *transcode_video_overlay( sout_stream_t *, sout_stream_id_t *,
+                                           picture_t * );
+
 static void* EncoderThread( void *obj )
 {
-    sout_stream_sys_t *p_sys = (sout_stream_sys_t*)obj;
+    sout_stream_t *p_stream = obj;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
     sout_stream_id_t *id = p_sys->id_video;
-    picture_t *p_pic;
     int canc = vlc_savecancel ();
 
+    vlc_mutex_lock( &p_sys->lock_out );
     for( ;; )
     {
-        block_t *p_block;
+        transcode_video_job_t *p_job;
 
-        vlc_mutex_lock( &p_sys->lock_out );
-        while( !p_sys->b_abort &&
-               (p_pic = picture_fifo_Pop( p_sys->pp_pics )) == NULL )
+        while( !p_sys->b_abort
+            && ((p_job = p_sys->p_encode_jobs) == NULL
+             || p_job->i_seq != p_sys->i_encode_seq) )
             vlc_cond_wait( &p_sys->cond, &p_sys->lock_out );
 
         if( p_sys->b_abort )
-        {
-            vlc_mutex_unlock( &p_sys->lock_out );
             break;
-        }
+        p_sys->p_encode_jobs = p_job->p_next;
         vlc_mutex_unlock( &p_sys->lock_out );
 
-        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
+        picture_t *p_pic = p_job->p_pic;
+        block_t *p_block = NULL;
+
+        /* Run user specified filter chain */
+        if( p_pic != NULL && id->p_uf_chain )
+            p_pic = filter_chain_VideoFilter( id->p_uf_chain, p_pic );
+
+        if( p_pic != NULL )
+        {
+            p_pic = transcode_video_overlay( p_stream, id, p_pic );
+            p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
+
+            if( unlikely( p_job->i_dup_date > VLC_TS_INVALID ) )
+            {
+                p_pic->date = p_job->i_dup_date;
+                block_ChainAppend( &p_block,
+                    id->p_encoder->pf_encode_video( id->p_encoder, p_pic ) );
+            }
+            picture_Release( p_pic );
+        }
+        free( p_job );
 
         vlc_mutex_lock( &p_sys->lock_out );
         block_ChainAppend( &p_sys->p_buffers, p_block );
+        p_sys->i_encode_seq++;
+        p_sys->i_pending--;
+        vlc_cond_signal( &p_sys->cond_idle );
+    }
+    vlc_mutex_unlock( &p_sys->lock_out );
+
+    vlc_restorecancel (canc);
+    return NULL;
+}
+
+static void* FilterThread( void *obj )
+{
+    sout_stream_t *p_stream = obj;
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    sout_stream_id_t *id = p_sys->id_video;
+    int canc = vlc_savecancel ();
+
+    vlc_mutex_lock( &p_sys->lock_out );
+    for( ;; )
+    {
+        transcode_video_job_t *p_job;
+
+        while( !p_sys->b_abort
+            && (p_job = JobPop( &p_sys->p_filter_jobs,
+                                &p_sys->pp_filter_last )) == NULL )
+            vlc_cond_wait( &p_sys->cond, &p_sys->lock_out );
 
+        if( p_sys->b_abort )
+            break;
         vlc_mutex_unlock( &p_sys->lock_out );
-        picture_Release( p_pic );
+
+        if( id->p_f_chain )
+            p_job->p_pic = filter_chain_VideoFilter( id->p_f_chain,
+                                                     p_job->p_pic );
+
+        vlc_mutex_lock( &p_sys->lock_out );
+        if( p_job->p_pic == NULL )
+        {   /* Dropped or held back by the deinterlacer */
+            free( p_job );
+            p_sys->i_pending--;
+            vlc_cond_signal( &p_sys->cond_idle );
+            continue;
+        }
+
+        p_job->i_seq = p_sys->i_filter_seq++;
+        if( p_sys->p_workers[0].p_chain != NULL )
+            JobPush( &p_sys->pp_convert_last, p_job );
+        else
+            JobSort( &p_sys->p_encode_jobs, p_job );
+        vlc_cond_broadcast( &p_sys->cond );
     }
+    vlc_mutex_unlock( &p_sys->lock_out );
 
-    block_ChainRelease( p_sys->p_buffers );
+    vlc_restorecancel (canc);
+    return NULL;
+}
+
+static void* ConvertThread( void *obj )
+{
+    transcode_video_worker_t *p_worker = obj;
+    sout_stream_sys_t *p_sys = p_worker->p_stream->p_sys;
+    int canc = vlc_savecancel ();
+
+    vlc_mutex_lock( &p_sys->lock_out );
+    for( ;; )
+    {
+        transcode_video_job_t *p_job;
+
+        while( !p_sys->b_abort
+            && (p_job = JobPop( &p_sys->p_convert_jobs,
+                                &p_sys->pp_convert_last )) == NULL )
+            vlc_cond_wait( &p_sys->cond, &p_sys->lock_out );
+
+        if( p_sys->b_abort )
+            break;
+        vlc_mutex_unlock( &p_sys->lock_out );
+
+        /* The chain only changes while the pipeline is empty */
+        p_job->p_pic = filter_chain_VideoFilter( p_worker->p_chain,
+                                                 p_job->p_pic );
+
+        /* Even without a picture, the job keeps its place in the sequence */
+        vlc_mutex_lock( &p_sys->lock_out );
+        JobSort( &p_sys->p_encode_jobs, p_job );
+        vlc_cond_broadcast( &p_sys->cond );
+    }
+    vlc_mutex_unlock( &p_sys->lock_out );
 
     vlc_restorecancel (canc);
     return NULL;
 }
 
+/**
+ * Stops the pipeline threads.
+ * \param i_threads number of threads started: encoder, filter, then workers
+ */
+static void transcode_video_pipeline_stop( sout_stream_sys_t *p_sys,
+                                           int i_threads )
+{
+    vlc_mutex_lock( &p_sys->lock_out );
+    p_sys->b_abort = true;
+    vlc_cond_broadcast( &p_sys->cond );
+    vlc_mutex_unlock( &p_sys->lock_out );
+
+    if( i_threads > 0 )
+        vlc_join( p_sys->thread, NULL );
+    if( i_threads > 1 )
+        vlc_join( p_sys->filter_thread, NULL );
+    for( int i = 0; i < i_threads - 2; i++ )
+        vlc_join( p_sys->p_workers[i].thread, NULL );
+
+    JobsRelease( p_sys->p_filter_jobs );
+    JobsRelease( p_sys->p_convert_jobs );
+    JobsRelease( p_sys->p_encode_jobs );
+    block_ChainRelease( p_sys->p_buffers );
+    p_sys->p_buffers = NULL;
+
+    vlc_mutex_destroy( &p_sys->lock_out );
+    vlc_cond_destroy( &p_sys->cond );
+    vlc_cond_destroy( &p_sys->cond_idle );
+}
+
+static int transcode_video_pipeline_start( sout_stream_t *p_stream,
+                                           sout_stream_id_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+    int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
+                       VLC_THREAD_PRIORITY_VIDEO;
+    int i_threads = 0;
+
+    p_sys->p_workers = calloc( p_sys->i_threads, sizeof(*p_sys->p_workers) );
+    if( p_sys->p_workers == NULL )
+        return VLC_ENOMEM;
+    p_sys->i_workers = p_sys->i_threads;
+
+    p_sys->id_video = id;
+    vlc_mutex_init( &p_sys->lock_out );
+    vlc_cond_init( &p_sys->cond );
+    vlc_cond_init( &p_sys->cond_idle );
+    p_sys->p_buffers = NULL;
+    p_sys->b_abort = false;
+    p_sys->i_pending = 0;
+    /* Enough to keep every stage busy, with some slack for the encoder */
+    p_sys->i_pending_max = 2 * p_sys->i_workers + 4;
+    p_sys->p_filter_jobs = NULL;
+    p_sys->pp_filter_last = &p_sys->p_filter_jobs;
+    p_sys->p_convert_jobs = NULL;
+    p_sys->pp_convert_last = &p_sys->p_convert_jobs;
+    p_sys->p_encode_jobs = NULL;
+    p_sys->i_filter_seq = 0;
+    p_sys->i_encode_seq = 0;
+
+    if( vlc_clone( &p_sys->thread, EncoderThread, p_stream, i_priority ) )
+        goto error;
+    i_threads++;
+    if( vlc_clone( &p_sys->filter_thread, FilterThread, p_stream,
+                   VLC_THREAD_PRIORITY_VIDEO ) )
+        goto error;
+    i_threads++;
+    for( int i = 0; i < p_sys->i_workers; i++ )
+    {
+        transcode_video_worker_t *p_worker = &p_sys->p_workers[i];
+
+        p_worker->p_stream = p_stream;
+        if( vlc_clone( &p_worker->thread, ConvertThread, p_worker,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+            goto error;
+        i_threads++;
+    }
+    return VLC_SUCCESS;
+
+error:
+    transcode_video_pipeline_stop( p_sys, i_threads );
+    free( p_sys->p_workers );
+    p_sys->p_workers = NULL;
+    return VLC_EGENERIC;
+}
+
+/**
+ * Waits until all queued pictures are encoded, and collects the output.
+ */
+static void transcode_video_pipeline_drain( sout_stream_sys_t *p_sys,
+                                            block_t **out )
+{
+    vlc_mutex_lock( &p_sys->lock_out );
+    while( p_sys->i_pending > 0 )
+        vlc_cond_wait( &p_sys->cond_idle, &p_sys->lock_out );
+    block_ChainAppend( out, p_sys->p_buffers );
+    p_sys->p_buffers = NULL;
+    vlc_mutex_unlock( &p_sys->lock_out );
+}
+
+static void transcode_video_pipeline_push( sout_stream_sys_t *p_sys,
+                                           picture_t *p_pic,
+                                           mtime_t i_dup_date )
+{
+    transcode_video_job_t *p_job = malloc( sizeof(*p_job) );
+    if( unlikely( p_job == NULL ) )
+    {
+        picture_Release( p_pic );
+        return;
+    }
+    p_job->p_pic = p_pic;
+    p_job->i_dup_date = i_dup_date;
+
+    vlc_mutex_lock( &p_sys->lock_out );
+    /* Back-pressure: do not decode too far ahead of the encoder */
+    while( p_sys->i_pending >= p_sys->i_pending_max )
+        vlc_cond_wait( &p_sys->cond_idle, &p_sys->lock_out );
+    JobPush( &p_sys->pp_filter_last, p_job );
+    p_sys->i_pending++;
+    vlc_cond_broadcast( &p_sys->cond );
+    vlc_mutex_unlock( &p_sys->lock_out );
+}
+
 int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_t *id )
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
@@ -223,32 +518,14 @@ int transcode_video_new( sout_stream_t *p_stream, sout_stream_id_t *id )
     }
     id->p_encoder->p_module = NULL;
 
-    if( p_sys->i_threads >= 1 )
+    if( p_sys->i_threads >= 1
+     && transcode_video_pipeline_start( p_stream, id ) )
     {
-        int i_priority = p_sys->b_high_priority ? VLC_THREAD_PRIORITY_OUTPUT :
-                           VLC_THREAD_PRIORITY_VIDEO;
-        p_sys->id_video = id;
-        vlc_mutex_init( &p_sys->lock_out );
-        vlc_cond_init( &p_sys->cond );
-        p_sys->pp_pics = picture_fifo_New();
-        if( p_sys->pp_pics == NULL )
-        {
-            msg_Err( p_stream, "cannot create picture fifo" );
-            module_unneed( id->p_decoder, id->p_decoder->p_module );
-            id->p_decoder->p_module = NULL;
-            free( id->p_decoder->p_owner );
-            return VLC_ENOMEM;
-        }
-        p_sys->p_buffers = NULL;
-        p_sys->b_abort = false;
-        if( vlc_clone( &p_sys->thread, EncoderThread, p_sys, i_priority ) )
-        {
-            msg_Err( p_stream, "cannot spawn encoder thread" );
-            module_unneed( id->p_decoder, id->p_decoder->p_module );
-            id->p_decoder->p_module = NULL;
-            free( id->p_decoder->p_owner );
-            return VLC_EGENERIC;
-        }
+        msg_Err( p_stream, "cannot spawn video transcoding threads" );
+        module_unneed( id->p_decoder, id->p_decoder->p_module );
+        id->p_decoder->p_module = NULL;
+        free( id->p_decoder->p_owner );
+        return VLC_EGENERIC;
     }
     return VLC_SUCCESS;
 }
@@ -280,10 +557,45 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
         ( id->p_decoder->fmt_out.video.i_height !=
           id->p_encoder->fmt_in.video.i_height ) )
     {
-       filter_chain_AppendFilter( id->p_f_chain,
-                                  NULL, NULL,
-                                  &id->p_decoder->fmt_out,
-                                  &id->p_encoder->fmt_in );
+        bool b_workers = p_stream->p_sys->i_threads >= 1;
+
+        /* Conversion is stateless: one chain per pipeline worker */
+        for( int i = 0; b_workers && i < p_stream->p_sys->i_workers; i++ )
+        {
+            filter_chain_t *p_chain =
+                filter_chain_New( p_stream, "video filter2", false,
+                                  transcode_video_filter_allocation_init,
+                                  transcode_video_filter_allocation_clear,
+                                  p_stream->p_sys );
+            if( p_chain != NULL &&
+                filter_chain_AppendFilter( p_chain, NULL, NULL,
+                                           &id->p_decoder->fmt_out,
+                                           &id->p_encoder->fmt_in ) == NULL )
+            {
+                filter_chain_Delete( p_chain );
+                p_chain = NULL;
+            }
+            if( p_chain == NULL )
+            {
+                /* the workers either all convert, or none of them does */
+                msg_Warn( p_stream, "cannot create the conversion chains, "
+                          "converting in the filter thread" );
+                while( i-- > 0 )
+                {
+                    filter_chain_Delete( p_stream->p_sys->p_workers[i].p_chain );
+                    p_stream->p_sys->p_workers[i].p_chain = NULL;
+                }
+                b_workers = false;
+                break;
+            }
+            p_stream->p_sys->p_workers[i].p_chain = p_chain;
+        }
+
+        if( !b_workers )
+            filter_chain_AppendFilter( id->p_f_chain,
+                                       NULL, NULL,
+                                       &id->p_decoder->fmt_out,
+                                       &id->p_encoder->fmt_in );
     }
 
     if( p_stream->p_sys->psz_vf2 )
@@ -311,6 +623,26 @@ static void transcode_video_filter_init( sout_stream_t *p_stream,
 
 }
 
+static void transcode_video_filter_clean( sout_stream_t *p_stream,
+                                          sout_stream_id_t *id )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( id->p_f_chain )
+        filter_chain_Delete( id->p_f_chain );
+    id->p_f_chain = NULL;
+    if( id->p_uf_chain )
+        filter_chain_Delete( id->p_uf_chain );
+    id->p_uf_chain = NULL;
+
+    for( int i = 0; i < p_sys->i_workers; i++ )
+    {
+        if( p_sys->p_workers[i].p_chain )
+            filter_chain_Delete( p_sys->p_workers[i].p_chain );
+        p_sys->p_workers[i].p_chain = NULL;
+    }
+}
+
 static void transcode_video_encoder_init( sout_stream_t *p_stream,
                                           sout_stream_id_t *id )
 {
@@ -527,20 +859,10 @@ static int transcode_video_encoder_open( sout_stream_t *p_stream,
 void transcode_video_close( sout_stream_t *p_stream,
                                    sout_stream_id_t *id )
 {
-    if( p_stream->p_sys->i_threads >= 1 )
-    {
-        vlc_mutex_lock( &p_stream->p_sys->lock_out );
-        p_stream->p_sys->b_abort = true;
-        vlc_cond_signal( &p_stream->p_sys->cond );
-        vlc_mutex_unlock( &p_stream->p_sys->lock_out );
-
-        vlc_join( p_stream->p_sys->thread, NULL );
-        vlc_mutex_destroy( &p_stream->p_sys->lock_out );
-        vlc_cond_destroy( &p_stream->p_sys->cond );
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
 
-        picture_fifo_Delete( p_stream->p_sys->pp_pics );
-        p_stream->p_sys->pp_pics = NULL;
-    }
+    if( p_sys->i_threads >= 1 )
+        transcode_video_pipeline_stop( p_sys, 2 + p_sys->i_workers );
 
     /* Close decoder */
     if( id->p_decoder->p_module )
@@ -555,10 +877,76 @@ void transcode_video_close( sout_stream_t *p_stream,
         module_unneed( id->p_encoder, id->p_encoder->p_module );
 
     /* Close filters */
-    if( id->p_f_chain )
-        filter_chain_Delete( id->p_f_chain );
-    if( id->p_uf_chain )
-        filter_chain_Delete( id->p_uf_chain );
+    transcode_video_filter_clean( p_stream, id );
+    free( p_sys->p_workers );
+    p_sys->p_workers = NULL;
+    p_sys->i_workers = 0;
+}
+
+/* Overlays the subpictures, if any */
+static picture_t *transcode_video_overlay( sout_stream_t *p_stream,
+                                           sout_stream_id_t *id,
+                                           picture_t *p_pic )
+{
+    sout_stream_sys_t *p_sys = p_stream->p_sys;
+
+    if( !p_sys->p_spu )
+        return p_pic;
+
+    video_format_t fmt = id->p_encoder->fmt_in.video;
+    if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
+    {
+        fmt.i_visible_width  = fmt.i_width;
+        fmt.i_visible_height = fmt.i_height;
+        fmt.i_x_offset       = 0;
+        fmt.i_y_offset       = 0;
+    }
+
+    subpicture_t *p_subpic = spu_Render( p_sys->p_spu, NULL, &fmt, &fmt,
+                                         p_pic->date, p_pic->date, false );
+
+    /* Overlay subpicture */
+    if( p_subpic )
+    {
+        if( picture_IsReferenced( p_pic ) && !filter_chain_GetLength( id->p_f_chain ) )
+        {
+            /* We can't modify the picture, we need to duplicate it,
+             * in this point the picture is already p_encoder->fmt.in format*/
+            picture_t *p_tmp = video_new_buffer_encoder( id->p_encoder );
+            if( likely( p_tmp ) )
+            {
+                picture_Copy( p_tmp, p_pic );
+                picture_Release( p_pic );
+                p_pic = p_tmp;
+            }
+        }
+        if( unlikely( !p_sys->p_spu_blend ) )
+            p_sys->p_spu_blend = filter_NewBlend( VLC_OBJECT( p_sys->p_spu ), &fmt );
+        if( likely( p_sys->p_spu_blend ) )
+            picture_BlendSubpicture( p_pic, p_sys->p_spu_blend, p_subpic );
+        subpicture_Delete( p_subpic );
+    }
+    return p_pic;
+}
+
+/* Advances the master sync date, returns the date for a duplicate picture */
+static mtime_t transcode_video_sync_next( sout_stream_t *p_stream,
+                                          sout_stream_id_t *id,
+                                          const picture_t *p_pic )
+{
+    mtime_t i_pts = date_Get( &id->interpolated_pts ) + 1;
+    mtime_t i_video_drift = p_pic->date - i_pts;
+    if (unlikely ( i_video_drift  > MASTER_SYNC_MAX_DRIFT
+          || i_video_drift < -MASTER_SYNC_MAX_DRIFT ) )
+    {
+        msg_Dbg( p_stream,
+            "drift is too high (%"PRId64"), resetting master sync",
+            i_video_drift );
+        date_Set( &id->interpolated_pts, p_pic->date );
+        i_pts = p_pic->date + 1;
+    }
+    date_Increment( &id->interpolated_pts, 1 );
+    return i_pts;
 }
 
 int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
@@ -566,12 +954,16 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
 {
     sout_stream_sys_t *p_sys = p_stream->p_sys;
     bool b_need_duplicate = false;
-    picture_t *p_pic, *p_pic2 = NULL;
+    picture_t *p_pic;
     *out = NULL;
 
     if( unlikely( in == NULL ) )
     {
-        if( p_sys->i_threads == 0 )
+        /* Let the pipeline threads encode what they have first */
+        if( p_sys->i_threads >= 1 )
+            transcode_video_pipeline_drain( p_sys, out );
+
+        if( id->p_encoder->p_module )
         {
             block_t *p_block;
             do {
@@ -579,13 +971,6 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
                 block_ChainAppend( out, p_block );
             } while( p_block );
         }
-        else
-        {
-            /*
-             * FIXME: we need EncoderThread() to flush buffers and signal us
-             * when it's done so we can send the last frames to the chain
-             */
-        }
         return VLC_SUCCESS;
     }
 
@@ -654,13 +1039,12 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
                         p_sys->fmt_input_video.i_sar_num, id->p_decoder->fmt_out.video.i_sar_num,
                         p_sys->fmt_input_video.i_sar_den, id->p_decoder->fmt_out.video.i_sar_den
                     );
+            /* The filters must not be in use */
+            if( p_sys->i_threads >= 1 )
+                transcode_video_pipeline_drain( p_sys, out );
+
             /* Close filters */
-            if( id->p_f_chain )
-                filter_chain_Delete( id->p_f_chain );
-            id->p_f_chain = NULL;
-            if( id->p_uf_chain )
-                filter_chain_Delete( id->p_uf_chain );
-            id->p_uf_chain = NULL;
+            transcode_video_filter_clean( p_stream, id );
 
             /* Reinitialize filters */
             id->p_encoder->fmt_out.video.i_width  = p_sys->i_width & ~1;
@@ -689,6 +1073,22 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
             }
         }
 
+        if( p_sys->i_threads >= 1 )
+        {
+            /* Filtering and encoding are done by the pipeline threads */
+            mtime_t i_dup_date = VLC_TS_INVALID;
+
+            if( p_sys->b_master_sync )
+            {
+                mtime_t i_pts = transcode_video_sync_next( p_stream, id,
+                                                           p_pic );
+                if( unlikely( b_need_duplicate ) )
+                    i_dup_date = i_pts;
+            }
+            transcode_video_pipeline_push( p_sys, p_pic, i_dup_date );
+            continue;
+        }
+
         /* Run filter chain */
         if( id->p_f_chain )
             p_pic = filter_chain_VideoFilter( id->p_f_chain, p_pic );
@@ -706,106 +1106,35 @@ int transcode_video_process( sout_stream_t *p_stream, sout_stream_id_t *id,
          */
 
         /* Check if we have a subpicture to overlay */
-        if( p_sys->p_spu )
-        {
-            video_format_t fmt = id->p_encoder->fmt_in.video;
-            if( fmt.i_visible_width <= 0 || fmt.i_visible_height <= 0 )
-            {
-                fmt.i_visible_width  = fmt.i_width;
-                fmt.i_visible_height = fmt.i_height;
-                fmt.i_x_offset       = 0;
-                fmt.i_y_offset       = 0;
-            }
-
-            subpicture_t *p_subpic = spu_Render( p_sys->p_spu, NULL, &fmt, &fmt,
-                                                 p_pic->date, p_pic->date, false );
-
-            /* Overlay subpicture */
-            if( p_subpic )
-            {
-                if( picture_IsReferenced( p_pic ) && !filter_chain_GetLength( id->p_f_chain ) )
-                {
-                    /* We can't modify the picture, we need to duplicate it,
-                     * in this point the picture is already p_encoder->fmt.in format*/
-                    picture_t *p_tmp = video_new_buffer_encoder( id->p_encoder );
-                    if( likely( p_tmp ) )
-                    {
-                        picture_Copy( p_tmp, p_pic );
-                        picture_Release( p_pic );
-                        p_pic = p_tmp;
-                    }
-                }
-                if( unlikely( !p_sys->p_spu_blend ) )
-                    p_sys->p_spu_blend = filter_NewBlend( VLC_OBJECT( p_sys->p_spu ), &fmt );
-                if( likely( p_sys->p_spu_blend ) )
-                    picture_BlendSubpicture( p_pic, p_sys->p_spu_blend, p_subpic );
-                subpicture_Delete( p_subpic );
-            }
-        }
+        p_pic = transcode_video_overlay( p_stream, id, p_pic );
 
-        if( p_sys->i_threads == 0 )
-        {
-            block_t *p_block;
+        block_t *p_block;
 
-            p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
-            block_ChainAppend( out, p_block );
-        }
+        p_block = id->p_encoder->pf_encode_video( id->p_encoder, p_pic );
+        block_ChainAppend( out, p_block );
 
         if( p_sys->b_master_sync )
         {
-            mtime_t i_pts = date_Get( &id->interpolated_pts ) + 1;
-            mtime_t i_video_drift = p_pic->date - i_pts;
-            if (unlikely ( i_video_drift  > MASTER_SYNC_MAX_DRIFT
-                  || i_video_drift < -MASTER_SYNC_MAX_DRIFT ) )
-            {
-                msg_Dbg( p_stream,
-                    "drift is too high (%"PRId64"), resetting master sync",
-                    i_video_drift );
-                date_Set( &id->interpolated_pts, p_pic->date );
-                i_pts = p_pic->date + 1;
-            }
-            date_Increment( &id->interpolated_pts, 1 );
+            mtime_t i_pts = transcode_video_sync_next( p_stream, id, p_pic );
 
             if( unlikely( b_need_duplicate ) )
             {
-
-               if( p_sys->i_threads >= 1 )
-               {
-                   /* We can't modify the picture, we need to duplicate it */
-                   p_pic2 = video_new_buffer_encoder( id->p_encoder );
-                   if( likely( p_pic2 != NULL ) )
-                   {
-                       picture_Copy( p_pic2, p_pic );
-                       p_pic2->date = i_pts;
-                   }
-               }
-               else
-               {
-                   block_t *p_block;
-                   p_pic->date = i_pts;
-                   p_block = id->p_encoder->pf_encode_video(id->p_encoder, p_pic);
-                   block_ChainAppend( out, p_block );
-               }
-           }
-        }
-
-        if( p_sys->i_threads == 0 )
-        {
-            picture_Release( p_pic );
-        }
-        else
-        {
-            vlc_mutex_lock( &p_sys->lock_out );
-            picture_fifo_Push( p_sys->pp_pics, p_pic );
-            *out = p_sys->p_buffers;
-            p_sys->p_buffers = NULL;
-            if( p_pic2 != NULL )
-            {
-                picture_fifo_Push( p_sys->pp_pics, p_pic2 );
+                p_pic->date = i_pts;
+                p_block = id->p_encoder->pf_encode_video(id->p_encoder, p_pic);
+                block_ChainAppend( out, p_block );
             }
-            vlc_cond_signal( &p_sys->cond );
-            vlc_mutex_unlock( &p_sys->lock_out );
         }
+
+        picture_Release( p_pic );
+    }
+
+    /* Collect what the pipeline has encoded so far */
+    if( p_sys->i_threads >= 1 )
+    {
+        vlc_mutex_lock( &p_sys->lock_out );
+        block_ChainAppend( out, p_sys->p_buffers );
+        p_sys->p_buffers = NULL;
+        vlc_mutex_unlock( &p_sys->lock_out );
     }
 
     return VLC_SUCCESS;
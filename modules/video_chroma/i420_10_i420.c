@@ -0,0 +1,230 @@
+/*****************************************************************************
+ * i420_10_i420.c : High bit depth planar YUV 4:2:0 to 8-bit planar YUV 4:2:0
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#define SRC_FOURCC  "I09L,I0AL"
+#define DEST_FOURCC "I420,IYUV,J420,YV12"
+
+/*****************************************************************************
+ * Local and extern prototypes.
+ *****************************************************************************/
+static int  Activate ( vlc_object_t * );
+static void Deactivate ( vlc_object_t * );
+
+static void I420_10_I420        ( filter_t *, picture_t *, picture_t *, int );
+static picture_t *I420_10_I420_Filter ( filter_t *, picture_t * );
+
+#if defined (HAVE_AVX2_INTRINSICS)
+static void I420_10_I420_AVX2   ( filter_t *, picture_t *, picture_t *, int );
+static picture_t *I420_10_I420_AVX2_Filter( filter_t *, picture_t * );
+/* Picks the AVX2 version of a conversion if the CPU supports it */
+#   define AVX2_FILTER( name ) \
+        (vlc_CPU_AVX2() ? name ## _AVX2_Filter : name ## _Filter)
+#else
+#   define AVX2_FILTER( name ) name ## _Filter
+#endif
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+vlc_module_begin ()
+    set_description( N_("Conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    set_capability( "video filter2", 160 )
+    set_callbacks( Activate, Deactivate )
+vlc_module_end ()
+
+struct filter_sys_t
+{
+    int  i_shift; /* number of bits to drop */
+    bool b_swap;  /* YV12 output */
+};
+
+/*****************************************************************************
+ * Activate: allocate a chroma function
+ *****************************************************************************
+ * This function allocates and initializes a chroma function
+ *****************************************************************************/
+static int Activate( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    int i_shift;
+    bool b_swap;
+
+    if( p_filter->fmt_in.video.i_width & 1
+     || p_filter->fmt_in.video.i_height & 1 )
+    {
+        return -1;
+    }
+
+    if( p_filter->fmt_in.video.i_width != p_filter->fmt_out.video.i_width
+     || p_filter->fmt_in.video.i_height != p_filter->fmt_out.video.i_height )
+        return -1;
+
+    switch( p_filter->fmt_in.video.i_chroma )
+    {
+        case VLC_CODEC_I420_9L:
+            i_shift = 1;
+            break;
+        case VLC_CODEC_I420_10L:
+            i_shift = 2;
+            break;
+        default:
+            return -1;
+    }
+
+    switch( p_filter->fmt_out.video.i_chroma )
+    {
+        case VLC_CODEC_I420:
+        case VLC_CODEC_J420:
+            b_swap = false;
+            break;
+        case VLC_CODEC_YV12:
+            b_swap = true;
+            break;
+        default:
+            return -1;
+    }
+
+    filter_sys_t *p_sys = malloc( sizeof(*p_sys) );
+    if( !p_sys )
+        return VLC_ENOMEM;
+    p_sys->i_shift = i_shift;
+    p_sys->b_swap = b_swap;
+
+    p_filter->p_sys = p_sys;
+    p_filter->pf_video_filter = AVX2_FILTER( I420_10_I420 );
+    return 0;
+}
+
+static void Deactivate( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+
+    free( p_filter->p_sys );
+}
+
+/* Following functions are local */
+VIDEO_FILTER_WRAPPER_SLICED( I420_10_I420, 2 )
+#if defined (HAVE_AVX2_INTRINSICS)
+VIDEO_FILTER_WRAPPER_SLICED( I420_10_I420_AVX2, 2 )
+#endif
+
+/*****************************************************************************
+ * ReducePlanes: rounds each sample down to 8 bits
+ *****************************************************************************
+ * Samples are rounded to the nearest value and clipped to 255, so that
+ * out-of-range input does not wrap around.
+ * If not NULL, pf_reduce handles the first multiple of 32 samples of each line.
+ *****************************************************************************/
+typedef void (*reduce_line_t)( uint8_t *, const uint16_t *, int, int );
+
+static inline void ReducePlanes( filter_t *p_filter, picture_t *p_source,
+                                 picture_t *p_dest, int i_height,
+                                 reduce_line_t pf_reduce )
+{
+    const filter_sys_t *p_sys = p_filter->p_sys;
+    const int i_shift = p_sys->i_shift;
+    const unsigned i_round = 1 << (i_shift - 1);
+
+    for( int i_plane = 0; i_plane < 3; i_plane++ )
+    {
+        const int i_width = i_plane ? p_filter->fmt_in.video.i_width / 2
+                                    : p_filter->fmt_in.video.i_width;
+        const int i_lines = i_plane ? i_height / 2 : i_height;
+        const plane_t *p_src = &p_source->p[i_plane];
+        int i_dst = i_plane;
+
+        if( i_plane && p_sys->b_swap ) /* U and V are swapped */
+            i_dst = 3 - i_plane;
+
+        const uint8_t *p_in = p_src->p_pixels;
+        uint8_t *p_out = p_dest->p[i_dst].p_pixels;
+
+        for( int i_y = 0; i_y < i_lines; i_y++ )
+        {
+            const uint16_t *p_line = (const uint16_t *)p_in;
+            int i_x = pf_reduce != NULL ? i_width & ~31 : 0;
+
+            if( i_x > 0 )
+                pf_reduce( p_out, p_line, i_x, i_shift );
+            for( ; i_x < i_width; i_x++ )
+            {
+                unsigned i_value = (GetWLE( &p_line[i_x] ) + i_round) >> i_shift;
+                p_out[i_x] = __MIN( i_value, 255 );
+            }
+            p_in += p_src->i_pitch;
+            p_out += p_dest->p[i_dst].i_pitch;
+        }
+    }
+}
+
+/*****************************************************************************
+ * I420_10_I420: planar 9 or 10-bit YUV 4:2:0 to planar 8-bit YUV 4:2:0
+ *****************************************************************************/
+static void I420_10_I420( filter_t *p_filter, picture_t *p_source,
+                                              picture_t *p_dest, int i_height )
+{
+    ReducePlanes( p_filter, p_source, p_dest, i_height, NULL );
+}
+
+#if defined (HAVE_AVX2_INTRINSICS)
+#include <immintrin.h>
+
+/* Reduces i_count samples, i_count being a multiple of 32 */
+VLC_AVX2
+static void ReduceLineAVX2( uint8_t *p_out, const uint16_t *p_in,
+                            int i_count, int i_shift )
+{
+    const __m256i round = _mm256_set1_epi16( 1 << (i_shift - 1) );
+    const __m128i shift = _mm_cvtsi32_si128( i_shift );
+
+    for( int i_x = 0; i_x < i_count; i_x += 32 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)(p_in + i_x) );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)(p_in + i_x + 16) );
+
+        /* The saturated add and the signed pack take care of the clipping */
+        a = _mm256_srl_epi16( _mm256_adds_epu16( a, round ), shift );
+        b = _mm256_srl_epi16( _mm256_adds_epu16( b, round ), shift );
+        a = _mm256_permute4x64_epi64( _mm256_packus_epi16( a, b ), 0xD8 );
+        _mm256_storeu_si256( (__m256i *)(p_out + i_x), a );
+    }
+}
+
+static void I420_10_I420_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                   picture_t *p_dest,
+                                                   int i_height )
+{
+    ReducePlanes( p_filter, p_source, p_dest, i_height, ReduceLineAVX2 );
+}
+#endif
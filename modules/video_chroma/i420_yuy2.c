@@ -62,9 +62,9 @@
  *****************************************************************************/
 static int  Activate ( vlc_object_t * );
 
-static void I420_YUY2           ( filter_t *, picture_t *, picture_t * );
-static void I420_YVYU           ( filter_t *, picture_t *, picture_t * );
-static void I420_UYVY           ( filter_t *, picture_t *, picture_t * );
+static void I420_YUY2           ( filter_t *, picture_t *, picture_t *, int );
+static void I420_YVYU           ( filter_t *, picture_t *, picture_t *, int );
+static void I420_UYVY           ( filter_t *, picture_t *, picture_t *, int );
 static picture_t *I420_YUY2_Filter    ( filter_t *, picture_t * );
 static picture_t *I420_YVYU_Filter    ( filter_t *, picture_t * );
 static picture_t *I420_UYVY_Filter    ( filter_t *, picture_t * );
@@ -75,10 +75,24 @@ static picture_t *I420_IUYV_Filter    ( filter_t *, picture_t * );
 static picture_t *I420_cyuv_Filter    ( filter_t *, picture_t * );
 #endif
 #if defined (MODULE_NAME_IS_i420_yuy2)
-static void I420_Y211           ( filter_t *, picture_t *, picture_t * );
+static void I420_Y211           ( filter_t *, picture_t *, picture_t *, int );
 static picture_t *I420_Y211_Filter    ( filter_t *, picture_t * );
 #endif
 
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined (HAVE_AVX2_INTRINSICS)
+static void I420_YUY2_AVX2      ( filter_t *, picture_t *, picture_t *, int );
+static void I420_YVYU_AVX2      ( filter_t *, picture_t *, picture_t *, int );
+static void I420_UYVY_AVX2      ( filter_t *, picture_t *, picture_t *, int );
+static picture_t *I420_YUY2_AVX2_Filter( filter_t *, picture_t * );
+static picture_t *I420_YVYU_AVX2_Filter( filter_t *, picture_t * );
+static picture_t *I420_UYVY_AVX2_Filter( filter_t *, picture_t * );
+/* Picks the AVX2 version of a conversion if the CPU supports it */
+#   define AVX2_FILTER( name ) \
+        (vlc_CPU_AVX2() ? name ## _AVX2_Filter : name ## _Filter)
+#else
+#   define AVX2_FILTER( name ) name ## _Filter
+#endif
+
 #ifdef MODULE_NAME_IS_i420_yuy2_mmx
 /* Initialize MMX-specific constants */
 static const uint64_t i_00ffw = 0x00ff00ff00ff00ffULL;
@@ -98,7 +112,7 @@ vlc_module_begin ()
     set_capability( "video filter2", 160 )
 # define vlc_CPU_capable() vlc_CPU_MMX()
 #elif defined (MODULE_NAME_IS_i420_yuy2_sse2)
-    set_description( N_("SSE2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    set_description( N_("SSE2 and AVX2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
     set_capability( "video filter2", 250 )
 # define vlc_CPU_capable() vlc_CPU_SSE2()
 #elif defined (MODULE_NAME_IS_i420_yuy2_altivec)
@@ -138,15 +152,15 @@ static int Activate( vlc_object_t *p_this )
             switch( p_filter->fmt_out.video.i_chroma )
             {
                 case VLC_CODEC_YUYV:
-                    p_filter->pf_video_filter = I420_YUY2_Filter;
+                    p_filter->pf_video_filter = AVX2_FILTER( I420_YUY2 );
                     break;
 
                 case VLC_CODEC_YVYU:
-                    p_filter->pf_video_filter = I420_YVYU_Filter;
+                    p_filter->pf_video_filter = AVX2_FILTER( I420_YVYU );
                     break;
 
                 case VLC_CODEC_UYVY:
-                    p_filter->pf_video_filter = I420_UYVY_Filter;
+                    p_filter->pf_video_filter = AVX2_FILTER( I420_UYVY );
                     break;
 #if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
                 case VLC_FOURCC('I','U','Y','V'):
@@ -188,15 +202,20 @@ static inline unsigned long long read_cycles(void)
 
 /* Following functions are local */
 
-VIDEO_FILTER_WRAPPER( I420_YUY2 )
-VIDEO_FILTER_WRAPPER( I420_YVYU )
-VIDEO_FILTER_WRAPPER( I420_UYVY )
+VIDEO_FILTER_WRAPPER_SLICED( I420_YUY2, 2 )
+VIDEO_FILTER_WRAPPER_SLICED( I420_YVYU, 2 )
+VIDEO_FILTER_WRAPPER_SLICED( I420_UYVY, 2 )
 #if !defined (MODULE_NAME_IS_i420_yuy2_altivec)
 VIDEO_FILTER_WRAPPER( I420_IUYV )
 VIDEO_FILTER_WRAPPER( I420_cyuv )
 #endif
 #if defined (MODULE_NAME_IS_i420_yuy2)
-VIDEO_FILTER_WRAPPER( I420_Y211 )
+VIDEO_FILTER_WRAPPER_SLICED( I420_Y211, 2 )
+#endif
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined (HAVE_AVX2_INTRINSICS)
+VIDEO_FILTER_WRAPPER_SLICED( I420_YUY2_AVX2, 2 )
+VIDEO_FILTER_WRAPPER_SLICED( I420_YVYU_AVX2, 2 )
+VIDEO_FILTER_WRAPPER_SLICED( I420_UYVY_AVX2, 2 )
 #endif
 
 /*****************************************************************************
@@ -204,7 +223,7 @@ VIDEO_FILTER_WRAPPER( I420_Y211 )
  *****************************************************************************/
 VLC_TARGET
 static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, int i_height )
 {
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
@@ -239,10 +258,10 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     vector unsigned char y_vec;
 
     if( !( ( p_filter->fmt_in.video.i_width % 32 ) |
-           ( p_filter->fmt_in.video.i_height % 2 ) ) )
+           ( i_height % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
@@ -256,10 +275,10 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
 #warning FIXME: converting widths % 16 but !widths % 32 is broken on altivec
 #if 0
     else if( !( ( p_filter->fmt_in.video.i_width % 16 ) |
-                ( p_filter->fmt_in.video.i_height % 4 ) ) )
+                ( i_height % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 4 ; i_y-- ; )
+        for( i_y = i_height / 4 ; i_y-- ; )
         {
             /* Line 1 and 2, pixels 0 to ( width - 16 ) */
             VEC_NEXT_LINES( );
@@ -304,7 +323,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch;
 
 #if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -358,7 +377,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -386,7 +405,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -422,7 +441,7 @@ static void I420_YUY2( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 VLC_TARGET
 static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, int i_height )
 {
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
@@ -457,10 +476,10 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     vector unsigned char y_vec;
 
     if( !( ( p_filter->fmt_in.video.i_width % 32 ) |
-           ( p_filter->fmt_in.video.i_height % 2 ) ) )
+           ( i_height % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
@@ -472,10 +491,10 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
         }
     }
     else if( !( ( p_filter->fmt_in.video.i_width % 16 ) |
-                ( p_filter->fmt_in.video.i_height % 4 ) ) )
+                ( i_height % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 4 ; i_y-- ; )
+        for( i_y = i_height / 4 ; i_y-- ; )
         {
             /* Line 1 and 2, pixels 0 to ( width - 16 ) */
             VEC_NEXT_LINES( );
@@ -519,7 +538,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch;
 
 #if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -569,7 +588,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -597,7 +616,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -632,7 +651,7 @@ static void I420_YVYU( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 VLC_TARGET
 static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, int i_height )
 {
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
@@ -667,10 +686,10 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     vector unsigned char y_vec;
 
     if( !( ( p_filter->fmt_in.video.i_width % 32 ) |
-           ( p_filter->fmt_in.video.i_height % 2 ) ) )
+           ( i_height % 2 ) ) )
     {
         /* Width is a multiple of 32, we take 2 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             VEC_NEXT_LINES( );
             for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )
@@ -682,10 +701,10 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
         }
     }
     else if( !( ( p_filter->fmt_in.video.i_width % 16 ) |
-                ( p_filter->fmt_in.video.i_height % 4 ) ) )
+                ( i_height % 4 ) ) )
     {
         /* Width is only a multiple of 16, we take 4 lines at a time */
-        for( i_y = p_filter->fmt_in.video.i_height / 4 ; i_y-- ; )
+        for( i_y = i_height / 4 ; i_y-- ; )
         {
             /* Line 1 and 2, pixels 0 to ( width - 16 ) */
             VEC_NEXT_LINES( );
@@ -729,7 +748,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
                                - p_dest->p->i_visible_pitch;
 
 #if !defined(MODULE_NAME_IS_i420_yuy2_sse2)
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -779,7 +798,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
         ((intptr_t)p_line2|(intptr_t)p_y2))) )
     {
         /* use faster SSE2 aligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -807,7 +826,7 @@ static void I420_UYVY( filter_t *p_filter, picture_t *p_source,
     else
     {
         /* use slower SSE2 unaligned fetch and store */
-        for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+        for( i_y = i_height / 2 ; i_y-- ; )
         {
             p_line1 = p_line2;
             p_line2 += p_dest->p->i_pitch;
@@ -985,7 +1004,7 @@ static void I420_cyuv( filter_t *p_filter, picture_t *p_source,
  *****************************************************************************/
 #if defined (MODULE_NAME_IS_i420_yuy2)
 static void I420_Y211( filter_t *p_filter, picture_t *p_source,
-                                           picture_t *p_dest )
+                                           picture_t *p_dest, int i_height )
 {
     uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;
     uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;
@@ -1001,7 +1020,7 @@ static void I420_Y211( filter_t *p_filter, picture_t *p_source,
     const int i_dest_margin = p_dest->p->i_pitch
                                - p_dest->p->i_visible_pitch;
 
-    for( i_y = p_filter->fmt_in.video.i_height / 2 ; i_y-- ; )
+    for( i_y = i_height / 2 ; i_y-- ; )
     {
         p_line1 = p_line2;
         p_line2 += p_dest->p->i_pitch;
@@ -1024,3 +1043,69 @@ static void I420_Y211( filter_t *p_filter, picture_t *p_source,
     }
 }
 #endif
+
+#if defined (MODULE_NAME_IS_i420_yuy2_sse2) && defined (HAVE_AVX2_INTRINSICS)
+/*****************************************************************************
+ * AVX2 versions of I420_YUY2, I420_YVYU and I420_UYVY
+ *****************************************************************************/
+#define I420_AVX2( AVX2_INSTRUCTIONS, C_INSTRUCTIONS )                      \
+    uint8_t *p_line1, *p_line2 = p_dest->p->p_pixels;                       \
+    uint8_t *p_y1, *p_y2 = p_source->Y_PIXELS;                              \
+    uint8_t *p_u = p_source->U_PIXELS;                                      \
+    uint8_t *p_v = p_source->V_PIXELS;                                      \
+                                                                            \
+    int i_x, i_y;                                                           \
+                                                                            \
+    const int i_source_margin = p_source->p[0].i_pitch                      \
+                                 - p_source->p[0].i_visible_pitch;          \
+    const int i_source_margin_c = p_source->p[1].i_pitch                    \
+                                 - p_source->p[1].i_visible_pitch;          \
+    const int i_dest_margin = p_dest->p->i_pitch                            \
+                               - p_dest->p->i_visible_pitch;                \
+                                                                            \
+    for( i_y = i_height / 2 ; i_y-- ; )                                     \
+    {                                                                       \
+        p_line1 = p_line2;                                                  \
+        p_line2 += p_dest->p->i_pitch;                                      \
+                                                                            \
+        p_y1 = p_y2;                                                        \
+        p_y2 += p_source->p[Y_PLANE].i_pitch;                               \
+                                                                            \
+        for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )          \
+        {                                                                   \
+            AVX2_CALL( AVX2_INSTRUCTIONS );                                 \
+        }                                                                   \
+        for( i_x = ( p_filter->fmt_in.video.i_width % 32 ) / 2; i_x-- ; )   \
+        {                                                                   \
+            C_INSTRUCTIONS( );                                              \
+        }                                                                   \
+                                                                            \
+        p_y1 += i_source_margin;                                            \
+        p_y2 += i_source_margin;                                            \
+        p_u += i_source_margin_c;                                           \
+        p_v += i_source_margin_c;                                           \
+        p_line1 += i_dest_margin;                                           \
+        p_line2 += i_dest_margin;                                           \
+    }
+
+VLC_AVX2
+static void I420_YUY2_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    I420_AVX2( AVX2_YUV420_YUYV, C_YUV420_YUYV )
+}
+
+VLC_AVX2
+static void I420_YVYU_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    I420_AVX2( AVX2_YUV420_YVYU, C_YUV420_YVYU )
+}
+
+VLC_AVX2
+static void I420_UYVY_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    I420_AVX2( AVX2_YUV420_UYVY, C_YUV420_UYVY )
+}
+#endif
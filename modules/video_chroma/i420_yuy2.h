@@ -353,7 +353,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_stream_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_stream_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_stream_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_YUYV_UNALIGNED                  \
     xmm1 = _mm_loadl_epi64((__m128i *)p_u);         \
@@ -372,7 +372,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_storeu_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_storeu_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_storeu_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_YVYU_ALIGNED                    \
     xmm1 = _mm_loadl_epi64((__m128i *)p_v);         \
@@ -389,7 +389,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_stream_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_stream_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_stream_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_YVYU_UNALIGNED                  \
     xmm1 = _mm_loadl_epi64((__m128i *)p_v);         \
@@ -408,7 +408,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm1);           \
     _mm_storeu_si128((__m128i*)(p_line2), xmm4);    \
     xmm3 = _mm_unpackhi_epi8(xmm3, xmm1);           \
-    _mm_storeu_si128((__m128i*)(p_line1+16), xmm3);
+    _mm_storeu_si128((__m128i*)(p_line2+16), xmm3);
 
 #define SSE2_YUV420_UYVY_ALIGNED                    \
     xmm1 = _mm_loadl_epi64((__m128i *)p_u);         \
@@ -426,7 +426,7 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm3);           \
     _mm_stream_si128((__m128i*)(p_line2), xmm4);    \
     xmm1 = _mm_unpackhi_epi8(xmm1, xmm3);           \
-    _mm_stream_si128((__m128i*)(p_line1+16), xmm1);
+    _mm_stream_si128((__m128i*)(p_line2+16), xmm1);
 
 #define SSE2_YUV420_UYVY_UNALIGNED                  \
     xmm1 = _mm_loadl_epi64((__m128i *)p_u);         \
@@ -446,7 +446,70 @@ movdqu    %%xmm1, 16(%1)  # Store high UYVY                               \n\
     xmm4 = _mm_unpacklo_epi8(xmm4, xmm3);           \
     _mm_storeu_si128((__m128i*)(p_line2), xmm4);    \
     xmm1 = _mm_unpackhi_epi8(xmm1, xmm3);           \
-    _mm_storeu_si128((__m128i*)(p_line1+16), xmm1);
+    _mm_storeu_si128((__m128i*)(p_line2+16), xmm1);
+
+#endif
+
+#if defined(HAVE_AVX2_INTRINSICS)
+
+/* AVX2 intrinsics, used instead of SSE2 when the CPU supports them.
+ * The functions using them must have the VLC_AVX2 attribute. */
+
+#include <immintrin.h>
+
+#define AVX2_CALL(AVX2_INSTRUCTIONS)            \
+    do {                                        \
+        __m256i ymm0, ymm1;                     \
+        __m128i xmm0, xmm1;                     \
+        AVX2_INSTRUCTIONS                       \
+        p_line1 += 64; p_line2 += 64;           \
+        p_y1 += 32; p_y2 += 32;                 \
+        p_u += 16; p_v += 16;                   \
+    } while(0)
+
+/* Interleaves 16 bytes of p_a with 16 bytes of p_b into ymm1, with the
+ * 64-bit words in the 0, 2, 1, 3 order so that the in-lane unpacks of
+ * AVX2_STORE_* produce the pixels in order */
+#define AVX2_LOAD_CHROMA( p_a, p_b )                            \
+    xmm0 = _mm_loadu_si128((__m128i *)(p_a));                   \
+    xmm1 = _mm_loadu_si128((__m128i *)(p_b));                   \
+    ymm1 = _mm256_inserti128_si256(                             \
+               _mm256_castsi128_si256(_mm_unpacklo_epi8(xmm0, xmm1)), \
+               _mm_unpackhi_epi8(xmm0, xmm1), 1);               \
+    ymm1 = _mm256_permute4x64_epi64(ymm1, 0xD8);
+
+/* Stores 32 pixels of luma p_y with the chroma of ymm1, luma first */
+#define AVX2_STORE_YC( p_line, p_y )                            \
+    ymm0 = _mm256_loadu_si256((__m256i *)(p_y));                \
+    ymm0 = _mm256_permute4x64_epi64(ymm0, 0xD8);                \
+    _mm256_storeu_si256((__m256i *)(p_line),                    \
+                        _mm256_unpacklo_epi8(ymm0, ymm1));      \
+    _mm256_storeu_si256((__m256i *)((p_line)+32),               \
+                        _mm256_unpackhi_epi8(ymm0, ymm1));
+
+/* Same as AVX2_STORE_YC, chroma first */
+#define AVX2_STORE_CY( p_line, p_y )                            \
+    ymm0 = _mm256_loadu_si256((__m256i *)(p_y));                \
+    ymm0 = _mm256_permute4x64_epi64(ymm0, 0xD8);                \
+    _mm256_storeu_si256((__m256i *)(p_line),                    \
+                        _mm256_unpacklo_epi8(ymm1, ymm0));      \
+    _mm256_storeu_si256((__m256i *)((p_line)+32),               \
+                        _mm256_unpackhi_epi8(ymm1, ymm0));
+
+#define AVX2_YUV420_YUYV                        \
+    AVX2_LOAD_CHROMA( p_u, p_v )                \
+    AVX2_STORE_YC( p_line1, p_y1 )              \
+    AVX2_STORE_YC( p_line2, p_y2 )
+
+#define AVX2_YUV420_YVYU                        \
+    AVX2_LOAD_CHROMA( p_v, p_u )                \
+    AVX2_STORE_YC( p_line1, p_y1 )              \
+    AVX2_STORE_YC( p_line2, p_y2 )
+
+#define AVX2_YUV420_UYVY                        \
+    AVX2_LOAD_CHROMA( p_u, p_v )                \
+    AVX2_STORE_CY( p_line1, p_y1 )              \
+    AVX2_STORE_CY( p_line2, p_y2 )
 
 #endif
 
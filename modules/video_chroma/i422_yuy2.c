@@ -64,6 +64,20 @@ static void I422_Y211               ( filter_t *, picture_t *, picture_t * );
 static picture_t *I422_Y211_Filter  ( filter_t *, picture_t * );
 #endif
 
+#if defined (MODULE_NAME_IS_i422_yuy2_sse2) && defined (HAVE_AVX2_INTRINSICS)
+static void I422_YUY2_AVX2          ( filter_t *, picture_t *, picture_t *, int );
+static void I422_YVYU_AVX2          ( filter_t *, picture_t *, picture_t *, int );
+static void I422_UYVY_AVX2          ( filter_t *, picture_t *, picture_t *, int );
+static picture_t *I422_YUY2_AVX2_Filter( filter_t *, picture_t * );
+static picture_t *I422_YVYU_AVX2_Filter( filter_t *, picture_t * );
+static picture_t *I422_UYVY_AVX2_Filter( filter_t *, picture_t * );
+/* Picks the AVX2 version of a conversion if the CPU supports it */
+#   define AVX2_FILTER( name ) \
+        (vlc_CPU_AVX2() ? name ## _AVX2_Filter : name ## _Filter)
+#else
+#   define AVX2_FILTER( name ) name ## _Filter
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -79,7 +93,7 @@ vlc_module_begin ()
 # define vlc_CPU_capable() vlc_CPU_MMX()
 # define VLC_TARGET VLC_MMX
 #elif defined (MODULE_NAME_IS_i422_yuy2_sse2)
-    set_description( N_("SSE2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    set_description( N_("SSE2 and AVX2 conversions from " SRC_FOURCC " to " DEST_FOURCC) )
     set_capability( "video filter2", 120 )
 # define vlc_CPU_capable() vlc_CPU_SSE2()
 # define VLC_TARGET VLC_SSE
@@ -110,15 +124,15 @@ static int Activate( vlc_object_t *p_this )
             switch( p_filter->fmt_out.video.i_chroma )
             {
                 case VLC_CODEC_YUYV:
-                    p_filter->pf_video_filter = I422_YUY2_Filter;
+                    p_filter->pf_video_filter = AVX2_FILTER( I422_YUY2 );
                     break;
 
                 case VLC_CODEC_YVYU:
-                    p_filter->pf_video_filter = I422_YVYU_Filter;
+                    p_filter->pf_video_filter = AVX2_FILTER( I422_YVYU );
                     break;
 
                 case VLC_CODEC_UYVY:
-                    p_filter->pf_video_filter = I422_UYVY_Filter;
+                    p_filter->pf_video_filter = AVX2_FILTER( I422_UYVY );
                     break;
 
                 case VLC_FOURCC('I','U','Y','V'):
@@ -156,6 +170,11 @@ VIDEO_FILTER_WRAPPER( I422_cyuv )
 #if defined (MODULE_NAME_IS_i422_yuy2)
 VIDEO_FILTER_WRAPPER( I422_Y211 )
 #endif
+#if defined (MODULE_NAME_IS_i422_yuy2_sse2) && defined (HAVE_AVX2_INTRINSICS)
+VIDEO_FILTER_WRAPPER_SLICED( I422_YUY2_AVX2, 1 )
+VIDEO_FILTER_WRAPPER_SLICED( I422_YVYU_AVX2, 1 )
+VIDEO_FILTER_WRAPPER_SLICED( I422_UYVY_AVX2, 1 )
+#endif
 
 /*****************************************************************************
  * I422_YUY2: planar YUV 4:2:2 to packed YUY2 4:2:2
@@ -572,3 +591,60 @@ static void I422_Y211( filter_t *p_filter, picture_t *p_source,
     }
 }
 #endif
+
+#if defined (MODULE_NAME_IS_i422_yuy2_sse2) && defined (HAVE_AVX2_INTRINSICS)
+/*****************************************************************************
+ * AVX2 versions of I422_YUY2, I422_YVYU and I422_UYVY
+ *****************************************************************************/
+#define I422_AVX2( AVX2_INSTRUCTIONS, C_INSTRUCTIONS )                      \
+    uint8_t *p_line = p_dest->p->p_pixels;                                  \
+    uint8_t *p_y = p_source->Y_PIXELS;                                      \
+    uint8_t *p_u = p_source->U_PIXELS;                                      \
+    uint8_t *p_v = p_source->V_PIXELS;                                      \
+                                                                            \
+    int i_x, i_y;                                                           \
+                                                                            \
+    const int i_source_margin = p_source->p[0].i_pitch                      \
+                                 - p_source->p[0].i_visible_pitch;          \
+    const int i_source_margin_c = p_source->p[1].i_pitch                    \
+                                 - p_source->p[1].i_visible_pitch;          \
+    const int i_dest_margin = p_dest->p->i_pitch                            \
+                               - p_dest->p->i_visible_pitch;                \
+                                                                            \
+    for( i_y = i_height ; i_y-- ; )                                         \
+    {                                                                       \
+        for( i_x = p_filter->fmt_in.video.i_width / 32 ; i_x-- ; )          \
+        {                                                                   \
+            AVX2_CALL( AVX2_INSTRUCTIONS );                                 \
+        }                                                                   \
+        for( i_x = ( p_filter->fmt_in.video.i_width % 32 ) / 2; i_x-- ; )   \
+        {                                                                   \
+            C_INSTRUCTIONS( p_line, p_y, p_u, p_v );                        \
+        }                                                                   \
+        p_y += i_source_margin;                                             \
+        p_u += i_source_margin_c;                                           \
+        p_v += i_source_margin_c;                                           \
+        p_line += i_dest_margin;                                            \
+    }
+
+VLC_AVX2
+static void I422_YUY2_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    I422_AVX2( AVX2_YUV422_YUYV, C_YUV422_YUYV )
+}
+
+VLC_AVX2
+static void I422_YVYU_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    I422_AVX2( AVX2_YUV422_YVYU, C_YUV422_YVYU )
+}
+
+VLC_AVX2
+static void I422_UYVY_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    I422_AVX2( AVX2_YUV422_UYVY, C_YUV422_UYVY )
+}
+#endif
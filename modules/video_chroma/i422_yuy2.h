@@ -313,6 +313,58 @@ movdqu    %%xmm1, 16(%0)  # Store high UYVY                               \n\
 
 #endif
 
+#if defined(HAVE_AVX2_INTRINSICS)
+
+/* AVX2 intrinsics, used instead of SSE2 when the CPU supports them.
+ * The functions using them must have the VLC_AVX2 attribute. */
+
+#include <immintrin.h>
+
+#define AVX2_CALL(AVX2_INSTRUCTIONS)            \
+    do {                                        \
+        __m256i ymm0, ymm1;                     \
+        __m128i xmm0, xmm1;                     \
+        AVX2_INSTRUCTIONS                       \
+        p_line += 64; p_y += 32;                \
+        p_u += 16; p_v += 16;                   \
+    } while(0)
+
+/* Interleaves 16 bytes of p_a with 16 bytes of p_b into ymm1, and loads
+ * 32 bytes of luma into ymm0, both with the 64-bit words in the 0, 2, 1, 3
+ * order so that the in-lane unpacks produce the pixels in order */
+#define AVX2_LOAD( p_a, p_b )                                   \
+    xmm0 = _mm_loadu_si128((__m128i *)(p_a));                   \
+    xmm1 = _mm_loadu_si128((__m128i *)(p_b));                   \
+    ymm1 = _mm256_inserti128_si256(                             \
+               _mm256_castsi128_si256(_mm_unpacklo_epi8(xmm0, xmm1)), \
+               _mm_unpackhi_epi8(xmm0, xmm1), 1);               \
+    ymm1 = _mm256_permute4x64_epi64(ymm1, 0xD8);                \
+    ymm0 = _mm256_loadu_si256((__m256i *)p_y);                  \
+    ymm0 = _mm256_permute4x64_epi64(ymm0, 0xD8);
+
+#define AVX2_YUV422_YUYV                                        \
+    AVX2_LOAD( p_u, p_v )                                       \
+    _mm256_storeu_si256((__m256i *)(p_line),                    \
+                        _mm256_unpacklo_epi8(ymm0, ymm1));      \
+    _mm256_storeu_si256((__m256i *)(p_line+32),                 \
+                        _mm256_unpackhi_epi8(ymm0, ymm1));
+
+#define AVX2_YUV422_YVYU                                        \
+    AVX2_LOAD( p_v, p_u )                                       \
+    _mm256_storeu_si256((__m256i *)(p_line),                    \
+                        _mm256_unpacklo_epi8(ymm0, ymm1));      \
+    _mm256_storeu_si256((__m256i *)(p_line+32),                 \
+                        _mm256_unpackhi_epi8(ymm0, ymm1));
+
+#define AVX2_YUV422_UYVY                                        \
+    AVX2_LOAD( p_u, p_v )                                       \
+    _mm256_storeu_si256((__m256i *)(p_line),                    \
+                        _mm256_unpacklo_epi8(ymm1, ymm0));      \
+    _mm256_storeu_si256((__m256i *)(p_line+32),                 \
+                        _mm256_unpackhi_epi8(ymm1, ymm0));
+
+#endif
+
 #endif
 
 #define C_YUV422_YUYV( p_line, p_y, p_u, p_v )                              \
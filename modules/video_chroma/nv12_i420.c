@@ -0,0 +1,235 @@
+/*****************************************************************************
+ * nv12_i420.c : Semi-planar YUV 4:2:0 to planar YUV 4:2:0 conversion for vlc
+ *****************************************************************************
+ * Copyright (C) 2013 VLC authors and VideoLAN
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+/*****************************************************************************
+ * Preamble
+ *****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+# include "config.h"
+#endif
+
+#include <vlc_common.h>
+#include <vlc_plugin.h>
+#include <vlc_filter.h>
+#include <vlc_cpu.h>
+
+#define SRC_FOURCC  "NV12,NV21"
+#define DEST_FOURCC "I420,IYUV,J420,YV12"
+
+/*****************************************************************************
+ * Local and extern prototypes.
+ *****************************************************************************/
+static int  Activate ( vlc_object_t * );
+
+static void NV12_I420           ( filter_t *, picture_t *, picture_t *, int );
+static void NV12_YV12           ( filter_t *, picture_t *, picture_t *, int );
+static picture_t *NV12_I420_Filter    ( filter_t *, picture_t * );
+static picture_t *NV12_YV12_Filter    ( filter_t *, picture_t * );
+
+#if defined (HAVE_AVX2_INTRINSICS)
+static void NV12_I420_AVX2      ( filter_t *, picture_t *, picture_t *, int );
+static void NV12_YV12_AVX2      ( filter_t *, picture_t *, picture_t *, int );
+static picture_t *NV12_I420_AVX2_Filter( filter_t *, picture_t * );
+static picture_t *NV12_YV12_AVX2_Filter( filter_t *, picture_t * );
+/* Picks the AVX2 version of a conversion if the CPU supports it */
+#   define AVX2_FILTER( name ) \
+        (vlc_CPU_AVX2() ? name ## _AVX2_Filter : name ## _Filter)
+#else
+#   define AVX2_FILTER( name ) name ## _Filter
+#endif
+
+/*****************************************************************************
+ * Module descriptor
+ *****************************************************************************/
+vlc_module_begin ()
+    set_description( N_("Conversions from " SRC_FOURCC " to " DEST_FOURCC) )
+    set_capability( "video filter2", 160 )
+    set_callbacks( Activate, NULL )
+vlc_module_end ()
+
+/*****************************************************************************
+ * Activate: allocate a chroma function
+ *****************************************************************************
+ * This function allocates and initializes a chroma function
+ *****************************************************************************/
+static int Activate( vlc_object_t *p_this )
+{
+    filter_t *p_filter = (filter_t *)p_this;
+    bool b_swap;
+
+    if( p_filter->fmt_in.video.i_width & 1
+     || p_filter->fmt_in.video.i_height & 1 )
+    {
+        return -1;
+    }
+
+    if( p_filter->fmt_in.video.i_width != p_filter->fmt_out.video.i_width
+     || p_filter->fmt_in.video.i_height != p_filter->fmt_out.video.i_height )
+        return -1;
+
+    switch( p_filter->fmt_in.video.i_chroma )
+    {
+        case VLC_CODEC_NV12:
+            b_swap = false;
+            break;
+        case VLC_CODEC_NV21:
+            b_swap = true;
+            break;
+        default:
+            return -1;
+    }
+
+    switch( p_filter->fmt_out.video.i_chroma )
+    {
+        case VLC_CODEC_I420:
+        case VLC_CODEC_J420:
+            break;
+        case VLC_CODEC_YV12:
+            b_swap = !b_swap;
+            break;
+        default:
+            return -1;
+    }
+
+    /* NV21 to YV12 is the same as NV12 to I420, and vice versa */
+    if( b_swap )
+        p_filter->pf_video_filter = AVX2_FILTER( NV12_YV12 );
+    else
+        p_filter->pf_video_filter = AVX2_FILTER( NV12_I420 );
+    return 0;
+}
+
+/* Following functions are local */
+VIDEO_FILTER_WRAPPER_SLICED( NV12_I420, 2 )
+VIDEO_FILTER_WRAPPER_SLICED( NV12_YV12, 2 )
+#if defined (HAVE_AVX2_INTRINSICS)
+VIDEO_FILTER_WRAPPER_SLICED( NV12_I420_AVX2, 2 )
+VIDEO_FILTER_WRAPPER_SLICED( NV12_YV12_AVX2, 2 )
+#endif
+
+/*****************************************************************************
+ * SplitPlanes: copies the luma plane and deinterleaves the chroma plane
+ *****************************************************************************
+ * The first byte of each chroma pair goes to p_u, the second one to p_v.
+ * If not NULL, pf_split handles the first multiple of 32 pairs of each line.
+ *****************************************************************************/
+typedef void (*split_line_t)( uint8_t *, uint8_t *, const uint8_t *, int );
+
+static inline void SplitPlanes( filter_t *p_filter, picture_t *p_source,
+                                picture_t *p_dest, int i_height,
+                                uint8_t *p_u, uint8_t *p_v, int i_pitch_c,
+                                split_line_t pf_split )
+{
+    const int i_width = p_filter->fmt_in.video.i_width;
+    const uint8_t *p_y = p_source->Y_PIXELS;
+    const uint8_t *p_uv = p_source->p[1].p_pixels;
+    uint8_t *p_dy = p_dest->Y_PIXELS;
+
+    for( int i_y = 0; i_y < i_height; i_y++ )
+    {
+        memcpy( p_dy, p_y, i_width );
+        p_dy += p_dest->p[Y_PLANE].i_pitch;
+        p_y += p_source->p[Y_PLANE].i_pitch;
+    }
+
+    for( int i_y = 0; i_y < i_height / 2; i_y++ )
+    {
+        int i_x = pf_split != NULL ? i_width / 64 * 32 : 0;
+
+        if( i_x > 0 )
+            pf_split( p_u, p_v, p_uv, i_x );
+        for( ; i_x < i_width / 2; i_x++ )
+        {
+            p_u[i_x] = p_uv[2 * i_x];
+            p_v[i_x] = p_uv[2 * i_x + 1];
+        }
+        p_uv += p_source->p[1].i_pitch;
+        p_u += i_pitch_c;
+        p_v += i_pitch_c;
+    }
+}
+
+/*****************************************************************************
+ * NV12_I420: semi-planar NV12 4:2:0 to planar I420 4:2:0 Y:U:V
+ *****************************************************************************/
+static void NV12_I420( filter_t *p_filter, picture_t *p_source,
+                                           picture_t *p_dest, int i_height )
+{
+    SplitPlanes( p_filter, p_source, p_dest, i_height,
+                 p_dest->U_PIXELS, p_dest->V_PIXELS,
+                 p_dest->p[U_PLANE].i_pitch, NULL );
+}
+
+/*****************************************************************************
+ * NV12_YV12: semi-planar NV12 4:2:0 to planar YV12 4:2:0 Y:V:U
+ *****************************************************************************/
+static void NV12_YV12( filter_t *p_filter, picture_t *p_source,
+                                           picture_t *p_dest, int i_height )
+{
+    SplitPlanes( p_filter, p_source, p_dest, i_height,
+                 p_dest->V_PIXELS, p_dest->U_PIXELS, /* U and V are swapped */
+                 p_dest->p[U_PLANE].i_pitch, NULL );
+}
+
+#if defined (HAVE_AVX2_INTRINSICS)
+#include <immintrin.h>
+
+/* Deinterleaves i_count chroma pairs, i_count being a multiple of 32 */
+VLC_AVX2
+static void SplitLineAVX2( uint8_t *p_u, uint8_t *p_v, const uint8_t *p_uv,
+                           int i_count )
+{
+    const __m256i mask = _mm256_set1_epi16( 0x00ff );
+
+    for( int i_x = 0; i_x < i_count; i_x += 32 )
+    {
+        __m256i a = _mm256_loadu_si256( (const __m256i *)(p_uv + 2 * i_x) );
+        __m256i b = _mm256_loadu_si256( (const __m256i *)(p_uv + 2 * i_x + 32) );
+
+        /* The packs work on each 128-bit lane, hence the permutes */
+        __m256i u = _mm256_packus_epi16( _mm256_and_si256( a, mask ),
+                                         _mm256_and_si256( b, mask ) );
+        __m256i v = _mm256_packus_epi16( _mm256_srli_epi16( a, 8 ),
+                                         _mm256_srli_epi16( b, 8 ) );
+        _mm256_storeu_si256( (__m256i *)(p_u + i_x),
+                             _mm256_permute4x64_epi64( u, 0xD8 ) );
+        _mm256_storeu_si256( (__m256i *)(p_v + i_x),
+                             _mm256_permute4x64_epi64( v, 0xD8 ) );
+    }
+}
+
+static void NV12_I420_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    SplitPlanes( p_filter, p_source, p_dest, i_height,
+                 p_dest->U_PIXELS, p_dest->V_PIXELS,
+                 p_dest->p[U_PLANE].i_pitch, SplitLineAVX2 );
+}
+
+static void NV12_YV12_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    SplitPlanes( p_filter, p_source, p_dest, i_height,
+                 p_dest->V_PIXELS, p_dest->U_PIXELS, /* U and V are swapped */
+                 p_dest->p[U_PLANE].i_pitch, SplitLineAVX2 );
+}
+#endif
@@ -32,6 +32,7 @@
 #include <vlc_common.h>
 #include <vlc_plugin.h>
 #include <vlc_filter.h>
+#include <vlc_cpu.h>
 
 #define SRC_FOURCC "YUY2,YUNV,YVYU,UYVY,UYNV,Y422,cyuv"
 #define DEST_FOURCC  "I420"
@@ -51,6 +52,20 @@ static picture_t *YVYU_I420_Filter    ( filter_t *, picture_t * );
 static picture_t *UYVY_I420_Filter    ( filter_t *, picture_t * );
 static picture_t *cyuv_I420_Filter    ( filter_t *, picture_t * );
 
+#if defined (HAVE_AVX2_INTRINSICS)
+static void YUY2_I420_AVX2      ( filter_t *, picture_t *, picture_t *, int );
+static void YVYU_I420_AVX2      ( filter_t *, picture_t *, picture_t *, int );
+static void UYVY_I420_AVX2      ( filter_t *, picture_t *, picture_t *, int );
+static picture_t *YUY2_I420_AVX2_Filter( filter_t *, picture_t * );
+static picture_t *YVYU_I420_AVX2_Filter( filter_t *, picture_t * );
+static picture_t *UYVY_I420_AVX2_Filter( filter_t *, picture_t * );
+/* Picks the AVX2 version of a conversion if the CPU supports it */
+#   define AVX2_FILTER( name ) \
+        (vlc_CPU_AVX2() ? name ## _AVX2_Filter : name ## _Filter)
+#else
+#   define AVX2_FILTER( name ) name ## _Filter
+#endif
+
 /*****************************************************************************
  * Module descriptor
  *****************************************************************************/
@@ -85,15 +100,15 @@ static int Activate( vlc_object_t *p_this )
             switch( p_filter->fmt_in.video.i_chroma )
             {
                 case VLC_CODEC_YUYV:
-                    p_filter->pf_video_filter = YUY2_I420_Filter;
+                    p_filter->pf_video_filter = AVX2_FILTER( YUY2_I420 );
                     break;
 
                 case VLC_CODEC_YVYU:
-                    p_filter->pf_video_filter = YVYU_I420_Filter;
+                    p_filter->pf_video_filter = AVX2_FILTER( YVYU_I420 );
                     break;
 
                 case VLC_CODEC_UYVY:
-                    p_filter->pf_video_filter = UYVY_I420_Filter;
+                    p_filter->pf_video_filter = AVX2_FILTER( UYVY_I420 );
                     break;
 
                 case VLC_CODEC_CYUV:
@@ -116,6 +131,11 @@ VIDEO_FILTER_WRAPPER( YUY2_I420 )
 VIDEO_FILTER_WRAPPER( YVYU_I420 )
 VIDEO_FILTER_WRAPPER( UYVY_I420 )
 VIDEO_FILTER_WRAPPER( cyuv_I420 )
+#if defined (HAVE_AVX2_INTRINSICS)
+VIDEO_FILTER_WRAPPER_SLICED( YUY2_I420_AVX2, 2 )
+VIDEO_FILTER_WRAPPER_SLICED( YVYU_I420_AVX2, 2 )
+VIDEO_FILTER_WRAPPER_SLICED( UYVY_I420_AVX2, 2 )
+#endif
 
 /*****************************************************************************
  * YUY2_I420: packed YUY2 4:2:2 to planar YUV 4:2:0
@@ -178,8 +198,11 @@ static void YUY2_I420( filter_t *p_filter, picture_t *p_source,
         }
         p_line += i_source_margin;
         p_y += i_dest_margin;
-        p_u += i_dest_margin_c;
-        p_v += i_dest_margin_c;
+        if( !b_skip )
+        {   /* chroma is only written on the lines not skipped */
+            p_u += i_dest_margin_c;
+            p_v += i_dest_margin_c;
+        }
 
         b_skip = !b_skip;
     }
@@ -246,8 +269,11 @@ static void YVYU_I420( filter_t *p_filter, picture_t *p_source,
         }
         p_line += i_source_margin;
         p_y += i_dest_margin;
-        p_u += i_dest_margin_c;
-        p_v += i_dest_margin_c;
+        if( !b_skip )
+        {   /* chroma is only written on the lines not skipped */
+            p_u += i_dest_margin_c;
+            p_v += i_dest_margin_c;
+        }
 
         b_skip = !b_skip;
     }
@@ -283,8 +309,8 @@ static void UYVY_I420( filter_t *p_filter, picture_t *p_source,
             for( i_x = p_filter->fmt_out.video.i_width / 8 ; i_x-- ; )
             {
     #define C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v )      \
-                *p_u++ = *p_line++; p_line++; \
-                *p_v++ = *p_line++; p_line++
+                p_line++; *p_y++ = *p_line++; \
+                p_line++; *p_y++ = *p_line++
                 C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
                 C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
                 C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
@@ -314,8 +340,11 @@ static void UYVY_I420( filter_t *p_filter, picture_t *p_source,
         }
         p_line += i_source_margin;
         p_y += i_dest_margin;
-        p_u += i_dest_margin_c;
-        p_v += i_dest_margin_c;
+        if( !b_skip )
+        {   /* chroma is only written on the lines not skipped */
+            p_u += i_dest_margin_c;
+            p_v += i_dest_margin_c;
+        }
 
         b_skip = !b_skip;
     }
@@ -383,9 +412,137 @@ static void cyuv_I420( filter_t *p_filter, picture_t *p_source,
         }
         p_line += i_source_margin;
         p_y += i_dest_margin;
-        p_u += i_dest_margin_c;
-        p_v += i_dest_margin_c;
+        if( !b_skip )
+        {   /* chroma is only written on the lines not skipped */
+            p_u += i_dest_margin_c;
+            p_v += i_dest_margin_c;
+        }
 
         b_skip = !b_skip;
     }
 }
+
+#if defined (HAVE_AVX2_INTRINSICS)
+#include <immintrin.h>
+
+/*****************************************************************************
+ * Packed_I420_AVX2: packed 4:2:2 to planar YUV 4:2:0, 32 pixels at a time
+ *****************************************************************************
+ * b_uyvy selects the chroma first layouts, b_yvyu the V first layouts.
+ *****************************************************************************/
+VLC_AVX2
+static inline void Packed_I420_AVX2( filter_t *p_filter, picture_t *p_source,
+                                     picture_t *p_dest, int i_height,
+                                     bool b_uyvy, bool b_yvyu )
+{
+    uint8_t *p_line = p_source->p->p_pixels;
+
+    uint8_t *p_y = p_dest->Y_PIXELS;
+    /* YVYU is YUY2 with the chroma planes swapped */
+    uint8_t *p_u = b_yvyu ? p_dest->V_PIXELS : p_dest->U_PIXELS;
+    uint8_t *p_v = b_yvyu ? p_dest->U_PIXELS : p_dest->V_PIXELS;
+
+    int i_x, i_y;
+
+    const int i_dest_margin = p_dest->p[0].i_pitch
+                                 - p_dest->p[0].i_visible_pitch;
+    const int i_dest_margin_c = p_dest->p[1].i_pitch
+                                 - p_dest->p[1].i_visible_pitch;
+    const int i_source_margin = p_source->p->i_pitch
+                               - p_source->p->i_visible_pitch;
+    const __m256i mask = _mm256_set1_epi16( 0x00ff );
+
+    bool b_skip = false;
+
+    for( i_y = i_height ; i_y-- ; )
+    {
+        for( i_x = p_filter->fmt_out.video.i_width / 32 ; i_x-- ; )
+        {
+            __m256i a = _mm256_loadu_si256( (__m256i *)p_line );
+            __m256i b = _mm256_loadu_si256( (__m256i *)(p_line + 32) );
+            __m256i y, c;
+
+            /* The packs work on each 128-bit lane, hence the permutes */
+            if( b_uyvy )
+                y = _mm256_packus_epi16( _mm256_srli_epi16( a, 8 ),
+                                         _mm256_srli_epi16( b, 8 ) );
+            else
+                y = _mm256_packus_epi16( _mm256_and_si256( a, mask ),
+                                         _mm256_and_si256( b, mask ) );
+            y = _mm256_permute4x64_epi64( y, 0xD8 );
+            _mm256_storeu_si256( (__m256i *)p_y, y );
+
+            if( !b_skip )
+            {
+                if( b_uyvy )
+                    c = _mm256_packus_epi16( _mm256_and_si256( a, mask ),
+                                             _mm256_and_si256( b, mask ) );
+                else
+                    c = _mm256_packus_epi16( _mm256_srli_epi16( a, 8 ),
+                                             _mm256_srli_epi16( b, 8 ) );
+                c = _mm256_permute4x64_epi64( c, 0xD8 );
+                /* c holds UVUV..., split it into 16 U then 16 V */
+                c = _mm256_packus_epi16( _mm256_and_si256( c, mask ),
+                                         _mm256_srli_epi16( c, 8 ) );
+                c = _mm256_permute4x64_epi64( c, 0xD8 );
+                _mm_storeu_si128( (__m128i *)p_u, _mm256_castsi256_si128( c ) );
+                _mm_storeu_si128( (__m128i *)p_v,
+                                  _mm256_extracti128_si256( c, 1 ) );
+                p_u += 16;
+                p_v += 16;
+            }
+            p_line += 64;
+            p_y += 32;
+        }
+        for( i_x = ( p_filter->fmt_out.video.i_width % 32 ) / 2; i_x-- ; )
+        {
+            if( b_skip && b_uyvy )
+            {
+                C_UYVY_YUV422_skip( p_line, p_y, p_u, p_v );
+            }
+            else if( b_skip )
+            {
+                C_YUYV_YUV422_skip( p_line, p_y, p_u, p_v );
+            }
+            else if( b_uyvy )
+            {
+                C_UYVY_YUV422( p_line, p_y, p_u, p_v );
+            }
+            else
+            {
+                C_YUYV_YUV422( p_line, p_y, p_u, p_v );
+            }
+        }
+        p_line += i_source_margin;
+        p_y += i_dest_margin;
+        if( !b_skip )
+        {
+            p_u += i_dest_margin_c;
+            p_v += i_dest_margin_c;
+        }
+
+        b_skip = !b_skip;
+    }
+}
+
+VLC_AVX2
+static void YUY2_I420_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    Packed_I420_AVX2( p_filter, p_source, p_dest, i_height, false, false );
+}
+
+VLC_AVX2
+static void YVYU_I420_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    Packed_I420_AVX2( p_filter, p_source, p_dest, i_height, false, true );
+}
+
+VLC_AVX2
+static void UYVY_I420_AVX2( filter_t *p_filter, picture_t *p_source,
+                                                picture_t *p_dest, int i_height )
+{
+    Packed_I420_AVX2( p_filter, p_source, p_dest, i_height, true, false );
+}
+#endif
@@ -55,18 +55,30 @@ static picture_t *Filter( filter_t *, picture_t * );
 #define ALPHA_TEXT N_("Alpha of the blended image")
 #define ALPHA_LONGTEXT N_("Alpha with which the blend image is blended")
 
+#define WIDTH_TEXT N_("Width of the generated images")
+#define WIDTH_LONGTEXT N_("Width of the images generated when no image file " \
+                          "is given")
+
+#define HEIGHT_TEXT N_("Height of the generated images")
+#define HEIGHT_LONGTEXT N_("Height of the images generated when no image " \
+                           "file is given")
+
 #define BASE_IMAGE_TEXT N_("Image to be blended onto")
 #define BASE_IMAGE_LONGTEXT N_("The image which will be used to blend onto")
 
-#define BASE_CHROMA_TEXT N_("Chroma for the base image")
-#define BASE_CHROMA_LONGTEXT N_("Chroma which the base image will be loaded in")
+#define BASE_CHROMA_TEXT N_("Chromas for the base image")
+#define BASE_CHROMA_LONGTEXT N_("Comma-separated list of chromas in which " \
+                                "the base image will be loaded. If empty, " \
+                                "every chroma supported by the blending is " \
+                                "tested")
 
 #define BLEND_IMAGE_TEXT N_("Image which will be blended")
 #define BLEND_IMAGE_LONGTEXT N_("The image blended onto the base image")
 
-#define BLEND_CHROMA_TEXT N_("Chroma for the blend image")
-#define BLEND_CHROMA_LONGTEXT N_("Chroma which the blend image will be loaded" \
-                                 " in")
+#define BLEND_CHROMA_TEXT N_("Chromas for the blend image")
+#define BLEND_CHROMA_LONGTEXT N_("Comma-separated list of chromas in which " \
+                                 "the blend image will be loaded. If empty, " \
+                                 "YUVA, RGBA and YUVP are tested")
 
 #define CFG_PREFIX "blendbench-"
 
@@ -82,27 +94,36 @@ vlc_module_begin ()
               LOOPS_LONGTEXT, false )
     add_integer_with_range( CFG_PREFIX "alpha", 128, 0, 255, ALPHA_TEXT,
               ALPHA_LONGTEXT, false )
+    add_integer( CFG_PREFIX "width", 1280, WIDTH_TEXT, WIDTH_LONGTEXT, false )
+    add_integer( CFG_PREFIX "height", 720, HEIGHT_TEXT, HEIGHT_LONGTEXT, false )
 
     set_section( N_("Base image"), NULL )
     add_loadfile( CFG_PREFIX "base-image", NULL, BASE_IMAGE_TEXT,
                   BASE_IMAGE_LONGTEXT, false )
-    add_string( CFG_PREFIX "base-chroma", "I420", BASE_CHROMA_TEXT,
+    add_string( CFG_PREFIX "base-chroma", "", BASE_CHROMA_TEXT,
               BASE_CHROMA_LONGTEXT, false )
 
     set_section( N_("Blend image"), NULL )
     add_loadfile( CFG_PREFIX "blend-image", NULL, BLEND_IMAGE_TEXT,
                   BLEND_IMAGE_LONGTEXT, false )
-    add_string( CFG_PREFIX "blend-chroma", "YUVA", BLEND_CHROMA_TEXT,
+    add_string( CFG_PREFIX "blend-chroma", "", BLEND_CHROMA_TEXT,
               BLEND_CHROMA_LONGTEXT, false )
 
     set_callbacks( Create, Destroy )
 vlc_module_end ()
 
 static const char *const ppsz_filter_options[] = {
-    "loops", "alpha", "base-image", "base-chroma", "blend-image",
-    "blend-chroma", NULL
+    "loops", "alpha", "width", "height", "base-image", "base-chroma",
+    "blend-image", "blend-chroma", NULL
 };
 
+/* Chromas tested when none is given, the base ones are those handled by
+ * the blend module */
+static const char psz_all_base_chromas[] =
+    "RV15,RV16,RV24,RV32,YVU9,I410,I411,YV12,NV12,NV21,J420,I420,"
+    "I09L,I0AL,J422,I422,I29L,I2AL,J444,I444,I49L,I4AL,YUYV,UYVY,YVYU,VYUY";
+static const char psz_all_blend_chromas[] = "YUVA,RGBA,YUVP";
+
 /*****************************************************************************
  * filter_sys_t: filter method descriptor
  *****************************************************************************/
@@ -110,39 +131,221 @@ struct filter_sys_t
 {
     bool b_done;
     int i_loops, i_alpha;
+    int i_width, i_height;
 
-    picture_t *p_base_image;
-    picture_t *p_blend_image;
+    char *psz_base_image;
+    char *psz_base_chromas;
+    char *psz_blend_image;
+    char *psz_blend_chromas;
 
-    vlc_fourcc_t i_base_chroma;
-    vlc_fourcc_t i_blend_chroma;
+    video_palette_t palette;
 };
 
-static int blendbench_LoadImage( vlc_object_t *p_this, picture_t **pp_pic,
-                                 vlc_fourcc_t i_chroma, char *psz_file, const char *psz_name )
+static picture_t *blendbench_LoadImage( vlc_object_t *p_this,
+                                        vlc_fourcc_t i_chroma,
+                                        const char *psz_file,
+                                        const char *psz_name )
 {
     image_handler_t *p_image;
     video_format_t fmt_in, fmt_out;
+    picture_t *p_pic;
 
     memset( &fmt_in, 0, sizeof(video_format_t) );
     memset( &fmt_out, 0, sizeof(video_format_t) );
 
     fmt_out.i_chroma = i_chroma;
     p_image = image_HandlerCreate( p_this );
-    *pp_pic = image_ReadUrl( p_image, psz_file, &fmt_in, &fmt_out );
+    p_pic = image_ReadUrl( p_image, psz_file, &fmt_in, &fmt_out );
     image_HandlerDelete( p_image );
 
-    if( *pp_pic == NULL )
+    if( p_pic == NULL )
     {
-        msg_Err( p_this, "Unable to load %s image", psz_name );
-        return VLC_EGENERIC;
+        msg_Err( p_this, "Unable to load %s image in %4.4s", psz_name,
+                 (const char *)&i_chroma );
+        return NULL;
     }
 
     msg_Dbg( p_this, "%s image has dim %d x %d (Y plane)", psz_name,
-             (*pp_pic)->p[Y_PLANE].i_visible_pitch,
-             (*pp_pic)->p[Y_PLANE].i_visible_lines );
+             p_pic->p[Y_PLANE].i_visible_pitch,
+             p_pic->p[Y_PLANE].i_visible_lines );
 
-    return VLC_SUCCESS;
+    return p_pic;
+}
+
+/* Same sequence as the POSIX rand() example, so that every run blends the
+ * same pictures */
+static uint8_t blendbench_Random( uint32_t *pi_seed )
+{
+    *pi_seed = *pi_seed * 1103515245 + 12345;
+    return *pi_seed >> 16;
+}
+
+/*****************************************************************************
+ * blendbench_NewImage: generates a picture filled with noise
+ *****************************************************************************
+ * The lower half of the blend image is fully transparent, as most of a
+ * subtitle picture is.
+ *****************************************************************************/
+static picture_t *blendbench_NewImage( filter_t *p_filter,
+                                       vlc_fourcc_t i_chroma, bool b_blend )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    video_format_t fmt;
+    uint32_t i_seed = 1;
+
+    memset( &fmt, 0, sizeof(video_format_t) );
+    video_format_Setup( &fmt, i_chroma, p_sys->i_width, p_sys->i_height,
+                        1, 1 );
+    if( i_chroma == VLC_CODEC_YUVP )
+        fmt.p_palette = &p_sys->palette;
+
+    picture_t *p_pic = picture_NewFromFormat( &fmt );
+    if( p_pic == NULL )
+    {
+        msg_Err( p_filter, "Unable to allocate a %4.4s image",
+                 (const char *)&i_chroma );
+        return NULL;
+    }
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        plane_t *p_plane = &p_pic->p[i];
+
+        for( int y = 0; y < p_plane->i_lines; y++ )
+            for( int x = 0; x < p_plane->i_pitch; x++ )
+                p_plane->p_pixels[y * p_plane->i_pitch + x] =
+                    blendbench_Random( &i_seed );
+    }
+    if( !b_blend )
+        return p_pic;
+
+    /* Entry 0 of the palette is the transparent one */
+    plane_t *p_plane = &p_pic->p[i_chroma == VLC_CODEC_YUVA ? A_PLANE : 0];
+    for( int y = p_plane->i_visible_lines / 2; y < p_plane->i_lines; y++ )
+    {
+        uint8_t *p_line = &p_plane->p_pixels[y * p_plane->i_pitch];
+
+        if( i_chroma == VLC_CODEC_RGBA )
+            for( int x = 3; x < p_plane->i_pitch; x += 4 )
+                p_line[x] = 0;
+        else
+            memset( p_line, 0, p_plane->i_pitch );
+    }
+    return p_pic;
+}
+
+static picture_t *blendbench_GetImage( filter_t *p_filter,
+                                       vlc_fourcc_t i_chroma,
+                                       const char *psz_file, bool b_blend )
+{
+    if( psz_file != NULL && *psz_file != '\0' )
+        return blendbench_LoadImage( VLC_OBJECT(p_filter), i_chroma, psz_file,
+                                     b_blend ? "Blend" : "Base" );
+    return blendbench_NewImage( p_filter, i_chroma, b_blend );
+}
+
+/*****************************************************************************
+ * blendbench_Checksum: hashes the visible part of a picture
+ *****************************************************************************
+ * Two kernels for the same chromas must give the same checksum.
+ *****************************************************************************/
+static uint32_t blendbench_Checksum( const picture_t *p_pic )
+{
+    uint32_t i_sum = 0;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p_plane = &p_pic->p[i];
+
+        for( int y = 0; y < p_plane->i_visible_lines; y++ )
+            for( int x = 0; x < p_plane->i_visible_pitch; x++ )
+                i_sum = i_sum * 31 + p_plane->p_pixels[y * p_plane->i_pitch + x];
+    }
+    return i_sum;
+}
+
+/*****************************************************************************
+ * blendbench_Run: times the blending of one chroma onto another
+ *****************************************************************************/
+static void blendbench_Run( filter_t *p_filter, picture_t *p_base,
+                            picture_t *p_blend )
+{
+    filter_sys_t *p_sys = p_filter->p_sys;
+    const vlc_fourcc_t i_base = p_base->format.i_chroma;
+    const vlc_fourcc_t i_src = p_blend->format.i_chroma;
+
+    filter_t *p_blender = vlc_object_create( p_filter, sizeof(filter_t) );
+    if( !p_blender )
+        return;
+    p_blender->fmt_out.video = p_base->format;
+    p_blender->fmt_in.video = p_blend->format;
+    p_blender->p_module = module_need( p_blender, "video blending", NULL,
+                                       false );
+    if( !p_blender->p_module )
+    {
+        msg_Warn( p_filter, "%4.4s onto %4.4s: not supported",
+                  (const char *)&i_src, (const char *)&i_base );
+        vlc_object_release( p_blender );
+        return;
+    }
+
+    /* A first blend warms the caches up */
+    p_blender->pf_video_blend( p_blender, p_base, p_blend, 0, 0,
+                               p_sys->i_alpha );
+
+    mtime_t time = mdate();
+    for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+    {
+        p_blender->pf_video_blend( p_blender, p_base, p_blend, 0, 0,
+                                   p_sys->i_alpha );
+    }
+    time = mdate() - time;
+    if( time <= 0 )
+        time = 1;
+
+    const double f_pixels =
+        (double)__MIN( p_base->format.i_visible_width,
+                       p_blend->format.i_visible_width ) *
+                __MIN( p_base->format.i_visible_height,
+                       p_blend->format.i_visible_height );
+    const double f_rate = (double)p_sys->i_loops / time * 1000000;
+
+    msg_Info( p_filter, "%4.4s onto %4.4s: %d images in %f sec, "
+              "%f images/second, %f Mpixels/second, checksum %08"PRIx32,
+              (const char *)&i_src, (const char *)&i_base, p_sys->i_loops,
+              time / 1000000.0, f_rate, f_rate * f_pixels / 1000000,
+              blendbench_Checksum( p_base ) );
+
+    module_unneed( p_blender, p_blender->p_module );
+    vlc_object_release( p_blender );
+}
+
+/* Returns the next chroma of a comma-separated list, 0 at the end */
+static vlc_fourcc_t blendbench_NextChroma( filter_t *p_filter,
+                                           const char **ppsz_list )
+{
+    const char *psz = *ppsz_list;
+
+    while( *psz != '\0' )
+    {
+        size_t i_len = strcspn( psz, "," );
+        char psz_name[i_len + 1];
+
+        memcpy( psz_name, psz, i_len );
+        psz_name[i_len] = '\0';
+        psz += i_len;
+        if( *psz == ',' )
+            psz++;
+        *ppsz_list = psz;
+
+        vlc_fourcc_t i_chroma =
+            vlc_fourcc_GetCodecFromString( VIDEO_ES, psz_name );
+        if( i_chroma != 0 )
+            return i_chroma;
+        if( i_len > 0 )
+            msg_Warn( p_filter, "unknown chroma %s", psz_name );
+    }
+    return 0;
 }
 
 /*****************************************************************************
@@ -152,8 +355,6 @@ static int Create( vlc_object_t *p_this )
 {
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys;
-    char *psz_temp, *psz_cmd;
-    int i_ret;
 
     /* Allocate structure */
     p_filter->p_sys = malloc( sizeof( filter_sys_t ) );
@@ -174,30 +375,34 @@ static int Create( vlc_object_t *p_this )
                                                   CFG_PREFIX "loops" );
     p_sys->i_alpha = var_CreateGetIntegerCommand( p_filter,
                                                   CFG_PREFIX "alpha" );
-
-    psz_temp = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-chroma" );
-    p_sys->i_base_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
-                                       psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "base-image" );
-    i_ret = blendbench_LoadImage( p_this, &p_sys->p_base_image,
-                                  p_sys->i_base_chroma, psz_cmd, "Base" );
-    free( psz_temp );
-    free( psz_cmd );
-    if( i_ret != VLC_SUCCESS )
+    p_sys->i_width = var_CreateGetIntegerCommand( p_filter,
+                                                  CFG_PREFIX "width" );
+    p_sys->i_height = var_CreateGetIntegerCommand( p_filter,
+                                                   CFG_PREFIX "height" );
+    if( p_sys->i_width <= 0 || p_sys->i_height <= 0 )
     {
+        msg_Err( p_filter, "invalid image size %dx%d",
+                 p_sys->i_width, p_sys->i_height );
         free( p_sys );
-        return i_ret;
+        return VLC_EGENERIC;
     }
 
-    psz_temp = var_CreateGetStringCommand( p_filter,
-                                           CFG_PREFIX "blend-chroma" );
-    p_sys->i_blend_chroma = VLC_FOURCC( psz_temp[0], psz_temp[1],
-                                        psz_temp[2], psz_temp[3] );
-    psz_cmd = var_CreateGetStringCommand( p_filter, CFG_PREFIX "blend-image" );
-    blendbench_LoadImage( p_this, &p_sys->p_blend_image, p_sys->i_blend_chroma,
-                          psz_cmd, "Blend" );
-    free( psz_temp );
-    free( psz_cmd );
+    p_sys->psz_base_image = var_CreateGetStringCommand( p_filter,
+                                                 CFG_PREFIX "base-image" );
+    p_sys->psz_base_chromas = var_CreateGetStringCommand( p_filter,
+                                                 CFG_PREFIX "base-chroma" );
+    p_sys->psz_blend_image = var_CreateGetStringCommand( p_filter,
+                                                 CFG_PREFIX "blend-image" );
+    p_sys->psz_blend_chromas = var_CreateGetStringCommand( p_filter,
+                                                 CFG_PREFIX "blend-chroma" );
+
+    /* Entry 0 is transparent, the others have a random alpha */
+    uint32_t i_seed = 2;
+    p_sys->palette.i_entries = 256;
+    for( int i = 0; i < 256; i++ )
+        for( int j = 0; j < 4; j++ )
+            p_sys->palette.palette[i][j] = i ? blendbench_Random( &i_seed )
+                                             : 0;
 
     return VLC_SUCCESS;
 }
@@ -210,58 +415,53 @@ static void Destroy( vlc_object_t *p_this )
     filter_t *p_filter = (filter_t *)p_this;
     filter_sys_t *p_sys = p_filter->p_sys;
 
-    picture_Release( p_sys->p_base_image );
-    picture_Release( p_sys->p_blend_image );
+    free( p_sys->psz_base_image );
+    free( p_sys->psz_base_chromas );
+    free( p_sys->psz_blend_image );
+    free( p_sys->psz_blend_chromas );
+    free( p_sys );
 }
 
 /*****************************************************************************
- * Render: displays previously rendered output
+ * Render: runs the benchmark on the first picture, then passes pictures
+ * through
  *****************************************************************************/
 static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
 {
     filter_sys_t *p_sys = p_filter->p_sys;
-    filter_t *p_blend;
 
     if( p_sys->b_done )
         return p_pic;
+    p_sys->b_done = true;
 
-    p_blend = vlc_object_create( p_filter, sizeof(filter_t) );
-    if( !p_blend )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-    p_blend->fmt_out.video = p_sys->p_base_image->format;
-    p_blend->fmt_in.video = p_sys->p_blend_image->format;
-    p_blend->p_module = module_need( p_blend, "video blending", NULL, false );
-    if( !p_blend->p_module )
-    {
-        picture_Release( p_pic );
-        vlc_object_release( p_blend );
-        return NULL;
-    }
+    const char *psz_bases = *p_sys->psz_base_chromas
+                          ? p_sys->psz_base_chromas : psz_all_base_chromas;
+    vlc_fourcc_t i_base;
 
-    mtime_t time = mdate();
-    for( int i_iter = 0; i_iter < p_sys->i_loops; ++i_iter )
+    while( (i_base = blendbench_NextChroma( p_filter, &psz_bases )) != 0 )
     {
-        p_blend->pf_video_blend( p_blend,
-                                 p_sys->p_base_image, p_sys->p_blend_image,
-                                 0, 0, p_sys->i_alpha );
+        const char *psz_blends = *p_sys->psz_blend_chromas
+                               ? p_sys->psz_blend_chromas
+                               : psz_all_blend_chromas;
+        vlc_fourcc_t i_blend;
+
+        while( (i_blend = blendbench_NextChroma( p_filter, &psz_blends )) != 0 )
+        {
+            /* Every pair starts from the same base picture */
+            picture_t *p_base = blendbench_GetImage( p_filter, i_base,
+                                                     p_sys->psz_base_image,
+                                                     false );
+            picture_t *p_blend = blendbench_GetImage( p_filter, i_blend,
+                                                      p_sys->psz_blend_image,
+                                                      true );
+            if( p_base != NULL && p_blend != NULL )
+                blendbench_Run( p_filter, p_base, p_blend );
+            if( p_blend != NULL )
+                picture_Release( p_blend );
+            if( p_base != NULL )
+                picture_Release( p_base );
+        }
     }
-    time = mdate() - time;
-
-    msg_Info( p_filter, "Blended %d images in %f sec", p_sys->i_loops,
-              time / 1000000.0f );
-    msg_Info( p_filter, "Speed is: %f images/second, %f pixels/second",
-              (float) p_sys->i_loops / time * 1000000,
-              (float) p_sys->i_loops / time * 1000000 *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_pitch *
-                  p_sys->p_blend_image->p[Y_PLANE].i_visible_lines );
-
-    module_unneed( p_blend, p_blend->p_module );
 
-    vlc_object_release( p_blend );
-
-    p_sys->b_done = true;
     return p_pic;
 }
@@ -31,6 +31,9 @@
 
 #include <stdint.h>
 #include <assert.h>
+#ifdef HAVE_AVX2_INTRINSICS
+#   include <immintrin.h>
+#endif
 
 #include <vlc_common.h>
 #include <vlc_cpu.h>
@@ -245,6 +248,59 @@ static int TestForMotionInBlockMMX( uint8_t *p_pix_p, uint8_t *p_pix_c,
     return (i_motion >= 8);
 }
 #endif
+
+#ifdef HAVE_AVX2_INTRINSICS
+/**
+ * Same as TestForMotionInBlock(), but for four horizontally adjacent blocks
+ * at once. The results are the numbers of blocks (0 to 4) with motion.
+ */
+VLC_AVX2
+static int TestForMotionIn4BlocksAVX2( uint8_t *p_pix_p, uint8_t *p_pix_c,
+                                       int i_pitch_prev, int i_pitch_curr,
+                                       int* pi_top, int* pi_bot )
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one  = _mm256_set1_epi8( 1 );
+    const __m256i thr  = _mm256_set1_epi8( T );
+    __m256i top = zero;
+    __m256i bot = zero;
+
+    for( int y = 0; y < 8; ++y )
+    {
+        __m256i c = _mm256_loadu_si256( (const __m256i *)p_pix_c );
+        __m256i p = _mm256_loadu_si256( (const __m256i *)p_pix_p );
+        /* 1 where abs(c - p) > T, else 0 */
+        __m256i d = _mm256_or_si256( _mm256_subs_epu8( c, p ),
+                                     _mm256_subs_epu8( p, c ) );
+        d = _mm256_min_epu8( _mm256_subs_epu8( d, thr ), one );
+
+        if( y % 2 == 0 )
+            top = _mm256_add_epi8( top, d );
+        else
+            bot = _mm256_add_epi8( bot, d );
+
+        p_pix_c += i_pitch_curr;
+        p_pix_p += i_pitch_prev;
+    }
+
+    /* One sum per 8 pixels wide block */
+    uint64_t pi_top_motion[4], pi_bot_motion[4];
+    _mm256_storeu_si256( (__m256i *)pi_top_motion, _mm256_sad_epu8( top, zero ) );
+    _mm256_storeu_si256( (__m256i *)pi_bot_motion, _mm256_sad_epu8( bot, zero ) );
+
+    int i_motion = 0;
+    (*pi_top) = 0;
+    (*pi_bot) = 0;
+    for( int i = 0; i < 4; i++ )
+    {
+        /* Same thresholds as TestForMotionInBlock() */
+        (*pi_top) += ( pi_top_motion[i] >= 8 );
+        (*pi_bot) += ( pi_bot_motion[i] >= 8 );
+        i_motion  += ( pi_top_motion[i] + pi_bot_motion[i] >= 8 );
+    }
+    return i_motion;
+}
+#endif
 #undef T
 
 /*****************************************************************************
@@ -400,6 +456,18 @@ int EstimateNumBlocksWithMotion( const picture_t* p_prev,
         motion_in_block = TestForMotionInBlockMMX;
 #endif
 
+    /* Runs of four blocks, if the CPU can do them at once */
+    int (*motion_in_4_blocks)(uint8_t *, uint8_t *, int , int, int *, int *) =
+        NULL;
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+    {
+        motion_in_4_blocks = TestForMotionIn4BlocksAVX2;
+        /* The MMX version does not give the same results for the rest */
+        motion_in_block = TestForMotionInBlock;
+    }
+#endif
+
     int i_score = 0;
     for( int i_plane = 0 ; i_plane < p_prev->i_planes ; i_plane++ )
     {
@@ -423,7 +491,24 @@ int EstimateNumBlocksWithMotion( const picture_t* p_prev,
             uint8_t *p_pix_p = &p_prev->p[i_plane].p_pixels[i_pitch_prev*8*by];
             uint8_t *p_pix_c = &p_curr->p[i_plane].p_pixels[i_pitch_curr*8*by];
 
-            for( int bx = 0; bx < i_mbx; ++bx )
+            int bx = 0;
+            if( motion_in_4_blocks != NULL )
+            {
+                for( ; bx + 4 <= i_mbx; bx += 4 )
+                {
+                    int i_top_temp, i_bot_temp;
+                    i_score += motion_in_4_blocks( p_pix_p, p_pix_c,
+                                                   i_pitch_prev, i_pitch_curr,
+                                                   &i_top_temp, &i_bot_temp );
+                    i_score_top += i_top_temp;
+                    i_score_bot += i_bot_temp;
+
+                    p_pix_p += 32;
+                    p_pix_c += 32;
+                }
+            }
+
+            for( ; bx < i_mbx; ++bx )
             {
                 int i_top_temp, i_bot_temp;
                 i_score += motion_in_block( p_pix_p, p_pix_c,
@@ -582,6 +667,86 @@ static int CalculateInterlaceScoreMMX( const picture_t* p_pic_top,
 }
 #endif
 
+/**
+ * Counts the pixels of the line p_c where the comb metric is above T,
+ * p_p and p_n being the lines above and below.
+ */
+static int32_t InterlaceScoreLine( const uint8_t *p_c, const uint8_t *p_p,
+                                   const uint8_t *p_n, int w )
+{
+    int32_t i_score = 0;
+
+    for( int x = 0; x < w; ++x )
+    {
+        /* Worst case: need 17 bits for "comb". */
+        int_fast32_t C = *p_c;
+        int_fast32_t P = *p_p;
+        int_fast32_t N = *p_n;
+
+        /* Comments in Transcode's filter_ivtc.c attribute this
+           combing metric to Gunnar Thalin.
+
+            The idea is that if the picture is interlaced, both
+            expressions will have the same sign, and this comes
+            up positive. The value T = 100 has been chosen such
+            that a pixel difference of 10 (on average) will
+            trigger the detector.
+        */
+        int_fast32_t comb = (P - C) * (N - C);
+        if( comb > T )
+            ++i_score;
+
+        ++p_c;
+        ++p_p;
+        ++p_n;
+    }
+    return i_score;
+}
+
+#ifdef HAVE_AVX2_INTRINSICS
+/**
+ * Same as InterlaceScoreLine(), 16 pixels at a time.
+ */
+VLC_AVX2
+static int32_t InterlaceScoreLineAVX2( const uint8_t *p_c, const uint8_t *p_p,
+                                       const uint8_t *p_n, int w )
+{
+    const __m256i thr = _mm256_set1_epi16( T + 1 );
+    const __m256i all = _mm256_set1_epi16( -1 );
+    __m256i acc = _mm256_setzero_si256();
+    int32_t i_score;
+    int x = 0;
+
+    /* Each lane of acc counts up to w / 16 */
+    for( ; x + 16 <= w; x += 16 )
+    {
+        __m256i C = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)&p_c[x] ) );
+        __m256i P = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)&p_p[x] ) );
+        __m256i N = _mm256_cvtepu8_epi16( _mm_loadu_si128( (const __m128i *)&p_n[x] ) );
+        __m256i pc = _mm256_sub_epi16( P, C );
+        __m256i nc = _mm256_sub_epi16( N, C );
+
+        /* comb > T <=> same signs and abs(P - C) * abs(N - C) > T,
+           the product fitting in 16 unsigned bits */
+        __m256i prod = _mm256_mullo_epi16( _mm256_abs_epi16( pc ),
+                                           _mm256_abs_epi16( nc ) );
+        __m256i big  = _mm256_cmpeq_epi16( _mm256_max_epu16( prod, thr ), prod );
+        __m256i same = _mm256_cmpgt_epi16( _mm256_xor_si256( pc, nc ), all );
+        acc = _mm256_sub_epi16( acc, _mm256_and_si256( big, same ) );
+    }
+
+    /* Horizontal sum */
+    acc = _mm256_madd_epi16( acc, _mm256_set1_epi16( 1 ) );
+    __m128i sum = _mm_add_epi32( _mm256_castsi256_si128( acc ),
+                                 _mm256_extracti128_si256( acc, 1 ) );
+    sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, 0x4E ) );
+    sum = _mm_add_epi32( sum, _mm_shuffle_epi32( sum, 0xB1 ) );
+    i_score = _mm_cvtsi128_si32( sum );
+
+    return i_score + InterlaceScoreLine( &p_c[x], &p_p[x], &p_n[x], w - x );
+}
+#endif
+
 /* See header for function doc. */
 int CalculateInterlaceScore( const picture_t* p_pic_top,
                              const picture_t* p_pic_bot )
@@ -602,8 +767,14 @@ int CalculateInterlaceScore( const picture_t* p_pic_top,
     if( p_pic_top->i_planes != p_pic_bot->i_planes )
         return -1;
 
+    int32_t (*score_line)( const uint8_t *, const uint8_t *,
+                           const uint8_t *, int ) = InterlaceScoreLine;
+#ifdef HAVE_AVX2_INTRINSICS
+    if (vlc_CPU_AVX2())
+        score_line = InterlaceScoreLineAVX2;
+#endif
 #ifdef CAN_COMPILE_MMXEXT
-    if (vlc_CPU_MMXEXT())
+    if (score_line == InterlaceScoreLine && vlc_CPU_MMXEXT())
         return CalculateInterlaceScoreMMX( p_pic_top, p_pic_bot );
 #endif
 
@@ -636,30 +807,7 @@ int CalculateInterlaceScore( const picture_t* p_pic_top,
             uint8_t *p_p = &ngh->p[i_plane].p_pixels[(y-1)*wn]; /* prev line */
             uint8_t *p_n = &ngh->p[i_plane].p_pixels[(y+1)*wn]; /* next line */
 
-            for( int x = 0; x < w; ++x )
-            {
-                /* Worst case: need 17 bits for "comb". */
-                int_fast32_t C = *p_c;
-                int_fast32_t P = *p_p;
-                int_fast32_t N = *p_n;
-
-                /* Comments in Transcode's filter_ivtc.c attribute this
-                   combing metric to Gunnar Thalin.
-
-                    The idea is that if the picture is interlaced, both
-                    expressions will have the same sign, and this comes
-                    up positive. The value T = 100 has been chosen such
-                    that a pixel difference of 10 (on average) will
-                    trigger the detector.
-                */
-                int_fast32_t comb = (P - C) * (N - C);
-                if( comb > T )
-                    ++i_score;
-
-                ++p_c;
-                ++p_p;
-                ++p_n;
-            }
+            i_score += score_line( p_c, p_p, p_n, w );
 
             /* Now the other field - swap current and neighbour pictures */
             const picture_t *tmp = cur;
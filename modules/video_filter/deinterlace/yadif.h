@@ -145,3 +145,118 @@ static void yadif_filter_line_c_16bit(uint16_t *dst, uint16_t *prev, uint16_t *c
     prefs /= 2;
     FILTER
 }
+
+#if defined(HAVE_AVX2_INTRINSICS)
+// ================ AVX2 ================
+/* Same computations as FILTER, 16 pixels at a time in 16-bit lanes.
+   Unlike the assembly versions above, it is bit-exact with the C version
+   and does not write past w. */
+#define HAVE_YADIF_AVX2
+#include <immintrin.h>
+
+#define LOAD_AVX2(p) _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(p)))
+#define ABSDIFF_AVX2(a,b) _mm256_abs_epi16(_mm256_sub_epi16(a, b))
+
+/* CHECK(j): returns the lanes where the score of direction j was better,
+   among the lanes given by valid */
+VLC_AVX2
+static inline __m256i yadif_check_avx2(const uint8_t *cur, int prefs, int mrefs,
+                                       int j, __m256i *spatial_score,
+                                       __m256i *spatial_pred, __m256i valid)
+{
+    __m256i a = LOAD_AVX2(&cur[mrefs + j]);
+    __m256i b = LOAD_AVX2(&cur[prefs - j]);
+    __m256i score = _mm256_add_epi16(
+        _mm256_add_epi16(ABSDIFF_AVX2(LOAD_AVX2(&cur[mrefs - 1 + j]),
+                                      LOAD_AVX2(&cur[prefs - 1 - j])),
+                         ABSDIFF_AVX2(a, b)),
+        ABSDIFF_AVX2(LOAD_AVX2(&cur[mrefs + 1 + j]),
+                     LOAD_AVX2(&cur[prefs + 1 - j])));
+    __m256i better = _mm256_and_si256(_mm256_cmpgt_epi16(*spatial_score, score),
+                                      valid);
+
+    *spatial_score = _mm256_blendv_epi8(*spatial_score, score, better);
+    *spatial_pred = _mm256_blendv_epi8(*spatial_pred,
+                        _mm256_srli_epi16(_mm256_add_epi16(a, b), 1), better);
+    return better;
+}
+
+VLC_AVX2
+static void yadif_filter_line_avx2(uint8_t *dst, uint8_t *prev, uint8_t *cur, uint8_t *next, int w, int prefs, int mrefs, int parity, int mode) {
+    uint8_t *prev2= parity ? prev : cur ;
+    uint8_t *next2= parity ? cur  : next;
+    const __m256i all = _mm256_set1_epi16(-1);
+    int x;
+
+    for (x = 0; x + 16 <= w; x += 16) {
+        __m256i c = LOAD_AVX2(&cur[x + mrefs]);
+        __m256i e = LOAD_AVX2(&cur[x + prefs]);
+        __m256i p2 = LOAD_AVX2(&prev2[x]);
+        __m256i n2 = LOAD_AVX2(&next2[x]);
+        __m256i d = _mm256_srli_epi16(_mm256_add_epi16(p2, n2), 1);
+        __m256i temporal_diff0 = ABSDIFF_AVX2(p2, n2);
+        __m256i temporal_diff1 = _mm256_srli_epi16(_mm256_add_epi16(
+                ABSDIFF_AVX2(LOAD_AVX2(&prev[x + mrefs]), c),
+                ABSDIFF_AVX2(LOAD_AVX2(&prev[x + prefs]), e)), 1);
+        __m256i temporal_diff2 = _mm256_srli_epi16(_mm256_add_epi16(
+                ABSDIFF_AVX2(LOAD_AVX2(&next[x + mrefs]), c),
+                ABSDIFF_AVX2(LOAD_AVX2(&next[x + prefs]), e)), 1);
+        __m256i diff = _mm256_max_epi16(_mm256_max_epi16(
+                _mm256_srli_epi16(temporal_diff0, 1), temporal_diff1),
+                temporal_diff2);
+        __m256i spatial_pred = _mm256_srli_epi16(_mm256_add_epi16(c, e), 1);
+        __m256i spatial_score = _mm256_add_epi16(_mm256_add_epi16(
+                ABSDIFF_AVX2(LOAD_AVX2(&cur[x + mrefs - 1]),
+                             LOAD_AVX2(&cur[x + prefs - 1])),
+                ABSDIFF_AVX2(c, e)),
+                ABSDIFF_AVX2(LOAD_AVX2(&cur[x + mrefs + 1]),
+                             LOAD_AVX2(&cur[x + prefs + 1])));
+        spatial_score = _mm256_add_epi16(spatial_score, all); /* - 1 */
+
+        __m256i better;
+        better = yadif_check_avx2(&cur[x], prefs, mrefs, -1,
+                                  &spatial_score, &spatial_pred, all);
+        yadif_check_avx2(&cur[x], prefs, mrefs, -2,
+                         &spatial_score, &spatial_pred, better);
+        better = yadif_check_avx2(&cur[x], prefs, mrefs, 1,
+                                  &spatial_score, &spatial_pred, all);
+        yadif_check_avx2(&cur[x], prefs, mrefs, 2,
+                         &spatial_score, &spatial_pred, better);
+
+        if (mode < 2) {
+            __m256i b = _mm256_srli_epi16(_mm256_add_epi16(
+                    LOAD_AVX2(&prev2[x + 2 * mrefs]),
+                    LOAD_AVX2(&next2[x + 2 * mrefs])), 1);
+            __m256i f = _mm256_srli_epi16(_mm256_add_epi16(
+                    LOAD_AVX2(&prev2[x + 2 * prefs]),
+                    LOAD_AVX2(&next2[x + 2 * prefs])), 1);
+            __m256i dc = _mm256_sub_epi16(d, c);
+            __m256i de = _mm256_sub_epi16(d, e);
+            __m256i bc = _mm256_sub_epi16(b, c);
+            __m256i fe = _mm256_sub_epi16(f, e);
+            __m256i max = _mm256_max_epi16(_mm256_max_epi16(de, dc),
+                                           _mm256_min_epi16(bc, fe));
+            __m256i min = _mm256_min_epi16(_mm256_min_epi16(de, dc),
+                                           _mm256_max_epi16(bc, fe));
+
+            diff = _mm256_max_epi16(_mm256_max_epi16(diff, min),
+                                    _mm256_sub_epi16(_mm256_setzero_si256(), max));
+        }
+
+        /* diff is never negative, so this is the same as the C clipping */
+        spatial_pred = _mm256_min_epi16(spatial_pred, _mm256_add_epi16(d, diff));
+        spatial_pred = _mm256_max_epi16(spatial_pred, _mm256_sub_epi16(d, diff));
+
+        spatial_pred = _mm256_permute4x64_epi64(
+                _mm256_packus_epi16(spatial_pred, spatial_pred), 0xD8);
+        _mm_storeu_si128((__m128i *)&dst[x],
+                         _mm256_castsi256_si128(spatial_pred));
+    }
+
+    if (x < w)
+        yadif_filter_line_c(dst + x, prev + x, cur + x, next + x, w - x,
+                            prefs, mrefs, parity, mode);
+}
+#undef LOAD_AVX2
+#undef ABSDIFF_AVX2
+#endif
@@ -160,17 +160,13 @@ static void Destroy( vlc_object_t *p_this )
     free( p_sys );
 }
 
-/*****************************************************************************
- * Render: displays previously rendered output
- *****************************************************************************
- * This function send the currently rendered image to Invert image, waits
- * until it is displayed and switch the two rendering buffers, preparing next
- * frame.
- *****************************************************************************/
-static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+/* Sharpens the luma lines of one slice of the picture */
+static void FilterSlice( filter_t *p_filter, void *p_data,
+                         unsigned i_slice, unsigned i_slices )
 {
-    picture_t *p_outpic;
-    int i, j;
+    picture_t **pp_pics = p_data;
+    picture_t *p_pic = pp_pics[0], *p_outpic = pp_pics[1];
+    int i, j, i_first, i_end;
     uint8_t *p_src = NULL;
     uint8_t *p_out = NULL;
     int i_src_pitch;
@@ -179,15 +175,6 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     const int v1 = -1;
     const int v2 = 3; /* 2^3 = 8 */
 
-    if( !p_pic ) return NULL;
-
-    p_outpic = filter_NewPicture( p_filter );
-    if( !p_outpic )
-    {
-        picture_Release( p_pic );
-        return NULL;
-    }
-
     /* process the Y plane */
     p_src = p_pic->p[Y_PLANE].p_pixels;
     p_out = p_outpic->p[Y_PLANE].p_pixels;
@@ -195,8 +182,10 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
     i_out_pitch = p_outpic->p[Y_PLANE].i_pitch;
 
     /* perform convolution only on Y plane. Avoid border line. */
-    vlc_mutex_lock( &p_filter->p_sys->lock );
-    for( i = 0; i < p_pic->p[Y_PLANE].i_visible_lines; i++ )
+    filter_GetSliceLines( i_slice, i_slices,
+                          p_pic->p[Y_PLANE].i_visible_lines, 1,
+                          &i_first, &i_end );
+    for( i = i_first; i < i_end; i++ )
     {
         if( (i == 0) || (i == p_pic->p[Y_PLANE].i_visible_lines - 1) )
         {
@@ -227,6 +216,33 @@ static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
                p_filter->p_sys->tab_precalc[pix + 256] );
         }
     }
+}
+
+/*****************************************************************************
+ * Render: displays previously rendered output
+ *****************************************************************************
+ * This function send the currently rendered image to Invert image, waits
+ * until it is displayed and switch the two rendering buffers, preparing next
+ * frame.
+ *****************************************************************************/
+static picture_t *Filter( filter_t *p_filter, picture_t *p_pic )
+{
+    picture_t *p_outpic;
+
+    if( !p_pic ) return NULL;
+
+    p_outpic = filter_NewPicture( p_filter );
+    if( !p_outpic )
+    {
+        picture_Release( p_pic );
+        return NULL;
+    }
+
+    /* The slices only read the table, while the lock is held here */
+    picture_t *pp_pics[2] = { p_pic, p_outpic };
+    vlc_mutex_lock( &p_filter->p_sys->lock );
+    filter_RunSlices( p_filter, FilterSlice, pp_pics,
+                      p_pic->p[Y_PLANE].i_visible_lines );
     vlc_mutex_unlock( &p_filter->p_sys->lock );
 
     plane_CopyPixels( &p_outpic->p[U_PLANE], &p_pic->p[U_PLANE] );
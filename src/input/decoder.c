@@ -384,6 +384,11 @@ void input_DecoderDecode( decoder_t *p_dec, block_t *p_block, bool b_do_pace )
 {
     decoder_owner_sys_t *p_owner = p_dec->p_owner;
 
+    /* Decoders and packetizers may modify their input in place */
+    p_block = block_Writable( p_block );
+    if( p_block == NULL )
+        return;
+
     if( b_do_pace )
     {
         /* The fifo is not consummed when buffering and so will
@@ -786,7 +791,8 @@ static decoder_t * CreateDecoder( vlc_object_t *p_parent,
     p_owner->b_packetizer = b_packetizer;
 
     /* decoder fifo */
-    p_owner->p_fifo = block_FifoNew();
+    /* Only the input thread feeds the decoder thread */
+    p_owner->p_fifo = block_FifoNewSPSC();
     if( unlikely(p_owner->p_fifo == NULL) )
     {
         free( p_owner );
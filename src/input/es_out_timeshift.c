@@ -62,12 +62,16 @@
 #   define attribute_packed
 #endif
 
+/* Minimal duration between two sync points of the index */
+#define TS_INDEX_INTERVAL (CLOCK_FREQ/4)
+
 enum
 {
     C_ADD,
     C_SEND,
     C_DEL,
     C_CONTROL,
+    C_NONE,     /* Already played command that cannot be played again */
 };
 
 typedef struct attribute_packed
@@ -156,6 +160,7 @@ typedef struct ts_storage_t ts_storage_t;
 struct ts_storage_t
 {
     ts_storage_t *p_next;
+    int64_t      i_number; /* Creation order */
 
     /* */
     char    *psz_file;  /* Filename */
@@ -171,12 +176,22 @@ struct ts_storage_t
     ts_cmd_t *p_cmd;
 };
 
+/* A command where playback can restart: a key frame or, for streams that
+ * do not flag them, a PCR */
+typedef struct
+{
+    ts_storage_t *p_storage;
+    int          i_cmd;
+    mtime_t      i_date;
+} ts_index_t;
+
 typedef struct
 {
     vlc_thread_t   thread;
     input_thread_t *p_input;
     es_out_t       *p_out;
     int64_t        i_tmp_size_max;
+    int64_t        i_window_size_max;
     const char     *psz_tmp_path;
 
     /* Lock for all following fields */
@@ -197,11 +212,27 @@ typedef struct
     mtime_t        i_buffering_delay;
 
     /* */
+    ts_storage_t   *p_storage_first;
     ts_storage_t   *p_storage_r;
     ts_storage_t   *p_storage_w;
+    int64_t        i_storage_size;
 
     mtime_t        i_cmd_delay;
 
+    /* Last played time, and the date of its command */
+    mtime_t        i_time;
+    mtime_t        i_time_date;
+
+    /* Sync points of the kept storages, by increasing date */
+    int            i_index;
+    int            i_index_max;
+    ts_index_t     *p_index;
+    bool           b_index_key;
+
+    /* Pending seek, done by the timeshift thread */
+    bool           b_seek;
+    ts_index_t     seek;
+
 } ts_thread_t;
 
 struct es_out_id_t
@@ -216,6 +247,7 @@ struct es_out_sys_t
 
     /* Configuration */
     int64_t        i_tmp_size_max;    /* Maximal temporary file size in byte */
+    int64_t        i_window_size_max; /* Maximal size of the played data kept in byte */
     char           *psz_tmp_path;     /* Path for temporary files */
 
     /* Lock for all following fields */
@@ -252,6 +284,7 @@ static bool         TsHasCmd( ts_thread_t * );
 static bool         TsIsUnused( ts_thread_t * );
 static int          TsChangePause( ts_thread_t *, bool b_source_paused, bool b_paused, mtime_t i_date );
 static int          TsChangeRate( ts_thread_t *, int i_src_rate, int i_rate );
+static int          TsSeek( ts_thread_t *, mtime_t i_time );
 
 static void         *TsRun( void * );
 
@@ -281,6 +314,7 @@ static void CmdExecuteAdd    ( es_out_t *, ts_cmd_t * );
 static int  CmdExecuteSend   ( es_out_t *, ts_cmd_t * );
 static void CmdExecuteDel    ( es_out_t *, ts_cmd_t * );
 static int  CmdExecuteControl( es_out_t *, ts_cmd_t * );
+static bool CmdIsReplayable  ( const ts_cmd_t * );
 
 /* File helpers */
 static char *GetTmpPath( char *psz_path );
@@ -338,6 +372,20 @@ es_out_t *input_EsOutTimeshiftNew( input_thread_t *p_input, es_out_t *p_next_out
     msg_Dbg( p_input, "using timeshift granularity of %d MiB, in path '%s'",
              (int)p_sys->i_tmp_size_max/(1024*1024), p_sys->psz_tmp_path );
 
+    /* With a window, live streams are always recorded and the played data
+     * is kept in a ring of temporary files */
+    const int64_t i_window_size_max = var_CreateGetInteger( p_input, "input-timeshift-window" );
+    if( i_window_size_max > 0 )
+    {
+        p_sys->i_window_size_max = __MAX( i_window_size_max, 2 * p_sys->i_tmp_size_max );
+        msg_Dbg( p_input, "using a timeshift window of %"PRId64" MiB",
+                 p_sys->i_window_size_max/(1024*1024) );
+    }
+    else
+    {
+        p_sys->i_window_size_max = 0;
+    }
+
 #if 0
 #define S(t) msg_Err( p_input, "SIZEOF("#t")=%d", sizeof(t) )
     S(ts_cmd_t);
@@ -415,6 +463,10 @@ static int Send( es_out_t *p_out, es_out_id_t *p_es, block_t *p_block )
 
     TsAutoStop( p_out );
 
+    if( !p_sys->b_delayed && p_sys->i_window_size_max > 0 &&
+        !p_sys->p_input->p->b_can_pace_control )
+        TsStart( p_out );
+
     CmdInitSend( &cmd, p_es, p_block );
     if( p_sys->b_delayed )
         TsPushCmd( p_sys->p_ts, &cmd );
@@ -559,10 +611,17 @@ static int ControlLockedSetTime( es_out_t *p_out, mtime_t i_date )
     es_out_sys_t *p_sys = p_out->p_sys;
 
     if( !p_sys->b_delayed )
+    {
+        /* Only a timeshift window can be moved into */
+        if( i_date >= 0 )
+            return VLC_EGENERIC;
         return es_out_SetTime( p_sys->p_out, i_date );
+    }
+
+    if( i_date >= 0 )
+        return TsSeek( p_sys->p_ts, i_date );
 
-    /* TODO */
-    msg_Err( p_sys->p_input, "EsOutTimeshift does not yet support time change" );
+    msg_Err( p_sys->p_input, "EsOutTimeshift does not support time change of the source" );
     return VLC_EGENERIC;
 }
 static int ControlLockedSetFrameNext( es_out_t *p_out )
@@ -743,6 +802,7 @@ static int TsStart( es_out_t *p_out )
         return VLC_EGENERIC;
 
     p_ts->i_tmp_size_max = p_sys->i_tmp_size_max;
+    p_ts->i_window_size_max = p_sys->i_window_size_max;
     p_ts->psz_tmp_path = p_sys->psz_tmp_path;
     p_ts->p_input = p_sys->p_input;
     p_ts->p_out = p_sys->p_out;
@@ -756,8 +816,17 @@ static int TsStart( es_out_t *p_out )
     p_ts->i_rate_delay = 0;
     p_ts->i_buffering_delay = 0;
     p_ts->i_cmd_delay = 0;
+    p_ts->p_storage_first = NULL;
     p_ts->p_storage_r = NULL;
     p_ts->p_storage_w = NULL;
+    p_ts->i_storage_size = 0;
+    p_ts->i_index = 0;
+    p_ts->i_index_max = 0;
+    p_ts->p_index = NULL;
+    p_ts->b_index_key = false;
+    p_ts->b_seek = false;
+    p_ts->i_time = -1;
+    p_ts->i_time_date = -1;
 
     p_sys->b_delayed = true;
     if( vlc_clone( &p_ts->thread, TsRun, p_ts, VLC_THREAD_PRIORITY_INPUT ) )
@@ -800,12 +869,65 @@ static void TsStop( ts_thread_t *p_ts )
         CmdClean( &cmd );
     }
     assert( !p_ts->p_storage_r || !p_ts->p_storage_r->p_next );
-    if( p_ts->p_storage_r )
-        TsStorageDelete( p_ts->p_storage_r );
+    while( p_ts->p_storage_first )
+    {
+        ts_storage_t *p_next = p_ts->p_storage_first->p_next;
+
+        TsStorageDelete( p_ts->p_storage_first );
+        p_ts->p_storage_first = p_next;
+    }
+    free( p_ts->p_index );
     vlc_mutex_unlock( &p_ts->lock );
 
     TsDestroy( p_ts );
 }
+static bool TsIsSyncPointLocked( ts_thread_t *p_ts, const ts_cmd_t *p_cmd )
+{
+    if( p_cmd->i_type == C_SEND )
+    {
+        if( !p_cmd->u.send.p_block ||
+            !(p_cmd->u.send.p_block->i_flags & BLOCK_FLAG_TYPE_I) )
+            return false;
+
+        /* Only key frames will be used from now on */
+        p_ts->b_index_key = true;
+        return true;
+    }
+    return !p_ts->b_index_key && p_cmd->i_type == C_CONTROL &&
+           ( p_cmd->u.control.i_query == ES_OUT_SET_PCR ||
+             p_cmd->u.control.i_query == ES_OUT_SET_GROUP_PCR );
+}
+static void TsIndexCmdLocked( ts_thread_t *p_ts, ts_storage_t *p_storage, int i_cmd, bool b_sync )
+{
+    const ts_cmd_t *p_cmd = &p_storage->p_cmd[i_cmd];
+
+    if( p_cmd->i_type == C_ADD || p_cmd->i_type == C_DEL ||
+        ( p_cmd->i_type == C_CONTROL && p_cmd->u.control.i_query == ES_OUT_SET_ES_FMT ) )
+    {
+        /* The older commands cannot be played again with the new set of
+         * ES, so playback cannot go back before this one */
+        p_ts->i_index = 0;
+        return;
+    }
+    if( !b_sync )
+        return;
+    if( p_ts->i_index > 0 &&
+        p_cmd->i_date < p_ts->p_index[p_ts->i_index-1].i_date + TS_INDEX_INTERVAL )
+        return;
+
+    if( p_ts->i_index >= p_ts->i_index_max )
+    {
+        const int i_max = __MAX( 2 * p_ts->i_index_max, 1024 );
+        ts_index_t *p_new = realloc( p_ts->p_index, i_max * sizeof(*p_new) );
+        if( !p_new )
+            return;
+        p_ts->p_index = p_new;
+        p_ts->i_index_max = i_max;
+    }
+    p_ts->p_index[p_ts->i_index++] = (ts_index_t){ .p_storage = p_storage,
+                                                   .i_cmd = i_cmd,
+                                                   .i_date = p_cmd->i_date };
+}
 static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 {
     vlc_mutex_lock( &p_ts->lock );
@@ -824,41 +946,72 @@ static void TsPushCmd( ts_thread_t *p_ts, ts_cmd_t *p_cmd )
 
         if( !p_ts->p_storage_w )
         {
-            p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
+            p_ts->p_storage_first = p_ts->p_storage_r = p_ts->p_storage_w = p_storage;
         }
         else
         {
             TsStoragePack( p_ts->p_storage_w );
+            /* It will be read without being written anymore */
+            fflush( p_ts->p_storage_w->p_filew );
+            p_storage->i_number = p_ts->p_storage_w->i_number + 1;
             p_ts->p_storage_w->p_next = p_storage;
             p_ts->p_storage_w = p_storage;
         }
     }
 
+    ts_storage_t *p_storage = p_ts->p_storage_w;
+    const int64_t i_file_size = p_storage->i_file_size;
+    const int i_cmd = p_storage->i_cmd_w;
+    const bool b_sync = p_ts->i_window_size_max > 0 &&
+                        TsIsSyncPointLocked( p_ts, p_cmd );
+
     /* TODO return error and warn the user (but only once) */
-    TsStoragePushCmd( p_ts->p_storage_w, p_cmd, p_ts->p_storage_r == p_ts->p_storage_w );
+    TsStoragePushCmd( p_storage, p_cmd, p_ts->p_storage_r == p_storage );
+
+    p_ts->i_storage_size += p_storage->i_file_size - i_file_size;
+    if( p_ts->i_window_size_max > 0 && p_storage->i_cmd_w > i_cmd )
+        TsIndexCmdLocked( p_ts, p_storage, i_cmd, b_sync );
 
     vlc_cond_signal( &p_ts->wait );
 
     vlc_mutex_unlock( &p_ts->lock );
 }
-static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
+static void TsNextStorageLocked( ts_thread_t *p_ts )
 {
-    vlc_assert_locked( &p_ts->lock );
-
-    if( TsStorageIsEmpty( p_ts->p_storage_r ) )
-        return VLC_EGENERIC;
-
-    TsStoragePopCmd( p_ts->p_storage_r, p_cmd, b_flush );
-
     while( p_ts->p_storage_r && TsStorageIsEmpty( p_ts->p_storage_r ) )
     {
         ts_storage_t *p_next = p_ts->p_storage_r->p_next;
         if( !p_next )
             break;
 
-        TsStorageDelete( p_ts->p_storage_r );
+        if( p_ts->i_window_size_max <= 0 )
+        {
+            assert( p_ts->p_storage_first == p_ts->p_storage_r );
+            p_ts->i_storage_size -= p_ts->p_storage_r->i_file_size;
+            TsStorageDelete( p_ts->p_storage_r );
+            p_ts->p_storage_first = p_next;
+        }
         p_ts->p_storage_r = p_next;
+        if( p_next == p_ts->p_storage_w )
+            fflush( p_next->p_filew );
     }
+}
+static int TsPopCmdLocked( ts_thread_t *p_ts, ts_cmd_t *p_cmd, bool b_flush )
+{
+    vlc_assert_locked( &p_ts->lock );
+
+    TsNextStorageLocked( p_ts );
+    if( TsStorageIsEmpty( p_ts->p_storage_r ) )
+        return VLC_EGENERIC;
+
+    ts_storage_t *p_storage = p_ts->p_storage_r;
+    TsStoragePopCmd( p_storage, p_cmd, b_flush );
+
+    /* The kept command must not use the data released once executed */
+    if( p_ts->i_window_size_max > 0 && !CmdIsReplayable( p_cmd ) )
+        p_storage->p_cmd[p_storage->i_cmd_r-1].i_type = C_NONE;
+
+    TsNextStorageLocked( p_ts );
 
     return VLC_SUCCESS;
 }
@@ -877,7 +1030,8 @@ static bool TsIsUnused( ts_thread_t *p_ts )
     bool b_unused;
 
     vlc_mutex_lock( &p_ts->lock );
-    b_unused = !p_ts->b_paused &&
+    b_unused = p_ts->i_window_size_max <= 0 &&
+               !p_ts->b_paused &&
                p_ts->i_rate == p_ts->i_rate_source &&
                TsStorageIsEmpty( p_ts->p_storage_r );
     vlc_mutex_unlock( &p_ts->lock );
@@ -934,6 +1088,179 @@ static int TsChangeRate( ts_thread_t *p_ts, int i_src_rate, int i_rate )
     return i_ret;
 }
 
+static mtime_t TsGetReadDateLocked( ts_thread_t *p_ts )
+{
+    TsNextStorageLocked( p_ts );
+
+    const ts_storage_t *p_storage = p_ts->p_storage_r;
+    if( !TsStorageIsEmpty( p_ts->p_storage_r ) )
+        return p_storage->p_cmd[p_storage->i_cmd_r].i_date;
+
+    /* Everything received was played */
+    p_storage = p_ts->p_storage_w;
+    if( p_storage && p_storage->i_cmd_w > 0 )
+        return p_storage->p_cmd[p_storage->i_cmd_w-1].i_date;
+    return mdate();
+}
+static bool TsIsAfterReadLocked( ts_thread_t *p_ts, const ts_index_t *p_position )
+{
+    const ts_storage_t *p_storage = p_ts->p_storage_r;
+
+    if( p_position->p_storage != p_storage )
+        return p_position->p_storage->i_number > p_storage->i_number;
+    return p_position->i_cmd > p_storage->i_cmd_r;
+}
+static int TsSeek( ts_thread_t *p_ts, mtime_t i_time )
+{
+    int i_ret = VLC_EGENERIC;
+
+    vlc_mutex_lock( &p_ts->lock );
+    if( p_ts->i_index > 0 && p_ts->i_time_date >= 0 )
+    {
+        const mtime_t i_date = p_ts->i_time_date + i_time - p_ts->i_time;
+
+        /* Find the last sync point before the requested date, or the first
+         * one when it is before the window */
+        int i_low = 0;
+        int i_high = p_ts->i_index;
+        while( i_high - i_low > 1 )
+        {
+            const int i_middle = (i_low + i_high) / 2;
+
+            if( p_ts->p_index[i_middle].i_date <= i_date )
+                i_low = i_middle;
+            else
+                i_high = i_middle;
+        }
+
+        /* Do not move the wrong way when the window does not go that far */
+        const ts_index_t *p_target = &p_ts->p_index[i_low];
+        if( TsIsAfterReadLocked( p_ts, p_target ) == (i_time > p_ts->i_time) )
+        {
+            p_ts->seek = *p_target;
+            p_ts->b_seek = true;
+            vlc_cond_signal( &p_ts->wait );
+            i_ret = VLC_SUCCESS;
+        }
+    }
+    vlc_mutex_unlock( &p_ts->lock );
+
+    return i_ret;
+}
+/* Moves forward up to the given command, only the commands changing the ES
+ * are executed */
+static void TsSkipLocked( ts_thread_t *p_ts, ts_storage_t *p_storage, int i_cmd )
+{
+    while( p_ts->p_storage_r != p_storage || p_ts->p_storage_r->i_cmd_r < i_cmd )
+    {
+        ts_cmd_t cmd;
+
+        if( TsPopCmdLocked( p_ts, &cmd, true ) )
+            break;
+
+        switch( cmd.i_type )
+        {
+        case C_ADD:
+            CmdExecuteAdd( p_ts->p_out, &cmd );
+            CmdCleanAdd( &cmd );
+            break;
+        case C_SEND:
+            CmdCleanSend( &cmd );
+            break;
+        case C_CONTROL:
+            switch( cmd.u.control.i_query )
+            {
+            case ES_OUT_SET_PCR:
+            case ES_OUT_SET_GROUP_PCR:
+            case ES_OUT_RESET_PCR:
+            case ES_OUT_SET_NEXT_DISPLAY_TIME:
+                break;
+            default:
+                CmdExecuteControl( p_ts->p_out, &cmd );
+                break;
+            }
+            CmdCleanControl( &cmd );
+            break;
+        case C_DEL:
+            CmdExecuteDel( p_ts->p_out, &cmd );
+            break;
+        default:
+            break;
+        }
+    }
+}
+static void TsSeekLocked( ts_thread_t *p_ts, const ts_index_t *p_target )
+{
+    const mtime_t i_date = TsGetReadDateLocked( p_ts );
+
+    if( TsIsAfterReadLocked( p_ts, p_target ) )
+    {
+        TsSkipLocked( p_ts, p_target->p_storage, p_target->i_cmd );
+    }
+    else
+    {
+        /* All the following commands can be played again */
+        p_target->p_storage->i_cmd_r = p_target->i_cmd;
+        for( ts_storage_t *p = p_target->p_storage->p_next; p != NULL; p = p->p_next )
+            p->i_cmd_r = 0;
+
+        p_ts->p_storage_r = p_target->p_storage;
+        if( p_ts->p_storage_r == p_ts->p_storage_w )
+            fflush( p_ts->p_storage_w->p_filew );
+    }
+
+    /* Reset the decoders and clock, the new commands are due now */
+    es_out_SetTime( p_ts->p_out, -1 );
+
+    p_ts->i_cmd_delay += p_ts->i_rate_delay + i_date - p_target->i_date;
+    p_ts->i_rate_date = -1;
+    p_ts->i_rate_delay = 0;
+}
+/* Releases the oldest storages until the kept data fits in the window */
+static void TsTrimLocked( ts_thread_t *p_ts )
+{
+    while( p_ts->i_window_size_max > 0 &&
+           p_ts->i_storage_size > p_ts->i_window_size_max &&
+           p_ts->p_storage_first != p_ts->p_storage_w )
+    {
+        ts_storage_t *p_storage = p_ts->p_storage_first;
+
+        /* Its sync points are the first ones */
+        int i_index = 0;
+        while( i_index < p_ts->i_index && p_ts->p_index[i_index].p_storage == p_storage )
+            i_index++;
+
+        if( p_storage == p_ts->p_storage_r )
+        {
+            /* Playback fell behind the window (long pause), move it to the
+             * next sync point */
+            msg_Warn( p_ts->p_input, "es out timeshift: dropping data not played yet" );
+
+            ts_index_t next;
+            if( i_index < p_ts->i_index )
+            {
+                next = p_ts->p_index[i_index];
+            }
+            else
+            {
+                next.p_storage = p_storage->p_next;
+                next.i_cmd = 0;
+                next.i_date = next.p_storage->i_cmd_w > 0 ? next.p_storage->p_cmd[0].i_date
+                                                          : TsGetReadDateLocked( p_ts );
+            }
+            TsSeekLocked( p_ts, &next );
+        }
+
+        memmove( &p_ts->p_index[0], &p_ts->p_index[i_index],
+                 (p_ts->i_index - i_index) * sizeof(*p_ts->p_index) );
+        p_ts->i_index -= i_index;
+
+        p_ts->p_storage_first = p_storage->p_next;
+        p_ts->i_storage_size -= p_storage->i_file_size;
+        TsStorageDelete( p_storage );
+    }
+}
+
 static void *TsRun( void *p_data )
 {
     ts_thread_t *p_ts = p_data;
@@ -952,6 +1279,13 @@ static void *TsRun( void *p_data )
         for( ;; )
         {
             const int canc = vlc_savecancel();
+            if( p_ts->b_seek )
+            {
+                p_ts->b_seek = false;
+                TsSeekLocked( p_ts, &p_ts->seek );
+            }
+            TsTrimLocked( p_ts );
+
             b_buffering = es_out_GetBuffering( p_ts->p_out );
 
             if( ( !p_ts->b_paused || b_buffering ) && !TsPopCmdLocked( p_ts, &cmd, false ) )
@@ -964,6 +1298,12 @@ static void *TsRun( void *p_data )
             vlc_cond_wait( &p_ts->wait, &p_ts->lock );
         }
 
+        if( cmd.i_type == C_CONTROL && cmd.u.control.i_query == ES_OUT_SET_TIMES )
+        {
+            p_ts->i_time = cmd.u.control.u.times.i_time;
+            p_ts->i_time_date = cmd.i_date;
+        }
+
         if( b_buffering && i_buffering_date < 0 )
         {
             i_buffering_date = cmd.i_date;
@@ -1042,6 +1382,8 @@ static void *TsRun( void *p_data )
         case C_DEL:
             CmdExecuteDel( p_ts->p_out, &cmd );
             break;
+        case C_NONE:
+            break;
         default:
             assert(0);
             break;
@@ -1222,12 +1564,35 @@ static void CmdClean( ts_cmd_t *p_cmd )
         CmdCleanControl( p_cmd );
         break;
     case C_DEL:
+    case C_NONE:
         break;
     default:
         assert(0);
         break;
     }
 }
+static bool CmdIsReplayable( const ts_cmd_t *p_cmd )
+{
+    switch( p_cmd->i_type )
+    {
+    case C_SEND:
+        return true;
+    case C_CONTROL:
+        /* Their data is released once executed */
+        switch( p_cmd->u.control.i_query )
+        {
+        case ES_OUT_SET_GROUP_META:
+        case ES_OUT_SET_GROUP_EPG:
+        case ES_OUT_SET_META:
+        case ES_OUT_SET_ES_FMT:
+            return false;
+        default:
+            return true;
+        }
+    default:
+        return false;
+    }
+}
 
 static int CmdInitAdd( ts_cmd_t *p_cmd, es_out_id_t *p_es, const es_format_t *p_fmt, bool b_copy )
 {
@@ -181,29 +181,51 @@ int input_Read( vlc_object_t *p_parent, input_item_t *p_item )
     return VLC_SUCCESS;
 }
 
+static void PreparseTimeout( void *data )
+{
+    input_thread_t *p_input = data;
+
+    /* Again every second, for the objects created since the last time */
+    ObjectKillChildrens( p_input, VLC_OBJECT(p_input) );
+}
+
 /**
  * Initialize an input and initialize it to preparse the item
  * This function is blocking. It will only accept parsing regular files.
  *
  * \param p_parent a vlc_object_t
  * \param p_item an input item
- * \return VLC_SUCCESS or an error
+ * \param i_timeout delay after which the input is killed, or 0
+ * \return VLC_SUCCESS, VLC_ETIMEOUT or an error
  */
-int input_Preparse( vlc_object_t *p_parent, input_item_t *p_item )
+int input_Preparse( vlc_object_t *p_parent, input_item_t *p_item,
+                    mtime_t i_timeout )
 {
     input_thread_t *p_input;
+    vlc_timer_t timer;
+    bool b_timer = false;
 
     /* Allocate descriptor */
     p_input = Create( p_parent, p_item, NULL, true, NULL );
     if( !p_input )
         return VLC_EGENERIC;
 
+    if( i_timeout > 0 && !vlc_timer_create( &timer, PreparseTimeout, p_input ) )
+    {
+        vlc_timer_schedule( timer, false, i_timeout, CLOCK_FREQ );
+        b_timer = true;
+    }
+
     if( !Init( p_input ) )
         End( p_input );
 
+    if( b_timer )
+        vlc_timer_destroy( timer );
+    bool b_killed = !vlc_object_alive( p_input );
+
     vlc_object_release( p_input );
 
-    return VLC_SUCCESS;
+    return b_killed ? VLC_ETIMEOUT : VLC_SUCCESS;
 }
 
 /**
@@ -804,6 +826,8 @@ static void MainLoop( input_thread_t *p_input, bool b_interactive )
                     mtime_t i_current = mdate();
                     if( i_last_seek_mdate + INT64_C(125000) >= i_current )
                         i_limit = __MIN( i_deadline, i_current + INT64_C(20000) );
+                    else
+                        b_buffering = false; /* A timeshifted stream always buffers */
                 }
 
                 int i_type;
@@ -863,6 +887,10 @@ static void InitStatistics( input_thread_t * p_input )
         INIT_COUNTER( read_packets, COUNTER );
         INIT_COUNTER( demux_read, COUNTER );
         INIT_COUNTER( input_bitrate, DERIVATIVE );
+        INIT_COUNTER( cache_hits, COUNTER );
+        INIT_COUNTER( cache_misses, COUNTER );
+        INIT_COUNTER( cache_refills, COUNTER );
+        INIT_COUNTER( cache_refill_time, COUNTER );
         INIT_COUNTER( demux_bitrate, DERIVATIVE );
         INIT_COUNTER( demux_corrupted, COUNTER );
         INIT_COUNTER( demux_discontinuity, COUNTER );
@@ -1342,6 +1370,10 @@ error:
         EXIT_COUNTER( read_packets );
         EXIT_COUNTER( demux_read );
         EXIT_COUNTER( input_bitrate );
+        EXIT_COUNTER( cache_hits );
+        EXIT_COUNTER( cache_misses );
+        EXIT_COUNTER( cache_refills );
+        EXIT_COUNTER( cache_refill_time );
         EXIT_COUNTER( demux_bitrate );
         EXIT_COUNTER( demux_corrupted );
         EXIT_COUNTER( demux_discontinuity );
@@ -1415,6 +1447,10 @@ static void End( input_thread_t * p_input )
             CL_CO( read_packets );
             CL_CO( demux_read );
             CL_CO( input_bitrate );
+            CL_CO( cache_hits );
+            CL_CO( cache_misses );
+            CL_CO( cache_refills );
+            CL_CO( cache_refill_time );
             CL_CO( demux_bitrate );
             CL_CO( demux_corrupted );
             CL_CO( demux_discontinuity );
@@ -1742,6 +1778,14 @@ static bool Control( input_thread_t *p_input,
             if( i_time < 0 )
                 i_time = 0;
 
+            /* A live stream can still move inside its timeshift window */
+            if( !p_input->p->b_can_pace_control &&
+                !es_out_SetTime( p_input->p->p_es_out, i_time ) )
+            {
+                b_force_update = true;
+                break;
+            }
+
             /* Reset the decoders states and clock sync (before calling the demuxer */
             es_out_SetTime( p_input->p->p_es_out, -1 );
 
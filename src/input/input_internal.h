@@ -140,6 +140,10 @@ struct input_thread_private_t
         counter_t *p_read_packets;
         counter_t *p_read_bytes;
         counter_t *p_input_bitrate;
+        counter_t *p_cache_hits;
+        counter_t *p_cache_misses;
+        counter_t *p_cache_refills;
+        counter_t *p_cache_refill_time;
         counter_t *p_demux_read;
         counter_t *p_demux_bitrate;
         counter_t *p_demux_corrupted;
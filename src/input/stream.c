@@ -58,16 +58,23 @@
  *      It should probably defaulted (instead of the stream method (2)).
  */
 
-/* How many tracks we have, currently only used for stream mode */
+/* How many tracks we have, currently only used for stream mode.
+ * The number of tracks in use is adapted at runtime between 1 and
+ * STREAM_CACHE_TRACK_MAX depending on the seek pattern. */
 #ifdef OPTIMIZE_MEMORY
 #   define STREAM_CACHE_TRACK 1
-    /* Max size of our cache 128Ko per track */
+#   define STREAM_CACHE_TRACK_MAX 2
+    /* Default size of our cache 128Ko per track */
 #   define STREAM_CACHE_SIZE  (STREAM_CACHE_TRACK*1024*128)
 #else
 #   define STREAM_CACHE_TRACK 3
-    /* Max size of our cache 4Mo per track */
+#   define STREAM_CACHE_TRACK_MAX 8
+    /* Default size of our cache 4Mo per track */
 #   define STREAM_CACHE_SIZE  (4*STREAM_CACHE_TRACK*1024*1024)
 #endif
+/* Bounds of the user configurable cache size */
+#define STREAM_CACHE_SIZE_MIN (64*1024)
+#define STREAM_CACHE_SIZE_MAX (256*1024*1024)
 
 /* How many data we try to prebuffer
  * XXX it should be small to avoid useless latency but big enough for
@@ -80,20 +87,30 @@
  */
 
 /* Method2: A bit more complex, for pf_read
- *  - We use ring buffers, only one if unseekable, all if seekable
+ *  - We use ring buffers, only one if unseekable, several if seekable
  *  - Upon seek date current ring, then search if one ring match the pos,
  *      yes: switch to it, seek the access to match the end of the ring
  *      no: search the ring with i_end the closer to i_pos,
  *          if close enough, read data and use this ring
  *          else use the oldest ring, seek and use it.
+ *  - The cache is split in more (smaller) rings when hard seeks happen
+ *    after short sequential runs (random access, badly interleaved files)
+ *    and in less (bigger) rings when the access is mostly sequential.
+ *    The layout changes once enough hard seeks in a row voted for it, and
+ *    then drops what the other rings held.
+ *  - The read size follows the throughput measured on the access, so
+ *    fast local storage gets big reads and slow sources small ones.
  *
- *  TODO: - with access non seekable: use all space available for only one ring, but
- *          we have to support seekable/non-seekable switch on the fly.
- *        - compute a good value for i_read_size
- *        - ?
+ *  TODO: - we have to support seekable/non-seekable switch on the fly.
  */
 #define STREAM_READ_ATONCE 1024
-#define STREAM_CACHE_TRACK_SIZE (STREAM_CACHE_SIZE/STREAM_CACHE_TRACK)
+#define STREAM_READ_ATONCE_MAX (256*1024)
+/* Amount of time worth of data we try to get with each read */
+#define STREAM_READ_DURATION (CLOCK_FREQ/50)
+/* Number of consistent hard seek patterns before changing the tracks */
+#define STREAM_CACHE_TRACK_VOTES 3
+/* Tracks are never made smaller than this */
+#define STREAM_CACHE_TRACK_SIZE_MIN (512*1024)
 
 typedef struct
 {
@@ -127,6 +144,8 @@ struct stream_sys_t
 
     uint64_t     i_pos;      /* Current reading offset */
 
+    size_t       i_cache_size; /* Size of the cache for both methods */
+
     /* Method 1: pf_block */
     struct
     {
@@ -145,7 +164,9 @@ struct stream_sys_t
     {
         unsigned i_offset;   /* Buffer offset in the current track */
         int      i_tk;       /* Current track */
-        stream_track_t tk[STREAM_CACHE_TRACK];
+        int      i_tk_count; /* Number of tracks in use */
+        unsigned i_tk_size;  /* Size of each track */
+        stream_track_t tk[STREAM_CACHE_TRACK_MAX];
 
         /* Global buffer */
         uint8_t *p_buffer;
@@ -154,6 +175,11 @@ struct stream_sys_t
         unsigned i_used; /* Used since last read */
         unsigned i_read_size;
 
+        /* Access pattern */
+        uint64_t i_seq_bytes; /* Read since the last hard seek */
+        int      i_tk_vote;   /* >0 wants more tracks, <0 less */
+        uint64_t i_byterate;  /* Smoothed access throughput */
+
     } stream;
 
     /* Peek temporary buffer */
@@ -174,6 +200,11 @@ struct stream_sys_t
         unsigned i_seek_count;
         uint64_t i_seek_time;
 
+        /* Stat about cache usage */
+        unsigned i_hit_count;
+        unsigned i_miss_count;
+        unsigned i_refill_count;
+
     } stat;
 
     /* Streams list */
@@ -195,6 +226,9 @@ static int  AStreamReadStream( stream_t *s, void *p_read, unsigned int i_read );
 static int  AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int i_read );
 static int  AStreamSeekStream( stream_t *s, uint64_t i_pos );
 static void AStreamPrebufferStream( stream_t *s );
+static void AStreamSetupTracks( stream_t *s, int i_count );
+static int  AStreamTuneTracks( stream_t *s );
+static void AStreamTuneReadSize( stream_t *s, uint64_t i_bytes, mtime_t i_duration );
 static int  AReadStream( stream_t *s, void *p_read, unsigned int i_read );
 
 /* Common */
@@ -202,6 +236,8 @@ static int AStreamControl( stream_t *s, int i_query, va_list );
 static void AStreamDestroy( stream_t *s );
 static void UStreamDestroy( stream_t *s );
 static int  ASeek( stream_t *s, uint64_t i_pos );
+static void AStreamStatCache( stream_t *s, bool b_hit );
+static void AStreamStatRefill( stream_t *s, mtime_t i_duration );
 
 /****************************************************************************
  * stream_CommonNew: create an empty stream structure
@@ -315,6 +351,18 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
     p_sys->stat.i_read_count = 0;
     p_sys->stat.i_seek_count = 0;
     p_sys->stat.i_seek_time = 0;
+    p_sys->stat.i_hit_count = 0;
+    p_sys->stat.i_miss_count = 0;
+    p_sys->stat.i_refill_count = 0;
+
+    /* Cache size */
+    int64_t i_cache_size = var_InheritInteger( s, "stream-cache-size" );
+    if( i_cache_size > 0 )
+        p_sys->i_cache_size = VLC_CLIP( i_cache_size * 1024,
+                                        STREAM_CACHE_SIZE_MIN,
+                                        STREAM_CACHE_SIZE_MAX );
+    else
+        p_sys->i_cache_size = STREAM_CACHE_SIZE;
 
     TAB_INIT( p_sys->i_list, p_sys->list );
     p_sys->i_list_index = 0;
@@ -394,7 +442,7 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
     }
     else
     {
-        int i;
+        bool b_seek;
 
         assert( p_sys->method == STREAM_METHOD_STREAM );
 
@@ -404,9 +452,7 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
         s->pf_peek = AStreamPeekStream;
 
         /* Allocate/Setup our tracks */
-        p_sys->stream.i_offset = 0;
-        p_sys->stream.i_tk     = 0;
-        p_sys->stream.p_buffer = malloc( STREAM_CACHE_SIZE );
+        p_sys->stream.p_buffer = malloc( p_sys->i_cache_size );
         if( p_sys->stream.p_buffer == NULL )
             goto error;
         p_sys->stream.i_used   = 0;
@@ -414,15 +460,13 @@ stream_t *stream_AccessNew( access_t *p_access, char **ppsz_list )
 #if STREAM_READ_ATONCE < 256
 #   error "Invalid STREAM_READ_ATONCE value"
 #endif
+        p_sys->stream.i_seq_bytes = 0;
+        p_sys->stream.i_tk_vote = 0;
+        p_sys->stream.i_byterate = 0;
 
-        for( i = 0; i < STREAM_CACHE_TRACK; i++ )
-        {
-            p_sys->stream.tk[i].i_date  = 0;
-            p_sys->stream.tk[i].i_start = p_sys->i_pos;
-            p_sys->stream.tk[i].i_end   = p_sys->i_pos;
-            p_sys->stream.tk[i].p_buffer=
-                &p_sys->stream.p_buffer[i * STREAM_CACHE_TRACK_SIZE];
-        }
+        /* Without seek, only one track can ever be used */
+        access_Control( p_access, ACCESS_CAN_SEEK, &b_seek );
+        AStreamSetupTracks( s, b_seek ? STREAM_CACHE_TRACK : 1 );
 
         /* Do the prebuffering */
         AStreamPrebufferStream( s );
@@ -460,6 +504,15 @@ static void AStreamDestroy( stream_t *s )
 {
     stream_sys_t *p_sys = s->p_sys;
 
+    if( p_sys->stat.i_hit_count + p_sys->stat.i_miss_count > 0 )
+        msg_Dbg( s, "cache hit rate %u%% (%u/%u), %u refills in %"PRId64" ms",
+                 100 * p_sys->stat.i_hit_count /
+                     (p_sys->stat.i_hit_count + p_sys->stat.i_miss_count),
+                 p_sys->stat.i_hit_count,
+                 p_sys->stat.i_hit_count + p_sys->stat.i_miss_count,
+                 p_sys->stat.i_refill_count,
+                 p_sys->stat.i_read_time / 1000 );
+
     if( p_sys->method == STREAM_METHOD_BLOCK )
         block_ChainRelease( p_sys->block.p_first );
     else
@@ -515,21 +568,14 @@ static void AStreamControlReset( stream_t *s )
     }
     else
     {
-        int i;
-
         assert( p_sys->method == STREAM_METHOD_STREAM );
 
         /* Setup our tracks */
-        p_sys->stream.i_offset = 0;
-        p_sys->stream.i_tk     = 0;
         p_sys->stream.i_used   = 0;
+        p_sys->stream.i_seq_bytes = 0;
+        p_sys->stream.i_tk_vote = 0;
 
-        for( i = 0; i < STREAM_CACHE_TRACK; i++ )
-        {
-            p_sys->stream.tk[i].i_date  = 0;
-            p_sys->stream.tk[i].i_start = p_sys->i_pos;
-            p_sys->stream.tk[i].i_end   = p_sys->i_pos;
-        }
+        AStreamSetupTracks( s, p_sys->stream.i_tk_count );
 
         /* Do the prebuffering */
         AStreamPrebufferStream( s );
@@ -861,6 +907,7 @@ static int AStreamSeekBlock( stream_t *s, uint64_t i_pos )
         p_sys->block.i_offset = i_offset - i_current;
 
         p_sys->i_pos = i_pos;
+        AStreamStatCache( s, true );
 
         return VLC_SUCCESS;
     }
@@ -903,7 +950,7 @@ static int AStreamSeekBlock( stream_t *s, uint64_t i_pos )
             int i_th = b_aseekfast ? 1 : 5;
 
             if( i_skip <= i_th * i_avg &&
-                i_skip < STREAM_CACHE_SIZE )
+                (uint64_t)i_skip < p_sys->i_cache_size )
                 b_seek = false;
             else
                 b_seek = true;
@@ -939,10 +986,12 @@ static int AStreamSeekBlock( stream_t *s, uint64_t i_pos )
         /* Update stat */
         p_sys->stat.i_seek_time += i_end - i_start;
         p_sys->stat.i_seek_count++;
+        AStreamStatCache( s, false );
         return VLC_SUCCESS;
     }
     else
     {
+        AStreamStatCache( s, true );
         do
         {
             while( p_sys->block.p_current &&
@@ -975,7 +1024,7 @@ static int AStreamRefillBlock( stream_t *s )
     block_t      *b;
 
     /* Release data */
-    while( p_sys->block.i_size >= STREAM_CACHE_SIZE &&
+    while( p_sys->block.i_size >= p_sys->i_cache_size &&
            p_sys->block.p_first != p_sys->block.p_current )
     {
         block_t *b = p_sys->block.p_first;
@@ -986,7 +1035,7 @@ static int AStreamRefillBlock( stream_t *s )
 
         block_Release( b );
     }
-    if( p_sys->block.i_size >= STREAM_CACHE_SIZE &&
+    if( p_sys->block.i_size >= p_sys->i_cache_size &&
         p_sys->block.p_current == p_sys->block.p_first &&
         p_sys->block.p_current->p_next )    /* At least 2 packets */
     {
@@ -1010,7 +1059,9 @@ static int AStreamRefillBlock( stream_t *s )
             return VLC_EGENERIC;
     }
 
-    p_sys->stat.i_read_time += mdate() - i_start;
+    const mtime_t i_duration = mdate() - i_start;
+    p_sys->stat.i_read_time += i_duration;
+    AStreamStatRefill( s, i_duration );
     while( b )
     {
         /* Append the block */
@@ -1072,8 +1123,8 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
 #endif
 
     /* Avoid problem, but that should *never* happen */
-    if( i_read > STREAM_CACHE_TRACK_SIZE / 2 )
-        i_read = STREAM_CACHE_TRACK_SIZE / 2;
+    if( i_read > p_sys->stream.i_tk_size / 2 )
+        i_read = p_sys->stream.i_tk_size / 2;
 
     while( tk->i_end < tk->i_start + p_sys->stream.i_offset + i_read )
     {
@@ -1092,8 +1143,8 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
 
 
     /* Now, direct pointer or a copy ? */
-    i_off = (tk->i_start + p_sys->stream.i_offset) % STREAM_CACHE_TRACK_SIZE;
-    if( i_off + i_read <= STREAM_CACHE_TRACK_SIZE )
+    i_off = (tk->i_start + p_sys->stream.i_offset) % p_sys->stream.i_tk_size;
+    if( i_off + i_read <= p_sys->stream.i_tk_size )
     {
         *pp_peek = &tk->p_buffer[i_off];
         return i_read;
@@ -1111,9 +1162,9 @@ static int AStreamPeekStream( stream_t *s, const uint8_t **pp_peek, unsigned int
     }
 
     memcpy( p_sys->p_peek, &tk->p_buffer[i_off],
-            STREAM_CACHE_TRACK_SIZE - i_off );
-    memcpy( &p_sys->p_peek[STREAM_CACHE_TRACK_SIZE - i_off],
-            &tk->p_buffer[0], i_read - (STREAM_CACHE_TRACK_SIZE - i_off) );
+            p_sys->stream.i_tk_size - i_off );
+    memcpy( &p_sys->p_peek[p_sys->stream.i_tk_size - i_off],
+            &tk->p_buffer[0], i_read - (p_sys->stream.i_tk_size - i_off) );
 
     *pp_peek = p_sys->p_peek;
     return i_read;
@@ -1172,7 +1223,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     if( !tk )
     {
         /* Try to maximize already read data */
-        for( int i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             stream_track_t *t = &p_sys->stream.tk[i];
 
@@ -1189,7 +1240,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
     if( !tk )
     {
         /* Use the oldest unused */
-        for( int i = 0; i < STREAM_CACHE_TRACK; i++ )
+        for( int i = 0; i < p_sys->stream.i_tk_count; i++ )
         {
             stream_track_t *t = &p_sys->stream.tk[i];
 
@@ -1200,7 +1251,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
             }
         }
     }
-    assert( i_tk_idx >= 0 && i_tk_idx < STREAM_CACHE_TRACK );
+    assert( i_tk_idx >= 0 && i_tk_idx < p_sys->stream.i_tk_count );
 
     if( tk != p_current )
         i_skip_threshold = 0;
@@ -1212,6 +1263,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
                  i_tk_idx, tk->i_start, tk->i_end,
                  tk != p_current ? "seek" : i_pos > tk->i_end ? "skip" : "noseek" );
 #endif
+        AStreamStatCache( s, true );
         if( tk != p_current )
         {
             assert( b_aseek );
@@ -1227,7 +1279,7 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
             uint64_t i_skip = i_pos - tk->i_end;
             while( i_skip > 0 )
             {
-                const int i_read_max = __MIN( 10 * STREAM_READ_ATONCE, i_skip );
+                const int i_read_max = __MIN( 10 * p_sys->stream.i_read_size, i_skip );
                 if( AStreamReadNoSeekStream( s, NULL, i_read_max ) != i_read_max )
                     return VLC_EGENERIC;
                 i_skip -= i_read_max;
@@ -1242,9 +1294,22 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
         /* Nothing good, seek and choose oldest segment */
         if( ASeek( s, i_pos ) )
             return VLC_EGENERIC;
+        AStreamStatCache( s, false );
 
         tk->i_start = i_pos;
         tk->i_end   = i_pos;
+
+        /* Everything in this track is lost anyway, so this is the best
+         * time to change the tracks layout (the others are dropped) */
+        const int i_count = AStreamTuneTracks( s );
+        if( i_count != p_sys->stream.i_tk_count )
+        {
+            p_sys->i_pos = i_pos;
+            AStreamSetupTracks( s, i_count );
+            tk = &p_sys->stream.tk[0];
+            i_tk_idx = 0;
+        }
+        p_sys->stream.i_seq_bytes = 0;
     }
     p_sys->stream.i_offset = i_pos - tk->i_start;
     p_sys->stream.i_tk = i_tk_idx;
@@ -1257,8 +1322,8 @@ static int AStreamSeekStream( stream_t *s, uint64_t i_pos )
      */
     if( tk->i_end < tk->i_start + p_sys->stream.i_offset + p_sys->stream.i_read_size )
     {
-        if( p_sys->stream.i_used < STREAM_READ_ATONCE / 2 )
-            p_sys->stream.i_used = STREAM_READ_ATONCE / 2;
+        if( p_sys->stream.i_used < p_sys->stream.i_read_size / 2 )
+            p_sys->stream.i_used = p_sys->stream.i_read_size / 2;
 
         if( AStreamRefillStream( s ) && i_pos >= tk->i_end )
             return VLC_EGENERIC;
@@ -1286,10 +1351,10 @@ static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_re
 
     while( i_data < i_read )
     {
-        unsigned i_off = (tk->i_start + p_sys->stream.i_offset) % STREAM_CACHE_TRACK_SIZE;
+        unsigned i_off = (tk->i_start + p_sys->stream.i_offset) % p_sys->stream.i_tk_size;
         unsigned int i_current =
             __MIN( tk->i_end - tk->i_start - p_sys->stream.i_offset,
-                   STREAM_CACHE_TRACK_SIZE - i_off );
+                   p_sys->stream.i_tk_size - i_off );
         int i_copy = __MIN( i_current, i_read - i_data );
 
         if( i_copy <= 0 ) break; /* EOF */
@@ -1306,6 +1371,7 @@ static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_re
 
         /* Update pos now */
         p_sys->i_pos += i_copy;
+        p_sys->stream.i_seq_bytes += i_copy;
 
         /* */
         p_sys->stream.i_used += i_copy;
@@ -1313,8 +1379,8 @@ static int AStreamReadNoSeekStream( stream_t *s, void *p_read, unsigned int i_re
         if( tk->i_end + i_data <= tk->i_start + p_sys->stream.i_offset + i_read )
         {
             const unsigned i_read_requested = VLC_CLIP( i_read - i_data,
-                                                    STREAM_READ_ATONCE / 2,
-                                                    STREAM_READ_ATONCE * 10 );
+                                                    p_sys->stream.i_read_size / 2,
+                                                    p_sys->stream.i_read_size * 10 );
 
             if( p_sys->stream.i_used < i_read_requested )
                 p_sys->stream.i_used = i_read_requested;
@@ -1338,8 +1404,9 @@ static int AStreamRefillStream( stream_t *s )
 
     /* We read but won't increase i_start after initial start + offset */
     int i_toread =
-        __MIN( p_sys->stream.i_used, STREAM_CACHE_TRACK_SIZE -
+        __MIN( p_sys->stream.i_used, p_sys->stream.i_tk_size -
                (tk->i_end - tk->i_start - p_sys->stream.i_offset) );
+    int i_read_total = 0;
     bool b_read = false;
     int64_t i_start, i_stop;
 
@@ -1353,13 +1420,13 @@ static int AStreamRefillStream( stream_t *s )
     i_start = mdate();
     while( i_toread > 0 )
     {
-        int i_off = tk->i_end % STREAM_CACHE_TRACK_SIZE;
+        int i_off = tk->i_end % p_sys->stream.i_tk_size;
         int i_read;
 
         if( !vlc_object_alive(s) )
             return VLC_EGENERIC;
 
-        i_read = __MIN( i_toread, STREAM_CACHE_TRACK_SIZE - i_off );
+        i_read = __MIN( i_toread, p_sys->stream.i_tk_size - i_off );
         i_read = AReadStream( s, &tk->p_buffer[i_off], i_read );
 
         /* msg_Dbg( s, "AStreamRefillStream: read=%d", i_read ); */
@@ -1378,16 +1445,17 @@ static int AStreamRefillStream( stream_t *s )
         /* Update end */
         tk->i_end += i_read;
 
-        /* Windows of STREAM_CACHE_TRACK_SIZE */
-        if( tk->i_start + STREAM_CACHE_TRACK_SIZE < tk->i_end )
+        /* Windows of i_tk_size */
+        if( tk->i_start + p_sys->stream.i_tk_size < tk->i_end )
         {
-            unsigned i_invalid = tk->i_end - tk->i_start - STREAM_CACHE_TRACK_SIZE;
+            unsigned i_invalid = tk->i_end - tk->i_start - p_sys->stream.i_tk_size;
 
             tk->i_start += i_invalid;
             p_sys->stream.i_offset -= i_invalid;
         }
 
         i_toread -= i_read;
+        i_read_total += i_read;
         p_sys->stream.i_used -= i_read;
 
         p_sys->stat.i_bytes += i_read;
@@ -1396,6 +1464,8 @@ static int AStreamRefillStream( stream_t *s )
     i_stop = mdate();
 
     p_sys->stat.i_read_time += i_stop - i_start;
+    AStreamStatRefill( s, i_stop - i_start );
+    AStreamTuneReadSize( s, i_read_total, i_stop - i_start );
 
     return VLC_SUCCESS;
 }
@@ -1436,7 +1506,7 @@ static void AStreamPrebufferStream( stream_t *s )
         }
 
         /* */
-        i_read = STREAM_CACHE_TRACK_SIZE - i_buffered;
+        i_read = p_sys->stream.i_tk_size - i_buffered;
         i_read = __MIN( (int)p_sys->stream.i_read_size, i_read );
         i_read = AReadStream( s, &tk->p_buffer[i_buffered], i_read );
         if( i_read <  0 )
@@ -1457,6 +1527,84 @@ static void AStreamPrebufferStream( stream_t *s )
     }
 }
 
+/* Do not split the cache in tracks too small to be useful */
+static int AStreamMaxTracks( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    return __MAX( 1, __MIN( STREAM_CACHE_TRACK_MAX,
+                  (int)(p_sys->i_cache_size / STREAM_CACHE_TRACK_SIZE_MIN) ) );
+}
+
+static void AStreamSetupTracks( stream_t *s, int i_count )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    i_count = VLC_CLIP( i_count, 1, AStreamMaxTracks( s ) );
+
+    p_sys->stream.i_offset   = 0;
+    p_sys->stream.i_tk       = 0;
+    p_sys->stream.i_tk_count = i_count;
+    p_sys->stream.i_tk_size  = p_sys->i_cache_size / i_count;
+
+    for( int i = 0; i < i_count; i++ )
+    {
+        p_sys->stream.tk[i].i_date  = 0;
+        p_sys->stream.tk[i].i_start = p_sys->i_pos;
+        p_sys->stream.tk[i].i_end   = p_sys->i_pos;
+        p_sys->stream.tk[i].p_buffer=
+            &p_sys->stream.p_buffer[i * p_sys->stream.i_tk_size];
+    }
+}
+
+/* Called on each hard seek, returns the number of tracks to use */
+static int AStreamTuneTracks( stream_t *s )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    int i_count = p_sys->stream.i_tk_count;
+
+    /* Short runs between hard seeks means random access (badly interleaved
+     * file, index lookups...), more tracks keep more places of the file
+     * cached. Long sequential runs only benefit from bigger tracks. */
+    if( p_sys->stream.i_seq_bytes < p_sys->stream.i_tk_size / 4 )
+        p_sys->stream.i_tk_vote = __MAX( p_sys->stream.i_tk_vote, 0 ) + 1;
+    else if( p_sys->stream.i_seq_bytes > p_sys->i_cache_size )
+        p_sys->stream.i_tk_vote = __MIN( p_sys->stream.i_tk_vote, 0 ) - 1;
+    else
+        p_sys->stream.i_tk_vote = 0;
+
+    if( p_sys->stream.i_tk_vote >= STREAM_CACHE_TRACK_VOTES )
+        i_count++;
+    else if( p_sys->stream.i_tk_vote <= -STREAM_CACHE_TRACK_VOTES )
+        i_count--;
+    else
+        return i_count;
+
+    p_sys->stream.i_tk_vote = 0;
+    i_count = VLC_CLIP( i_count, 1, AStreamMaxTracks( s ) );
+    if( i_count != p_sys->stream.i_tk_count )
+        msg_Dbg( s, "using %d cache tracks of %zu KiB", i_count,
+                 p_sys->i_cache_size / i_count / 1024 );
+    return i_count;
+}
+
+/* Read about STREAM_READ_DURATION worth of data at once */
+static void AStreamTuneReadSize( stream_t *s, uint64_t i_bytes, mtime_t i_duration )
+{
+    stream_sys_t *p_sys = s->p_sys;
+
+    const uint64_t i_byterate = i_bytes * CLOCK_FREQ / (i_duration + 1);
+    if( p_sys->stream.i_byterate > 0 )
+        p_sys->stream.i_byterate = (7 * p_sys->stream.i_byterate + i_byterate) / 8;
+    else
+        p_sys->stream.i_byterate = i_byterate;
+
+    uint64_t i_read_size = p_sys->stream.i_byterate * STREAM_READ_DURATION / CLOCK_FREQ;
+    i_read_size = __MIN( i_read_size, p_sys->stream.i_tk_size / 16 );
+    p_sys->stream.i_read_size = VLC_CLIP( i_read_size, STREAM_READ_ATONCE,
+                                          STREAM_READ_ATONCE_MAX );
+}
+
 /****************************************************************************
  * stream_ReadLine:
  ****************************************************************************/
@@ -1645,6 +1793,45 @@ error:
     return NULL;
 }
 
+/****************************************************************************
+ * Cache statistics
+ ****************************************************************************/
+static void AStreamStatCache( stream_t *s, bool b_hit )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    input_thread_t *p_input = s->p_input;
+
+    if( b_hit )
+        p_sys->stat.i_hit_count++;
+    else
+        p_sys->stat.i_miss_count++;
+
+    if( p_input && libvlc_stats( s ) )
+    {
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        stats_Update( b_hit ? p_input->p->counters.p_cache_hits
+                            : p_input->p->counters.p_cache_misses, 1, NULL );
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
+}
+
+static void AStreamStatRefill( stream_t *s, mtime_t i_duration )
+{
+    stream_sys_t *p_sys = s->p_sys;
+    input_thread_t *p_input = s->p_input;
+
+    p_sys->stat.i_refill_count++;
+
+    if( p_input && libvlc_stats( s ) )
+    {
+        vlc_mutex_lock( &p_input->p->counters.counters_lock );
+        stats_Update( p_input->p->counters.p_cache_refills, 1, NULL );
+        stats_Update( p_input->p->counters.p_cache_refill_time,
+                      i_duration, NULL );
+        vlc_mutex_unlock( &p_input->p->counters.counters_lock );
+    }
+}
+
 /****************************************************************************
  * Access reading/seeking wrappers to handle concatenated streams.
  ****************************************************************************/
@@ -1724,13 +1911,19 @@ static block_t *AReadBlock( stream_t *s, bool *pb_eof )
         if( p_input && p_block && libvlc_stats (p_access) )
         {
             uint64_t total;
+            size_t i_bytes;
+            int i_packets;
+
+            /* Accesses may return several packets at once */
+            block_ChainProperties( p_block, &i_packets, &i_bytes, NULL );
 
             vlc_mutex_lock( &p_input->p->counters.counters_lock );
             stats_Update( p_input->p->counters.p_read_bytes,
-                          p_block->i_buffer, &total );
+                          i_bytes, &total );
             stats_Update( p_input->p->counters.p_input_bitrate,
                           total, NULL );
-            stats_Update( p_input->p->counters.p_read_packets, 1, NULL );
+            stats_Update( p_input->p->counters.p_read_packets, i_packets,
+                          NULL );
             vlc_mutex_unlock( &p_input->p->counters.counters_lock );
         }
         return p_block;
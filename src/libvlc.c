@@ -114,6 +114,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
     priv = libvlc_priv (p_libvlc);
     priv->p_playlist = NULL;
     priv->p_ml = NULL;
+    priv->p_slices = NULL;
     priv->p_dialog_provider = NULL;
     priv->p_vlm = NULL;
     priv->i_verbose = 3; /* initial value until config is loaded */
@@ -125,6 +126,7 @@ libvlc_int_t * libvlc_InternalCreate( void )
 
     /* Initialize mutexes */
     vlc_mutex_init( &priv->ml_lock );
+    vlc_mutex_init( &priv->slices_lock );
     vlc_ExitInit( &priv->exit );
 
     return p_libvlc;
@@ -400,6 +402,9 @@ dbus_out:
 
     priv->b_stats = var_InheritBool( p_libvlc, "stats" );
 
+    block_PoolSetLimit( var_InheritInteger( p_libvlc, "block-pool-size" )
+                        * 1024 );
+
     /*
      * Initialize hotkey handling
      */
@@ -592,7 +597,7 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     {
         ml_Destroy( VLC_OBJECT( p_ml ) );
         vlc_object_release( p_ml );
-        libvlc_priv(p_playlist->p_libvlc)->p_ml = NULL;
+        priv->p_ml = NULL;
     }
 #endif
 
@@ -601,8 +606,18 @@ void libvlc_InternalCleanup( libvlc_int_t *p_libvlc )
     if( p_playlist != NULL )
         playlist_Destroy( p_playlist );
 
+    /* No filters can be running anymore */
+    filter_DestroySlices( p_libvlc );
+
     msg_Dbg( p_libvlc, "removing stats" );
 
+    uint64_t i_pool_hits, i_pool_misses;
+    size_t i_pool_cached;
+    block_PoolStats( &i_pool_hits, &i_pool_misses, &i_pool_cached );
+    vlc_Log( VLC_OBJECT(p_libvlc), priv->b_stats ? VLC_MSG_INFO : VLC_MSG_DBG,
+             MODULE_STRING, "block pool: %"PRIu64" hits, %"PRIu64" misses, "
+             "%zu bytes cached", i_pool_hits, i_pool_misses, i_pool_cached );
+
 #if !defined( WIN32 ) && !defined( __OS2__ )
     char* psz_pidfile = NULL;
 
@@ -648,6 +663,7 @@ void libvlc_InternalDestroy( libvlc_int_t *p_libvlc )
 
     /* Destroy mutexes */
     vlc_ExitDestroy( &priv->exit );
+    vlc_mutex_destroy( &priv->slices_lock );
     vlc_mutex_destroy( &priv->ml_lock );
 
     assert( atomic_load(&(vlc_internals(p_libvlc)->refs)) == 1 );
@@ -74,6 +74,18 @@ void vlc_assert_locked (vlc_mutex_t *);
 # define vlc_assert_locked( m ) (void)m
 #endif
 
+/*
+ * Block allocator
+ */
+void block_PoolSetLimit (size_t);
+void block_PoolStats (uint64_t *hits, uint64_t *misses, size_t *cached);
+
+/*
+ * Video filter slice threads
+ */
+typedef struct filter_slices filter_slices_t;
+void filter_DestroySlices (libvlc_int_t *);
+
 /*
  * LibVLC exit event handling
  */
@@ -150,6 +162,8 @@ typedef struct libvlc_priv_t
     playlist_t        *p_playlist; ///< the playlist singleton
     struct media_library_t *p_ml;    ///< the ML singleton
     vlc_mutex_t       ml_lock; ///< Mutex for ML creation
+    filter_slices_t   *p_slices; ///< video filter slice threads (or NULL)
+    vlc_mutex_t       slices_lock; ///< Mutex for slice threads creation
     vlm_t             *p_vlm;  ///< the VLM singleton (or NULL)
     vlc_object_t      *p_dialog_provider; ///< dialog provider
 #ifdef ENABLE_SOUT
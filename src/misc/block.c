@@ -39,6 +39,8 @@
 #include <vlc_common.h>
 #include <vlc_block.h>
 #include <vlc_fs.h>
+#include <vlc_atomic.h>
+#include "libvlc.h"
 
 /**
  * @section Block handling functions.
@@ -128,15 +130,332 @@ static void BlockMetaCopy( block_t *restrict out, const block_t *in )
 /* Maximum size of reserved footer before shrinking with realloc(). */
 #define BLOCK_WASTE_SIZE   2048
 
+/* Size classes of the block pool: powers of two of the whole allocation,
+ * including the block_t header and the padding. */
+#define BLOCK_POOL_MIN     512
+#define BLOCK_POOL_CLASSES 8 /* up to 64 KiB */
+#define BLOCK_POOL_MAX     (BLOCK_POOL_MIN << (BLOCK_POOL_CLASSES - 1))
+
+/* Bytes of each size class kept by a thread before it hands blocks back */
+#define BLOCK_POOL_CACHE   65536
+
+/**
+ * Per-thread cache of free blocks.
+ * Allocations and releases are served from here without any lock. Blocks
+ * move in batches between the cache and the shared depot, so that threads
+ * releasing blocks allocated by other threads (e.g. decoders) feed them back.
+ */
+typedef struct
+{
+    block_t *first[BLOCK_POOL_CLASSES];
+    unsigned count[BLOCK_POOL_CLASSES];
+    unsigned hits;
+    unsigned misses;
+    unsigned generation; /**< pool limit the cache was filled under */
+} block_cache_t;
+
+static struct
+{
+    vlc_mutex_t lock;
+    block_t *first[BLOCK_POOL_CLASSES]; /**< depot free lists */
+    atomic_size_t size; /**< bytes in the depot and the thread caches */
+    uint64_t hits;
+    uint64_t misses;
+    atomic_size_t limit; /**< pool memory cap, 0 disables the pool */
+    atomic_uint generation; /**< bumped whenever the limit changes */
+    atomic_bool ready;
+    vlc_threadvar_t key;
+} pool = { .lock = VLC_STATIC_MUTEX, };
+
+/** Accounts size more bytes in the pool, unless that exceeds the cap. */
+static bool block_pool_Reserve (size_t size)
+{
+    const size_t limit = atomic_load_explicit (&pool.limit,
+                                               memory_order_relaxed);
+
+    if (atomic_fetch_add (&pool.size, size) + size <= limit)
+        return true;
+    atomic_fetch_sub (&pool.size, size);
+    return false;
+}
+
+/** Size class of an allocation, or BLOCK_POOL_CLASSES if it is not pooled */
+static unsigned block_pool_Class (size_t alloc)
+{
+    if (alloc > BLOCK_POOL_MAX
+     || atomic_load_explicit (&pool.limit, memory_order_relaxed) == 0)
+        return BLOCK_POOL_CLASSES;
+    if (alloc <= BLOCK_POOL_MIN)
+        return 0;
+    return (sizeof (unsigned) * 8 - clz (alloc - 1))
+         - (sizeof (unsigned) * 8 - clz (BLOCK_POOL_MIN - 1));
+}
+
+static unsigned block_cache_Capacity (unsigned cls)
+{
+    unsigned n = BLOCK_POOL_CACHE / (BLOCK_POOL_MIN << cls);
+    return VLC_CLIP(n, 2, 32);
+}
+
+/** Accounts the cache statistics in the depot. Pool lock must be held. */
+static void block_cache_Account (block_cache_t *cache)
+{
+    vlc_assert_locked (&pool.lock);
+    pool.hits += cache->hits;
+    pool.misses += cache->misses;
+    cache->hits = cache->misses = 0;
+}
+
+/**
+ * Hands up to count blocks of a class from the cache back to the depot.
+ * Blocks in excess of the pool memory cap are freed.
+ */
+static void block_cache_Flush (block_cache_t *cache, unsigned cls,
+                               unsigned count)
+{
+    const size_t size = BLOCK_POOL_MIN << cls;
+    const size_t limit = atomic_load_explicit (&pool.limit,
+                                               memory_order_relaxed);
+    block_t *excess = NULL;
+
+    vlc_mutex_lock (&pool.lock);
+    block_cache_Account (cache);
+    while (count > 0 && cache->first[cls] != NULL)
+    {
+        block_t *b = cache->first[cls];
+
+        cache->first[cls] = b->p_next;
+        cache->count[cls]--;
+        count--;
+
+        /* the block is already accounted for in the pool size */
+        if (atomic_load (&pool.size) <= limit)
+        {
+            b->p_next = pool.first[cls];
+            pool.first[cls] = b;
+        }
+        else
+        {
+            atomic_fetch_sub (&pool.size, size);
+            b->p_next = excess;
+            excess = b;
+        }
+    }
+    vlc_mutex_unlock (&pool.lock);
+
+    while (excess != NULL)
+    {
+        block_t *next = excess->p_next;
+        free (excess);
+        excess = next;
+    }
+}
+
+/** Takes a batch of blocks of a class from the depot into the cache. */
+static void block_cache_Refill (block_cache_t *cache, unsigned cls)
+{
+    unsigned count = block_cache_Capacity (cls) / 2;
+
+    vlc_mutex_lock (&pool.lock);
+    block_cache_Account (cache);
+    while (count > 0 && pool.first[cls] != NULL)
+    {
+        block_t *b = pool.first[cls];
+
+        pool.first[cls] = b->p_next;
+        b->p_next = cache->first[cls];
+        cache->first[cls] = b;
+        cache->count[cls]++;
+        count--;
+    }
+    vlc_mutex_unlock (&pool.lock);
+}
+
+static void block_cache_Destroy (void *data)
+{
+    block_cache_t *cache = data;
+
+    for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+        block_cache_Flush (cache, i, cache->count[i]);
+    vlc_mutex_lock (&pool.lock);
+    block_cache_Account (cache);
+    vlc_mutex_unlock (&pool.lock);
+    free (cache);
+}
+
+static block_cache_t *block_cache_Get (void)
+{
+    if (!atomic_load (&pool.ready))
+        return NULL;
+
+    block_cache_t *cache = vlc_threadvar_get (pool.key);
+    if (unlikely(cache == NULL))
+    {
+        cache = calloc (1, sizeof (*cache));
+        if (unlikely(cache == NULL))
+            return NULL;
+        if (unlikely(vlc_threadvar_set (pool.key, cache)))
+        {
+            free (cache);
+            return NULL;
+        }
+        cache->generation = atomic_load (&pool.generation);
+    }
+
+    /* The limit changed: give back what the cache held under the old one */
+    const unsigned generation = atomic_load_explicit (&pool.generation,
+                                                      memory_order_relaxed);
+    if (unlikely(cache->generation != generation))
+    {
+        cache->generation = generation;
+        for (unsigned i = 0; i < BLOCK_POOL_CLASSES; i++)
+            block_cache_Flush (cache, i, cache->count[i]);
+    }
+    return cache;
+}
+
+static block_t *block_pool_Get (unsigned cls)
+{
+    block_cache_t *cache = block_cache_Get ();
+    if (unlikely(cache == NULL))
+        return malloc (BLOCK_POOL_MIN << cls);
+
+    if (cache->first[cls] == NULL)
+        block_cache_Refill (cache, cls);
+
+    block_t *b = cache->first[cls];
+    if (b == NULL)
+    {
+        cache->misses++;
+        return malloc (BLOCK_POOL_MIN << cls);
+    }
+
+    cache->first[cls] = b->p_next;
+    cache->count[cls]--;
+    atomic_fetch_sub (&pool.size, (size_t)BLOCK_POOL_MIN << cls);
+    if (++cache->hits >= 4096)
+    {
+        vlc_mutex_lock (&pool.lock);
+        block_cache_Account (cache);
+        vlc_mutex_unlock (&pool.lock);
+    }
+    return b;
+}
+
+static void block_pool_Release (block_t *block)
+{
+    const size_t alloc = sizeof (*block) + block->i_size;
+    const unsigned cls = block_pool_Class (alloc);
+
+    /* That is always true for blocks allocated with block_Alloc(). */
+    assert (block->p_start == (unsigned char *)(block + 1));
+    block_Invalidate (block);
+
+    block_cache_t *cache = block_cache_Get ();
+    if (cls >= BLOCK_POOL_CLASSES || cache == NULL
+     || !block_pool_Reserve (alloc))
+    {   /* Pool disabled or full in the mean time */
+        free (block);
+        return;
+    }
+    assert (alloc == ((size_t)BLOCK_POOL_MIN << cls));
+
+    unsigned capacity = block_cache_Capacity (cls);
+    if (cache->count[cls] >= capacity)
+        block_cache_Flush (cache, cls, capacity / 2);
+
+    block->p_next = cache->first[cls];
+    cache->first[cls] = block;
+    cache->count[cls]++;
+}
+
+/** Whether a pooled block is already of the size class for a payload */
+static bool block_pool_Fits (const block_t *block, size_t size)
+{
+    if (block->pf_release != block_pool_Release)
+        return false;
+
+    unsigned cls = block_pool_Class (sizeof (block_t) + BLOCK_ALIGN
+                                     + (2 * BLOCK_PADDING) + size);
+    return cls < BLOCK_POOL_CLASSES
+        && ((size_t)BLOCK_POOL_MIN << cls) == sizeof (block_t) + block->i_size;
+}
+
+/**
+ * Sets the amount of memory that the block pool may hold, in the depot and
+ * in the thread caches together. The depot is trimmed right away, each
+ * thread cache the next time its thread goes through the pool.
+ * @param limit bytes, 0 to disable pooling
+ */
+void block_PoolSetLimit (size_t limit)
+{
+    block_t *excess = NULL;
+
+    vlc_mutex_lock (&pool.lock);
+    if (!atomic_load (&pool.ready)
+     && vlc_threadvar_create (&pool.key, block_cache_Destroy) == 0)
+        atomic_store (&pool.ready, true);
+    if (!atomic_load (&pool.ready))
+        limit = 0;
+    atomic_store (&pool.limit, limit);
+    atomic_fetch_add (&pool.generation, 1);
+
+    for (unsigned i = BLOCK_POOL_CLASSES;
+         atomic_load (&pool.size) > limit && i-- > 0;)
+        while (atomic_load (&pool.size) > limit && pool.first[i] != NULL)
+        {
+            block_t *b = pool.first[i];
+
+            pool.first[i] = b->p_next;
+            atomic_fetch_sub (&pool.size, (size_t)BLOCK_POOL_MIN << i);
+            b->p_next = excess;
+            excess = b;
+        }
+    vlc_mutex_unlock (&pool.lock);
+
+    while (excess != NULL)
+    {
+        block_t *next = excess->p_next;
+        free (excess);
+        excess = next;
+    }
+}
+
+/**
+ * Reports the block pool statistics: allocations served from the pool,
+ * allocations that had to hit the heap, and bytes held by the pool.
+ */
+void block_PoolStats (uint64_t *hits, uint64_t *misses, size_t *cached)
+{
+    vlc_mutex_lock (&pool.lock);
+    *hits = pool.hits;
+    *misses = pool.misses;
+    *cached = atomic_load (&pool.size);
+    vlc_mutex_unlock (&pool.lock);
+}
+
 block_t *block_Alloc (size_t size)
 {
     /* 2 * BLOCK_PADDING: pre + post padding */
-    const size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
-                       + size;
+    size_t alloc = sizeof (block_t) + BLOCK_ALIGN + (2 * BLOCK_PADDING)
+                 + size;
     if (unlikely(alloc <= size))
         return NULL;
 
-    block_t *b = malloc (alloc);
+    const unsigned cls = block_pool_Class (alloc);
+    block_t *b;
+
+    if (cls < BLOCK_POOL_CLASSES)
+    {
+        alloc = BLOCK_POOL_MIN << cls;
+        b = block_pool_Get (cls);
+    }
+    else
+    {
+        if (alloc <= BLOCK_POOL_MAX) /* pool disabled: empty the cache */
+            block_cache_Get ();
+        b = malloc (alloc);
+    }
     if (unlikely(b == NULL))
         return NULL;
 
@@ -146,10 +465,13 @@ block_t *block_Alloc (size_t size)
     b->p_buffer += BLOCK_PADDING + BLOCK_ALIGN - 1;
     b->p_buffer = (void *)(((uintptr_t)b->p_buffer) & ~(BLOCK_ALIGN - 1));
     b->i_buffer = size;
-    b->pf_release = block_generic_Release;
+    b->pf_release = (cls < BLOCK_POOL_CLASSES) ? block_pool_Release
+                                               : block_generic_Release;
     return b;
 }
 
+static bool block_view_ClaimHead (block_t *, size_t);
+
 block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
 {
     size_t requested = i_prebody + i_body;
@@ -163,6 +485,24 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
         return NULL;
     }
 
+    /* Shared payloads are read-only: only trimming is done in place, but one
+     * of the views can prepend a header in the room left before the payload */
+    if( block_IsShared( p_block ) && i_prebody > 0
+     && i_body <= p_block->i_buffer
+     && block_view_ClaimHead( p_block, i_prebody ) )
+    {
+        p_block->p_buffer -= i_prebody;
+        p_block->i_buffer = i_prebody + i_body;
+        return p_block;
+    }
+    if( block_IsShared( p_block )
+     && ( i_prebody > 0 || i_body > p_block->i_buffer ) )
+    {
+        p_block = block_Writable( p_block );
+        if( p_block == NULL )
+            return NULL;
+    }
+
     assert( p_block->p_start <= p_block->p_buffer );
     assert( p_block->p_start + p_block->i_size
                                     >= p_block->p_buffer + p_block->i_buffer );
@@ -227,9 +567,11 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
         p_block = p_rea;
     }
     else
-    /* We have a very large reserved footer now? Release some of it.
+    /* We have a very large reserved footer now? Release some of it,
+     * unless a smaller block would come from the same pool size class.
      * XXX it might not preserve the alignment of p_buffer */
-    if( p_end - (p_block->p_buffer + i_body) > BLOCK_WASTE_SIZE )
+    if( p_end - (p_block->p_buffer + i_body) > BLOCK_WASTE_SIZE
+     && !block_pool_Fits( p_block, requested ) )
     {
         block_t *p_rea = block_Alloc( requested );
         if( p_rea )
@@ -262,6 +604,210 @@ block_t *block_Realloc( block_t *p_block, ssize_t i_prebody, size_t i_body )
     return p_block;
 }
 
+/**
+ * @section Shared blocks
+ *
+ * A shared block is a read-only view on the payload of another block. The
+ * underlying block is reference-counted and released along with its last
+ * view, so that a payload can be fanned out without copies.
+ */
+typedef struct
+{
+    atomic_uint refs;
+    atomic_bool head; /**< Whether a view took the head room */
+    block_t    *block; /**< Underlying payload owner */
+} block_shared_t;
+
+typedef struct
+{
+    block_t         self;
+    block_shared_t *shared;
+    bool            b_head; /**< Owns the head room of the payload */
+} block_view_t;
+
+static void block_view_Release (block_t *block)
+{
+    block_view_t *view = (block_view_t *)block;
+    block_shared_t *shared = view->shared;
+
+    block_Invalidate (block);
+    free (view);
+
+    if (atomic_fetch_sub (&shared->refs, 1) == 1)
+    {
+        block_Release (shared->block);
+        free (shared);
+    }
+}
+
+static block_t *block_view_Alloc (block_shared_t *shared,
+                                  uint8_t *buf, size_t size)
+{
+    block_view_t *view = malloc (sizeof (*view));
+    if (unlikely(view == NULL))
+        return NULL;
+
+    /* No tail room, and no head room until claimed (see below) */
+    block_Init (&view->self, buf, size);
+    view->self.pf_release = block_view_Release;
+    view->shared = shared;
+    view->b_head = false;
+    return &view->self;
+}
+
+/**
+ * Gives a view the room before the shared payload, so that it can prepend
+ * a header without copying the payload (e.g. the PES header of a TS branch).
+ * Only the first view that asks gets it: the headers of the other views
+ * would overwrite it.
+ * @return whether the view has at least size bytes of head room
+ */
+static bool block_view_ClaimHead (block_t *block, size_t size)
+{
+    block_view_t *view = (block_view_t *)block;
+    block_shared_t *shared = view->shared;
+
+    if (!view->b_head)
+    {
+        if (block->p_buffer != shared->block->p_buffer
+         || atomic_exchange (&shared->head, true))
+            return false;
+        view->b_head = true;
+        block->i_size += block->p_start - shared->block->p_start;
+        block->p_start = shared->block->p_start;
+    }
+    return (size_t)(block->p_buffer - block->p_start) >= size;
+}
+
+/**
+ * Converts a block into a shared block.
+ *
+ * The payload of a shared block must not be modified in place, but
+ * duplicating it with block_Duplicate() only takes a reference.
+ * Modules that need to write to a block can request a private copy with
+ * block_Writable(). The first view prepending data with block_Realloc()
+ * does it in place, in front of the shared payload.
+ *
+ * @param block block to share (a single block, not a chain)
+ * @return the shared block, or the original block if memory is lacking
+ */
+block_t *block_Share (block_t *block)
+{
+    if (block_IsShared (block))
+        return block;
+
+    block_shared_t *shared = malloc (sizeof (*shared));
+    if (unlikely(shared == NULL))
+        return block;
+
+    /* Keep head room for the first view that prepends a header */
+    if ((size_t)(block->p_buffer - block->p_start) < BLOCK_PADDING)
+    {
+        block_t *copy = block_Alloc (block->i_buffer);
+        if (likely(copy != NULL))
+        {
+            BlockMetaCopy (copy, block);
+            memcpy (copy->p_buffer, block->p_buffer, block->i_buffer);
+            block->p_next = NULL;
+            block_Release (block);
+            block = copy;
+        }
+    }
+
+    block_t *view = block_view_Alloc (shared, block->p_buffer,
+                                      block->i_buffer);
+    if (unlikely(view == NULL))
+    {
+        free (shared);
+        return block;
+    }
+
+    BlockMetaCopy (view, block);
+    block->p_next = NULL;
+    atomic_init (&shared->refs, 1);
+    atomic_init (&shared->head, false);
+    shared->block = block;
+    return view;
+}
+
+/**
+ * Checks whether a block is a read-only view of a shared payload.
+ */
+bool block_IsShared (const block_t *block)
+{
+    return block->pf_release == block_view_Release;
+}
+
+/**
+ * Creates a copy of a block.
+ *
+ * Shared blocks (see block_Share()) are duplicated by reference; other blocks
+ * are copied.
+ * @return the duplicate, or NULL on error
+ */
+block_t *block_Duplicate (block_t *block)
+{
+    block_t *dup;
+
+    if (block_IsShared (block))
+    {
+        block_shared_t *shared = ((block_view_t *)block)->shared;
+
+        dup = block_view_Alloc (shared, block->p_buffer, block->i_buffer);
+        if (unlikely(dup == NULL))
+            return NULL;
+        atomic_fetch_add (&shared->refs, 1);
+    }
+    else
+    {
+        dup = block_Alloc (block->i_buffer);
+        if (unlikely(dup == NULL))
+            return NULL;
+        memcpy (dup->p_buffer, block->p_buffer, block->i_buffer);
+    }
+
+    block_CopyProperties (dup, block);
+    return dup;
+}
+
+/**
+ * Makes sure that the payload of a block can be modified in place.
+ *
+ * A shared block is replaced with a private copy of its payload, or with the
+ * underlying block if no other references remain. Other blocks are returned
+ * unchanged.
+ * @return a writable block, or NULL on error (the block is released then)
+ */
+block_t *block_Writable (block_t *block)
+{
+    if (!block_IsShared (block))
+        return block;
+
+    block_view_t *view = (block_view_t *)block;
+    block_shared_t *shared = view->shared;
+    block_t *priv;
+
+    if (atomic_load (&shared->refs) == 1)
+    {   /* Last reference: take the underlying block back */
+        priv = shared->block;
+        priv->p_buffer = block->p_buffer;
+        priv->i_buffer = block->i_buffer;
+        BlockMetaCopy (priv, block);
+        block_Invalidate (block);
+        free (view);
+        free (shared);
+        return priv;
+    }
+
+    priv = block_Alloc (block->i_buffer);
+    if (likely(priv != NULL))
+    {
+        BlockMetaCopy (priv, block);
+        memcpy (priv->p_buffer, block->p_buffer, block->i_buffer);
+    }
+    block_Release (block);
+    return priv;
+}
 
 static void block_heap_Release (block_t *block)
 {
@@ -508,6 +1054,39 @@ block_t *block_FilePath (const char *path)
  * @section Thread-safe block queue functions
  */
 
+/**
+ * Number of slots of the single producer/single consumer ring.
+ * Must be a power of two. Blocks overflowing the ring are queued in the
+ * (locked) linked list until the consumer catches up.
+ */
+#define BLOCK_FIFO_SPSC_SLOTS 512
+
+/**
+ * Number of times an empty single producer/single consumer FIFO is polled
+ * before the consumer goes to sleep.
+ */
+#define BLOCK_FIFO_SPSC_SPIN 100
+
+/**
+ * Lock-less state of single producer/single consumer block queues
+ */
+typedef struct
+{
+    atomic_uintptr_t    slots[BLOCK_FIFO_SPSC_SLOTS]; /**< Queued blocks */
+    atomic_size_t       i_head;    /**< Next slot to read (consumer) */
+    atomic_size_t       i_tail;    /**< Next slot to write (producer) */
+
+    atomic_size_t       i_depth;
+    atomic_size_t       i_size;
+
+    atomic_bool         b_overflow; /**< Linked list in use (ring was full) */
+    atomic_bool         b_waiting;  /**< Consumer sleeps on wait */
+    atomic_bool         b_pacing;   /**< Producer sleeps on wait_room */
+    atomic_size_t       i_pace_depth; /**< Limits the producer waits for */
+    atomic_size_t       i_pace_size;
+    atomic_bool         b_force_wake;
+} block_spsc_t;
+
 /**
  * Internal state for block queues
  */
@@ -522,6 +1101,8 @@ struct block_fifo_t
     size_t              i_depth;
     size_t              i_size;
     bool          b_force_wake;
+
+    block_spsc_t        *p_spsc;   /**< NULL unless single producer/consumer */
 };
 
 block_fifo_t *block_FifoNew( void )
@@ -537,23 +1118,305 @@ block_fifo_t *block_FifoNew( void )
     p_fifo->pp_last = &p_fifo->p_first;
     p_fifo->i_depth = p_fifo->i_size = 0;
     p_fifo->b_force_wake = false;
+    p_fifo->p_spsc = NULL;
 
     return p_fifo;
 }
 
+/**
+ * Creates a FIFO for exactly one producer and one consumer thread.
+ *
+ * block_FifoPut() and block_FifoGet() do not lock in the common case, and
+ * the consumer is only signaled when it actually sleeps, so a busy consumer
+ * costs the producer no system call at all.
+ *
+ * block_FifoPut(), block_FifoPace(), block_FifoEmpty() and block_FifoWake()
+ * must be serialized by the caller (producer side). block_FifoGet() and
+ * block_FifoShow() must only be called from the consumer thread.
+ * block_FifoEmpty() is allowed on the producer side while the consumer runs.
+ */
+block_fifo_t *block_FifoNewSPSC( void )
+{
+    block_fifo_t *p_fifo = block_FifoNew();
+    if( !p_fifo )
+        return NULL;
+
+    block_spsc_t *p_spsc = malloc( sizeof( *p_spsc ) );
+    if( !p_spsc )
+    {
+        block_FifoRelease( p_fifo );
+        return NULL;
+    }
+
+    for( unsigned i = 0; i < BLOCK_FIFO_SPSC_SLOTS; i++ )
+        atomic_init( &p_spsc->slots[i], (uintptr_t)NULL );
+    atomic_init( &p_spsc->i_head, 0 );
+    atomic_init( &p_spsc->i_tail, 0 );
+    atomic_init( &p_spsc->i_depth, 0 );
+    atomic_init( &p_spsc->i_size, 0 );
+    atomic_init( &p_spsc->b_overflow, false );
+    atomic_init( &p_spsc->b_waiting, false );
+    atomic_init( &p_spsc->b_pacing, false );
+    atomic_init( &p_spsc->i_pace_depth, 0 );
+    atomic_init( &p_spsc->i_pace_size, 0 );
+    atomic_init( &p_spsc->b_force_wake, false );
+
+    p_fifo->p_spsc = p_spsc;
+    return p_fifo;
+}
+
 void block_FifoRelease( block_fifo_t *p_fifo )
 {
     block_FifoEmpty( p_fifo );
+    free( p_fifo->p_spsc );
     vlc_cond_destroy( &p_fifo->wait_room );
     vlc_cond_destroy( &p_fifo->wait );
     vlc_mutex_destroy( &p_fifo->lock );
     free( p_fifo );
 }
 
+/*
+ * Single producer/single consumer helpers.
+ *
+ * The producer owns i_tail, the consumer owns i_head. A slot is taken with
+ * an atomic exchange, so that block_FifoEmpty() can steal the queued blocks
+ * from the producer side while the consumer is running: whoever gets the
+ * non-NULL pointer owns the block.
+ */
+static bool SpscPush( block_spsc_t *p_spsc, block_t *p_block )
+{
+    size_t i_tail = atomic_load( &p_spsc->i_tail );
+
+    if( i_tail - atomic_load( &p_spsc->i_head ) >= BLOCK_FIFO_SPSC_SLOTS )
+        return false; /* full */
+
+    atomic_store( &p_spsc->slots[i_tail % BLOCK_FIFO_SPSC_SLOTS],
+                  (uintptr_t)p_block );
+    atomic_store( &p_spsc->i_tail, i_tail + 1 );
+    return true;
+}
+
+static block_t *SpscPop( block_spsc_t *p_spsc, bool b_peek )
+{
+    size_t i_head = atomic_load( &p_spsc->i_head );
+    const size_t i_tail = atomic_load( &p_spsc->i_tail );
+
+    for( ; i_head != i_tail; i_head++ )
+    {
+        atomic_uintptr_t *p_slot = &p_spsc->slots[i_head % BLOCK_FIFO_SPSC_SLOTS];
+        block_t *p_block;
+
+        if( b_peek )
+            p_block = (block_t *)atomic_load( p_slot );
+        else
+            p_block = (block_t *)atomic_exchange( p_slot, (uintptr_t)NULL );
+
+        if( p_block != NULL )
+        {
+            if( !b_peek )
+                atomic_store( &p_spsc->i_head, i_head + 1 );
+            return p_block;
+        }
+        /* Stolen by block_FifoEmpty() */
+        atomic_store( &p_spsc->i_head, i_head + 1 );
+    }
+    return NULL;
+}
+
+static bool SpscIsEmpty( block_spsc_t *p_spsc )
+{
+    return atomic_load( &p_spsc->i_head ) == atomic_load( &p_spsc->i_tail )
+        && !atomic_load( &p_spsc->b_overflow );
+}
+
+/* Dequeues (or peeks) the first block, waits if needed */
+static block_t *SpscGet( block_fifo_t *p_fifo, bool b_peek, bool b_wakeable )
+{
+    block_spsc_t *p_spsc = p_fifo->p_spsc;
+    block_t *b;
+
+    for( ;; )
+    {
+        b = SpscPop( p_spsc, b_peek );
+        if( b == NULL && atomic_load( &p_spsc->b_overflow ) )
+        {
+            /* The ring is drained, continue with what did not fit in.
+             * The producer may have filled the ring again before setting
+             * b_overflow: while it is set, it only adds to the list, so the
+             * ring is drained first, under the lock. */
+            vlc_mutex_lock( &p_fifo->lock );
+            b = SpscPop( p_spsc, b_peek );
+            if( b == NULL )
+            {
+                b = p_fifo->p_first;
+                if( b != NULL && !b_peek )
+                {
+                    p_fifo->p_first = b->p_next;
+                    if( p_fifo->p_first == NULL )
+                    {
+                        p_fifo->pp_last = &p_fifo->p_first;
+                        atomic_store( &p_spsc->b_overflow, false );
+                    }
+                }
+            }
+            vlc_mutex_unlock( &p_fifo->lock );
+        }
+        if( b != NULL )
+            break;
+
+        /* Give the producer a short chance to queue more data: waking up a
+         * sleeping thread is far more costly than a few atomic loads. */
+        for( unsigned i = 0; i < BLOCK_FIFO_SPSC_SPIN; i++ )
+            if( !SpscIsEmpty( p_spsc ) )
+                break;
+        if( !SpscIsEmpty( p_spsc ) )
+            continue;
+
+        /* Sleep until the producer signals. It only does so when
+         * b_waiting is set, so that it does not need to lock otherwise. */
+        vlc_mutex_lock( &p_fifo->lock );
+        mutex_cleanup_push( &p_fifo->lock );
+        atomic_store( &p_spsc->b_waiting, true );
+        while( SpscIsEmpty( p_spsc )
+            && !( b_wakeable && atomic_load( &p_spsc->b_force_wake ) ) )
+            vlc_cond_wait( &p_fifo->wait, &p_fifo->lock );
+        atomic_store( &p_spsc->b_waiting, false );
+        vlc_cleanup_pop();
+
+        if( b_wakeable && SpscIsEmpty( p_spsc ) )
+        {
+            /* Forced wakeup */
+            atomic_store( &p_spsc->b_force_wake, false );
+            vlc_mutex_unlock( &p_fifo->lock );
+            return NULL;
+        }
+        vlc_mutex_unlock( &p_fifo->lock );
+    }
+
+    if( b_peek )
+        return b;
+
+    atomic_store( &p_spsc->b_force_wake, false );
+    const size_t i_depth = atomic_fetch_sub( &p_spsc->i_depth, 1 ) - 1;
+    const size_t i_size = atomic_fetch_sub( &p_spsc->i_size, b->i_buffer )
+                        - b->i_buffer;
+    /* Let the queue drain to half the pacing limits before waking the
+     * producer up, instead of once per block */
+    if( atomic_load( &p_spsc->b_pacing )
+     && i_depth <= atomic_load( &p_spsc->i_pace_depth ) / 2
+     && i_size <= atomic_load( &p_spsc->i_pace_size ) / 2 )
+    {
+        vlc_mutex_lock( &p_fifo->lock );
+        vlc_cond_broadcast( &p_fifo->wait_room );
+        vlc_mutex_unlock( &p_fifo->lock );
+    }
+
+    b->p_next = NULL;
+    return b;
+}
+
+static size_t SpscPut( block_fifo_t *p_fifo, block_t *p_block )
+{
+    block_spsc_t *p_spsc = p_fifo->p_spsc;
+    size_t i_total = 0;
+
+    while( p_block != NULL )
+    {
+        block_t *p_next = p_block->p_next;
+        p_block->p_next = NULL;
+
+        /* Account before queuing, so that the consumer never goes below 0 */
+        atomic_fetch_add( &p_spsc->i_depth, 1 );
+        atomic_fetch_add( &p_spsc->i_size, p_block->i_buffer );
+        i_total += p_block->i_buffer;
+
+        if( atomic_load( &p_spsc->b_overflow ) || !SpscPush( p_spsc, p_block ) )
+        {
+            vlc_mutex_lock( &p_fifo->lock );
+            if( atomic_load( &p_spsc->b_overflow ) || !SpscPush( p_spsc, p_block ) )
+            {
+                *p_fifo->pp_last = p_block;
+                p_fifo->pp_last = &p_block->p_next;
+                atomic_store( &p_spsc->b_overflow, true );
+            }
+            vlc_mutex_unlock( &p_fifo->lock );
+        }
+        p_block = p_next;
+    }
+
+    /* Wake up the consumer only if it sleeps, once for the whole chain */
+    if( atomic_load( &p_spsc->b_waiting ) )
+    {
+        vlc_mutex_lock( &p_fifo->lock );
+        vlc_cond_signal( &p_fifo->wait );
+        vlc_mutex_unlock( &p_fifo->lock );
+    }
+    return i_total;
+}
+
+static void SpscEmpty( block_fifo_t *p_fifo )
+{
+    block_spsc_t *p_spsc = p_fifo->p_spsc;
+    block_t *p_list = NULL, **pp_list = &p_list;
+
+    vlc_mutex_lock( &p_fifo->lock );
+    const size_t i_tail = atomic_load( &p_spsc->i_tail );
+    for( size_t i = atomic_load( &p_spsc->i_head ); i != i_tail; i++ )
+    {
+        block_t *b = (block_t *)atomic_exchange(
+                &p_spsc->slots[i % BLOCK_FIFO_SPSC_SLOTS], (uintptr_t)NULL );
+        if( b == NULL )
+            continue; /* already dequeued */
+        *pp_list = b;
+        pp_list = &b->p_next;
+    }
+    *pp_list = p_fifo->p_first;
+    p_fifo->p_first = NULL;
+    p_fifo->pp_last = &p_fifo->p_first;
+    atomic_store( &p_spsc->b_overflow, false );
+
+    for( block_t *b = p_list; b != NULL; b = b->p_next )
+    {
+        atomic_fetch_sub( &p_spsc->i_depth, 1 );
+        atomic_fetch_sub( &p_spsc->i_size, b->i_buffer );
+    }
+    vlc_cond_broadcast( &p_fifo->wait_room );
+    vlc_mutex_unlock( &p_fifo->lock );
+
+    block_ChainRelease( p_list );
+}
+
+static void SpscPace( block_fifo_t *p_fifo, size_t max_depth, size_t max_size )
+{
+    block_spsc_t *p_spsc = p_fifo->p_spsc;
+
+    if( atomic_load( &p_spsc->i_depth ) <= max_depth
+     && atomic_load( &p_spsc->i_size ) <= max_size )
+        return;
+
+    vlc_mutex_lock( &p_fifo->lock );
+    mutex_cleanup_push( &p_fifo->lock );
+    atomic_store( &p_spsc->i_pace_depth, max_depth );
+    atomic_store( &p_spsc->i_pace_size, max_size );
+    atomic_store( &p_spsc->b_pacing, true );
+    while( atomic_load( &p_spsc->i_depth ) > max_depth
+        || atomic_load( &p_spsc->i_size ) > max_size )
+        vlc_cond_wait( &p_fifo->wait_room, &p_fifo->lock );
+    atomic_store( &p_spsc->b_pacing, false );
+    vlc_cleanup_pop();
+    vlc_mutex_unlock( &p_fifo->lock );
+}
+
 void block_FifoEmpty( block_fifo_t *p_fifo )
 {
     block_t *block;
 
+    if( p_fifo->p_spsc != NULL )
+    {
+        SpscEmpty( p_fifo );
+        return;
+    }
+
     vlc_mutex_lock( &p_fifo->lock );
     block = p_fifo->p_first;
     if (block != NULL)
@@ -596,6 +1459,12 @@ void block_FifoPace (block_fifo_t *fifo, size_t max_depth, size_t max_size)
 {
     vlc_testcancel ();
 
+    if (fifo->p_spsc != NULL)
+    {
+        SpscPace (fifo, max_depth, max_size);
+        return;
+    }
+
     vlc_mutex_lock (&fifo->lock);
     while ((fifo->i_depth > max_depth) || (fifo->i_size > max_size))
     {
@@ -619,6 +1488,8 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
 
     if (p_block == NULL)
         return 0;
+    if (p_fifo->p_spsc != NULL)
+        return SpscPut (p_fifo, p_block);
     for (p_last = p_block; ; p_last = p_last->p_next)
     {
         i_size += p_last->i_buffer;
@@ -642,7 +1513,12 @@ size_t block_FifoPut( block_fifo_t *p_fifo, block_t *p_block )
 void block_FifoWake( block_fifo_t *p_fifo )
 {
     vlc_mutex_lock( &p_fifo->lock );
-    if( p_fifo->p_first == NULL )
+    if( p_fifo->p_spsc != NULL )
+    {
+        if( SpscIsEmpty( p_fifo->p_spsc ) )
+            atomic_store( &p_fifo->p_spsc->b_force_wake, true );
+    }
+    else if( p_fifo->p_first == NULL )
         p_fifo->b_force_wake = true;
     vlc_cond_broadcast( &p_fifo->wait );
     vlc_mutex_unlock( &p_fifo->lock );
@@ -660,6 +1536,9 @@ block_t *block_FifoGet( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->p_spsc != NULL )
+        return SpscGet( p_fifo, false, true );
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
@@ -713,6 +1592,9 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 
     vlc_testcancel( );
 
+    if( p_fifo->p_spsc != NULL )
+        return SpscGet( p_fifo, true, false );
+
     vlc_mutex_lock( &p_fifo->lock );
     mutex_cleanup_push( &p_fifo->lock );
 
@@ -728,11 +1610,15 @@ block_t *block_FifoShow( block_fifo_t *p_fifo )
 /* FIXME: not thread-safe */
 size_t block_FifoSize( const block_fifo_t *p_fifo )
 {
+    if( p_fifo->p_spsc != NULL )
+        return atomic_load( &p_fifo->p_spsc->i_size );
     return p_fifo->i_size;
 }
 
 /* FIXME: not thread-safe */
 size_t block_FifoCount( const block_fifo_t *p_fifo )
 {
+    if( p_fifo->p_spsc != NULL )
+        return atomic_load( &p_fifo->p_spsc->i_depth );
     return p_fifo->i_depth;
 }
@@ -25,6 +25,8 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+
 #include <vlc_common.h>
 #include <libvlc.h>
 #include <vlc_filter.h>
@@ -111,6 +113,239 @@ void filter_DeleteBlend( filter_t *p_blend )
     vlc_object_release( p_blend );
 }
 
+/*****************************************************************************
+ * Slice threads
+ *****************************************************************************
+ * One pool of threads per LibVLC instance is shared by all the filters that
+ * call filter_RunSlices(). Each call queues a job made of a number of slices;
+ * idle threads claim slices from the oldest job, while the calling thread
+ * claims the slices of its own job. A job therefore always completes, even if
+ * all the threads are busy with other jobs.
+ *****************************************************************************/
+#define FILTER_SLICES_MAX      16 /* maximum number of slices per job */
+#define FILTER_SLICE_MIN_LINES 32 /* minimum number of lines per slice */
+
+typedef struct filter_slice_job filter_slice_job_t;
+
+struct filter_slice_job
+{
+    filter_slice_job_t *p_next;
+
+    void (*pf_slice)( filter_t *, void *, unsigned, unsigned );
+    filter_t *p_filter;
+    void *p_data;
+
+    unsigned i_slices;  /* number of slices */
+    unsigned i_next;    /* next slice to be claimed */
+    unsigned i_pending; /* number of slices not completed yet */
+};
+
+struct filter_slices
+{
+    vlc_mutex_t lock;
+    vlc_cond_t  wait; /* signaled when a job is queued, or to exit */
+    vlc_cond_t  done; /* signaled when a job completes */
+
+    filter_slice_job_t  *p_first; /* jobs with unclaimed slices */
+    filter_slice_job_t **pp_last;
+    bool b_exit;
+
+    unsigned     i_threads;
+    vlc_thread_t threads[];
+};
+
+/* Claims the next slice of a job, p_slices->lock must be held. */
+static unsigned SliceClaim( filter_slices_t *p_slices,
+                            filter_slice_job_t *p_job )
+{
+    unsigned i_slice = p_job->i_next++;
+
+    if( p_job->i_next == p_job->i_slices )
+    {   /* All slices are claimed, remove the job from the queue */
+        filter_slice_job_t **pp = &p_slices->p_first;
+
+        while( *pp != p_job )
+            pp = &(*pp)->p_next;
+        *pp = p_job->p_next;
+        if( p_slices->pp_last == &p_job->p_next )
+            p_slices->pp_last = pp;
+    }
+    return i_slice;
+}
+
+/* Runs one slice of a job, p_slices->lock must be held. */
+static void SliceRun( filter_slices_t *p_slices, filter_slice_job_t *p_job,
+                      unsigned i_slice )
+{
+    vlc_mutex_unlock( &p_slices->lock );
+    p_job->pf_slice( p_job->p_filter, p_job->p_data, i_slice,
+                     p_job->i_slices );
+    vlc_mutex_lock( &p_slices->lock );
+
+    assert( p_job->i_pending > 0 );
+    if( --p_job->i_pending == 0 )
+        vlc_cond_broadcast( &p_slices->done );
+}
+
+static void *SliceThread( void *data )
+{
+    filter_slices_t *p_slices = data;
+
+    vlc_mutex_lock( &p_slices->lock );
+    for( ;; )
+    {
+        while( p_slices->p_first == NULL && !p_slices->b_exit )
+            vlc_cond_wait( &p_slices->wait, &p_slices->lock );
+        if( p_slices->p_first == NULL )
+            break;
+
+        filter_slice_job_t *p_job = p_slices->p_first;
+        SliceRun( p_slices, p_job, SliceClaim( p_slices, p_job ) );
+    }
+    vlc_mutex_unlock( &p_slices->lock );
+    return NULL;
+}
+
+static filter_slices_t *SlicesCreate( vlc_object_t *p_obj )
+{
+    int i_count = var_InheritInteger( p_obj, "filter-threads" );
+    if( i_count <= 0 )
+        i_count = __MIN( vlc_GetCPUCount(), FILTER_SLICES_MAX );
+    i_count = __MIN( i_count, FILTER_SLICES_MAX );
+
+    /* The calling thread runs slices too */
+    unsigned i_threads = i_count > 1 ? i_count - 1 : 0;
+    filter_slices_t *p_slices = malloc( sizeof(*p_slices)
+                                      + i_threads * sizeof(vlc_thread_t) );
+    if( unlikely(p_slices == NULL) )
+        return NULL;
+
+    vlc_mutex_init( &p_slices->lock );
+    vlc_cond_init( &p_slices->wait );
+    vlc_cond_init( &p_slices->done );
+    p_slices->p_first = NULL;
+    p_slices->pp_last = &p_slices->p_first;
+    p_slices->b_exit = false;
+    p_slices->i_threads = 0;
+
+    for( unsigned i = 0; i < i_threads; i++ )
+    {
+        if( vlc_clone( &p_slices->threads[i], SliceThread, p_slices,
+                       VLC_THREAD_PRIORITY_VIDEO ) )
+            break;
+        p_slices->i_threads++;
+    }
+    msg_Dbg( p_obj, "video filter slices: %u thread(s)",
+             p_slices->i_threads + 1 );
+    return p_slices;
+}
+
+void filter_DestroySlices( libvlc_int_t *p_libvlc )
+{
+    filter_slices_t *p_slices = libvlc_priv( p_libvlc )->p_slices;
+    if( p_slices == NULL )
+        return;
+
+    vlc_mutex_lock( &p_slices->lock );
+    assert( p_slices->p_first == NULL );
+    p_slices->b_exit = true;
+    vlc_cond_broadcast( &p_slices->wait );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    for( unsigned i = 0; i < p_slices->i_threads; i++ )
+        vlc_join( p_slices->threads[i], NULL );
+
+    vlc_cond_destroy( &p_slices->done );
+    vlc_cond_destroy( &p_slices->wait );
+    vlc_mutex_destroy( &p_slices->lock );
+    free( p_slices );
+    libvlc_priv( p_libvlc )->p_slices = NULL;
+}
+
+static filter_slices_t *SlicesGet( filter_t *p_filter )
+{
+    libvlc_priv_t *priv = libvlc_priv( p_filter->p_libvlc );
+
+    vlc_mutex_lock( &priv->slices_lock );
+    if( priv->p_slices == NULL )
+        priv->p_slices = SlicesCreate( VLC_OBJECT(p_filter) );
+    vlc_mutex_unlock( &priv->slices_lock );
+    return priv->p_slices;
+}
+
+void filter_RunSlices( filter_t *p_filter,
+                       void (*pf_slice)( filter_t *, void *,
+                                         unsigned, unsigned ),
+                       void *p_data, int i_lines )
+{
+    filter_slices_t *p_slices = SlicesGet( p_filter );
+    unsigned i_slices = 1;
+
+    if( p_slices != NULL && i_lines > 0 )
+        i_slices = __MIN( p_slices->i_threads + 1,
+                          (unsigned)i_lines / FILTER_SLICE_MIN_LINES );
+    if( i_slices <= 1 )
+    {
+        pf_slice( p_filter, p_data, 0, 1 );
+        return;
+    }
+
+    filter_slice_job_t job = {
+        .p_next = NULL,
+        .pf_slice = pf_slice,
+        .p_filter = p_filter,
+        .p_data = p_data,
+        .i_slices = i_slices,
+        .i_next = 0,
+        .i_pending = i_slices,
+    };
+
+    /* The job lives on this stack: it must not be abandoned half-way */
+    int canc = vlc_savecancel();
+
+    vlc_mutex_lock( &p_slices->lock );
+    *p_slices->pp_last = &job;
+    p_slices->pp_last = &job.p_next;
+    vlc_cond_broadcast( &p_slices->wait );
+
+    while( job.i_next < job.i_slices )
+        SliceRun( p_slices, &job, SliceClaim( p_slices, &job ) );
+    while( job.i_pending > 0 )
+        vlc_cond_wait( &p_slices->done, &p_slices->lock );
+    vlc_mutex_unlock( &p_slices->lock );
+
+    vlc_restorecancel( canc );
+}
+
+void filter_SlicePicture( picture_t *p_view, const picture_t *p_pic,
+                          int i_first, int i_end )
+{
+    const plane_t *p_luma = &p_pic->p[0];
+
+    memset( p_view, 0, sizeof(*p_view) );
+    p_view->format = p_pic->format;
+    p_view->i_planes = p_pic->i_planes;
+
+    for( int i = 0; i < p_pic->i_planes; i++ )
+    {
+        const plane_t *p_src = &p_pic->p[i];
+        plane_t *p_dst = &p_view->p[i];
+
+        /* Scale the band to the vertical subsampling of the plane */
+        int i_plane_first = i_first * p_src->i_lines / p_luma->i_lines;
+        int i_plane_end = i_end * p_src->i_lines / p_luma->i_lines;
+        if( i_end >= p_luma->i_visible_lines )
+            i_plane_end = __MAX( i_plane_end, p_src->i_visible_lines );
+
+        *p_dst = *p_src;
+        p_dst->p_pixels += i_plane_first * p_src->i_pitch;
+        p_dst->i_lines = __MAX( p_src->i_lines - i_plane_first, 0 );
+        p_dst->i_visible_lines = __MAX( __MIN( i_plane_end,
+                                               p_src->i_visible_lines )
+                                        - i_plane_first, 0 );
+    }
+}
+
 /* */
 #include <vlc_video_splitter.h>
 
@@ -356,6 +356,7 @@ typedef struct module_bank
 
     int            i_loaded_cache;
     module_cache_t *loaded_cache;
+    bool           b_stale; /* whether the loaded cache must be rewritten */
 } module_bank_t;
 
 static void AllocatePluginDir (module_bank_t *, unsigned,
@@ -393,6 +394,7 @@ static void AllocatePluginPath (vlc_object_t *p_this, const char *path,
     bank.i_cache = 0;
     bank.loaded_cache = cache;
     bank.i_loaded_cache = count;
+    bank.b_stale = false;
 
     /* Don't go deeper than 5 subdirectories */
     AllocatePluginDir (&bank, 5, path, NULL);
@@ -404,10 +406,22 @@ static void AllocatePluginPath (vlc_object_t *p_this, const char *path,
             for( size_t i = 0; i < count; i++ )
             {
                 if (cache[i].p_module != NULL)
+                {
                    vlc_module_destroy (cache[i].p_module);
+                   bank.b_stale = true;
+                }
                 free (cache[i].path);
             }
             free( cache );
+
+            if (!bank.b_stale)
+            {   /* The cache file is up to date, do not rewrite it */
+                for (size_t i = 0; i < bank.i_cache; i++)
+                    free (bank.cache[i].path);
+                free (bank.cache);
+                break;
+            }
+            /* fall through */
         case CACHE_RESET:
             CacheSave (p_this, path, bank.cache, bank.i_cache);
         case CACHE_IGNORE:
@@ -519,6 +533,8 @@ static int AllocatePluginFile (module_bank_t *bank, const char *abspath,
                 module = NULL;
             }
         }
+        if (module == NULL)
+            bank->b_stale = true;
     }
     if (module == NULL)
         module = module_InitDynamic (bank->obj, abspath, true);
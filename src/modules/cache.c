@@ -37,6 +37,10 @@
 #   include <unistd.h>
 #endif
 #include <assert.h>
+#include <fcntl.h>
+#ifdef HAVE_MMAP
+#   include <sys/mman.h>
+#endif
 
 #include <vlc_common.h>
 #include "libvlc.h"
@@ -57,7 +61,7 @@
 #ifdef HAVE_DYNAMIC_PLUGINS
 /* Sub-version number
  * (only used to avoid breakage in dev version when cache structure changes) */
-#define CACHE_SUBVERSION_NUM 22
+#define CACHE_SUBVERSION_NUM 23
 
 /* Cache filename */
 #define CACHE_NAME "plugins.dat"
@@ -78,144 +82,367 @@ void CacheDelete( vlc_object_t *obj, const char *dir )
     free( path );
 }
 
-#define LOAD_IMMEDIATE(a) \
-    if (fread (&(a), sizeof (char), sizeof (a), file) != sizeof (a)) \
-        goto error
-#define LOAD_FLAG(a) \
-    do { \
-        unsigned char b; \
-        LOAD_IMMEDIATE(b); \
-        if (b > 1) \
-            goto error; \
-        (a) = b; \
-    } while (0)
-
-static int CacheLoadString (char **p, FILE *file)
+/*
+ * Cache file layout
+ *
+ * The cache is a single relocatable image meant to be mapped read-only and
+ * used in place: module descriptors point directly to the strings and
+ * integer choices lists within the image. After the magic string, the file
+ * contains a cache_header_t and then records, tables and strings. All
+ * references are 32-bits offsets from the beginning of the file, 0 meaning
+ * NULL. The file always ends with a nul byte so that no string can overrun
+ * the image.
+ */
+typedef struct
 {
-    char *psz = NULL;
-    uint16_t size;
+    uint32_t subversion; /**< CACHE_SUBVERSION_NUM */
+    uint32_t size; /**< Total size of the file */
+    uint32_t count; /**< Number of plugins */
+    uint32_t plugins; /**< Table of cache_plugin_t */
+} cache_header_t;
 
-    LOAD_IMMEDIATE (size);
-    if (size > 16384)
-    {
-error:
+typedef struct
+{
+    uint32_t shortname;
+    uint32_t longname;
+    uint32_t help;
+    uint32_t capability;
+    uint32_t shortcuts; /**< Table of string offsets */
+    uint32_t i_shortcuts;
+    int32_t  score;
+} cache_module_t;
+
+#define CACHE_CFG_ADVANCED   0x01
+#define CACHE_CFG_INTERNAL   0x02
+#define CACHE_CFG_UNSAVEABLE 0x04
+#define CACHE_CFG_SAFE       0x08
+#define CACHE_CFG_REMOVED    0x10
+
+typedef struct
+{
+    module_value_t orig;
+    module_value_t min;
+    module_value_t max;
+    uint64_t list_cb; /**< XXX: see CacheLoadConfig() */
+    int      type;
+    char     i_short;
+    uint8_t  flags;
+    uint16_t list_count;
+    uint32_t psz_type;
+    uint32_t psz_name;
+    uint32_t psz_text;
+    uint32_t psz_longtext;
+    uint32_t orig_psz;
+    uint32_t list; /**< Table of string offsets or of integers */
+    uint32_t list_text; /**< Table of string offsets */
+} cache_config_t;
+
+typedef struct
+{
+    cache_module_t module;
+    int64_t  mtime;
+    int64_t  size;
+    uint32_t path;
+    uint32_t domain;
+    uint32_t config; /**< Table of cache_config_t */
+    uint32_t confsize;
+    uint32_t config_items;
+    uint32_t bool_items;
+    uint32_t submodules; /**< Table of cache_module_t */
+    uint32_t submodule_count;
+    uint32_t unloadable;
+} cache_plugin_t;
+
+#define CACHE_ALIGN 8
+#define CACHE_ALIGN_UP(n) (((n) + CACHE_ALIGN - 1) & ~(size_t)(CACHE_ALIGN - 1))
+
+/** Magic string, immediately followed by the cache_header_t */
+#ifdef DISTRO_VERSION
+static const char cache_magic[] = CACHE_STRING DISTRO_VERSION;
+#else
+static const char cache_magic[] = CACHE_STRING;
+#endif
+#define CACHE_HEADER_OFFSET CACHE_ALIGN_UP(sizeof (cache_magic) - 1)
+
+/** In-memory image of a cache file, shared by all the modules loaded from it */
+struct module_cache_map
+{
+    const char *base;
+    size_t      size;
+    unsigned    refs;
+    bool        mapped;
+};
+
+/**
+ * Releases a reference to a cache image. The image is unmapped when the last
+ * module referencing it is destroyed. This is serialized by the modules bank.
+ */
+void CacheRelease (module_cache_map_t *map)
+{
+    assert (map->refs > 0);
+    if (--map->refs > 0)
+        return;
+#ifdef HAVE_MMAP
+    if (map->mapped)
+        munmap ((void *)map->base, map->size);
+    else
+#endif
+        free ((void *)map->base);
+    free (map);
+}
+
+/** Checks that a table of count elements fits in the image */
+static const void *CacheTable (const module_cache_map_t *map, uint32_t offset,
+                               size_t count, size_t size, size_t align)
+{
+    if (count == 0)
+        return NULL;
+    if (offset == 0 || (offset & (align - 1))
+     || offset > map->size || count > (map->size - offset) / size)
+        return NULL;
+    return map->base + offset;
+}
+
+static int CacheString (char **p, const module_cache_map_t *map,
+                        uint32_t offset)
+{
+    if (offset >= map->size)
         return -1;
+    *p = offset ? (char *)(map->base + offset) : NULL;
+    return 0;
+}
+
+#define LOAD_STRING(a, offset) \
+    if (CacheString (&(a), map, (offset))) goto error
+
+/** Loads a table of strings, NULL being replaced with the empty string */
+static int CacheStringTable (char **tab, const module_cache_map_t *map,
+                             uint32_t offset, size_t count)
+{
+    const uint32_t *offsets = CacheTable (map, offset, count,
+                                          sizeof (uint32_t), 4);
+    if (offsets == NULL)
+        return -1;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        LOAD_STRING(tab[i], offsets[i]);
+        if (tab[i] == NULL)
+            tab[i] = (char *)"";
     }
+    return 0;
+error:
+    return -1;
+}
 
-    if (size > 0)
+static int CacheLoadModule (module_t *module, const module_cache_map_t *map,
+                            const cache_module_t *rec)
+{
+    LOAD_STRING(module->psz_shortname, rec->shortname);
+    LOAD_STRING(module->psz_longname, rec->longname);
+    LOAD_STRING(module->psz_help, rec->help);
+    LOAD_STRING(module->psz_capability, rec->capability);
+    module->i_score = rec->score;
+
+    if (rec->i_shortcuts > MODULE_SHORTCUT_MAX)
+        goto error;
+    if (rec->i_shortcuts > 0)
     {
-        psz = malloc (size+1);
-        if (unlikely(psz == NULL))
+        const uint32_t *offsets = CacheTable (map, rec->shortcuts,
+                                              rec->i_shortcuts,
+                                              sizeof (uint32_t), 4);
+        if (offsets == NULL)
             goto error;
-        if (fread (psz, 1, size, file) != size)
-        {
-            free (psz);
+
+        module->pp_shortcuts = malloc (rec->i_shortcuts * sizeof (char *));
+        if (unlikely(module->pp_shortcuts == NULL))
             goto error;
+        module->i_shortcuts = rec->i_shortcuts;
+        for (unsigned j = 0; j < module->i_shortcuts; j++)
+        {
+            LOAD_STRING(module->pp_shortcuts[j], offsets[j]);
+            if (module->pp_shortcuts[j] == NULL)
+                goto error;
         }
-        psz[size] = '\0';
     }
-    *p = psz;
     return 0;
+error:
+    return -1;
 }
 
-#define LOAD_STRING(a) \
-    if (CacheLoadString (&(a), file)) goto error
-
-static int CacheLoadConfig (module_config_t *cfg, FILE *file)
+static int CacheLoadConfig (module_config_t *cfg, char ***ptrs,
+                            const module_cache_map_t *map,
+                            const cache_config_t *rec)
 {
-    LOAD_IMMEDIATE (cfg->i_type);
-    LOAD_IMMEDIATE (cfg->i_short);
-    LOAD_FLAG (cfg->b_advanced);
-    LOAD_FLAG (cfg->b_internal);
-    LOAD_FLAG (cfg->b_unsaveable);
-    LOAD_FLAG (cfg->b_safe);
-    LOAD_FLAG (cfg->b_removed);
-    LOAD_STRING (cfg->psz_type);
-    LOAD_STRING (cfg->psz_name);
-    LOAD_STRING (cfg->psz_text);
-    LOAD_STRING (cfg->psz_longtext);
-    LOAD_IMMEDIATE (cfg->list_count);
+    cfg->i_type = rec->type;
+    cfg->i_short = rec->i_short;
+    cfg->b_advanced = (rec->flags & CACHE_CFG_ADVANCED) != 0;
+    cfg->b_internal = (rec->flags & CACHE_CFG_INTERNAL) != 0;
+    cfg->b_unsaveable = (rec->flags & CACHE_CFG_UNSAVEABLE) != 0;
+    cfg->b_safe = (rec->flags & CACHE_CFG_SAFE) != 0;
+    cfg->b_removed = (rec->flags & CACHE_CFG_REMOVED) != 0;
+    LOAD_STRING(cfg->psz_type, rec->psz_type);
+    LOAD_STRING(cfg->psz_name, rec->psz_name);
+    LOAD_STRING(cfg->psz_text, rec->psz_text);
+    LOAD_STRING(cfg->psz_longtext, rec->psz_longtext);
+    cfg->list_count = rec->list_count;
 
     if (IsConfigStringType (cfg->i_type))
     {
-        LOAD_STRING (cfg->orig.psz);
+        /* The current value is mutable and remains on the heap */
+        LOAD_STRING(cfg->orig.psz, rec->orig_psz);
         if (cfg->orig.psz != NULL)
+        {
             cfg->value.psz = strdup (cfg->orig.psz);
-        else
-            cfg->value.psz = NULL;
+            if (unlikely(cfg->value.psz == NULL))
+                goto error;
+        }
 
         if (cfg->list_count)
-            cfg->list.psz = xmalloc (cfg->list_count * sizeof (char *));
-        else /* TODO: fix config_GetPszChoices() instead of this hack: */
-            LOAD_IMMEDIATE(cfg->list.psz_cb);
-        for (unsigned i = 0; i < cfg->list_count; i++)
         {
-            LOAD_STRING (cfg->list.psz[i]);
-            if (cfg->list.psz[i] == NULL /* NULL -> empty string */
-             && (cfg->list.psz[i] = calloc (1, 1)) == NULL)
+            cfg->list.psz = *ptrs;
+            *ptrs += cfg->list_count;
+            if (CacheStringTable (cfg->list.psz, map, rec->list,
+                                  cfg->list_count))
                 goto error;
         }
+        else /* TODO: fix config_GetPszChoices() instead of this hack: */
+            cfg->list.psz_cb = (vlc_string_list_cb)(uintptr_t)rec->list_cb;
     }
     else
     {
-        LOAD_IMMEDIATE (cfg->orig);
-        LOAD_IMMEDIATE (cfg->min);
-        LOAD_IMMEDIATE (cfg->max);
+        cfg->orig = rec->orig;
+        cfg->min = rec->min;
+        cfg->max = rec->max;
         cfg->value = cfg->orig;
 
         if (cfg->list_count)
-            cfg->list.i = xmalloc (cfg->list_count * sizeof (int));
+        {
+            cfg->list.i = (int *)CacheTable (map, rec->list, cfg->list_count,
+                                             sizeof (int), sizeof (int));
+            if (cfg->list.i == NULL)
+                goto error;
+        }
         else /* TODO: fix config_GetPszChoices() instead of this hack: */
-            LOAD_IMMEDIATE(cfg->list.i_cb);
-        for (unsigned i = 0; i < cfg->list_count; i++)
-             LOAD_IMMEDIATE (cfg->list.i[i]);
+            cfg->list.i_cb = (vlc_integer_list_cb)(uintptr_t)rec->list_cb;
     }
-    cfg->list_text = xmalloc (cfg->list_count * sizeof (char *));
-    for (unsigned i = 0; i < cfg->list_count; i++)
+
+    if (cfg->list_count)
     {
-        LOAD_STRING (cfg->list_text[i]);
-        if (cfg->list_text[i] == NULL /* NULL -> empty string */
-         && (cfg->list_text[i] = calloc (1, 1)) == NULL)
+        cfg->list_text = *ptrs;
+        *ptrs += cfg->list_count;
+        if (CacheStringTable (cfg->list_text, map, rec->list_text,
+                              cfg->list_count))
             goto error;
     }
-
     return 0;
 error:
-    return -1; /* FIXME: leaks */
+    return -1;
 }
 
-static int CacheLoadModuleConfig (module_t *module, FILE *file)
+static int CacheLoadModuleConfig (module_t *module,
+                                  const module_cache_map_t *map,
+                                  const cache_plugin_t *rec)
 {
-    uint16_t lines;
+    size_t lines = rec->confsize;
 
-    /* Calculate the structure length */
-    LOAD_IMMEDIATE (module->i_config_items);
-    LOAD_IMMEDIATE (module->i_bool_items);
-    LOAD_IMMEDIATE (lines);
+    module->i_config_items = rec->config_items;
+    module->i_bool_items = rec->bool_items;
+    if (lines == 0)
+        return 0;
 
-    /* Allocate memory */
-    if (lines)
-    {
-        module->p_config = malloc (lines * sizeof (module_config_t));
-        if (unlikely(module->p_config == NULL))
-        {
-            module->confsize = 0;
-            return -1;
-        }
-    }
-    else
-        module->p_config = NULL;
+    const cache_config_t *tab = CacheTable (map, rec->config, lines,
+                                            sizeof (*tab), CACHE_ALIGN);
+    if (tab == NULL)
+        return -1;
+
+    /* Items and choices lists pointers are allocated in one go */
+    size_t n = 0;
+    for (size_t i = 0; i < lines; i++)
+        n += tab[i].list_count
+           * (IsConfigStringType (tab[i].type) ? 2 : 1);
+
+    module->p_config = calloc (1, lines * sizeof (module_config_t)
+                                  + n * sizeof (char *));
+    if (unlikely(module->p_config == NULL))
+        return -1;
     module->confsize = lines;
 
-    /* Do the duplication job */
+    char **ptrs = (char **)(module->p_config + lines);
     for (size_t i = 0; i < lines; i++)
-        if (CacheLoadConfig (module->p_config + i, file))
+        if (CacheLoadConfig (module->p_config + i, &ptrs, map, tab + i))
             return -1;
     return 0;
-error:
-    return -1; /* FIXME: leaks */
 }
 
+static module_cache_map_t *CacheMap (vlc_object_t *obj, const char *path)
+{
+    int fd = vlc_open (path, O_RDONLY);
+    if (fd == -1)
+    {
+        msg_Warn (obj, "cannot read %s (%m)", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat (fd, &st)
+     || st.st_size < (off_t)(CACHE_HEADER_OFFSET + sizeof (cache_header_t))
+     || st.st_size > UINT32_MAX)
+    {
+        msg_Warn (obj, "This doesn't look like a valid plugins cache "
+                  "(bad size)");
+        close (fd);
+        return NULL;
+    }
+
+    module_cache_map_t *map = malloc (sizeof (*map));
+    if (unlikely(map == NULL))
+    {
+        close (fd);
+        return NULL;
+    }
+    map->size = st.st_size;
+    map->refs = 1;
+    map->mapped = false;
+
+#ifdef HAVE_MMAP
+    void *addr = mmap (NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (addr != MAP_FAILED)
+    {
+        map->base = addr;
+        map->mapped = true;
+    }
+    else
+#endif
+    {
+        char *buf = malloc (map->size);
+        size_t done = 0;
+
+        while (buf != NULL && done < map->size)
+        {
+            ssize_t val = read (fd, buf + done, map->size - done);
+            if (val <= 0)
+            {
+                if (val < 0 && errno == EINTR)
+                    continue;
+                free (buf);
+                buf = NULL;
+            }
+            else
+                done += val;
+        }
+        map->base = buf;
+    }
+    close (fd);
+
+    if (map->base == NULL)
+    {
+        msg_Warn (obj, "cannot read %s (%m)", path);
+        free (map);
+        return NULL;
+    }
+    return map;
+}
 
 /**
  * Loads a plugins cache file.
@@ -228,11 +455,6 @@ error:
 size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
 {
     char *psz_filename;
-    FILE *file;
-    int i_size, i_read;
-    char p_cachestring[sizeof(CACHE_STRING)];
-    size_t i_cache;
-    int32_t i_marker;
 
     assert( dir != NULL );
 
@@ -242,146 +464,105 @@ size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
 
     msg_Dbg( p_this, "loading plugins cache file %s", psz_filename );
 
-    file = vlc_fopen( psz_filename, "rb" );
-    if( !file )
-    {
-        msg_Warn( p_this, "cannot read %s (%m)",
-                  psz_filename );
-        free( psz_filename );
-        return 0;
-    }
+    module_cache_map_t *map = CacheMap( p_this, psz_filename );
     free( psz_filename );
+    if( map == NULL )
+        return 0;
 
     /* Check the file is a plugins cache */
-    i_size = sizeof(CACHE_STRING) - 1;
-    i_read = fread( p_cachestring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_cachestring, CACHE_STRING, i_size ) )
+    if( memcmp( map->base, cache_magic, sizeof(cache_magic) - 1 ) )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
+        CacheRelease( map );
         return 0;
     }
 
-#ifdef DISTRO_VERSION
-    /* Check for distribution specific version */
-    char p_distrostring[sizeof( DISTRO_VERSION )];
-    i_size = sizeof( DISTRO_VERSION ) - 1;
-    i_read = fread( p_distrostring, 1, i_size, file );
-    if( i_read != i_size ||
-        memcmp( p_distrostring, DISTRO_VERSION, i_size ) )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache" );
-        fclose( file );
-        return 0;
-    }
-#endif
+    const cache_header_t *hdr =
+        (const cache_header_t *)(map->base + CACHE_HEADER_OFFSET);
 
     /* Check Sub-version number */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) || i_marker != CACHE_SUBVERSION_NUM )
+    if( hdr->subversion != CACHE_SUBVERSION_NUM || hdr->size != map->size
+     || map->base[map->size - 1] != '\0' )
     {
         msg_Warn( p_this, "This doesn't look like a valid plugins cache "
                   "(corrupted header)" );
-        fclose( file );
+        CacheRelease( map );
         return 0;
     }
 
-    /* Check header marker */
-    i_read = fread( &i_marker, 1, sizeof(i_marker), file );
-    if( i_read != sizeof(i_marker) ||
-        i_marker != ftell( file ) - (int)sizeof(i_marker) )
-    {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(corrupted header)" );
-        fclose( file );
-        return 0;
-    }
+    size_t i_cache = hdr->count;
+    const cache_plugin_t *plugins = CacheTable( map, hdr->plugins, i_cache,
+                                                sizeof(*plugins), CACHE_ALIGN );
+    module_cache_t *cache = NULL;
+    size_t count = 0;
 
-    if (fread( &i_cache, 1, sizeof(i_cache), file ) != sizeof(i_cache) )
+    if( i_cache > 0 )
     {
-        msg_Warn( p_this, "This doesn't look like a valid plugins cache "
-                  "(file too short)" );
-        fclose( file );
-        return 0;
+        if( plugins == NULL )
+            goto error;
+        cache = malloc( i_cache * sizeof(*cache) );
+        if( unlikely(cache == NULL) )
+            goto error;
     }
 
-    module_cache_t *cache = NULL;
-
-    for (size_t count = 0; count < i_cache;)
+    for (; count < i_cache; count++)
     {
-        module_t *module;
-        int i_submodules;
-
-        module = vlc_module_create (NULL);
-
-        /* Load additional infos */
-        LOAD_STRING(module->psz_shortname);
-        LOAD_STRING(module->psz_longname);
-        LOAD_STRING(module->psz_help);
-
-        LOAD_IMMEDIATE(module->i_shortcuts);
-        if (module->i_shortcuts > MODULE_SHORTCUT_MAX)
+        const cache_plugin_t *rec = plugins + count;
+        module_t *module = vlc_module_create (NULL);
+        if (unlikely(module == NULL))
             goto error;
-        else
-        {
-            module->pp_shortcuts =
-                              xmalloc (sizeof (char **) * module->i_shortcuts);
-            for (unsigned j = 0; j < module->i_shortcuts; j++)
-                LOAD_STRING(module->pp_shortcuts[j]);
-        }
+        module->cache_map = map;
+        map->refs++;
 
-        LOAD_STRING(module->psz_capability);
-        LOAD_IMMEDIATE(module->i_score);
-        LOAD_IMMEDIATE(module->b_unloadable);
+        /* Load additional infos */
+        if (CacheLoadModule (module, map, &rec->module))
+            goto error_module;
+        module->b_unloadable = rec->unloadable != 0;
 
         /* Config stuff */
-        if (CacheLoadModuleConfig (module, file) != VLC_SUCCESS)
-            goto error;
+        if (CacheLoadModuleConfig (module, map, rec))
+            goto error_module;
 
-        LOAD_STRING(module->domain);
+        if (CacheString (&module->domain, map, rec->domain))
+            goto error_module;
         if (module->domain != NULL)
             vlc_bindtextdomain (module->domain);
 
-        LOAD_IMMEDIATE( i_submodules );
+        const cache_module_t *subs = CacheTable (map, rec->submodules,
+                                                 rec->submodule_count,
+                                                 sizeof (*subs), CACHE_ALIGN);
+        if (rec->submodule_count > 0 && subs == NULL)
+            goto error_module;
 
-        while( i_submodules-- )
+        for (uint32_t i = 0; i < rec->submodule_count; i++)
         {
             module_t *submodule = vlc_module_create (module);
-            free (submodule->pp_shortcuts);
-            LOAD_STRING(submodule->psz_shortname);
-            LOAD_STRING(submodule->psz_longname);
-
-            LOAD_IMMEDIATE(submodule->i_shortcuts);
-            if (submodule->i_shortcuts > MODULE_SHORTCUT_MAX)
-                goto error;
-            else
-            {
-                submodule->pp_shortcuts =
-                           xmalloc (sizeof (char **) * submodule->i_shortcuts);
-                for (unsigned j = 0; j < submodule->i_shortcuts; j++)
-                    LOAD_STRING(submodule->pp_shortcuts[j]);
-            }
-
-            LOAD_STRING(submodule->psz_capability);
-            LOAD_IMMEDIATE(submodule->i_score);
+            if (unlikely(submodule == NULL))
+                goto error_module;
+            submodule->cache_map = map;
+            map->refs++;
+            if (CacheLoadModule (submodule, map, subs + i))
+                goto error_module;
         }
 
-        char *path;
-        struct stat st;
-
         /* Load common info */
-        LOAD_STRING(path);
-        if (path == NULL)
-            goto error;
-        LOAD_IMMEDIATE(st.st_mtime);
-        LOAD_IMMEDIATE(st.st_size);
-
-        CacheAdd (&cache, &count, path, &st, module);
-        free (path);
-        /* TODO: deal with errors */
+        char *path;
+        if (CacheString (&path, map, rec->path) || path == NULL)
+            goto error_module;
+        /* NOTE: strdup() could be avoided, but the bank frees the paths */
+        cache[count].path = strdup (path);
+        if (unlikely(cache[count].path == NULL))
+            goto error_module;
+        cache[count].mtime = rec->mtime;
+        cache[count].size = rec->size;
+        cache[count].p_module = module;
+        continue;
+
+    error_module:
+        vlc_module_destroy (module);
+        goto error;
     }
-    fclose( file );
+    CacheRelease( map );
 
     *r = cache;
     return i_cache;
@@ -389,93 +570,184 @@ size_t CacheLoad( vlc_object_t *p_this, const char *dir, module_cache_t **r )
 error:
     msg_Warn( p_this, "plugins cache not loaded (corrupted)" );
 
-    /* TODO: cleanup */
-    fclose( file );
+    for (size_t i = 0; i < count; i++)
+    {
+        vlc_module_destroy (cache[i].p_module);
+        free (cache[i].path);
+    }
+    free (cache);
+    CacheRelease( map );
     return 0;
 }
 
-#define SAVE_IMMEDIATE( a ) \
-    if (fwrite (&(a), sizeof(a), 1, file) != 1) \
-        goto error
-#define SAVE_FLAG(a) \
-    do { \
-        char b = (a); \
-        SAVE_IMMEDIATE(b); \
-    } while (0)
+/** Cache file image being built */
+typedef struct
+{
+    char  *data;
+    size_t size;
+    size_t alloc;
+    bool   error;
+} cache_buffer_t;
 
-static int CacheSaveString (FILE *file, const char *str)
+/**
+ * Appends aligned data to the cache image (zeroes if data is NULL).
+ * \return the offset of the data in the image, 0 on error
+ */
+static uint32_t CacheAppend (cache_buffer_t *buf, const void *data,
+                             size_t len, size_t align)
 {
-    uint16_t size = (str != NULL) ? strlen (str) : 0;
+    size_t offset = (buf->size + align - 1) & ~(align - 1);
 
-    SAVE_IMMEDIATE (size);
-    if (size != 0 && fwrite (str, 1, size, file) != size)
+    if (buf->error || offset + len > UINT32_MAX)
+        goto error;
+
+    if (offset + len > buf->alloc)
     {
-error:
-        return -1;
+        size_t alloc = buf->alloc ? buf->alloc : 65536;
+        while (alloc < offset + len)
+            alloc *= 2;
+
+        char *p = realloc (buf->data, alloc);
+        if (unlikely(p == NULL))
+            goto error;
+        buf->data = p;
+        buf->alloc = alloc;
     }
+
+    memset (buf->data + buf->size, 0, offset - buf->size);
+    if (data != NULL)
+        memcpy (buf->data + offset, data, len);
+    else
+        memset (buf->data + offset, 0, len);
+    buf->size = offset + len;
+    return offset;
+error:
+    buf->error = true;
     return 0;
 }
 
-#define SAVE_STRING( a ) \
-    if (CacheSaveString (file, (a))) \
-        goto error
+static uint32_t CacheAppendString (cache_buffer_t *buf, const char *str)
+{
+    return (str != NULL) ? CacheAppend (buf, str, strlen (str) + 1, 1) : 0;
+}
+
+static uint32_t CacheAppendStringTable (cache_buffer_t *buf,
+                                        char *const *tab, size_t count)
+{
+    if (count == 0)
+        return 0;
+
+    uint32_t offset = CacheAppend (buf, NULL, count * sizeof (uint32_t), 4);
+    for (size_t i = 0; i < count; i++)
+    {
+        uint32_t str = CacheAppendString (buf, tab[i]);
+        if (!buf->error)
+            memcpy (buf->data + offset + i * sizeof (str), &str, sizeof (str));
+    }
+    return offset;
+}
+
+static void CacheSaveModule (cache_buffer_t *buf, cache_module_t *rec,
+                             const module_t *module)
+{
+    rec->shortname = CacheAppendString (buf, module->psz_shortname);
+    rec->longname = CacheAppendString (buf, module->psz_longname);
+    rec->help = CacheAppendString (buf, module->psz_help);
+    rec->capability = CacheAppendString (buf, module->psz_capability);
+    rec->shortcuts = CacheAppendStringTable (buf, module->pp_shortcuts,
+                                             module->i_shortcuts);
+    rec->i_shortcuts = module->i_shortcuts;
+    rec->score = module->i_score;
+}
 
-static int CacheSaveConfig (FILE *file, const module_config_t *cfg)
+static void CacheSaveConfig (cache_buffer_t *buf, cache_config_t *rec,
+                             const module_config_t *cfg)
 {
-    SAVE_IMMEDIATE (cfg->i_type);
-    SAVE_IMMEDIATE (cfg->i_short);
-    SAVE_FLAG (cfg->b_advanced);
-    SAVE_FLAG (cfg->b_internal);
-    SAVE_FLAG (cfg->b_unsaveable);
-    SAVE_FLAG (cfg->b_safe);
-    SAVE_FLAG (cfg->b_removed);
-    SAVE_STRING (cfg->psz_type);
-    SAVE_STRING (cfg->psz_name);
-    SAVE_STRING (cfg->psz_text);
-    SAVE_STRING (cfg->psz_longtext);
-    SAVE_IMMEDIATE (cfg->list_count);
+    rec->type = cfg->i_type;
+    rec->i_short = cfg->i_short;
+    rec->flags = (cfg->b_advanced ? CACHE_CFG_ADVANCED : 0)
+               | (cfg->b_internal ? CACHE_CFG_INTERNAL : 0)
+               | (cfg->b_unsaveable ? CACHE_CFG_UNSAVEABLE : 0)
+               | (cfg->b_safe ? CACHE_CFG_SAFE : 0)
+               | (cfg->b_removed ? CACHE_CFG_REMOVED : 0);
+    rec->psz_type = CacheAppendString (buf, cfg->psz_type);
+    rec->psz_name = CacheAppendString (buf, cfg->psz_name);
+    rec->psz_text = CacheAppendString (buf, cfg->psz_text);
+    rec->psz_longtext = CacheAppendString (buf, cfg->psz_longtext);
+    rec->list_count = cfg->list_count;
 
     if (IsConfigStringType (cfg->i_type))
     {
-        SAVE_STRING (cfg->orig.psz);
-        if (cfg->list_count == 0)
-            SAVE_IMMEDIATE (cfg->list.psz_cb); /* XXX: see CacheLoadConfig() */
-        for (unsigned i = 0; i < cfg->list_count; i++)
-            SAVE_STRING (cfg->list.psz[i]);
+        rec->orig_psz = CacheAppendString (buf, cfg->orig.psz);
+        if (cfg->list_count == 0) /* XXX: see CacheLoadConfig() */
+            rec->list_cb = (uintptr_t)cfg->list.psz_cb;
+        rec->list = CacheAppendStringTable (buf, cfg->list.psz,
+                                            cfg->list_count);
     }
     else
     {
-        SAVE_IMMEDIATE (cfg->orig);
-        SAVE_IMMEDIATE (cfg->min);
-        SAVE_IMMEDIATE (cfg->max);
-        if (cfg->list_count == 0)
-            SAVE_IMMEDIATE (cfg->list.i_cb); /* XXX: see CacheLoadConfig() */
-        for (unsigned i = 0; i < cfg->list_count; i++)
-             SAVE_IMMEDIATE (cfg->list.i[i]);
+        rec->orig = cfg->orig;
+        rec->min = cfg->min;
+        rec->max = cfg->max;
+        if (cfg->list_count == 0) /* XXX: see CacheLoadConfig() */
+            rec->list_cb = (uintptr_t)cfg->list.i_cb;
+        else
+            rec->list = CacheAppend (buf, cfg->list.i,
+                                     cfg->list_count * sizeof (int),
+                                     sizeof (int));
     }
-    for (unsigned i = 0; i < cfg->list_count; i++)
-        SAVE_STRING (cfg->list_text[i]);
-
-    return 0;
-error:
-    return -1;
+    rec->list_text = CacheAppendStringTable (buf, cfg->list_text,
+                                             cfg->list_count);
 }
 
-static int CacheSaveModuleConfig (FILE *file, const module_t *module)
+static void CacheSaveModuleConfig (cache_buffer_t *buf, cache_plugin_t *rec,
+                                   const module_t *module)
 {
-    uint16_t lines = module->confsize;
+    rec->config_items = module->i_config_items;
+    rec->bool_items = module->i_bool_items;
+    rec->confsize = module->confsize;
+    if (module->confsize == 0)
+        return;
 
-    SAVE_IMMEDIATE (module->i_config_items);
-    SAVE_IMMEDIATE (module->i_bool_items);
-    SAVE_IMMEDIATE (lines);
+    rec->config = CacheAppend (buf, NULL,
+                               module->confsize * sizeof (cache_config_t),
+                               CACHE_ALIGN);
+    for (size_t i = 0; i < module->confsize; i++)
+    {
+        cache_config_t cfg;
 
-    for (size_t i = 0; i < lines; i++)
-        if (CacheSaveConfig (file, module->p_config + i))
-           goto error;
+        memset (&cfg, 0, sizeof (cfg));
+        CacheSaveConfig (buf, &cfg, module->p_config + i);
+        if (!buf->error)
+            memcpy (buf->data + rec->config + i * sizeof (cfg), &cfg,
+                    sizeof (cfg));
+    }
+}
 
-    return 0;
-error:
-    return -1;
+static void CacheSaveSubmodules (cache_buffer_t *buf, cache_plugin_t *rec,
+                                 const module_t *module)
+{
+    size_t n = module->submodule_count;
+
+    rec->submodule_count = n;
+    if (n == 0)
+        return;
+
+    rec->submodules = CacheAppend (buf, NULL, n * sizeof (cache_module_t),
+                                   CACHE_ALIGN);
+    /* Submodules are stored in reverse order, since loading reverses it */
+    for (const module_t *p = module->submodule; p != NULL && n > 0;
+         p = p->next)
+    {
+        cache_module_t sub;
+
+        memset (&sub, 0, sizeof (sub));
+        CacheSaveModule (buf, &sub, p);
+        n--;
+        if (!buf->error)
+            memcpy (buf->data + rec->submodules + n * sizeof (sub), &sub,
+                    sizeof (sub));
+    }
 }
 
 static int CacheSaveBank( FILE *file, const module_cache_t *, size_t );
@@ -529,95 +801,65 @@ out:
     free (entries);
 }
 
-static int CacheSaveSubmodule (FILE *, const module_t *);
-
 static int CacheSaveBank (FILE *file, const module_cache_t *cache,
                           size_t i_cache)
 {
-    uint32_t i_file_size = 0;
+    cache_buffer_t buf = { NULL, 0, 0, false };
+    cache_header_t hdr;
 
-    /* Contains version number */
-    if (fputs (CACHE_STRING, file) == EOF)
-        goto error;
-#ifdef DISTRO_VERSION
-    /* Allow binary maintaner to pass a string to detect new binary version*/
-    if (fputs( DISTRO_VERSION, file ) == EOF)
-        goto error;
-#endif
-    /* Sub-version number (to avoid breakage in the dev version when cache
-     * structure changes) */
-    i_file_size = CACHE_SUBVERSION_NUM;
-    if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1 )
-        goto error;
+    /* Contains version number (and distribution specific version) */
+    CacheAppend (&buf, cache_magic, sizeof (cache_magic) - 1, 1);
+    uint32_t hdr_offset = CacheAppend (&buf, NULL, sizeof (hdr), CACHE_ALIGN);
+    assert (buf.error || hdr_offset == CACHE_HEADER_OFFSET);
 
-    /* Header marker */
-    i_file_size = ftell( file );
-    if (fwrite (&i_file_size, sizeof (i_file_size), 1, file) != 1)
-        goto error;
+    hdr.plugins = CacheAppend (&buf, NULL, i_cache * sizeof (cache_plugin_t),
+                               CACHE_ALIGN);
 
-    if (fwrite( &i_cache, sizeof (i_cache), 1, file) != 1)
-        goto error;
-
-    for (unsigned i = 0; i < i_cache; i++)
+    for (size_t i = 0; i < i_cache; i++)
     {
-        module_t *module = cache[i].p_module;
-        uint32_t i_submodule;
-
-        /* Save additional infos */
-        SAVE_STRING(module->psz_shortname);
-        SAVE_STRING(module->psz_longname);
-        SAVE_STRING(module->psz_help);
-        SAVE_IMMEDIATE(module->i_shortcuts);
-        for (unsigned j = 0; j < module->i_shortcuts; j++)
-            SAVE_STRING(module->pp_shortcuts[j]);
+        const module_t *module = cache[i].p_module;
+        cache_plugin_t rec;
 
-        SAVE_STRING(module->psz_capability);
-        SAVE_IMMEDIATE(module->i_score);
-        SAVE_IMMEDIATE(module->b_unloadable);
+        memset (&rec, 0, sizeof (rec));
+        CacheSaveModule (&buf, &rec.module, module);
+        rec.unloadable = module->b_unloadable;
 
         /* Config stuff */
-        if (CacheSaveModuleConfig (file, module))
-            goto error;
-
-        SAVE_STRING(module->domain);
-
-        i_submodule = module->submodule_count;
-        SAVE_IMMEDIATE( i_submodule );
-        if (CacheSaveSubmodule (file, module->submodule))
-            goto error;
+        CacheSaveModuleConfig (&buf, &rec, module);
+        rec.domain = CacheAppendString (&buf, module->domain);
+        CacheSaveSubmodules (&buf, &rec, module);
 
         /* Save common info */
-        SAVE_STRING(cache[i].path);
-        SAVE_IMMEDIATE(cache[i].mtime);
-        SAVE_IMMEDIATE(cache[i].size);
+        rec.path = CacheAppendString (&buf, cache[i].path);
+        rec.mtime = cache[i].mtime;
+        rec.size = cache[i].size;
+
+        if (!buf.error)
+            memcpy (buf.data + hdr.plugins + i * sizeof (rec), &rec,
+                    sizeof (rec));
     }
 
-    if (fflush (file)) /* flush libc buffers */
+    /* Terminating nul byte, so that strings cannot overrun the image */
+    CacheAppend (&buf, "", 1, 1);
+    if (buf.error)
         goto error;
-    return 0; /* success! */
 
-error:
-    return -1;
-}
+    /* Sub-version number (to avoid breakage in the dev version when cache
+     * structure changes) */
+    hdr.subversion = CACHE_SUBVERSION_NUM;
+    hdr.size = buf.size;
+    hdr.count = i_cache;
+    memcpy (buf.data + hdr_offset, &hdr, sizeof (hdr));
 
-static int CacheSaveSubmodule( FILE *file, const module_t *p_module )
-{
-    if( !p_module )
-        return 0;
-    if( CacheSaveSubmodule( file, p_module->next ) )
+    if (fwrite (buf.data, 1, buf.size, file) != buf.size)
         goto error;
-
-    SAVE_STRING( p_module->psz_shortname );
-    SAVE_STRING( p_module->psz_longname );
-    SAVE_IMMEDIATE( p_module->i_shortcuts );
-    for( unsigned j = 0; j < p_module->i_shortcuts; j++ )
-         SAVE_STRING( p_module->pp_shortcuts[j] );
-
-    SAVE_STRING( p_module->psz_capability );
-    SAVE_IMMEDIATE( p_module->i_score );
-    return 0;
+    if (fflush (file)) /* flush libc buffers */
+        goto error;
+    free (buf.data);
+    return 0; /* success! */
 
 error:
+    free (buf.data);
     return -1;
 }
 
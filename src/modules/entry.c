@@ -80,6 +80,7 @@ module_t *vlc_module_create (module_t *parent)
     /*module->handle = garbage */
     module->psz_filename = NULL;
     module->domain = NULL;
+    module->cache_map = NULL;
     return module;
 }
 
@@ -97,6 +98,21 @@ void vlc_module_destroy (module_t *module)
         vlc_module_destroy (m);
     }
 
+#ifdef HAVE_DYNAMIC_PLUGINS
+    if (module->cache_map != NULL)
+    {   /* Strings and lists point to the plugins cache image */
+        for (size_t i = 0; i < module->confsize; i++)
+            if (IsConfigStringType (module->p_config[i].i_type))
+                free (module->p_config[i].value.psz);
+        free (module->p_config);
+        free (module->psz_filename);
+        free (module->pp_shortcuts);
+        CacheRelease (module->cache_map);
+        free (module);
+        return;
+    }
+#endif
+
     config_Free (module->p_config, module->confsize);
 
     free (module->domain);
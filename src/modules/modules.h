@@ -43,6 +43,9 @@ struct module_cache_t
 
 #define MODULE_SHORTCUT_MAX 20
 
+/** Memory-mapped plugins cache image */
+typedef struct module_cache_map module_cache_map_t;
+
 /** The module handle type */
 typedef void *module_handle_t;
 
@@ -98,6 +101,8 @@ struct module_t
     module_handle_t     handle;                             /* Unique handle */
     char *              psz_filename;                     /* Module filename */
     char *              domain;                            /* gettext domain */
+    /* Cache image holding the strings and lists, NULL if they are allocated */
+    module_cache_map_t *cache_map;
 };
 
 module_t *vlc_plugin_describe (vlc_plugin_cb);
@@ -123,6 +128,7 @@ void module_Unload (module_handle_t);
 void   CacheMerge (vlc_object_t *, module_t *, module_t *);
 void   CacheDelete(vlc_object_t *, const char *);
 size_t CacheLoad  (vlc_object_t *, const char *, module_cache_t **);
+void   CacheRelease (module_cache_map_t *);
 
 struct stat;
 
@@ -51,6 +51,9 @@
 #ifdef HAVE_POLL
 # include <poll.h>
 #endif
+#ifdef HAVE_SYS_EPOLL_H
+# include <sys/epoll.h>
+#endif
 
 #if defined( WIN32 )
 #   include <winsock2.h>
@@ -67,7 +70,27 @@
 
 static void httpd_ClientClean( httpd_client_t *cl );
 
-/* each host run in his own thread */
+/* clients of a host are spread over a few worker threads, each of them
+ * owning its clients and waiting for their events on its own */
+typedef struct
+{
+    httpd_host_t *host;
+
+    vlc_thread_t thread;
+    vlc_mutex_t  lock;
+#ifdef HAVE_SYS_EPOLL_H
+    int          epfd;
+#endif
+
+    int            i_client;
+    httpd_client_t **client;
+
+    mtime_t i_sweep;    /* date of the next timeout and idle client check */
+    bool    b_idle;     /* some clients are not waiting for any event */
+} httpd_worker_t;
+
+#define HTTPD_SWEEP_DELAY (CLOCK_FREQ / 50)
+
 struct httpd_host_t
 {
     VLC_COMMON_MEMBERS
@@ -80,10 +103,12 @@ struct httpd_host_t
     unsigned     nfd;
     unsigned     port;
 
-    vlc_thread_t thread;
     vlc_mutex_t lock;
     vlc_cond_t  wait;
 
+    unsigned       i_worker;
+    httpd_worker_t *worker;
+
     /* all registered url (becarefull that 2 httpd_url_t could point at the same url)
      * This will slow down the url research but make my live easier
      * All url will have their cb trigger, but only the first one can answer
@@ -91,9 +116,6 @@ struct httpd_host_t
     int         i_url;
     httpd_url_t **url;
 
-    int            i_client;
-    httpd_client_t **client;
-
     /* TLS data */
     vlc_tls_creds_t *p_tls;
 };
@@ -126,6 +148,7 @@ enum
     HTTPD_CLIENT_SEND_DONE,
 
     HTTPD_CLIENT_WAITING,
+    HTTPD_CLIENT_STREAMING, /* sending straight from a httpd_stream_t */
 
     HTTPD_CLIENT_DEAD,
 
@@ -150,6 +173,7 @@ struct httpd_client_t
 
     bool    b_stream_mode;
     uint8_t i_state;
+    short   i_events;   /* poll events the client is waiting for */
 
     mtime_t i_activity_date;
     mtime_t i_activity_timeout;
@@ -163,6 +187,9 @@ struct httpd_client_t
     httpd_message_t query;  /* client -> httpd */
     httpd_message_t answer; /* httpd -> client */
 
+    /* stream served without copy, NULL otherwise */
+    httpd_stream_t *stream;
+
     /* TLS data */
     vlc_tls_t *p_tls;
 };
@@ -618,6 +645,7 @@ void httpd_RedirectDelete( httpd_redirect_t *rdir )
 struct httpd_stream_t
 {
     vlc_mutex_t lock;
+    vlc_cond_t  wait; /* signaled when a worker unpins the buffer */
     httpd_url_t *url;
 
     char    *psz_mime;
@@ -631,6 +659,12 @@ struct httpd_stream_t
     uint8_t     *p_buffer;          /* buffer */
     int64_t     i_buffer_pos;       /* absolute position from begining */
     int64_t     i_buffer_last_pos;  /* a new connection will start with that */
+    int         i_buffer_writing;   /* bytes the owner is about to write */
+
+    /* data being sent by the workers, that must not be overwritten */
+    int64_t     *pi_pin;            /* absolute start positions */
+    int         i_pin;
+    int         i_pin_max;          /* allocated pins */
 };
 
 static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
@@ -654,9 +688,11 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
                  answer->i_body_offset );
 #endif
 
+        vlc_mutex_lock( &stream->lock );
         if( answer->i_body_offset >= stream->i_buffer_pos )
         {
             /* fprintf( stderr, "httpd_StreamCallBack: no data\n" ); */
+            vlc_mutex_unlock( &stream->lock );
             return VLC_EGENERIC;    /* wait, no data available */
         }
         if( answer->i_body_offset + stream->i_buffer_size <
@@ -678,6 +714,7 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
         }
         else if( i_write <= 0 )
         {
+            vlc_mutex_unlock( &stream->lock );
             return VLC_EGENERIC;    /* wait, no data available */
         }
 
@@ -692,6 +729,7 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
         answer->i_body = i_write;
         answer->p_body = xmalloc( i_write );
         memcpy( answer->p_body, &stream->p_buffer[i_pos], i_write );
+        vlc_mutex_unlock( &stream->lock );
 
         answer->i_body_offset += i_write;
 
@@ -708,6 +746,10 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
         if( query->i_type != HTTPD_MSG_HEAD )
         {
             cl->b_stream_mode = true;
+            /* TLS sessions need the exact same data when a send is retried,
+             * so they keep working on private copies */
+            if( cl->p_tls == NULL )
+                cl->stream = stream;
             vlc_mutex_lock( &stream->lock );
             /* Send the header */
             if( stream->i_header > 0 )
@@ -762,6 +804,105 @@ static int httpd_StreamCallBack( httpd_callback_sys_t *p_sys,
     }
 }
 
+static ssize_t httpd_NetSend( httpd_client_t *, const uint8_t *, size_t );
+
+/* Whether data before the given position is being sent by a worker */
+static bool httpd_StreamPinned( httpd_stream_t *stream, int64_t i_pos )
+{
+    for( int i = 0; i < stream->i_pin; i++ )
+        if( stream->pi_pin[i] < i_pos )
+            return true;
+    return false;
+}
+
+static int httpd_StreamPin( httpd_stream_t *stream, int64_t i_pos )
+{
+    if( stream->i_pin == stream->i_pin_max )
+    {
+        int64_t *pi_pin = realloc( stream->pi_pin, ( stream->i_pin_max + 4 )
+                                                   * sizeof( *pi_pin ) );
+        if( unlikely(pi_pin == NULL) )
+            return VLC_ENOMEM;
+        stream->pi_pin = pi_pin;
+        stream->i_pin_max += 4;
+    }
+    stream->pi_pin[stream->i_pin++] = i_pos;
+    return VLC_SUCCESS;
+}
+
+static void httpd_StreamUnpin( httpd_stream_t *stream, int64_t i_pos )
+{
+    for( int i = 0; i < stream->i_pin; i++ )
+        if( stream->pi_pin[i] == i_pos )
+        {
+            stream->pi_pin[i] = stream->pi_pin[--stream->i_pin];
+            break;
+        }
+    vlc_cond_signal( &stream->wait );
+}
+
+/* Sends stream data straight out of the circular buffer, so that the only
+ * copy left for each client is the one into its socket. The lock is not held
+ * while sending: the data is pinned instead, and httpd_StreamSend() only
+ * waits if it is about to overwrite it, for at most one non-blocking send.
+ * Returns 1 if the socket is full, 0 if there is no more data to send and
+ * -1 on error. */
+static int httpd_StreamPush( httpd_client_t *cl )
+{
+    httpd_stream_t *stream = cl->stream;
+
+    for( ;; )
+    {
+        vlc_mutex_lock( &stream->lock );
+        int64_t i_offset = cl->answer.i_body_offset;
+
+        if( i_offset + stream->i_buffer_size
+              < stream->i_buffer_pos + stream->i_buffer_writing )
+        {
+            /* this client isn't fast enough (or the data is being
+             * overwritten) */
+            i_offset = stream->i_buffer_last_pos;
+            cl->answer.i_body_offset = i_offset;
+        }
+        if( i_offset >= stream->i_buffer_pos )
+        {
+            vlc_mutex_unlock( &stream->lock );
+            return 0;
+        }
+
+        int i_pos = i_offset % stream->i_buffer_size;
+        size_t i_len = __MIN( stream->i_buffer_pos - i_offset,
+                              stream->i_buffer_size - i_pos );
+        if( httpd_StreamPin( stream, i_offset ) )
+        {
+            vlc_mutex_unlock( &stream->lock );
+            return -1;
+        }
+        vlc_mutex_unlock( &stream->lock );
+
+        ssize_t i_sent = httpd_NetSend( cl, &stream->p_buffer[i_pos], i_len );
+
+        vlc_mutex_lock( &stream->lock );
+        httpd_StreamUnpin( stream, i_offset );
+        vlc_mutex_unlock( &stream->lock );
+
+        if( i_sent <= 0 )
+        {
+#if defined( WIN32 )
+            if( i_sent < 0 && WSAGetLastError() == WSAEWOULDBLOCK )
+#else
+            if( i_sent < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+#endif
+                return 1;
+            return -1;
+        }
+
+        cl->answer.i_body_offset += i_sent;
+        if( (size_t)i_sent < i_len )
+            return 1;
+    }
+}
+
 httpd_stream_t *httpd_StreamNew( httpd_host_t *host,
                                  const char *psz_url, const char *psz_mime,
                                  const char *psz_user, const char *psz_password )
@@ -775,6 +916,7 @@ httpd_stream_t *httpd_StreamNew( httpd_host_t *host,
         return NULL;
     }
     vlc_mutex_init( &stream->lock );
+    vlc_cond_init( &stream->wait );
     if( psz_mime && *psz_mime )
     {
         stream->psz_mime = strdup( psz_mime );
@@ -791,6 +933,10 @@ httpd_stream_t *httpd_StreamNew( httpd_host_t *host,
      * (this way i_body_offset can never be 0) */
     stream->i_buffer_pos = 1;
     stream->i_buffer_last_pos = 1;
+    stream->i_buffer_writing = 0;
+    stream->pi_pin = NULL;
+    stream->i_pin = 0;
+    stream->i_pin_max = 0;
 
     httpd_UrlCatch( stream->url, HTTPD_MSG_HEAD, httpd_StreamCallBack,
                     (httpd_callback_sys_t*)stream );
@@ -830,6 +976,13 @@ int httpd_StreamSend( httpd_stream_t *stream, uint8_t *p_data, int i_data )
     }
     vlc_mutex_lock( &stream->lock );
 
+    /* do not overwrite the data that workers are sending */
+    stream->i_buffer_writing = i_data;
+    while( httpd_StreamPinned( stream, stream->i_buffer_pos + i_data
+                                       - stream->i_buffer_size ) )
+        vlc_cond_wait( &stream->wait, &stream->lock );
+    stream->i_buffer_writing = 0;
+
     /* save this pointer (to be used by new connection) */
     stream->i_buffer_last_pos = stream->i_buffer_pos;
 
@@ -858,7 +1011,9 @@ int httpd_StreamSend( httpd_stream_t *stream, uint8_t *p_data, int i_data )
 void httpd_StreamDelete( httpd_stream_t *stream )
 {
     httpd_UrlDelete( stream->url );
+    vlc_cond_destroy( &stream->wait );
     vlc_mutex_destroy( &stream->lock );
+    free( stream->pi_pin );
     free( stream->psz_mime );
     free( stream->p_header );
     free( stream->p_buffer );
@@ -868,7 +1023,8 @@ void httpd_StreamDelete( httpd_stream_t *stream )
 /*****************************************************************************
  * Low level
  *****************************************************************************/
-static void* httpd_HostThread( void * );
+static void* httpd_WorkerThread( void * );
+static void httpd_WorkerRemove( httpd_worker_t *, int );
 static httpd_host_t *httpd_HostCreate( vlc_object_t *, const char *,
                                        const char *, vlc_tls_creds_t * );
 
@@ -1000,6 +1156,8 @@ static httpd_host_t *httpd_HostCreate( vlc_object_t *p_this,
     vlc_mutex_init( &host->lock );
     vlc_cond_init( &host->wait );
     host->i_ref = 1;
+    host->i_worker = 0;
+    host->worker = NULL;
 
     host->fds = net_ListenTCP( p_this, url.psz_host, port );
     if( host->fds == NULL )
@@ -1018,17 +1176,66 @@ static httpd_host_t *httpd_HostCreate( vlc_object_t *p_this,
     host->port     = port;
     host->i_url    = 0;
     host->url      = NULL;
-    host->i_client = 0;
-    host->client   = NULL;
     host->p_tls    = p_tls;
 
-    /* create the thread */
-    if( vlc_clone( &host->thread, httpd_HostThread, host,
-                   VLC_THREAD_PRIORITY_LOW ) )
+    /* create the worker threads */
+    unsigned i_worker = var_InheritInteger( p_this, "http-threads" );
+    if( i_worker == 0 )
+        i_worker = __MIN( vlc_GetCPUCount(), 4 );
+
+    host->worker = calloc( i_worker, sizeof( *host->worker ) );
+    if( host->worker == NULL )
+        goto error;
+
+    for( ; host->i_worker < i_worker; host->i_worker++ )
+    {
+        httpd_worker_t *w = &host->worker[host->i_worker];
+
+        w->host = host;
+        w->i_client = 0;
+        w->client = NULL;
+        w->i_sweep = 0;
+        w->b_idle = false;
+#ifdef HAVE_SYS_EPOLL_H
+        w->epfd = epoll_create1( EPOLL_CLOEXEC );
+        if( w->epfd == -1 )
+        {
+            msg_Err( p_this, "cannot create epoll instance: %m" );
+            break;
+        }
+
+        for( unsigned i = 0; i < host->nfd; i++ )
+        {
+            struct epoll_event ev = {
+                .events = EPOLLIN,
+                .data.ptr = &host->fds[i],
+            };
+# ifdef EPOLLEXCLUSIVE
+            /* only wake one worker up per incoming connection */
+            ev.events |= EPOLLEXCLUSIVE;
+# endif
+            epoll_ctl( w->epfd, EPOLL_CTL_ADD, host->fds[i], &ev );
+        }
+#endif
+        vlc_mutex_init( &w->lock );
+
+        if( vlc_clone( &w->thread, httpd_WorkerThread, w,
+                       VLC_THREAD_PRIORITY_LOW ) )
+        {
+            vlc_mutex_destroy( &w->lock );
+#ifdef HAVE_SYS_EPOLL_H
+            close( w->epfd );
+#endif
+            break;
+        }
+    }
+
+    if( host->i_worker < i_worker )
     {
         msg_Err( p_this, "cannot spawn http host thread" );
         goto error;
     }
+    msg_Dbg( p_this, "HTTP host serving with %u thread(s)", host->i_worker );
 
     /* now add it to httpd */
     TAB_APPEND( httpd.i_host, httpd.host, host );
@@ -1043,6 +1250,18 @@ error:
 
     if( host != NULL )
     {
+        for( unsigned i = 0; i < host->i_worker; i++ )
+        {
+            httpd_worker_t *w = &host->worker[i];
+
+            vlc_cancel( w->thread );
+            vlc_join( w->thread, NULL );
+            vlc_mutex_destroy( &w->lock );
+#ifdef HAVE_SYS_EPOLL_H
+            close( w->epfd );
+#endif
+        }
+        free( host->worker );
         net_ListenClose( host->fds );
         vlc_cond_destroy( &host->wait );
         vlc_mutex_destroy( &host->lock );
@@ -1076,8 +1295,10 @@ void httpd_HostDelete( httpd_host_t *host )
     }
     TAB_REMOVE( httpd.i_host, httpd.host, host );
 
-    vlc_cancel( host->thread );
-    vlc_join( host->thread, NULL );
+    for( unsigned j = 0; j < host->i_worker; j++ )
+        vlc_cancel( host->worker[j].thread );
+    for( unsigned j = 0; j < host->i_worker; j++ )
+        vlc_join( host->worker[j].thread, NULL );
 
     msg_Dbg( host, "HTTP host removed" );
 
@@ -1085,16 +1306,22 @@ void httpd_HostDelete( httpd_host_t *host )
     {
         msg_Err( host, "url still registered: %s", host->url[i]->psz_url );
     }
-    for( i = 0; i < host->i_client; i++ )
+    for( unsigned j = 0; j < host->i_worker; j++ )
     {
-        httpd_client_t *cl = host->client[i];
-        msg_Warn( host, "client still connected" );
-        httpd_ClientClean( cl );
-        TAB_REMOVE( host->i_client, host->client, cl );
-        free( cl );
-        i--;
-        /* TODO */
+        httpd_worker_t *w = &host->worker[j];
+
+        while( w->i_client > 0 )
+        {
+            msg_Warn( host, "client still connected" );
+            httpd_WorkerRemove( w, 0 );
+            /* TODO */
+        }
+        vlc_mutex_destroy( &w->lock );
+#ifdef HAVE_SYS_EPOLL_H
+        close( w->epfd );
+#endif
     }
+    free( host->worker );
 
     vlc_tls_Delete( host->p_tls );
     net_ListenClose( host->fds );
@@ -1164,28 +1391,37 @@ void httpd_UrlDelete( httpd_url_t *url )
 
     vlc_mutex_lock( &host->lock );
     TAB_REMOVE( host->i_url, host->url, url );
+    vlc_mutex_unlock( &host->lock );
 
-    vlc_mutex_destroy( &url->lock );
-    free( url->psz_url );
-    free( url->psz_user );
-    free( url->psz_password );
-
-    for( i = 0; i < host->i_client; i++ )
+    /* Clients belong to their worker thread, which may be waiting for their
+     * events: only mark them dead, the worker will close them. Once this is
+     * done, no worker can reach the URL anymore. */
+    for( unsigned j = 0; j < host->i_worker; j++ )
     {
-        httpd_client_t *client = host->client[i];
+        httpd_worker_t *w = &host->worker[j];
 
-        if( client->url == url )
+        vlc_mutex_lock( &w->lock );
+        for( i = 0; i < w->i_client; i++ )
         {
-            /* TODO complete it */
-            msg_Warn( host, "force closing connections" );
-            httpd_ClientClean( client );
-            TAB_REMOVE( host->i_client, host->client, client );
-            free( client );
-            i--;
+            httpd_client_t *client = w->client[i];
+
+            if( client->url == url )
+            {
+                /* TODO complete it */
+                msg_Warn( host, "force closing connections" );
+                client->url = NULL;
+                client->stream = NULL;
+                client->i_state = HTTPD_CLIENT_DEAD;
+            }
         }
+        vlc_mutex_unlock( &w->lock );
     }
+
+    vlc_mutex_destroy( &url->lock );
+    free( url->psz_url );
+    free( url->psz_user );
+    free( url->psz_password );
     free( url );
-    vlc_mutex_unlock( &host->lock );
 }
 
 static void httpd_MsgInit( httpd_message_t *msg )
@@ -1274,6 +1510,8 @@ static void httpd_ClientInit( httpd_client_t *cl, mtime_t now )
     cl->i_buffer = 0;
     cl->p_buffer = xmalloc( cl->i_buffer_size );
     cl->b_stream_mode = false;
+    cl->i_events = 0;
+    cl->stream = NULL;
 
     httpd_MsgInit( &cl->query );
     httpd_MsgInit( &cl->answer );
@@ -1833,7 +2071,8 @@ static void httpd_ClientSend( httpd_client_t *cl )
 
         if( cl->i_buffer >= cl->i_buffer_size )
         {
-            if( cl->answer.i_body == 0  && cl->answer.i_body_offset > 0 )
+            if( cl->answer.i_body == 0  && cl->answer.i_body_offset > 0
+             && cl->stream == NULL )
             {
                 /* catch more body data */
                 int     i_msg = cl->query.i_type;
@@ -1900,427 +2139,583 @@ static void httpd_ClientTlsHandshake( httpd_client_t *cl )
     }
 }
 
-static void* httpd_HostThread( void *data )
+/* Handles a received query */
+static void httpd_ClientAnswer( httpd_host_t *host, httpd_client_t *cl )
 {
-    httpd_host_t *host = data;
-    int canc = vlc_savecancel();
+    httpd_message_t *answer = &cl->answer;
+    httpd_message_t *query  = &cl->query;
+    int i_msg = query->i_type;
 
-    vlc_mutex_lock( &host->lock );
-    while( host->i_ref > 0 )
+    httpd_MsgInit( answer );
+
+    /* Handle what we received */
+    if( i_msg == HTTPD_MSG_ANSWER )
+    {
+        cl->url     = NULL;
+        cl->i_state = HTTPD_CLIENT_DEAD;
+    }
+    else if( i_msg == HTTPD_MSG_OPTIONS )
     {
-        struct pollfd ufd[host->nfd + host->i_client];
-        unsigned nfd;
-        for( nfd = 0; nfd < host->nfd; nfd++ )
-        {
-            ufd[nfd].fd = host->fds[nfd];
-            ufd[nfd].events = POLLIN;
-            ufd[nfd].revents = 0;
-        }
 
-        /* add all socket that should be read/write and close dead connection */
-        while( host->i_url <= 0 )
-        {
-            mutex_cleanup_push( &host->lock );
-            vlc_restorecancel( canc );
-            vlc_cond_wait( &host->wait, &host->lock );
-            canc = vlc_savecancel();
-            vlc_cleanup_pop();
-        }
+        answer->i_type   = HTTPD_MSG_ANSWER;
+        answer->i_proto  = query->i_proto;
+        answer->i_status = 200;
+        answer->i_body = 0;
+        answer->p_body = NULL;
 
-        mtime_t now = mdate();
-        bool b_low_delay = false;
+        httpd_MsgAdd( answer, "Server", "VLC/%s", VERSION );
+        httpd_MsgAdd( answer, "Content-Length", "0" );
 
-        for(int i_client = 0; i_client < host->i_client; i_client++ )
+        switch( query->i_proto )
         {
-            httpd_client_t *cl = host->client[i_client];
-            if( cl->i_ref < 0 || ( cl->i_ref == 0 &&
-                ( cl->i_state == HTTPD_CLIENT_DEAD ||
-                  ( cl->i_activity_timeout > 0 &&
-                    cl->i_activity_date+cl->i_activity_timeout < now) ) ) )
-            {
-                httpd_ClientClean( cl );
-                TAB_REMOVE( host->i_client, host->client, cl );
-                free( cl );
-                i_client--;
-                continue;
-            }
-
-            struct pollfd *pufd = ufd + nfd;
-            assert (pufd < ufd + (sizeof (ufd) / sizeof (ufd[0])));
-
-            pufd->fd = cl->fd;
-            pufd->events = pufd->revents = 0;
+            case HTTPD_PROTO_HTTP:
+                answer->i_version = 1;
+                httpd_MsgAdd( answer, "Allow",
+                              "GET,HEAD,POST,OPTIONS" );
+                break;
 
-            if( ( cl->i_state == HTTPD_CLIENT_RECEIVING )
-                  || ( cl->i_state == HTTPD_CLIENT_TLS_HS_IN ) )
-            {
-                pufd->events = POLLIN;
-            }
-            else if( ( cl->i_state == HTTPD_CLIENT_SENDING )
-                  || ( cl->i_state == HTTPD_CLIENT_TLS_HS_OUT ) )
+            case HTTPD_PROTO_RTSP:
             {
-                pufd->events = POLLOUT;
-            }
-            else if( cl->i_state == HTTPD_CLIENT_RECEIVE_DONE )
-            {
-                httpd_message_t *answer = &cl->answer;
-                httpd_message_t *query  = &cl->query;
-                int i_msg = query->i_type;
-
-                httpd_MsgInit( answer );
-
-                /* Handle what we received */
-                if( i_msg == HTTPD_MSG_ANSWER )
+                const char *p;
+                answer->i_version = 0;
+
+                p = httpd_MsgGet( query, "Cseq" );
+                if( p != NULL )
+                    httpd_MsgAdd( answer, "Cseq", "%s", p );
+                p = httpd_MsgGet( query, "Timestamp" );
+                if( p != NULL )
+                    httpd_MsgAdd( answer, "Timestamp", "%s", p );
+
+                p = httpd_MsgGet( query, "Require" );
+                if( p != NULL )
                 {
-                    cl->url     = NULL;
-                    cl->i_state = HTTPD_CLIENT_DEAD;
+                    answer->i_status = 551;
+                    httpd_MsgAdd( query, "Unsupported", "%s", p );
                 }
-                else if( i_msg == HTTPD_MSG_OPTIONS )
-                {
-
-                    answer->i_type   = HTTPD_MSG_ANSWER;
-                    answer->i_proto  = query->i_proto;
-                    answer->i_status = 200;
-                    answer->i_body = 0;
-                    answer->p_body = NULL;
 
-                    httpd_MsgAdd( answer, "Server", "VLC/%s", VERSION );
-                    httpd_MsgAdd( answer, "Content-Length", "0" );
-
-                    switch( query->i_proto )
-                    {
-                        case HTTPD_PROTO_HTTP:
-                            answer->i_version = 1;
-                            httpd_MsgAdd( answer, "Allow",
-                                          "GET,HEAD,POST,OPTIONS" );
-                            break;
+                httpd_MsgAdd( answer, "Public", "DESCRIBE,SETUP,"
+                              "TEARDOWN,PLAY,PAUSE,GET_PARAMETER" );
+                break;
+            }
+        }
 
-                        case HTTPD_PROTO_RTSP:
-                        {
-                            const char *p;
-                            answer->i_version = 0;
-
-                            p = httpd_MsgGet( query, "Cseq" );
-                            if( p != NULL )
-                                httpd_MsgAdd( answer, "Cseq", "%s", p );
-                            p = httpd_MsgGet( query, "Timestamp" );
-                            if( p != NULL )
-                                httpd_MsgAdd( answer, "Timestamp", "%s", p );
-
-                            p = httpd_MsgGet( query, "Require" );
-                            if( p != NULL )
-                            {
-                                answer->i_status = 551;
-                                httpd_MsgAdd( query, "Unsupported", "%s", p );
-                            }
+        cl->i_buffer = -1;  /* Force the creation of the answer in
+                             * httpd_ClientSend */
+        cl->i_state = HTTPD_CLIENT_SENDING;
+    }
+    else if( i_msg == HTTPD_MSG_NONE )
+    {
+        if( query->i_proto == HTTPD_PROTO_NONE )
+        {
+            cl->url = NULL;
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        }
+        else
+        {
+            char *p;
 
-                            httpd_MsgAdd( answer, "Public", "DESCRIBE,SETUP,"
-                                          "TEARDOWN,PLAY,PAUSE,GET_PARAMETER" );
-                            break;
-                        }
-                    }
+            /* unimplemented */
+            answer->i_proto  = query->i_proto ;
+            answer->i_type   = HTTPD_MSG_ANSWER;
+            answer->i_version= 0;
+            answer->i_status = 501;
 
-                    cl->i_buffer = -1;  /* Force the creation of the answer in
-                                         * httpd_ClientSend */
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
-                else if( i_msg == HTTPD_MSG_NONE )
-                {
-                    if( query->i_proto == HTTPD_PROTO_NONE )
-                    {
-                        cl->url = NULL;
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    }
-                    else
-                    {
-                        char *p;
+            answer->i_body = httpd_HtmlError (&p, 501, NULL);
+            answer->p_body = (uint8_t *)p;
+            httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
 
-                        /* unimplemented */
-                        answer->i_proto  = query->i_proto ;
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_version= 0;
-                        answer->i_status = 501;
+            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+            cl->i_state = HTTPD_CLIENT_SENDING;
+        }
+    }
+    else
+    {
+        bool b_auth_failed = false;
 
-                        answer->i_body = httpd_HtmlError (&p, 501, NULL);
-                        answer->p_body = (uint8_t *)p;
-                        httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
+        /* Search the url and trigger callbacks */
+        vlc_mutex_lock( &host->lock );
+        for(int i = 0; i < host->i_url; i++ )
+        {
+            httpd_url_t *url = host->url[i];
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                        cl->i_state = HTTPD_CLIENT_SENDING;
-                    }
-                }
-                else
+            if( !strcmp( url->psz_url, query->psz_url ) )
+            {
+                if( url->catch[i_msg].cb )
                 {
-                    bool b_auth_failed = false;
-
-                    /* Search the url and trigger callbacks */
-                    for(int i = 0; i < host->i_url; i++ )
+                    if( answer && ( *url->psz_user || *url->psz_password ) )
                     {
-                        httpd_url_t *url = host->url[i];
+                        /* create the headers */
+                        const char *b64 = httpd_MsgGet( query, "Authorization" ); /* BASIC id */
+                        char *user = NULL, *pass = NULL;
 
-                        if( !strcmp( url->psz_url, query->psz_url ) )
+                        if( b64 != NULL
+                         && !strncasecmp( b64, "BASIC", 5 ) )
                         {
-                            if( url->catch[i_msg].cb )
+                            b64 += 5;
+                            while( *b64 == ' ' )
+                                b64++;
+
+                            user = vlc_b64_decode( b64 );
+                            if (user != NULL)
                             {
-                                if( answer && ( *url->psz_user || *url->psz_password ) )
-                                {
-                                    /* create the headers */
-                                    const char *b64 = httpd_MsgGet( query, "Authorization" ); /* BASIC id */
-                                    char *user = NULL, *pass = NULL;
-
-                                    if( b64 != NULL
-                                     && !strncasecmp( b64, "BASIC", 5 ) )
-                                    {
-                                        b64 += 5;
-                                        while( *b64 == ' ' )
-                                            b64++;
-
-                                        user = vlc_b64_decode( b64 );
-                                        if (user != NULL)
-                                        {
-                                            pass = strchr (user, ':');
-                                            if (pass != NULL)
-                                                *pass++ = '\0';
-                                        }
-                                    }
-
-                                    if ((user == NULL) || (pass == NULL)
-                                     || strcmp (user, url->psz_user)
-                                     || strcmp (pass, url->psz_password))
-                                    {
-                                        httpd_MsgAdd( answer,
-                                                      "WWW-Authenticate",
-                                                      "Basic realm=\"VLC stream\"" );
-                                        /* We fail for all url */
-                                        b_auth_failed = true;
-                                        free( user );
-                                        break;
-                                    }
-
-                                    free( user );
-                                }
-
-                                if( !url->catch[i_msg].cb( url->catch[i_msg].p_sys, cl, answer, query ) )
-                                {
-                                    if( answer->i_proto == HTTPD_PROTO_NONE )
-                                    {
-                                        /* Raw answer from a CGI */
-                                        cl->i_buffer = cl->i_buffer_size;
-                                    }
-                                    else
-                                        cl->i_buffer = -1;
-
-                                    /* only one url can answer */
-                                    answer = NULL;
-                                    if( cl->url == NULL )
-                                    {
-                                        cl->url = url;
-                                    }
-                                }
+                                pass = strchr (user, ':');
+                                if (pass != NULL)
+                                    *pass++ = '\0';
                             }
                         }
-                    }
 
-                    if( answer )
-                    {
-                        char *p;
+                        if ((user == NULL) || (pass == NULL)
+                         || strcmp (user, url->psz_user)
+                         || strcmp (pass, url->psz_password))
+                        {
+                            httpd_MsgAdd( answer,
+                                          "WWW-Authenticate",
+                                          "Basic realm=\"VLC stream\"" );
+                            /* We fail for all url */
+                            b_auth_failed = true;
+                            free( user );
+                            break;
+                        }
 
-                        answer->i_proto  = query->i_proto;
-                        answer->i_type   = HTTPD_MSG_ANSWER;
-                        answer->i_version= 0;
+                        free( user );
+                    }
 
-                        if( b_auth_failed )
+                    if( !url->catch[i_msg].cb( url->catch[i_msg].p_sys, cl, answer, query ) )
+                    {
+                        if( answer->i_proto == HTTPD_PROTO_NONE )
                         {
-                            answer->i_status = 401;
+                            /* Raw answer from a CGI */
+                            cl->i_buffer = cl->i_buffer_size;
                         }
                         else
+                            cl->i_buffer = -1;
+
+                        /* only one url can answer */
+                        answer = NULL;
+                        if( cl->url == NULL )
                         {
-                            /* no url registered */
-                            answer->i_status = 404;
+                            cl->url = url;
                         }
+                    }
+                }
+            }
+        }
+        vlc_mutex_unlock( &host->lock );
 
-                        answer->i_body = httpd_HtmlError (&p,
-                                                          answer->i_status,
-                                                          query->psz_url);
-                        answer->p_body = (uint8_t *)p;
+        if( answer )
+        {
+            char *p;
 
-                        cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
-                        httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
-                        httpd_MsgAdd( answer, "Content-Type", "%s", "text/html" );
-                    }
+            answer->i_proto  = query->i_proto;
+            answer->i_type   = HTTPD_MSG_ANSWER;
+            answer->i_version= 0;
 
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
+            if( b_auth_failed )
+            {
+                answer->i_status = 401;
             }
-            else if( cl->i_state == HTTPD_CLIENT_SEND_DONE )
+            else
             {
-                if( !cl->b_stream_mode || cl->answer.i_body_offset == 0 )
-                {
-                    const char *psz_connection = httpd_MsgGet( &cl->answer, "Connection" );
-                    const char *psz_query = httpd_MsgGet( &cl->query, "Connection" );
-                    bool b_connection = false;
-                    bool b_keepalive = false;
-                    bool b_query = false;
-
-                    cl->url = NULL;
-                    if( psz_connection )
-                    {
-                        b_connection = ( strcasecmp( psz_connection, "Close" ) == 0 );
-                        b_keepalive = ( strcasecmp( psz_connection, "Keep-Alive" ) == 0 );
-                    }
+                /* no url registered */
+                answer->i_status = 404;
+            }
 
-                    if( psz_query )
-                    {
-                        b_query = ( strcasecmp( psz_query, "Close" ) == 0 );
-                    }
+            answer->i_body = httpd_HtmlError (&p,
+                                              answer->i_status,
+                                              query->psz_url);
+            answer->p_body = (uint8_t *)p;
 
-                    if( ( ( cl->query.i_proto == HTTPD_PROTO_HTTP ) &&
-                          ( ( cl->query.i_version == 0 && b_keepalive ) ||
-                            ( cl->query.i_version == 1 && !b_connection ) ) ) ||
-                        ( ( cl->query.i_proto == HTTPD_PROTO_RTSP ) &&
-                          !b_query && !b_connection ) )
-                    {
-                        httpd_MsgClean( &cl->query );
-                        httpd_MsgInit( &cl->query );
-
-                        cl->i_buffer = 0;
-                        cl->i_buffer_size = 1000;
-                        free( cl->p_buffer );
-                        cl->p_buffer = xmalloc( cl->i_buffer_size );
-                        cl->i_state = HTTPD_CLIENT_RECEIVING;
-                    }
-                    else
-                    {
-                        cl->i_state = HTTPD_CLIENT_DEAD;
-                    }
-                    httpd_MsgClean( &cl->answer );
-                }
-                else
-                {
-                    int64_t i_offset = cl->answer.i_body_offset;
-                    httpd_MsgClean( &cl->answer );
+            cl->i_buffer = -1;  /* Force the creation of the answer in httpd_ClientSend */
+            httpd_MsgAdd( answer, "Content-Length", "%d", answer->i_body );
+            httpd_MsgAdd( answer, "Content-Type", "%s", "text/html" );
+        }
 
-                    cl->answer.i_body_offset = i_offset;
-                    free( cl->p_buffer );
-                    cl->p_buffer = NULL;
-                    cl->i_buffer = 0;
-                    cl->i_buffer_size = 0;
+        cl->i_state = HTTPD_CLIENT_SENDING;
+    }
+}
 
-                    cl->i_state = HTTPD_CLIENT_WAITING;
-                }
-            }
-            else if( cl->i_state == HTTPD_CLIENT_WAITING )
-            {
-                int64_t i_offset = cl->answer.i_body_offset;
-                int     i_msg = cl->query.i_type;
+/* Handles a fully sent answer */
+static void httpd_ClientSent( httpd_client_t *cl )
+{
+    if( !cl->b_stream_mode || cl->answer.i_body_offset == 0 )
+    {
+        const char *psz_connection = httpd_MsgGet( &cl->answer, "Connection" );
+        const char *psz_query = httpd_MsgGet( &cl->query, "Connection" );
+        bool b_connection = false;
+        bool b_keepalive = false;
+        bool b_query = false;
+
+        cl->url = NULL;
+        if( psz_connection )
+        {
+            b_connection = ( strcasecmp( psz_connection, "Close" ) == 0 );
+            b_keepalive = ( strcasecmp( psz_connection, "Keep-Alive" ) == 0 );
+        }
 
-                httpd_MsgInit( &cl->answer );
-                cl->answer.i_body_offset = i_offset;
+        if( psz_query )
+        {
+            b_query = ( strcasecmp( psz_query, "Close" ) == 0 );
+        }
 
-                cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys, cl,
-                                          &cl->answer, &cl->query );
-                if( cl->answer.i_type != HTTPD_MSG_NONE )
-                {
-                    /* we have new data, so re-enter send mode */
-                    cl->i_buffer      = 0;
-                    cl->p_buffer      = cl->answer.p_body;
-                    cl->i_buffer_size = cl->answer.i_body;
-                    cl->answer.p_body = NULL;
-                    cl->answer.i_body = 0;
-                    cl->i_state = HTTPD_CLIENT_SENDING;
-                }
-            }
+        if( ( ( cl->query.i_proto == HTTPD_PROTO_HTTP ) &&
+              ( ( cl->query.i_version == 0 && b_keepalive ) ||
+                ( cl->query.i_version == 1 && !b_connection ) ) ) ||
+            ( ( cl->query.i_proto == HTTPD_PROTO_RTSP ) &&
+              !b_query && !b_connection ) )
+        {
+            httpd_MsgClean( &cl->query );
+            httpd_MsgInit( &cl->query );
+            cl->stream = NULL;
 
-            if (pufd->events != 0)
-                nfd++;
-            else
-                b_low_delay = true;
+            cl->i_buffer = 0;
+            cl->i_buffer_size = 1000;
+            free( cl->p_buffer );
+            cl->p_buffer = xmalloc( cl->i_buffer_size );
+            cl->i_state = HTTPD_CLIENT_RECEIVING;
         }
-        vlc_mutex_unlock( &host->lock );
-        vlc_restorecancel( canc );
+        else
+        {
+            cl->i_state = HTTPD_CLIENT_DEAD;
+        }
+        httpd_MsgClean( &cl->answer );
+    }
+    else
+    {
+        int64_t i_offset = cl->answer.i_body_offset;
+        httpd_MsgClean( &cl->answer );
 
-        /* we will wait 20ms (not too big) if HTTPD_CLIENT_WAITING */
-        int ret = poll( ufd, nfd, b_low_delay ? 20 : -1 );
+        cl->answer.i_body_offset = i_offset;
+        free( cl->p_buffer );
+        cl->p_buffer = NULL;
+        cl->i_buffer = 0;
+        cl->i_buffer_size = 0;
 
-        canc = vlc_savecancel();
-        vlc_mutex_lock( &host->lock );
-        switch( ret )
+        cl->i_state = ( cl->stream != NULL ) ? HTTPD_CLIENT_STREAMING
+                                             : HTTPD_CLIENT_WAITING;
+    }
+}
+
+/* Asks the URL handler for more data to send */
+static void httpd_ClientWait( httpd_client_t *cl )
+{
+    int64_t i_offset = cl->answer.i_body_offset;
+    int     i_msg = cl->query.i_type;
+
+    httpd_MsgInit( &cl->answer );
+    cl->answer.i_body_offset = i_offset;
+
+    cl->url->catch[i_msg].cb( cl->url->catch[i_msg].p_sys, cl,
+                              &cl->answer, &cl->query );
+    if( cl->answer.i_type != HTTPD_MSG_NONE )
+    {
+        /* we have new data, so re-enter send mode */
+        cl->i_buffer      = 0;
+        cl->p_buffer      = cl->answer.p_body;
+        cl->i_buffer_size = cl->answer.i_body;
+        cl->answer.p_body = NULL;
+        cl->answer.i_body = 0;
+        cl->i_state = HTTPD_CLIENT_SENDING;
+    }
+}
+
+/**
+ * Runs the client state machine up to its next I/O operation.
+ * \return the poll events the client is waiting for, or 0 if it has to be
+ * checked again later (waiting for data to send, or dead).
+ */
+static short httpd_ClientProcess( httpd_host_t *host, httpd_client_t *cl )
+{
+    for( ;; )
+    {
+        switch( cl->i_state )
         {
-            case -1:
-                if (errno != EINTR)
+            case HTTPD_CLIENT_RECEIVING:
+            case HTTPD_CLIENT_TLS_HS_IN:
+                return POLLIN;
+
+            case HTTPD_CLIENT_SENDING:
+            case HTTPD_CLIENT_TLS_HS_OUT:
+                return POLLOUT;
+
+            case HTTPD_CLIENT_RECEIVE_DONE:
+                httpd_ClientAnswer( host, cl );
+                break;
+
+            case HTTPD_CLIENT_SEND_DONE:
+                httpd_ClientSent( cl );
+                break;
+
+            case HTTPD_CLIENT_WAITING:
+                httpd_ClientWait( cl );
+                if( cl->i_state == HTTPD_CLIENT_WAITING )
+                    return 0;
+                break;
+
+            case HTTPD_CLIENT_STREAMING:
+                switch( httpd_StreamPush( cl ) )
                 {
-                    /* Kernel on low memory or a bug: pace */
-                    msg_Err( host, "polling error: %m" );
-                    msleep( 100000 );
+                    case 1:
+                        return POLLOUT;
+                    case 0:
+                        return 0;
                 }
-            case 0:
-                continue;
+                cl->i_state = HTTPD_CLIENT_DEAD;
+                break;
+
+            default: /* HTTPD_CLIENT_DEAD */
+                return 0;
         }
+    }
+}
 
-        /* Handle client sockets */
-        now = mdate();
-        nfd = host->nfd;
+static void httpd_WorkerRemove( httpd_worker_t *w, int i_client )
+{
+    httpd_client_t *cl = w->client[i_client];
 
-        for( int i_client = 0; i_client < host->i_client; i_client++ )
-        {
-            httpd_client_t *cl = host->client[i_client];
-            const struct pollfd *pufd = &ufd[nfd];
+#ifdef HAVE_SYS_EPOLL_H
+    if( cl->fd != -1 )
+        epoll_ctl( w->epfd, EPOLL_CTL_DEL, cl->fd, NULL );
+#endif
+    httpd_ClientClean( cl );
+    TAB_REMOVE( w->i_client, w->client, cl );
+    free( cl );
+}
 
-            assert( pufd < &ufd[sizeof(ufd) / sizeof(ufd[0])] );
+/* Advances a client and updates the events it is waiting for */
+static void httpd_WorkerUpdate( httpd_worker_t *w, httpd_client_t *cl )
+{
+    short i_events = httpd_ClientProcess( w->host, cl );
 
-            if( cl->fd != pufd->fd )
-                continue; // we were not waiting for this client
-            ++nfd;
-            if( pufd->revents == 0 )
-                continue; // no event received
+    if( cl->i_state == HTTPD_CLIENT_DEAD && cl->i_ref == 0 )
+    {
+        int i;
 
-            cl->i_activity_date = now;
+        TAB_FIND( w->i_client, w->client, cl, i );
+        assert( i >= 0 );
+        httpd_WorkerRemove( w, i );
+        return;
+    }
 
-            if( cl->i_state == HTTPD_CLIENT_RECEIVING )
-            {
-                httpd_ClientRecv( cl );
-            }
-            else if( cl->i_state == HTTPD_CLIENT_SENDING )
-            {
-                httpd_ClientSend( cl );
-            }
-            else if( cl->i_state == HTTPD_CLIENT_TLS_HS_IN
-                  || cl->i_state == HTTPD_CLIENT_TLS_HS_OUT )
-            {
-                httpd_ClientTlsHandshake( cl );
-            }
+    if( i_events == 0 )
+        w->b_idle = true;
+    if( i_events == cl->i_events )
+        return;
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev = {
+        .events = ((i_events & POLLIN) ? EPOLLIN : 0)
+                | ((i_events & POLLOUT) ? EPOLLOUT : 0),
+        .data.ptr = cl,
+    };
+    epoll_ctl( w->epfd, EPOLL_CTL_MOD, cl->fd, &ev );
+#endif
+    cl->i_events = i_events;
+}
+
+/* Drops timed out clients and retries the ones without pending I/O */
+static void httpd_WorkerSweep( httpd_worker_t *w, mtime_t now )
+{
+    w->b_idle = false;
+    w->i_sweep = now + HTTPD_SWEEP_DELAY;
+
+    for( int i = 0; i < w->i_client; i++ )
+    {
+        httpd_client_t *cl = w->client[i];
+
+        if( cl->i_ref < 0 || ( cl->i_ref == 0 &&
+            ( cl->i_state == HTTPD_CLIENT_DEAD ||
+              ( cl->i_activity_timeout > 0 &&
+                cl->i_activity_date+cl->i_activity_timeout < now) ) ) )
+        {
+            httpd_WorkerRemove( w, i );
+            i--;
+            continue;
         }
 
-        /* Handle server sockets (accept new connections) */
-        for( nfd = 0; nfd < host->nfd; nfd++ )
+        if( cl->i_events == 0 )
         {
-            httpd_client_t *cl;
-            int fd = ufd[nfd].fd;
+            httpd_WorkerUpdate( w, cl );
+            if( i < w->i_client && w->client[i] != cl )
+                i--; /* removed */
+        }
+    }
+}
 
-            assert (fd == host->fds[nfd]);
+/* Performs the I/O a client was waiting for */
+static void httpd_WorkerEvent( httpd_worker_t *w, httpd_client_t *cl,
+                               bool b_error, mtime_t now )
+{
+    cl->i_activity_date = now;
 
-            if( ufd[nfd].revents == 0 )
-                continue;
+    switch( cl->i_state )
+    {
+        case HTTPD_CLIENT_RECEIVING:
+            httpd_ClientRecv( cl );
+            break;
+        case HTTPD_CLIENT_SENDING:
+            httpd_ClientSend( cl );
+            break;
+        case HTTPD_CLIENT_TLS_HS_IN:
+        case HTTPD_CLIENT_TLS_HS_OUT:
+            httpd_ClientTlsHandshake( cl );
+            break;
+        case HTTPD_CLIENT_STREAMING:
+            break;
+        default:
+            /* no I/O pending: the error would be reported forever */
+            if( b_error )
+                cl->i_state = HTTPD_CLIENT_DEAD;
+            break;
+    }
+    httpd_WorkerUpdate( w, cl );
+}
+
+static void httpd_WorkerAccept( httpd_worker_t *w, int lfd, mtime_t now )
+{
+    httpd_host_t *host = w->host;
+    int fd = vlc_accept( lfd, NULL, NULL, true );
+    if( fd == -1 )
+        return; /* most likely taken by another worker */
+
+    setsockopt( fd, SOL_SOCKET, SO_REUSEADDR, &(int){ 1 }, sizeof(int) );
+
+    vlc_tls_t *p_tls;
+
+    if( host->p_tls != NULL )
+        p_tls = vlc_tls_SessionCreate( host->p_tls, fd, NULL );
+    else
+        p_tls = NULL;
+
+    httpd_client_t *cl = httpd_ClientNew( fd, p_tls, now );
+    if( cl == NULL )
+    {
+        if( p_tls != NULL )
+            vlc_tls_SessionDelete( p_tls );
+        net_Close( fd );
+        return;
+    }
+
+#ifdef HAVE_SYS_EPOLL_H
+    struct epoll_event ev = { .events = 0, .data.ptr = cl };
+    if( epoll_ctl( w->epfd, EPOLL_CTL_ADD, fd, &ev ) )
+    {
+        msg_Err( host, "cannot watch client socket: %m" );
+        httpd_ClientClean( cl );
+        free( cl );
+        return;
+    }
+#endif
+    TAB_APPEND( w->i_client, w->client, cl );
+    httpd_WorkerUpdate( w, cl );
+}
+
+static void* httpd_WorkerThread( void *data )
+{
+    httpd_worker_t *w = data;
+    httpd_host_t *host = w->host;
+    int canc = vlc_savecancel();
+
+    for( ;; )
+    {
+        /* do not serve anything until some url is registered */
+        vlc_mutex_lock( &host->lock );
+        while( host->i_url <= 0 )
+        {
+            mutex_cleanup_push( &host->lock );
+            vlc_restorecancel( canc );
+            vlc_cond_wait( &host->wait, &host->lock );
+            canc = vlc_savecancel();
+            vlc_cleanup_pop();
+        }
+        vlc_mutex_unlock( &host->lock );
+
+        vlc_mutex_lock( &w->lock );
+        mtime_t now = mdate();
+        if( now >= w->i_sweep )
+            httpd_WorkerSweep( w, now );
 
-            /* */
-            fd = vlc_accept (fd, NULL, NULL, true);
-            if (fd == -1)
+        /* we will wait 20ms (not too big) if some clients are idle */
+        int timeout = -1;
+        if( w->b_idle )
+            timeout = ( w->i_sweep > now )
+                    ? ( w->i_sweep - now + 999 ) / 1000 : 0;
+
+#ifdef HAVE_SYS_EPOLL_H
+        struct epoll_event ev[64];
+
+        vlc_mutex_unlock( &w->lock );
+        vlc_restorecancel( canc );
+        int ret = epoll_wait( w->epfd, ev, sizeof (ev) / sizeof (ev[0]),
+                              timeout );
+        canc = vlc_savecancel();
+#else
+        struct pollfd ufd[host->nfd + w->i_client];
+        httpd_client_t *ucl[host->nfd + w->i_client];
+        unsigned nfd;
+
+        for( nfd = 0; nfd < host->nfd; nfd++ )
+        {
+            ufd[nfd].fd = host->fds[nfd];
+            ufd[nfd].events = POLLIN;
+            ufd[nfd].revents = 0;
+        }
+        for( int i = 0; i < w->i_client; i++ )
+        {
+            httpd_client_t *cl = w->client[i];
+
+            if( cl->i_events == 0 )
                 continue;
-            setsockopt (fd, SOL_SOCKET, SO_REUSEADDR,
-                        &(int){ 1 }, sizeof(int));
+            ufd[nfd].fd = cl->fd;
+            ufd[nfd].events = cl->i_events;
+            ufd[nfd].revents = 0;
+            ucl[nfd++] = cl;
+        }
 
-            vlc_tls_t *p_tls;
+        vlc_mutex_unlock( &w->lock );
+        vlc_restorecancel( canc );
+        int ret = poll( ufd, nfd, timeout );
+        canc = vlc_savecancel();
+#endif
+        if( ret == -1 )
+        {
+            if( errno != EINTR )
+            {
+                /* Kernel on low memory or a bug: pace */
+                msg_Err( host, "polling error: %m" );
+                msleep( 100000 );
+            }
+            continue;
+        }
 
-            if( host->p_tls != NULL )
-                p_tls = vlc_tls_SessionCreate( host->p_tls, fd, NULL );
-            else
-                p_tls = NULL;
+        vlc_mutex_lock( &w->lock );
+        now = mdate();
+#ifdef HAVE_SYS_EPOLL_H
+        for( int i = 0; i < ret; i++ )
+        {
+            unsigned j;
 
-            cl = httpd_ClientNew( fd, p_tls, now );
+            for( j = 0; j < host->nfd; j++ )
+                if( ev[i].data.ptr == &host->fds[j] )
+                    break;
 
-            TAB_APPEND( host->i_client, host->client, cl );
+            if( j < host->nfd )
+                httpd_WorkerAccept( w, host->fds[j], now );
+            else
+                httpd_WorkerEvent( w, ev[i].data.ptr,
+                                   ev[i].events & (EPOLLERR|EPOLLHUP), now );
         }
+#else
+        /* Handle client sockets */
+        for( unsigned i = host->nfd; ret > 0 && i < nfd; i++ )
+            if( ufd[i].revents != 0 )
+                httpd_WorkerEvent( w, ucl[i],
+                                   ufd[i].revents & (POLLERR|POLLHUP), now );
+
+        /* Handle server sockets (accept new connections) */
+        for( unsigned i = 0; ret > 0 && i < host->nfd; i++ )
+            if( ufd[i].revents != 0 )
+                httpd_WorkerAccept( w, ufd[i].fd, now );
+#endif
+        vlc_mutex_unlock( &w->lock );
     }
-    vlc_mutex_unlock( &host->lock );
     return NULL;
 }
@@ -179,7 +179,9 @@ static void input_item_changed( const vlc_event_t * p_event,
                                 void * user_data )
 {
     playlist_item_t *p_item = user_data;
-    VLC_UNUSED( p_event );
+    if( p_event->type == vlc_InputItemMetaChanged ||
+        p_event->type == vlc_InputItemNameChanged )
+        playlist_IndexUpdate( p_item->p_playlist, p_item );
     var_SetAddress( p_item->p_playlist, "item-change", p_item->p_input );
 }
 
@@ -777,6 +779,7 @@ static void AddItem( playlist_t *p_playlist, playlist_item_t *p_item,
     PL_ASSERT_LOCKED;
     ARRAY_APPEND(p_playlist->items, p_item);
     ARRAY_APPEND(p_playlist->all_items, p_item);
+    playlist_IndexAdd( p_playlist, p_item );
 
     if( i_pos == PLAYLIST_END )
         playlist_NodeAppend( p_playlist, p_item, p_node );
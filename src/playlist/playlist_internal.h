@@ -42,12 +42,14 @@
 #include "preparser.h"
 
 typedef struct vlc_sd_internal_t vlc_sd_internal_t;
+typedef struct playlist_index_t playlist_index_t;
 
 typedef struct playlist_private_t
 {
     playlist_t           public_data;
     playlist_preparser_t *p_preparser;  /**< Preparser data */
     playlist_fetcher_t   *p_fetcher;    /**< Meta and art fetcher data */
+    playlist_index_t     *p_index;      /**< Index of all_items */
 
     playlist_item_array_t items_to_delete; /**< Array of items and nodes to
             delete... At the very end. This sucks. */
@@ -129,6 +131,13 @@ playlist_item_t * playlist_NodeAddInput( playlist_t *, input_item_t *,
 int playlist_InsertInputItemTree ( playlist_t *,
         playlist_item_t *, input_item_node_t *, int, bool );
 
+/* Index of all_items, for searches */
+playlist_index_t *playlist_IndexNew( void );
+void playlist_IndexDelete( playlist_index_t * );
+void playlist_IndexAdd( playlist_t *, playlist_item_t * );
+void playlist_IndexRemove( playlist_t *, playlist_item_t * );
+void playlist_IndexUpdate( playlist_t *, playlist_item_t * );
+
 /* Tree walking */
 playlist_item_t *playlist_ItemFindFromInputAndRoot( playlist_t *p_playlist,
                                 input_item_t *p_input, playlist_item_t *p_root,
@@ -25,6 +25,11 @@
 # include "config.h"
 #endif
 
+#include <assert.h>
+#ifdef HAVE_SEARCH_H
+# include <search.h>
+#endif
+
 #include <vlc_common.h>
 #include <vlc_playlist.h>
 
@@ -37,6 +42,23 @@
 /*****************************************************************************
  * Structures/definitions
  *****************************************************************************/
+typedef struct preparser_entry_t preparser_entry_t;
+
+struct preparser_entry_t
+{
+    input_item_t      *p_item;  /**< NULL once moved to the priority queue */
+    preparser_entry_t *p_next;
+    mtime_t            i_date;  /**< date of the first push */
+    bool               b_priority;
+    bool               b_running;
+};
+
+typedef struct
+{
+    preparser_entry_t  *p_first;
+    preparser_entry_t **pp_last;
+} preparser_queue_t;
+
 struct playlist_preparser_t
 {
     vlc_object_t        *object;
@@ -44,15 +66,56 @@ struct playlist_preparser_t
 
     vlc_mutex_t     lock;
     vlc_cond_t      wait;
-    bool            b_live;
-    input_item_t  **pp_waiting;
+    preparser_queue_t priority; /**< items shown or asked for */
+    preparser_queue_t normal;
+    void           *p_entries;  /**< waiting and running entries by item */
     int             i_waiting;
+    int             i_live;     /**< number of running threads */
+    int             i_threads;  /**< maximum number of running threads */
+    mtime_t         i_timeout;
 
     int             i_art_policy;
+
+    /* Statistics since the queue was last empty */
+    unsigned        i_done;
+    unsigned        i_timeouts;
+    int             i_waiting_max;
+    mtime_t         i_latency;  /**< sum of the delays from push to done */
+    mtime_t         i_latency_max;
 };
 
 static void *Thread( void * );
 
+static int EntryCmp( const void *a, const void *b )
+{
+    const preparser_entry_t *p_a = a, *p_b = b;
+
+    return (p_a->p_item > p_b->p_item) - (p_a->p_item < p_b->p_item);
+}
+
+static void Enqueue( preparser_queue_t *p_queue, preparser_entry_t *p_entry )
+{
+    p_entry->p_next = NULL;
+    *p_queue->pp_last = p_entry;
+    p_queue->pp_last = &p_entry->p_next;
+}
+
+static preparser_entry_t *Dequeue( preparser_queue_t *p_queue )
+{
+    preparser_entry_t *p_entry;
+
+    while( (p_entry = p_queue->p_first) != NULL )
+    {
+        p_queue->p_first = p_entry->p_next;
+        if( p_queue->p_first == NULL )
+            p_queue->pp_last = &p_queue->p_first;
+        if( p_entry->p_item != NULL )
+            break;
+        free( p_entry ); /* it moved to the priority queue */
+    }
+    return p_entry;
+}
+
 /*****************************************************************************
  * Public functions
  *****************************************************************************/
@@ -67,47 +130,116 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *parent,
     p_preparser->p_fetcher = p_fetcher;
     vlc_mutex_init( &p_preparser->lock );
     vlc_cond_init( &p_preparser->wait );
-    p_preparser->b_live = false;
-    p_preparser->i_art_policy = var_InheritInteger( parent, "album-art" );
+    p_preparser->priority.p_first = NULL;
+    p_preparser->priority.pp_last = &p_preparser->priority.p_first;
+    p_preparser->normal.p_first = NULL;
+    p_preparser->normal.pp_last = &p_preparser->normal.p_first;
+    p_preparser->p_entries = NULL;
     p_preparser->i_waiting = 0;
-    p_preparser->pp_waiting = NULL;
+    p_preparser->i_live = 0;
+    p_preparser->i_threads = var_InheritInteger( parent, "preparse-threads" );
+    if( p_preparser->i_threads < 1 )
+        p_preparser->i_threads = 1;
+    p_preparser->i_timeout = var_InheritInteger( parent, "preparse-timeout" )
+                             * (CLOCK_FREQ / 1000);
+    p_preparser->i_art_policy = var_InheritInteger( parent, "album-art" );
+
+    p_preparser->i_done = 0;
+    p_preparser->i_timeouts = 0;
+    p_preparser->i_waiting_max = 0;
+    p_preparser->i_latency = 0;
+    p_preparser->i_latency_max = 0;
 
     return p_preparser;
 }
 
-void playlist_preparser_Push( playlist_preparser_t *p_preparser, input_item_t *p_item )
+void playlist_preparser_Push( playlist_preparser_t *p_preparser,
+                              input_item_t *p_item, bool b_priority )
 {
-    vlc_gc_incref( p_item );
+    preparser_entry_t key = { .p_item = p_item };
+    preparser_entry_t **pp_found, *p_entry;
 
     vlc_mutex_lock( &p_preparser->lock );
-    INSERT_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting,
-                 p_preparser->i_waiting, p_item );
-    if( !p_preparser->b_live )
+    pp_found = tfind( &key, &p_preparser->p_entries, EntryCmp );
+    if( pp_found != NULL )
+    {
+        /* Already waiting or being preparsed */
+        preparser_entry_t *p_old = *pp_found;
+
+        if( b_priority && !p_old->b_priority && !p_old->b_running &&
+            (p_entry = malloc( sizeof(*p_entry) )) != NULL )
+        {
+            *p_entry = *p_old;
+            p_entry->b_priority = true;
+            *pp_found = p_entry; /* same key, the tree stays ordered */
+            p_old->p_item = NULL;
+            Enqueue( &p_preparser->priority, p_entry );
+        }
+        vlc_mutex_unlock( &p_preparser->lock );
+        return;
+    }
+
+    p_entry = malloc( sizeof(*p_entry) );
+    if( unlikely(p_entry == NULL) )
+    {
+        vlc_mutex_unlock( &p_preparser->lock );
+        return;
+    }
+    p_entry->p_item = p_item;
+    p_entry->i_date = mdate();
+    p_entry->b_priority = b_priority;
+    p_entry->b_running = false;
+    if( unlikely(tsearch( p_entry, &p_preparser->p_entries, EntryCmp ) == NULL) )
+    {
+        vlc_mutex_unlock( &p_preparser->lock );
+        free( p_entry );
+        return;
+    }
+    vlc_gc_incref( p_item );
+    Enqueue( b_priority ? &p_preparser->priority : &p_preparser->normal,
+             p_entry );
+
+    p_preparser->i_waiting++;
+    if( p_preparser->i_waiting > p_preparser->i_waiting_max )
+        p_preparser->i_waiting_max = p_preparser->i_waiting;
+
+    if( p_preparser->i_live < p_preparser->i_threads &&
+        p_preparser->i_live < p_preparser->i_waiting )
     {
         if( vlc_clone_detach( NULL, Thread, p_preparser,
                               VLC_THREAD_PRIORITY_LOW ) )
-            msg_Warn( p_preparser->object, "cannot spawn pre-parser thread" );
+        {
+            if( p_preparser->i_live == 0 )
+                msg_Warn( p_preparser->object,
+                          "cannot spawn pre-parser thread" );
+        }
         else
-            p_preparser->b_live = true;
+            p_preparser->i_live++;
     }
     vlc_mutex_unlock( &p_preparser->lock );
 }
 
 void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 {
+    preparser_entry_t *p_entry;
+
     vlc_mutex_lock( &p_preparser->lock );
-    /* Remove pending item to speed up preparser thread exit */
-    while( p_preparser->i_waiting > 0 )
+    /* Remove pending items to speed up the exit of the threads */
+    while( (p_entry = Dequeue( &p_preparser->priority )) != NULL ||
+           (p_entry = Dequeue( &p_preparser->normal )) != NULL )
     {
-        vlc_gc_decref( p_preparser->pp_waiting[0] );
-        REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
+        tdelete( p_entry, &p_preparser->p_entries, EntryCmp );
+        vlc_gc_decref( p_entry->p_item );
+        free( p_entry );
     }
+    p_preparser->i_waiting = 0;
 
-    while( p_preparser->b_live )
+    while( p_preparser->i_live > 0 )
         vlc_cond_wait( &p_preparser->wait, &p_preparser->lock );
     vlc_mutex_unlock( &p_preparser->lock );
 
     /* Destroy the item preparser */
+    assert( p_preparser->p_entries == NULL );
     vlc_cond_destroy( &p_preparser->wait );
     vlc_mutex_destroy( &p_preparser->lock );
     free( p_preparser );
@@ -119,8 +251,11 @@ void playlist_preparser_Delete( playlist_preparser_t *p_preparser )
 /**
  * This function preparses an item when needed.
  */
-static void Preparse( vlc_object_t *obj, input_item_t *p_item )
+static int Preparse( playlist_preparser_t *p_preparser, input_item_t *p_item )
 {
+    vlc_object_t *obj = p_preparser->object;
+    int i_ret = VLC_SUCCESS;
+
     vlc_mutex_lock( &p_item->lock );
     int i_type = p_item->i_type;
     vlc_mutex_unlock( &p_item->lock );
@@ -128,17 +263,24 @@ static void Preparse( vlc_object_t *obj, input_item_t *p_item )
     if( i_type != ITEM_TYPE_FILE )
     {
         input_item_SetPreparsed( p_item, true );
-        return;
+        return VLC_SUCCESS;
     }
 
     /* Do not preparse if it is already done (like by playing it) */
     if( !input_item_IsPreparsed( p_item ) )
     {
-        input_Preparse( obj, p_item );
+        i_ret = input_Preparse( obj, p_item, p_preparser->i_timeout );
+        if( i_ret == VLC_ETIMEOUT )
+        {
+            char *psz_uri = input_item_GetURI( p_item );
+            msg_Warn( obj, "preparsing %s timed out", psz_uri );
+            free( psz_uri );
+        }
         input_item_SetPreparsed( p_item, true );
 
         var_SetAddress( obj, "item-change", p_item );
     }
+    return i_ret;
 }
 
 /**
@@ -190,35 +332,53 @@ static void Art( playlist_preparser_t *p_preparser, input_item_t *p_item )
 static void *Thread( void *data )
 {
     playlist_preparser_t *p_preparser = data;
-    vlc_object_t *obj = p_preparser->object;
 
+    vlc_mutex_lock( &p_preparser->lock );
     for( ;; )
     {
-        input_item_t *p_current;
+        preparser_entry_t *p_entry = Dequeue( &p_preparser->priority );
+        if( p_entry == NULL )
+            p_entry = Dequeue( &p_preparser->normal );
+        if( p_entry == NULL )
+            break;
 
-        /* */
-        vlc_mutex_lock( &p_preparser->lock );
-        if( p_preparser->i_waiting > 0 )
-        {
-            p_current = p_preparser->pp_waiting[0];
-            REMOVE_ELEM( p_preparser->pp_waiting, p_preparser->i_waiting, 0 );
-        }
-        else
-        {
-            p_current = NULL;
-            p_preparser->b_live = false;
-            vlc_cond_signal( &p_preparser->wait );
-        }
+        p_preparser->i_waiting--;
+        p_entry->b_running = true;
         vlc_mutex_unlock( &p_preparser->lock );
 
-        if( !p_current )
-            break;
+        int i_ret = Preparse( p_preparser, p_entry->p_item );
+        Art( p_preparser, p_entry->p_item );
 
-        Preparse( obj, p_current );
+        vlc_mutex_lock( &p_preparser->lock );
+        tdelete( p_entry, &p_preparser->p_entries, EntryCmp );
 
-        Art( p_preparser, p_current );
-        vlc_gc_decref(p_current);
+        mtime_t i_latency = mdate() - p_entry->i_date;
+        p_preparser->i_done++;
+        if( i_ret == VLC_ETIMEOUT )
+            p_preparser->i_timeouts++;
+        p_preparser->i_latency += i_latency;
+        if( i_latency > p_preparser->i_latency_max )
+            p_preparser->i_latency_max = i_latency;
+
+        vlc_gc_decref( p_entry->p_item );
+        free( p_entry );
     }
+
+    if( --p_preparser->i_live == 0 && p_preparser->i_done > 0 )
+    {
+        msg_Dbg( p_preparser->object, "preparsed %u items (%u timed out), "
+                 "up to %d waiting, in %"PRId64" ms on average and %"PRId64
+                 " ms at most since queued", p_preparser->i_done,
+                 p_preparser->i_timeouts, p_preparser->i_waiting_max,
+                 p_preparser->i_latency / p_preparser->i_done / 1000,
+                 p_preparser->i_latency_max / 1000 );
+        p_preparser->i_done = 0;
+        p_preparser->i_timeouts = 0;
+        p_preparser->i_waiting_max = 0;
+        p_preparser->i_latency = 0;
+        p_preparser->i_latency_max = 0;
+    }
+    vlc_cond_signal( &p_preparser->wait );
+    vlc_mutex_unlock( &p_preparser->lock );
     return NULL;
 }
-
@@ -29,13 +29,13 @@
  * Preparser opaque structure.
  *
  * The preparser object will retreive the meta data of any given input item in
- * an asynchronous way.
+ * an asynchronous way, with a few threads.
  * It will also issue art fetching requests.
  */
 typedef struct playlist_preparser_t playlist_preparser_t;
 
 /**
- * This function creates the preparser object and thread.
+ * This function creates the preparser object.
  */
 playlist_preparser_t *playlist_preparser_New( vlc_object_t *,
                                               playlist_fetcher_t * );
@@ -44,12 +44,14 @@ playlist_preparser_t *playlist_preparser_New( vlc_object_t *,
  * This function enqueues the provided item to be preparsed.
  *
  * The input item is retained until the preparsing is done or until the
- * preparser object is deleted.
+ * preparser object is deleted. Items with priority are preparsed before the
+ * others. An item already waiting or being preparsed is not enqueued again,
+ * but it gains priority if it is still waiting.
  */
-void playlist_preparser_Push( playlist_preparser_t *, input_item_t * );
+void playlist_preparser_Push( playlist_preparser_t *, input_item_t *, bool );
 
 /**
- * This function destroys the preparser object and thread.
+ * This function destroys the preparser object and waits for its threads.
  *
  * All pending input items will be released.
  */
@@ -24,12 +24,418 @@
 # include "config.h"
 #endif
 #include <assert.h>
+#include <wctype.h>
 
 #include <vlc_common.h>
 #include <vlc_playlist.h>
 #include <vlc_charset.h>
+#include "../libvlc.h"
 #include "playlist_internal.h"
 
+/***************************************************************************
+ * Item index
+ ***************************************************************************
+ * Every item of all_items has an entry, found from its input item through
+ * a hash table. The entry also keeps the title, artist, album and URI of
+ * the input item, lowercased, so that the live search neither locks the
+ * input items nor walks their meta data. The index has its own lock
+ * because the input item events update it without the playlist lock.
+ ***************************************************************************/
+
+typedef struct playlist_index_entry_t playlist_index_entry_t;
+
+struct playlist_index_entry_t
+{
+    playlist_item_t        *p_item;
+    playlist_index_entry_t *p_next;   /**< next entry in the same bucket */
+    int                     i_pos;    /**< position in the entries array */
+    bool                    b_match;  /**< in the matches array */
+    char                   *psz_text; /**< lowercased fields, one per line */
+};
+
+TYPEDEF_ARRAY(playlist_index_entry_t *, playlist_index_entry_array_t)
+
+struct playlist_index_t
+{
+    vlc_mutex_t lock;
+
+    playlist_index_entry_t **pp_buckets;
+    unsigned i_bits; /**< log2 of the number of buckets */
+    playlist_index_entry_array_t entries;
+    bool b_incomplete; /**< an item could not be indexed */
+
+    /* The last live search. Every entry that contains it is in the matches
+     * array, so that a longer search string only needs to look at them. */
+    char *psz_search;
+    playlist_index_entry_array_t matches;
+};
+
+static unsigned IndexHash( const playlist_index_t *p_index,
+                           const input_item_t *p_input )
+{
+    uint32_t i_hash = (uintptr_t)p_input / sizeof(void *);
+
+    return (uint32_t)(i_hash * 2654435761u) >> (32 - p_index->i_bits);
+}
+
+static size_t IndexPutc( char *p, uint32_t cp )
+{
+    if( cp < 0x80 )
+    {
+        p[0] = cp;
+        return 1;
+    }
+    if( cp < 0x800 )
+    {
+        p[0] = 0xC0 | (cp >> 6);
+        p[1] = 0x80 | (cp & 0x3F);
+        return 2;
+    }
+    if( cp < 0x10000 )
+    {
+        p[0] = 0xE0 | (cp >> 12);
+        p[1] = 0x80 | ((cp >> 6) & 0x3F);
+        p[2] = 0x80 | (cp & 0x3F);
+        return 3;
+    }
+    p[0] = 0xF0 | (cp >> 18);
+    p[1] = 0x80 | ((cp >> 12) & 0x3F);
+    p[2] = 0x80 | ((cp >> 6) & 0x3F);
+    p[3] = 0x80 | (cp & 0x3F);
+    return 4;
+}
+
+/* Lowercases an UTF-8 string code point by code point, as vlc_strcasestr()
+ * compares them, so that strstr() can be used on the result. p_dst must have
+ * room for twice the length of psz. Invalid sequences are skipped and new
+ * lines become spaces: they separate the fields of an entry. */
+static char *IndexFold( char *p_dst, const char *psz )
+{
+    for( ;; )
+    {
+        uint32_t cp;
+        size_t i_len = vlc_towc( psz, &cp );
+
+        if( i_len == 0 )
+            break;
+        if( i_len == (size_t)-1 )
+        {
+            psz++;
+            continue;
+        }
+        psz += i_len;
+
+        cp = towlower( cp );
+        p_dst += IndexPutc( p_dst, cp == '\n' ? ' ' : cp );
+    }
+    return p_dst;
+}
+
+/* Gives back the room that folding did not use */
+static char *IndexTrim( char *psz, size_t i_size )
+{
+    char *psz_trim = realloc( psz, i_size );
+    return psz_trim != NULL ? psz_trim : psz;
+}
+
+static char *IndexFoldString( const char *psz )
+{
+    char *psz_fold = malloc( 2 * strlen( psz ) + 1 );
+
+    if( psz_fold != NULL )
+    {
+        char *p = IndexFold( psz_fold, psz );
+        *p = '\0';
+        psz_fold = IndexTrim( psz_fold, p - psz_fold + 1 );
+    }
+    return psz_fold;
+}
+
+static char *IndexText( input_item_t *p_input )
+{
+    char *ppsz_field[4] = {
+        input_item_GetTitleFbName( p_input ),
+        input_item_GetArtist( p_input ),
+        input_item_GetAlbum( p_input ),
+        input_item_GetURI( p_input ),
+    };
+    size_t i_size = 1;
+
+    for( unsigned i = 0; i < 4; i++ )
+        if( ppsz_field[i] != NULL )
+            i_size += 2 * strlen( ppsz_field[i] ) + 1;
+
+    char *psz_text = malloc( i_size );
+    if( psz_text != NULL )
+    {
+        char *p = psz_text;
+
+        for( unsigned i = 0; i < 4; i++ )
+        {
+            if( ppsz_field[i] == NULL )
+                continue;
+            p = IndexFold( p, ppsz_field[i] );
+            *p++ = '\n';
+        }
+        *p = '\0';
+        psz_text = IndexTrim( psz_text, p - psz_text + 1 );
+    }
+
+    for( unsigned i = 0; i < 4; i++ )
+        free( ppsz_field[i] );
+    return psz_text;
+}
+
+static playlist_index_entry_t *IndexFind( playlist_index_t *p_index,
+                                          const playlist_item_t *p_item )
+{
+    playlist_index_entry_t *p_entry;
+
+    p_entry = p_index->pp_buckets[IndexHash( p_index, p_item->p_input )];
+    while( p_entry != NULL && p_entry->p_item != p_item )
+        p_entry = p_entry->p_next;
+    return p_entry;
+}
+
+/* Doubles the number of buckets, or keeps the current ones on failure */
+static void IndexGrow( playlist_index_t *p_index )
+{
+    playlist_index_entry_t **pp_buckets;
+
+    pp_buckets = calloc( 2u << p_index->i_bits, sizeof(*pp_buckets) );
+    if( pp_buckets == NULL )
+        return;
+
+    free( p_index->pp_buckets );
+    p_index->pp_buckets = pp_buckets;
+    p_index->i_bits++;
+    FOREACH_ARRAY( playlist_index_entry_t *p_entry, p_index->entries )
+        unsigned i_hash = IndexHash( p_index, p_entry->p_item->p_input );
+        p_entry->p_next = pp_buckets[i_hash];
+        pp_buckets[i_hash] = p_entry;
+    FOREACH_END();
+}
+
+static void IndexSearchReset( playlist_index_t *p_index )
+{
+    FOREACH_ARRAY( playlist_index_entry_t *p_entry, p_index->matches )
+        p_entry->b_match = false;
+    FOREACH_END();
+    p_index->matches.i_size = 0;
+    free( p_index->psz_search );
+    p_index->psz_search = NULL;
+}
+
+/* Adds the entry to the matches if it contains the last search string */
+static void IndexSearchEntry( playlist_index_t *p_index,
+                              playlist_index_entry_t *p_entry )
+{
+    if( p_index->psz_search != NULL && !p_entry->b_match &&
+        strstr( p_entry->psz_text, p_index->psz_search ) != NULL )
+    {
+        p_entry->b_match = true;
+        ARRAY_APPEND( p_index->matches, p_entry );
+    }
+}
+
+/* Finds the entries containing psz_string. When it contains the previous
+ * search string, only the entries that matched the previous one are
+ * searched again. The index must be locked. */
+static int IndexSearch( playlist_index_t *p_index, const char *psz_string )
+{
+    playlist_index_entry_array_t matches;
+    char *psz_search;
+
+    if( p_index->b_incomplete )
+        return VLC_EGENERIC;
+    psz_search = IndexFoldString( psz_string );
+    if( psz_search == NULL )
+        return VLC_ENOMEM;
+
+    if( p_index->psz_search != NULL &&
+        strstr( psz_search, p_index->psz_search ) != NULL )
+    {
+        matches = p_index->matches;
+    }
+    else
+    {
+        IndexSearchReset( p_index );
+        matches = p_index->entries;
+    }
+
+    playlist_index_entry_array_t found;
+    ARRAY_INIT( found );
+    FOREACH_ARRAY( playlist_index_entry_t *p_entry, matches )
+        p_entry->b_match = strstr( p_entry->psz_text, psz_search ) != NULL;
+        if( p_entry->b_match )
+            ARRAY_APPEND( found, p_entry );
+    FOREACH_END();
+
+    ARRAY_RESET( p_index->matches );
+    p_index->matches = found;
+    free( p_index->psz_search );
+    p_index->psz_search = psz_search;
+    return VLC_SUCCESS;
+}
+
+playlist_index_t *playlist_IndexNew( void )
+{
+    playlist_index_t *p_index = malloc( sizeof(*p_index) );
+    if( p_index == NULL )
+        return NULL;
+
+    p_index->i_bits = 10;
+    p_index->pp_buckets = calloc( 1u << p_index->i_bits,
+                                  sizeof(*p_index->pp_buckets) );
+    if( p_index->pp_buckets == NULL )
+    {
+        free( p_index );
+        return NULL;
+    }
+    vlc_mutex_init( &p_index->lock );
+    ARRAY_INIT( p_index->entries );
+    p_index->b_incomplete = false;
+    p_index->psz_search = NULL;
+    ARRAY_INIT( p_index->matches );
+    return p_index;
+}
+
+void playlist_IndexDelete( playlist_index_t *p_index )
+{
+    if( p_index == NULL )
+        return;
+
+    FOREACH_ARRAY( playlist_index_entry_t *p_entry, p_index->entries )
+        free( p_entry->psz_text );
+        free( p_entry );
+    FOREACH_END();
+    ARRAY_RESET( p_index->entries );
+    ARRAY_RESET( p_index->matches );
+    free( p_index->psz_search );
+    free( p_index->pp_buckets );
+    vlc_mutex_destroy( &p_index->lock );
+    free( p_index );
+}
+
+/**
+ * Index an item added to all_items
+ * The playlist have to be locked
+ */
+void playlist_IndexAdd( playlist_t *p_playlist, playlist_item_t *p_item )
+{
+    playlist_index_t *p_index = pl_priv(p_playlist)->p_index;
+    PL_ASSERT_LOCKED;
+    if( p_index == NULL )
+        return;
+
+    playlist_index_entry_t *p_entry = malloc( sizeof(*p_entry) );
+    char *psz_text = IndexText( p_item->p_input );
+
+    vlc_mutex_lock( &p_index->lock );
+    if( unlikely(p_entry == NULL || psz_text == NULL) )
+    {
+        /* lookups and searches now walk the playlist */
+        p_index->b_incomplete = true;
+        vlc_mutex_unlock( &p_index->lock );
+        free( psz_text );
+        free( p_entry );
+        return;
+    }
+
+    if( (unsigned)p_index->entries.i_size >= (1u << p_index->i_bits) &&
+        p_index->i_bits < 24 )
+        IndexGrow( p_index );
+
+    p_entry->p_item = p_item;
+    p_entry->psz_text = psz_text;
+    p_entry->b_match = false;
+    p_entry->i_pos = p_index->entries.i_size;
+    ARRAY_APPEND( p_index->entries, p_entry );
+
+    unsigned i_hash = IndexHash( p_index, p_item->p_input );
+    p_entry->p_next = p_index->pp_buckets[i_hash];
+    p_index->pp_buckets[i_hash] = p_entry;
+
+    IndexSearchEntry( p_index, p_entry );
+    vlc_mutex_unlock( &p_index->lock );
+}
+
+/**
+ * Remove an item removed from all_items from the index
+ * The playlist have to be locked
+ */
+void playlist_IndexRemove( playlist_t *p_playlist, playlist_item_t *p_item )
+{
+    playlist_index_t *p_index = pl_priv(p_playlist)->p_index;
+    PL_ASSERT_LOCKED;
+    if( p_index == NULL )
+        return;
+
+    vlc_mutex_lock( &p_index->lock );
+    playlist_index_entry_t **pp_entry =
+        &p_index->pp_buckets[IndexHash( p_index, p_item->p_input )];
+    while( *pp_entry != NULL && (*pp_entry)->p_item != p_item )
+        pp_entry = &(*pp_entry)->p_next;
+
+    playlist_index_entry_t *p_entry = *pp_entry;
+    if( p_entry == NULL )
+    {
+        vlc_mutex_unlock( &p_index->lock );
+        return;
+    }
+    *pp_entry = p_entry->p_next;
+
+    /* the last entry takes its place */
+    playlist_index_entry_t *p_last =
+        ARRAY_VAL( p_index->entries, p_index->entries.i_size - 1 );
+    ARRAY_VAL( p_index->entries, p_entry->i_pos ) = p_last;
+    p_last->i_pos = p_entry->i_pos;
+    p_index->entries.i_size--;
+
+    if( p_entry->b_match )
+    {
+        for( int i = 0; i < p_index->matches.i_size; i++ )
+        {
+            if( ARRAY_VAL( p_index->matches, i ) == p_entry )
+            {
+                ARRAY_REMOVE( p_index->matches, i );
+                break;
+            }
+        }
+    }
+    vlc_mutex_unlock( &p_index->lock );
+
+    free( p_entry->psz_text );
+    free( p_entry );
+}
+
+/**
+ * Update the index after a change of the meta data of an item
+ * This is called from the input item events, without the playlist lock.
+ */
+void playlist_IndexUpdate( playlist_t *p_playlist, playlist_item_t *p_item )
+{
+    playlist_index_t *p_index = pl_priv(p_playlist)->p_index;
+    if( p_index == NULL )
+        return;
+
+    char *psz_text = IndexText( p_item->p_input );
+    if( unlikely(psz_text == NULL) )
+        return;
+
+    vlc_mutex_lock( &p_index->lock );
+    playlist_index_entry_t *p_entry = IndexFind( p_index, p_item );
+    if( p_entry != NULL )
+    {
+        free( p_entry->psz_text );
+        p_entry->psz_text = psz_text;
+        psz_text = NULL;
+        IndexSearchEntry( p_index, p_entry );
+    }
+    vlc_mutex_unlock( &p_index->lock );
+    free( psz_text );
+}
+
 /***************************************************************************
  * Item search functions
  ***************************************************************************/
@@ -69,7 +475,31 @@ playlist_item_t* playlist_ItemGetByInput( playlist_t * p_playlist,
     {
         return get_current_status_item( p_playlist );
     }
-    /** \todo Check if this is always incremental and whether we can bsearch */
+
+    playlist_index_t *p_index = pl_priv(p_playlist)->p_index;
+    if( p_index != NULL )
+    {
+        vlc_mutex_lock( &p_index->lock );
+        if( !p_index->b_incomplete )
+        {
+            /* The same input can be in several items, return the first one
+             * of all_items, as the linear search below */
+            playlist_item_t *p_found = NULL;
+            playlist_index_entry_t *p_entry =
+                p_index->pp_buckets[IndexHash( p_index, p_item )];
+
+            for( ; p_entry != NULL; p_entry = p_entry->p_next )
+            {
+                if( p_entry->p_item->p_input == p_item &&
+                    ( p_found == NULL || p_entry->p_item->i_id < p_found->i_id ) )
+                    p_found = p_entry->p_item;
+            }
+            vlc_mutex_unlock( &p_index->lock );
+            return p_found;
+        }
+        vlc_mutex_unlock( &p_index->lock );
+    }
+
     for( i =  0 ; i < p_playlist->all_items.i_size; i++ )
     {
         if( ARRAY_VAL(p_playlist->all_items, i)->p_input == p_item )
@@ -156,6 +586,43 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
 
 
 
+/**
+ * Enable/Disable items in the playlist according to the last index search
+ * @param p_index: the locked index
+ * @param p_root: the current root item
+ * @return true if an item match
+ */
+static bool playlist_LiveSearchApply( playlist_index_t *p_index,
+                                      playlist_item_t *p_root,
+                                      bool b_recursive )
+{
+    bool b_match = false;
+    for( int i = 0 ; i < p_root->i_children ; i ++ )
+    {
+        bool b_enable = false;
+        playlist_item_t *p_item = p_root->pp_children[i];
+        if( b_recursive && p_item->i_children >= 0 &&
+            playlist_LiveSearchApply( p_index, p_item, true ) )
+        {
+            b_enable = true;
+        }
+
+        if( !b_enable )
+        {
+            playlist_index_entry_t *p_entry = IndexFind( p_index, p_item );
+            b_enable = p_entry != NULL && p_entry->b_match;
+        }
+
+        if( b_enable )
+            p_item->i_flags &= ~PLAYLIST_DBL_FLAG;
+        else
+            p_item->i_flags |= PLAYLIST_DBL_FLAG;
+
+        b_match |= b_enable;
+    }
+    return b_match;
+}
+
 /**
  * Launch the recursive search in the playlist
  * @param p_playlist: the playlist
@@ -166,12 +633,23 @@ static bool playlist_LiveSearchUpdateInternal( playlist_item_t *p_root,
 int playlist_LiveSearchUpdate( playlist_t *p_playlist, playlist_item_t *p_root,
                                const char *psz_string, bool b_recursive )
 {
+    playlist_index_t *p_index = pl_priv(p_playlist)->p_index;
     PL_ASSERT_LOCKED;
     pl_priv(p_playlist)->b_reset_currently_playing = true;
-    if( *psz_string )
-        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive );
-    else
+    if( p_index != NULL )
+        vlc_mutex_lock( &p_index->lock );
+    if( !*psz_string )
+    {
+        if( p_index != NULL )
+            IndexSearchReset( p_index );
         playlist_LiveSearchClean( p_root );
+    }
+    else if( p_index != NULL && IndexSearch( p_index, psz_string ) == VLC_SUCCESS )
+        playlist_LiveSearchApply( p_index, p_root, b_recursive );
+    else
+        playlist_LiveSearchUpdateInternal( p_root, psz_string, b_recursive );
+    if( p_index != NULL )
+        vlc_mutex_unlock( &p_index->lock );
     vlc_cond_signal( &pl_priv(p_playlist)->signal );
     return VLC_SUCCESS;
 }
@@ -0,0 +1,215 @@
+/*****************************************************************************
+ * csa.c: test for the batched CSA scrambler
+ *****************************************************************************
+ * Copyright (C) 2013 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#define MODULE_STRING "test_csa"
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+/* The bitsliced stream cyphers are static */
+#include "../../../modules/mux/mpeg/csa.c"
+
+/* Every batched version is checked against csa_Encrypt(), on packets with
+ * random adaptation fields, sizes and batch lengths. With --bench, the
+ * throughput of each version is printed too. */
+typedef struct
+{
+    const char *psz_name;
+    csa_bs_stream_t pf_stream;
+    int i_batch;
+    bool b_available;
+} cypher_t;
+
+static cypher_t cyphers[] = {
+    { "c", csa_bs_Stream_c, 64, true },
+#ifdef __SSE2__
+    { "sse2", csa_bs_Stream_sse2, 128, true },
+#endif
+#ifdef HAVE_AVX2_INTRINSICS
+    { "avx2", csa_bs_Stream_avx2, 256, false },
+#endif
+};
+
+static uint8_t pkts[2][CSA_BATCH_MAX][188];
+
+static void RandomPackets( int i_pkts, int i_pkt_size )
+{
+    for( int i = 0; i < i_pkts; i++ )
+    {
+        uint8_t *p = pkts[0][i];
+
+        for( int j = 0; j < i_pkt_size; j++ )
+            p[j] = rand();
+        p[0] = 0x47;
+        /* unscrambled, with or without an adaptation field */
+        p[3] = (p[3] & 0x0f) | ((rand() & 1) ? 0x30 : 0x10);
+        p[4] = rand() % (i_pkt_size - 4);
+        memcpy( pkts[1][i], p, i_pkt_size );
+    }
+}
+
+/* Scrambles pkts[1] with the given stream cypher, as csa_EncryptPackets()
+ * would if it were the best one available */
+static void EncryptPackets( csa_t *c, const cypher_t *s, int i_pkts,
+                            int i_pkt_size )
+{
+    uint8_t *pp_data[CSA_BATCH_MAX];
+    int     pi_size[CSA_BATCH_MAX];
+    int     i_lanes = 0;
+
+    for( int i = 0; i < i_pkts; i++ )
+    {
+        int i_hdr = csa_EncryptBlocks( c, pkts[1][i], i_pkt_size );
+        if( i_hdr < 0 )
+            continue;
+        pp_data[i_lanes] = &pkts[1][i][i_hdr];
+        pi_size[i_lanes] = i_pkt_size - i_hdr;
+        i_lanes++;
+    }
+    if( i_lanes > 0 )
+        s->pf_stream( c->use_odd ? c->o_ck : c->e_ck, pp_data, pi_size,
+                      i_lanes );
+}
+
+static void Compare( int i_pkts, int i_pkt_size, const char *psz_name )
+{
+    for( int i = 0; i < i_pkts; i++ )
+    {
+        if( memcmp( pkts[0][i], pkts[1][i], i_pkt_size ) )
+        {
+            log( "  %s: packet %d/%d of %d bytes differs\n", psz_name,
+                 i, i_pkts, i_pkt_size );
+            abort();
+        }
+    }
+}
+
+static void test_csa( vlc_object_t *p_obj, csa_t *c )
+{
+    uint8_t *pp_pkts[CSA_BATCH_MAX];
+
+    for( int i = 0; i < CSA_BATCH_MAX; i++ )
+        pp_pkts[i] = pkts[1][i];
+
+    for( int i_test = 0; i_test < 200; i_test++ )
+    {
+        const int i_pkt_size = 12 + rand() % (188 - 12 + 1);
+        const int i_pkts = 1 + rand() % CSA_BATCH_MAX;
+
+        csa_UseKey( p_obj, c, rand() & 1 );
+
+        /* the public function, whatever its implementation */
+        RandomPackets( i_pkts, i_pkt_size );
+        for( int i = 0; i < i_pkts; i++ )
+            csa_Encrypt( c, pkts[0][i], i_pkt_size );
+        csa_EncryptPackets( c, pp_pkts, i_pkts, i_pkt_size );
+        Compare( i_pkts, i_pkt_size, "csa_EncryptPackets" );
+
+        /* and the descrambler gives the original packets back */
+        for( int i = 0; i < i_pkts; i++ )
+            csa_Decrypt( c, pkts[0][i], i_pkt_size );
+
+        for( unsigned j = 0; j < sizeof(cyphers) / sizeof(cyphers[0]); j++ )
+        {
+            const cypher_t *s = &cyphers[j];
+            const int i_lanes = __MIN( i_pkts, s->i_batch );
+
+            if( !s->b_available )
+                continue;
+
+            memcpy( pkts[1], pkts[0], sizeof(pkts[0]) );
+            for( int i = 0; i < i_lanes; i++ )
+            {
+                if( pkts[0][i][3] & 0x80 )
+                    abort(); /* not descrambled */
+                csa_Encrypt( c, pkts[0][i], i_pkt_size );
+            }
+            EncryptPackets( c, s, i_lanes, i_pkt_size );
+            Compare( i_lanes, i_pkt_size, s->psz_name );
+
+            for( int i = 0; i < i_lanes; i++ )
+                csa_Decrypt( c, pkts[0][i], i_pkt_size );
+        }
+    }
+}
+
+static void bench_csa( csa_t *c )
+{
+    const int i_count = 100 * CSA_BATCH_MAX;
+    mtime_t i_start;
+
+    RandomPackets( CSA_BATCH_MAX, 188 );
+    i_start = mdate();
+    for( int i = 0; i < i_count; i++ )
+        csa_Encrypt( c, pkts[0][i % CSA_BATCH_MAX], 188 );
+    log( "  scalar: %.1f MB/s\n",
+         (double)i_count * 188 / (mdate() - i_start) );
+
+    for( unsigned j = 0; j < sizeof(cyphers) / sizeof(cyphers[0]); j++ )
+    {
+        const cypher_t *s = &cyphers[j];
+
+        if( !s->b_available )
+            continue;
+        i_start = mdate();
+        for( int i = 0; i < i_count; i += s->i_batch )
+            EncryptPackets( c, s, s->i_batch, 188 );
+        log( "  %s: %.1f MB/s\n", s->psz_name,
+             (double)i_count * 188 / (mdate() - i_start) );
+    }
+}
+
+int main( int argc, char **argv )
+{
+    const bool b_bench = argc > 1 && !strcmp( argv[1], "--bench" );
+
+    test_init();
+
+#ifdef HAVE_AVX2_INTRINSICS
+    /* the last one */
+    cyphers[sizeof(cyphers) / sizeof(cyphers[0]) - 1].b_available =
+        vlc_CPU_AVX2();
+#endif
+
+    libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs,
+                                           test_defaults_args );
+    assert( p_vlc != NULL );
+    vlc_object_t *p_obj = VLC_OBJECT( p_vlc->p_libvlc_int );
+
+    csa_t *c = csa_New();
+    assert( c != NULL );
+    if( csa_SetCW( p_obj, c, (char *)"0x0123456789abcdef", false )
+     || csa_SetCW( p_obj, c, (char *)"fedcba9876543210", true ) )
+        abort();
+
+    log( "Testing the batched CSA scrambler\n" );
+    test_csa( p_obj, c );
+
+    if( b_bench )
+    {
+        log( "Scrambling 188 bytes packets\n" );
+        bench_csa( c );
+    }
+
+    csa_Delete( c );
+    libvlc_release( p_vlc );
+    return 0;
+}
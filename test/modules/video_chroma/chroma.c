@@ -0,0 +1,275 @@
+/*****************************************************************************
+ * chroma.c: bit-exactness test for the video chroma converters
+ *****************************************************************************
+ * Copyright (C) 2013 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#define MODULE_STRING "test_chroma"
+
+#include "../../libvlc/test.h"
+#include "../lib/libvlc_internal.h"
+
+#include <vlc_common.h>
+#include <vlc_filter.h>
+#include <vlc_picture.h>
+
+/* Every converter is checked against a plain C version written below, on
+ * sizes that are not multiples of the SIMD widths and with the margins of
+ * the pictures filled with garbage. */
+static const struct { int i_width, i_height; } sizes[] = {
+    { 640, 480 }, { 98, 66 }, { 34, 2 }, { 2, 70 }, { 720, 576 },
+};
+
+typedef uint8_t (*reference_t)( const picture_t *, int i_plane,
+                                int i_x, int i_y );
+
+/*****************************************************************************
+ * Reference conversions: return one byte of the output picture
+ *****************************************************************************/
+static uint8_t Sample( const picture_t *p_pic, int i_plane, int i_x, int i_y )
+{
+    return p_pic->p[i_plane].p_pixels[i_y * p_pic->p[i_plane].i_pitch + i_x];
+}
+
+/* Planar to packed, the chroma line is i_y >> i_vshift */
+static uint8_t ToPacked( const picture_t *p_in, int i_x, int i_y,
+                         int i_vshift, const char *psz_order )
+{
+    switch( psz_order[i_x % 4] )
+    {
+        case 'Y':
+            return Sample( p_in, Y_PLANE, i_x / 2, i_y );
+        case 'U':
+            return Sample( p_in, U_PLANE, i_x / 4, i_y >> i_vshift );
+        default:
+            return Sample( p_in, V_PLANE, i_x / 4, i_y >> i_vshift );
+    }
+}
+
+#define PACKED_REFERENCE( name, vshift, order ) \
+    static uint8_t name( const picture_t *p_in, int i_plane, \
+                         int i_x, int i_y ) \
+    { \
+        (void)i_plane; \
+        return ToPacked( p_in, i_x, i_y, vshift, order ); \
+    }
+PACKED_REFERENCE( I420_YUY2, 1, "YUYV" )
+PACKED_REFERENCE( I420_YVYU, 1, "YVYU" )
+PACKED_REFERENCE( I420_UYVY, 1, "UYVY" )
+PACKED_REFERENCE( I422_YUY2, 0, "YUYV" )
+PACKED_REFERENCE( I422_YVYU, 0, "YVYU" )
+PACKED_REFERENCE( I422_UYVY, 0, "UYVY" )
+
+/* Packed 4:2:2 to planar 4:2:0, the chroma comes from the even lines */
+static uint8_t FromPacked( const picture_t *p_in, int i_plane, int i_x,
+                           int i_y, const char *psz_order )
+{
+    const char c = "YUV"[i_plane];
+    int i_offset = strchr( psz_order, c ) - psz_order;
+
+    if( i_plane == Y_PLANE )
+        return Sample( p_in, 0, 4 * (i_x / 2) + i_offset + 2 * (i_x % 2), i_y );
+    return Sample( p_in, 0, 4 * i_x + i_offset, 2 * i_y );
+}
+
+#define PLANAR_REFERENCE( name, order ) \
+    static uint8_t name( const picture_t *p_in, int i_plane, \
+                         int i_x, int i_y ) \
+    { \
+        return FromPacked( p_in, i_plane, i_x, i_y, order ); \
+    }
+PLANAR_REFERENCE( YUY2_I420, "YUYV" )
+PLANAR_REFERENCE( YVYU_I420, "YVYU" )
+PLANAR_REFERENCE( UYVY_I420, "UYVY" )
+
+static uint8_t NV12_I420( const picture_t *p_in, int i_plane,
+                          int i_x, int i_y )
+{
+    if( i_plane == Y_PLANE )
+        return Sample( p_in, 0, i_x, i_y );
+    return Sample( p_in, 1, 2 * i_x + i_plane - 1, i_y );
+}
+
+static uint8_t NV21_YV12( const picture_t *p_in, int i_plane,
+                          int i_x, int i_y )
+{
+    /* Both the input and the output have V first */
+    return NV12_I420( p_in, i_plane, i_x, i_y );
+}
+
+static uint8_t I420_10L_I420( const picture_t *p_in, int i_plane,
+                              int i_x, int i_y )
+{
+    const uint8_t *p = &p_in->p[i_plane].p_pixels[i_y * p_in->p[i_plane].i_pitch
+                                                  + 2 * i_x];
+    unsigned i_value = ((p[0] | (p[1] << 8)) + 2) >> 2;
+
+    return __MIN( i_value, 255 );
+}
+
+/*****************************************************************************
+ * Test driver
+ *****************************************************************************/
+static picture_t *NewPicture( filter_t *p_filter )
+{
+    return picture_NewFromFormat( &p_filter->fmt_out.video );
+}
+
+static void DelPicture( filter_t *p_filter, picture_t *p_pic )
+{
+    (void)p_filter;
+    picture_Release( p_pic );
+}
+
+static int AllocationInit( filter_t *p_filter, void *p_data )
+{
+    (void)p_data;
+    p_filter->pf_video_buffer_new = NewPicture;
+    p_filter->pf_video_buffer_del = DelPicture;
+    return VLC_SUCCESS;
+}
+
+static void Check( libvlc_int_t *p_libvlc, const char *psz_module,
+                   vlc_fourcc_t i_in, vlc_fourcc_t i_out,
+                   reference_t pf_reference )
+{
+    for( unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++ )
+    {
+        es_format_t fmt_in, fmt_out;
+
+        es_format_Init( &fmt_in, VIDEO_ES, i_in );
+        video_format_Setup( &fmt_in.video, i_in,
+                            sizes[i].i_width, sizes[i].i_height, 1, 1 );
+        es_format_Init( &fmt_out, VIDEO_ES, i_out );
+        video_format_Setup( &fmt_out.video, i_out,
+                            sizes[i].i_width, sizes[i].i_height, 1, 1 );
+
+        filter_chain_t *p_chain = filter_chain_New( p_libvlc, "video filter2",
+                                                    false, AllocationInit,
+                                                    NULL, NULL );
+        assert( p_chain != NULL );
+        filter_chain_Reset( p_chain, &fmt_in, &fmt_out );
+
+        if( filter_chain_AppendFilter( p_chain, psz_module, NULL,
+                                       &fmt_in, &fmt_out ) == NULL )
+        {
+            /* SIMD modules are not built on every architecture */
+            log( "  %s not available, skipping\n", psz_module );
+            filter_chain_Delete( p_chain );
+            return;
+        }
+        log( "  %s %4.4s to %4.4s, %dx%d\n", psz_module,
+             (const char *)&i_in, (const char *)&i_out,
+             sizes[i].i_width, sizes[i].i_height );
+
+        picture_t *p_in = picture_NewFromFormat( &fmt_in.video );
+        assert( p_in != NULL );
+        for( int j = 0; j < p_in->i_planes; j++ )
+            for( int k = 0; k < p_in->p[j].i_lines * p_in->p[j].i_pitch; k++ )
+                p_in->p[j].p_pixels[k] = rand();
+
+        picture_t *p_out = filter_chain_VideoFilter( p_chain,
+                                                     picture_Hold( p_in ) );
+        assert( p_out != NULL );
+
+        for( int j = 0; j < p_out->i_planes; j++ )
+        {
+            const plane_t *p_plane = &p_out->p[j];
+
+            for( int y = 0; y < p_plane->i_visible_lines; y++ )
+                for( int x = 0; x < p_plane->i_visible_pitch; x++ )
+                {
+                    uint8_t i_ref = pf_reference( p_in, j, x, y );
+                    uint8_t i_val = p_plane->p_pixels[y * p_plane->i_pitch + x];
+                    if( i_ref != i_val )
+                    {
+                        log( "  mismatch in plane %d at %d,%d: "
+                             "got %u, expected %u\n", j, x, y, i_val, i_ref );
+                        abort();
+                    }
+                }
+        }
+
+        picture_Release( p_out );
+        picture_Release( p_in );
+        filter_chain_Delete( p_chain );
+        es_format_Clean( &fmt_out );
+        es_format_Clean( &fmt_in );
+    }
+}
+
+static void test_chroma( libvlc_int_t *p_libvlc )
+{
+    static const char *const i420_yuy2[] = {
+        "i420_yuy2", "i420_yuy2_sse2",
+    };
+    static const char *const i422_yuy2[] = {
+        "i422_yuy2", "i422_yuy2_sse2",
+    };
+
+    for( unsigned i = 0; i < 2; i++ )
+    {
+        Check( p_libvlc, i420_yuy2[i], VLC_CODEC_I420, VLC_CODEC_YUYV,
+               I420_YUY2 );
+        Check( p_libvlc, i420_yuy2[i], VLC_CODEC_I420, VLC_CODEC_YVYU,
+               I420_YVYU );
+        Check( p_libvlc, i420_yuy2[i], VLC_CODEC_I420, VLC_CODEC_UYVY,
+               I420_UYVY );
+        Check( p_libvlc, i422_yuy2[i], VLC_CODEC_I422, VLC_CODEC_YUYV,
+               I422_YUY2 );
+        Check( p_libvlc, i422_yuy2[i], VLC_CODEC_I422, VLC_CODEC_YVYU,
+               I422_YVYU );
+        Check( p_libvlc, i422_yuy2[i], VLC_CODEC_I422, VLC_CODEC_UYVY,
+               I422_UYVY );
+    }
+    Check( p_libvlc, "yuy2_i420", VLC_CODEC_YUYV, VLC_CODEC_I420, YUY2_I420 );
+    Check( p_libvlc, "yuy2_i420", VLC_CODEC_YVYU, VLC_CODEC_I420, YVYU_I420 );
+    Check( p_libvlc, "yuy2_i420", VLC_CODEC_UYVY, VLC_CODEC_I420, UYVY_I420 );
+    Check( p_libvlc, "nv12_i420", VLC_CODEC_NV12, VLC_CODEC_I420, NV12_I420 );
+    Check( p_libvlc, "nv12_i420", VLC_CODEC_NV21, VLC_CODEC_YV12, NV21_YV12 );
+    Check( p_libvlc, "i420_10_i420", VLC_CODEC_I420_10L, VLC_CODEC_I420,
+           I420_10L_I420 );
+}
+
+int main( void )
+{
+    /* Run everything once on a single thread, then split in slices */
+    static const char *const threads[] = {
+        "--filter-threads=1", "--filter-threads=3",
+    };
+
+    test_init();
+
+    for( unsigned i = 0; i < 2; i++ )
+    {
+        const char *args[test_defaults_nargs + 1];
+
+        memcpy( args, test_defaults_args, sizeof(test_defaults_args) );
+        args[test_defaults_nargs] = threads[i];
+
+        log( "Testing the chroma converters with %s\n", threads[i] );
+        libvlc_instance_t *p_vlc = libvlc_new( test_defaults_nargs + 1, args );
+        assert( p_vlc != NULL );
+
+        test_chroma( p_vlc->p_libvlc_int );
+
+        libvlc_release( p_vlc );
+    }
+
+    return 0;
+}
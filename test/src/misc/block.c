@@ -0,0 +1,180 @@
+/*****************************************************************************
+ * block.c: test for the shared (copy-on-write) blocks
+ *****************************************************************************
+ * Copyright (C) 2013 the VideoLAN team
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston MA 02110-1301, USA.
+ *****************************************************************************/
+
+#include <string.h>
+
+#include "../../libvlc/test.h"
+
+#include <vlc_common.h>
+#include <vlc_block.h>
+
+static const char payload[] = "0123456789abcdef";
+
+/* Payload owner that counts its releases */
+static unsigned i_released;
+
+static void OwnerRelease( block_t *p_block )
+{
+    i_released++;
+    free( p_block );
+}
+
+static block_t *OwnerNew( void )
+{
+    block_t *p_block = malloc( sizeof( *p_block ) + 64 + sizeof( payload ) );
+    assert( p_block != NULL );
+
+    block_Init( p_block, p_block + 1, 64 + sizeof( payload ) );
+    p_block->p_buffer += 64;
+    p_block->i_buffer = sizeof( payload );
+    memcpy( p_block->p_buffer, payload, sizeof( payload ) );
+    p_block->i_dts = 42;
+    p_block->pf_release = OwnerRelease;
+    return p_block;
+}
+
+static void test_block_Duplicate( void )
+{
+    block_t *p_owner = OwnerNew();
+    i_released = 0;
+
+    block_t *p_view = block_Share( p_owner );
+    assert( p_view != p_owner );
+    assert( block_IsShared( p_view ) );
+    assert( p_view->p_buffer == p_owner->p_buffer );
+    assert( p_view->i_dts == 42 );
+
+    /* duplicates are references on the same payload */
+    block_t *p_dup1 = block_Duplicate( p_view );
+    block_t *p_dup2 = block_Duplicate( p_dup1 );
+    assert( block_IsShared( p_dup1 ) && block_IsShared( p_dup2 ) );
+    assert( p_dup1->p_buffer == p_owner->p_buffer );
+    assert( p_dup2->p_buffer == p_owner->p_buffer );
+    assert( p_dup2->i_dts == 42 );
+
+    /* the payload lives until its last reference */
+    block_Release( p_dup1 );
+    block_Release( p_view );
+    assert( i_released == 0 );
+    block_Release( p_dup2 );
+    assert( i_released == 1 );
+
+    /* plain blocks are still copied */
+    block_t *p_plain = block_Alloc( sizeof( payload ) );
+    memcpy( p_plain->p_buffer, payload, sizeof( payload ) );
+    block_t *p_copy = block_Duplicate( p_plain );
+    assert( !block_IsShared( p_copy ) );
+    assert( p_copy->p_buffer != p_plain->p_buffer );
+    assert( !memcmp( p_copy->p_buffer, payload, sizeof( payload ) ) );
+    block_Release( p_copy );
+    block_Release( p_plain );
+}
+
+static void test_block_Writable( void )
+{
+    block_t *p_owner = OwnerNew();
+    i_released = 0;
+
+    block_t *p_view = block_Share( p_owner );
+    block_t *p_dup = block_Duplicate( p_view );
+
+    /* another reference is left: the payload is copied */
+    block_t *p_priv = block_Writable( p_dup );
+    assert( !block_IsShared( p_priv ) );
+    assert( p_priv->p_buffer != p_owner->p_buffer );
+    assert( !memcmp( p_priv->p_buffer, payload, sizeof( payload ) ) );
+    assert( p_priv->i_dts == 42 );
+    p_priv->p_buffer[0] = 'X';
+    assert( p_owner->p_buffer[0] == '0' );
+    block_Release( p_priv );
+    assert( i_released == 0 );
+
+    /* last reference: the owner is given back, trimmed like the view */
+    p_view = block_Realloc( p_view, -2, p_view->i_buffer );
+    p_priv = block_Writable( p_view );
+    assert( p_priv == p_owner );
+    assert( p_priv->i_buffer == sizeof( payload ) - 2 );
+    assert( !memcmp( p_priv->p_buffer, payload + 2, sizeof( payload ) - 2 ) );
+    assert( i_released == 0 );
+    block_Release( p_priv );
+    assert( i_released == 1 );
+
+    /* plain blocks are already writable */
+    block_t *p_plain = block_Alloc( 16 );
+    assert( block_Writable( p_plain ) == p_plain );
+    block_Release( p_plain );
+}
+
+static void test_block_Realloc( void )
+{
+    block_t *p_owner = OwnerNew();
+    uint8_t *p_payload = p_owner->p_buffer;
+    i_released = 0;
+
+    block_t *p_view = block_Share( p_owner );
+    block_t *p_dup = block_Duplicate( p_view );
+
+    /* the first view prepends in the head room, without copying */
+    p_view = block_Realloc( p_view, 4, p_view->i_buffer );
+    assert( block_IsShared( p_view ) );
+    assert( p_view->p_buffer + 4 == p_payload );
+    assert( p_view->i_buffer == sizeof( payload ) + 4 );
+    memcpy( p_view->p_buffer, "head", 4 );
+
+    /* a second one would overwrite that header: it gets a copy */
+    p_dup = block_Realloc( p_dup, 4, p_dup->i_buffer );
+    assert( !block_IsShared( p_dup ) );
+    assert( p_dup->p_buffer + 4 != p_payload );
+    assert( !memcmp( p_dup->p_buffer + 4, payload, sizeof( payload ) ) );
+    memcpy( p_dup->p_buffer, "HEAD", 4 );
+    assert( !memcmp( p_view->p_buffer, "head", 4 ) );
+    block_Release( p_dup );
+
+    /* so does growing the payload */
+    p_view = block_Realloc( p_view, 0, p_view->i_buffer + 1 );
+    assert( !block_IsShared( p_view ) );
+    assert( !memcmp( p_view->p_buffer, "head", 4 ) );
+    assert( !memcmp( p_view->p_buffer + 4, payload, sizeof( payload ) ) );
+    block_Release( p_view );
+    assert( i_released == 1 );
+
+    /* a block without head room is given some when it is shared */
+    block_t *p_heap = block_heap_Alloc( strdup( payload ), sizeof( payload ) );
+    p_view = block_Share( p_heap );
+    assert( block_IsShared( p_view ) );
+    assert( !memcmp( p_view->p_buffer, payload, sizeof( payload ) ) );
+    p_payload = p_view->p_buffer;
+    p_view = block_Realloc( p_view, 16, p_view->i_buffer );
+    assert( p_view->p_buffer + 16 == p_payload );
+    block_Release( p_view );
+}
+
+int main( void )
+{
+    log( "Testing block_Duplicate()\n" );
+    test_block_Duplicate();
+    log( "Testing block_Writable()\n" );
+    test_block_Writable();
+    log( "Testing block_Realloc() on shared blocks\n" );
+    test_block_Realloc();
+
+    return 0;
+}